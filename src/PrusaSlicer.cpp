@@ -26,6 +26,7 @@
 #include <boost/filesystem.hpp>
 #include <boost/nowide/args.hpp>
 #include <boost/nowide/cenv.hpp>
+#include <boost/nowide/cstdio.hpp>
 #include <boost/nowide/iostream.hpp>
 #include <boost/nowide/integration/filesystem.hpp>
 #include <boost/dll/runtime_symbol_info.hpp>
@@ -36,6 +37,8 @@
 #include "libslic3r/Config.hpp"
 #include "libslic3r/Geometry.hpp"
 #include "libslic3r/GCode/PostProcessor.hpp"
+#include "libslic3r/GCode/GCodeCompressor.hpp"
+#include "libslic3r/GCode/PreviewBuffers.hpp"
 #include "libslic3r/Model.hpp"
 #include "libslic3r/ModelArrange.hpp"
 #include "libslic3r/Platform.hpp"
@@ -495,6 +498,8 @@ int CLI::run(int argc, char **argv)
                 if (printer_technology == ptFFF) {
                     for (auto* mo : model.objects)
                         fff_print.auto_assign_extruders(mo);
+                    if (const ConfigOptionInt *opt_budget = m_config.opt<ConfigOptionInt>("layer_memory_budget"); opt_budget != nullptr && opt_budget->value > 0)
+                        fff_print.set_layer_memory_budget(size_t(opt_budget->value) << 20);
                 }
                 print->apply(model, m_print_config);
                 std::string err = print->validate();
@@ -508,10 +513,17 @@ int CLI::run(int argc, char **argv)
                     try {
                         std::string outfile_final;
                         print->process();
+                        // Without the post-processing scripts, which expect plain text, the G-code is compressed while being exported.
+                        GCodeCompression compression = printer_technology == ptFFF ? fff_print.config().gcode_compression.value : GCodeCompression::None;
+                        bool             compress_on_export = compression != GCodeCompression::None && fff_print.config().post_process.values.empty();
                         if (printer_technology == ptFFF) {
                             // The outfile is processed by a PlaceholderParser.
-                            outfile = fff_print.export_gcode(outfile, nullptr, nullptr);
+                            outfile = fff_print.export_gcode(outfile, nullptr, nullptr, compress_on_export ? GCodeCompressedOutput::Only : GCodeCompressedOutput::None);
                             outfile_final = fff_print.print_statistics().finalize_output_path(outfile);
+                            if (compress_on_export) {
+                                outfile       = compressed_gcode_path(outfile, compression);
+                                outfile_final = compressed_gcode_path(outfile_final, compression);
+                            }
                         } else {
                             outfile = sla_print.output_filepath(outfile);
                             // We need to finalize the filename beforehand because the export function sets the filename inside the zip metadata
@@ -527,6 +539,31 @@ int CLI::run(int argc, char **argv)
                         }
                         // Run the post-processing scripts if defined.
                         run_post_process_scripts(outfile, fff_print.full_print_config());
+                        if (compression != GCodeCompression::None && ! compress_on_export) {
+                            // Compress the post-processed G-code, replacing the plain text file.
+                            std::string      outfile_compressed = compressed_gcode_path(outfile, compression);
+                            compress_gcode_file(outfile, outfile + ".tmp", compression);
+                            boost::nowide::remove(outfile.c_str());
+                            if (Slic3r::rename_file(outfile + ".tmp", outfile_compressed)) {
+                                boost::nowide::cerr << "Renaming file " << outfile << ".tmp to " << outfile_compressed << " failed" << std::endl;
+                                return 1;
+                            }
+                            outfile = outfile_compressed;
+                        }
+                        if (printer_technology == ptFFF && m_config.opt_bool("export_gcode_preview")) {
+                            if (fff_print.config().gcode_compression.value != GCodeCompression::None)
+                                boost::nowide::cerr << "The G-code viewer does not open compressed G-code, the G-code preview is not exported" << std::endl;
+                            else {
+                                // Process the final G-code the same way as the G-code viewer does, including the changes by the post-processing scripts.
+                                GCodeProcessor processor;
+                                processor.enable_producers(true);
+                                processor.process_file(outfile, false);
+                                GCodePreviewBuffers preview;
+                                preview.generate(processor.get_result(), true);
+                                preview.save(gcode_preview_buffers_path(outfile));
+                                boost::nowide::cout << "G-code preview exported to " << gcode_preview_buffers_path(outfile) << std::endl;
+                            }
+                        }
                         boost::nowide::cout << "Slicing result exported to " << outfile << std::endl;
                     } catch (const std::exception &ex) {
                         boost::nowide::cerr << ex.what() << std::endl;
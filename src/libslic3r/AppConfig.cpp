@@ -47,6 +47,9 @@ void AppConfig::set_defaults()
         // Disable background processing by default as it is not stable.
         if (get("background_processing").empty())
             set("background_processing", "0");
+        // Memory in MB the extrusions of the sliced layers may occupy before being spilled to a scratch file, zero to keep all of them in memory.
+        if (get("layer_memory_budget").empty())
+            set("layer_memory_budget", "0");
         // If set, the "Controller" tab for the control of the printer over serial line and the serial port settings are hidden.
         // By default, Prusa has the controller hidden.
         if (get("no_controller").empty())
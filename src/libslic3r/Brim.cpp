@@ -11,6 +11,7 @@
 #include <numeric>
 #include <unordered_set>
 #include <tbb/parallel_for.h>
+#include <tbb/parallel_invoke.h>
 
 #ifndef NDEBUG
     // #define BRIM_DEBUG_TO_SVG
@@ -105,22 +106,29 @@ static ConstPrintObjectPtrs get_top_level_objects_with_brim(const Print &print)
 
 static Polygons top_level_outer_brim_islands(const ConstPrintObjectPtrs &top_level_objects_with_brim)
 {
-    Polygons islands;
-    for (const PrintObject *object : top_level_objects_with_brim) {
-        //FIXME how about the brim type?
-        auto     brim_offset = float(scale_(object->config().brim_offset.value));
-        Polygons islands_object;
-        for (const ExPolygon &ex_poly : object->layers().front()->lslices) {
-            Polygons contour_offset = offset(ex_poly.contour, brim_offset);
-            for (Polygon &poly : contour_offset)
-                poly.douglas_peucker(SCALED_RESOLUTION);
-
-            polygons_append(islands_object, std::move(contour_offset));
-        }
+    // Offset the islands of the objects in parallel.
+    std::vector<Polygons> islands_objects(top_level_objects_with_brim.size());
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, top_level_objects_with_brim.size()),
+        [&top_level_objects_with_brim, &islands_objects](const tbb::blocked_range<size_t> &range) {
+            for (size_t object_idx = range.begin(); object_idx < range.end(); ++ object_idx) {
+                const PrintObject *object = top_level_objects_with_brim[object_idx];
+                //FIXME how about the brim type?
+                auto      brim_offset    = float(scale_(object->config().brim_offset.value));
+                Polygons &islands_object = islands_objects[object_idx];
+                for (const ExPolygon &ex_poly : object->layers().front()->lslices) {
+                    Polygons contour_offset = offset(ex_poly.contour, brim_offset);
+                    for (Polygon &poly : contour_offset)
+                        poly.douglas_peucker(SCALED_RESOLUTION);
+
+                    polygons_append(islands_object, std::move(contour_offset));
+                }
+            }
+        });
 
-        for (const PrintInstance &instance : object->instances())
-            append_and_translate(islands, islands_object, instance);
-    }
+    Polygons islands;
+    for (size_t object_idx = 0; object_idx < top_level_objects_with_brim.size(); ++ object_idx)
+        for (const PrintInstance &instance : top_level_objects_with_brim[object_idx]->instances())
+            append_and_translate(islands, islands_objects[object_idx], instance);
     return islands;
 }
 
@@ -131,38 +139,46 @@ static ExPolygons top_level_outer_brim_area(const Print &print, const ConstPrint
     for (const PrintObject *object : top_level_objects_with_brim)
         top_level_objects_idx.insert(object->id().id);
 
+    // Calculate the brim areas of the objects in parallel.
+    std::vector<ExPolygons> brim_area_objects(print.objects().size());
+    std::vector<ExPolygons> no_brim_area_objects(print.objects().size());
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, print.objects().size()),
+        [&print, &top_level_objects_idx, no_brim_offset, &brim_area_objects, &no_brim_area_objects](const tbb::blocked_range<size_t> &range) {
+            for (size_t object_idx = range.begin(); object_idx < range.end(); ++ object_idx) {
+                const PrintObject *object            = print.objects()[object_idx];
+                const BrimType     brim_type         = object->config().brim_type.value;
+                const float        brim_offset       = scale_(object->config().brim_offset.value);
+                const float        brim_width        = scale_(object->config().brim_width.value);
+                const bool         is_top_outer_brim = top_level_objects_idx.find(object->id().id) != top_level_objects_idx.end();
+
+                ExPolygons &brim_area_object    = brim_area_objects[object_idx];
+                ExPolygons &no_brim_area_object = no_brim_area_objects[object_idx];
+                for (const ExPolygon &ex_poly : object->layers().front()->lslices) {
+                    if ((brim_type == BrimType::btOuterOnly || brim_type == BrimType::btOuterAndInner) && is_top_outer_brim)
+                        append(brim_area_object, diff_ex(offset(ex_poly.contour, brim_width + brim_offset), offset(ex_poly.contour, brim_offset)));
+
+                    if (brim_type == BrimType::btOuterOnly || brim_type == BrimType::btNoBrim)
+                        append(no_brim_area_object, offset_ex(ex_poly.holes, -no_brim_offset));
+
+                    if (brim_type == BrimType::btInnerOnly || brim_type == BrimType::btNoBrim)
+                        append(no_brim_area_object, diff_ex(offset(ex_poly.contour, no_brim_offset), ex_poly.holes));
+
+                    if (brim_type != BrimType::btNoBrim)
+                        append(no_brim_area_object, offset_ex(ExPolygon(ex_poly.contour), brim_offset));
+
+                    no_brim_area_object.emplace_back(ex_poly.contour);
+                }
+            }
+        });
+
     ExPolygons brim_area;
     ExPolygons no_brim_area;
-    for (const PrintObject *object : print.objects()) {
-        const BrimType brim_type         = object->config().brim_type.value;
-        const float    brim_offset       = scale_(object->config().brim_offset.value);
-        const float    brim_width        = scale_(object->config().brim_width.value);
-        const bool     is_top_outer_brim = top_level_objects_idx.find(object->id().id) != top_level_objects_idx.end();
-
-        ExPolygons brim_area_object;
-        ExPolygons no_brim_area_object;
-        for (const ExPolygon &ex_poly : object->layers().front()->lslices) {
-            if ((brim_type == BrimType::btOuterOnly || brim_type == BrimType::btOuterAndInner) && is_top_outer_brim)
-                append(brim_area_object, diff_ex(offset(ex_poly.contour, brim_width + brim_offset), offset(ex_poly.contour, brim_offset)));
-
-            if (brim_type == BrimType::btOuterOnly || brim_type == BrimType::btNoBrim)
-                append(no_brim_area_object, offset_ex(ex_poly.holes, -no_brim_offset));
-
-            if (brim_type == BrimType::btInnerOnly || brim_type == BrimType::btNoBrim)
-                append(no_brim_area_object, diff_ex(offset(ex_poly.contour, no_brim_offset), ex_poly.holes));
-
-            if (brim_type != BrimType::btNoBrim)
-                append(no_brim_area_object, offset_ex(ExPolygon(ex_poly.contour), brim_offset));
-
-            no_brim_area_object.emplace_back(ex_poly.contour);
+    for (size_t object_idx = 0; object_idx < print.objects().size(); ++ object_idx)
+        for (const PrintInstance &instance : print.objects()[object_idx]->instances()) {
+            append_and_translate(brim_area, brim_area_objects[object_idx], instance);
+            append_and_translate(no_brim_area, no_brim_area_objects[object_idx], instance);
         }
 
-        for (const PrintInstance &instance : object->instances()) {
-            append_and_translate(brim_area, brim_area_object, instance);
-            append_and_translate(no_brim_area, no_brim_area_object, instance);
-        }
-    }
-
     return diff_ex(brim_area, no_brim_area);
 }
 
@@ -173,45 +189,54 @@ static ExPolygons inner_brim_area(const Print &print, const ConstPrintObjectPtrs
     for (const PrintObject *object : top_level_objects_with_brim)
         top_level_objects_idx.insert(object->id().id);
 
-    ExPolygons brim_area;
-    ExPolygons no_brim_area;
-    Polygons   holes;
-    for (const PrintObject *object : print.objects()) {
-        const BrimType brim_type      = object->config().brim_type.value;
-        const float    brim_offset    = scale_(object->config().brim_offset.value);
-        const float    brim_width     = scale_(object->config().brim_width.value);
-        const bool     top_outer_brim = top_level_objects_idx.find(object->id().id) != top_level_objects_idx.end();
-
-        ExPolygons brim_area_object;
-        ExPolygons no_brim_area_object;
-        Polygons   holes_object;
-        for (const ExPolygon &ex_poly : object->layers().front()->lslices) {
-            if (brim_type == BrimType::btOuterOnly || brim_type == BrimType::btOuterAndInner) {
-                if (top_outer_brim)
-                    no_brim_area_object.emplace_back(ex_poly);
-                else
-                    append(brim_area_object, diff_ex(offset(ex_poly.contour, brim_width + brim_offset), offset(ex_poly.contour, brim_offset)));
-            }
+    // Calculate the brim areas of the objects in parallel.
+    std::vector<ExPolygons> brim_area_objects(print.objects().size());
+    std::vector<ExPolygons> no_brim_area_objects(print.objects().size());
+    std::vector<Polygons>   holes_objects(print.objects().size());
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, print.objects().size()),
+        [&print, &top_level_objects_idx, no_brim_offset, &brim_area_objects, &no_brim_area_objects, &holes_objects](const tbb::blocked_range<size_t> &range) {
+            for (size_t object_idx = range.begin(); object_idx < range.end(); ++ object_idx) {
+                const PrintObject *object         = print.objects()[object_idx];
+                const BrimType     brim_type      = object->config().brim_type.value;
+                const float        brim_offset    = scale_(object->config().brim_offset.value);
+                const float        brim_width     = scale_(object->config().brim_width.value);
+                const bool         top_outer_brim = top_level_objects_idx.find(object->id().id) != top_level_objects_idx.end();
+
+                ExPolygons &brim_area_object    = brim_area_objects[object_idx];
+                ExPolygons &no_brim_area_object = no_brim_area_objects[object_idx];
+                Polygons   &holes_object        = holes_objects[object_idx];
+                for (const ExPolygon &ex_poly : object->layers().front()->lslices) {
+                    if (brim_type == BrimType::btOuterOnly || brim_type == BrimType::btOuterAndInner) {
+                        if (top_outer_brim)
+                            no_brim_area_object.emplace_back(ex_poly);
+                        else
+                            append(brim_area_object, diff_ex(offset(ex_poly.contour, brim_width + brim_offset), offset(ex_poly.contour, brim_offset)));
+                    }
 
-            if (brim_type == BrimType::btInnerOnly || brim_type == BrimType::btOuterAndInner)
-                append(brim_area_object, diff_ex(offset_ex(ex_poly.holes, -brim_offset), offset_ex(ex_poly.holes, -brim_width - brim_offset)));
+                    if (brim_type == BrimType::btInnerOnly || brim_type == BrimType::btOuterAndInner)
+                        append(brim_area_object, diff_ex(offset_ex(ex_poly.holes, -brim_offset), offset_ex(ex_poly.holes, -brim_width - brim_offset)));
 
-            if (brim_type == BrimType::btInnerOnly || brim_type == BrimType::btNoBrim)
-                append(no_brim_area_object, diff_ex(offset(ex_poly.contour, no_brim_offset), ex_poly.holes));
+                    if (brim_type == BrimType::btInnerOnly || brim_type == BrimType::btNoBrim)
+                        append(no_brim_area_object, diff_ex(offset(ex_poly.contour, no_brim_offset), ex_poly.holes));
 
-            if (brim_type == BrimType::btOuterOnly || brim_type == BrimType::btNoBrim)
-                append(no_brim_area_object, offset_ex(ex_poly.holes, -no_brim_offset));
+                    if (brim_type == BrimType::btOuterOnly || brim_type == BrimType::btNoBrim)
+                        append(no_brim_area_object, offset_ex(ex_poly.holes, -no_brim_offset));
 
-            append(holes_object, ex_poly.holes);
-        }
-        append(no_brim_area_object, offset_ex(object->layers().front()->lslices, brim_offset));
+                    append(holes_object, ex_poly.holes);
+                }
+                append(no_brim_area_object, offset_ex(object->layers().front()->lslices, brim_offset));
+            }
+        });
 
-        for (const PrintInstance &instance : object->instances()) {
-            append_and_translate(brim_area, brim_area_object, instance);
-            append_and_translate(no_brim_area, no_brim_area_object, instance);
-            append_and_translate(holes, holes_object, instance);
+    ExPolygons brim_area;
+    ExPolygons no_brim_area;
+    Polygons   holes;
+    for (size_t object_idx = 0; object_idx < print.objects().size(); ++ object_idx)
+        for (const PrintInstance &instance : print.objects()[object_idx]->instances()) {
+            append_and_translate(brim_area, brim_area_objects[object_idx], instance);
+            append_and_translate(no_brim_area, no_brim_area_objects[object_idx], instance);
+            append_and_translate(holes, holes_objects[object_idx], instance);
         }
-    }
 
     return diff_ex(intersection_ex(to_polygons(std::move(brim_area)), holes), no_brim_area);
 }
@@ -336,9 +361,17 @@ ExtrusionEntityCollection make_brim(const Print &print, PrintTryCancel try_cance
 {
     Flow                 flow                         = print.brim_flow();
     ConstPrintObjectPtrs top_level_objects_with_brim  = get_top_level_objects_with_brim(print);
-    Polygons             islands                      = top_level_outer_brim_islands(top_level_objects_with_brim);
-    ExPolygons           islands_area_ex              = top_level_outer_brim_area(print, top_level_objects_with_brim, float(flow.scaled_spacing()));
-    islands_area                                      = to_polygons(islands_area_ex);
+    Polygons             islands;
+    ExPolygons           islands_area_ex;
+    // The inner brim does not depend on the outer brim, it is calculated concurrently.
+    ExtrusionEntityCollection inner_brim;
+    tbb::parallel_invoke(
+        [&islands, &top_level_objects_with_brim]() { islands = top_level_outer_brim_islands(top_level_objects_with_brim); },
+        [&islands_area_ex, &print, &top_level_objects_with_brim, &flow]() {
+            islands_area_ex = top_level_outer_brim_area(print, top_level_objects_with_brim, float(flow.scaled_spacing()));
+        },
+        [&inner_brim, &print, &top_level_objects_with_brim]() { make_inner_brim(print, top_level_objects_with_brim, inner_brim); });
+    islands_area = to_polygons(islands_area_ex);
 
     Polygons        loops;
     size_t          num_loops = size_t(floor(max_brim_width(print.objects()) / flow.spacing()));
@@ -373,6 +406,8 @@ ExtrusionEntityCollection make_brim(const Print &print, PrintTryCancel try_cance
     loops_pl_by_levels.clear();
 
     // Flip orientation of open polylines to minimize travel distance.
+    // This pass and connect_brim_lines() below stay serial: the brim lines are chained across all the islands,
+    // each line is reversed or connected depending on the end point of the preceding line in the chain.
     optimize_polylines_by_reversing(&all_loops);
 
 #ifdef BRIM_DEBUG_TO_SVG
@@ -532,7 +567,7 @@ ExtrusionEntityCollection make_brim(const Print &print, PrintTryCancel try_cance
         extrusion_entities_append_loops_and_paths(brim.entities, std::move(all_loops), erSkirt, float(flow.mm3_per_mm()), float(flow.width()), float(print.skirt_first_layer_height()));
     }
 
-    make_inner_brim(print, top_level_objects_with_brim, brim);
+    append(brim.entities, std::move(inner_brim.entities));
     return brim;
 }
 
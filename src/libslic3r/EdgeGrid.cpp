@@ -5,6 +5,8 @@
 
 #include <png.h>
 
+#include <tbb/parallel_for.h>
+
 #include "libslic3r.h"
 #include "ClipperUtils.hpp"
 #include "EdgeGrid.hpp"
@@ -25,6 +27,11 @@
 
 namespace Slic3r {
 
+// Number of contour segments rasterized by a single task when filling in the edge grid.
+static constexpr const size_t EDGE_GRID_SEGMENTS_PER_CHUNK = 4096;
+// Maximum number of horizontal bands of the edge grid filled in parallel.
+static constexpr const size_t EDGE_GRID_MAX_BANDS = 64;
+
 void EdgeGrid::Grid::create(const Polygons &polygons, coord_t resolution)
 {
 	// Collect the contours.
@@ -165,175 +172,88 @@ void EdgeGrid::Grid::create_from_m_contours(coord_t resolution)
 	m_rows = (m_bbox.max(1) - m_bbox.min(1) + m_resolution - 1) / m_resolution;
 	m_cells.assign(m_rows * m_cols, Cell());
 
-	// 3) First round of contour rasterization, count the edges per grid cell.
-	for (size_t i = 0; i < m_contours.size(); ++ i) {
-		const Contour &contour = m_contours[i];
-		for (size_t j = 0; j < contour.num_segments(); ++ j) {
-			// End points of the line segment.
-			Slic3r::Point p1(contour.segment_start(j));
-			Slic3r::Point p2(contour.segment_end(j));
-			p1(0) -= m_bbox.min(0);
-			p1(1) -= m_bbox.min(1);
-			p2(0) -= m_bbox.min(0);
-			p2(1) -= m_bbox.min(1);
-		   	// Get the cells of the end points.
-		    coord_t ix    = p1(0) / m_resolution;
-		    coord_t iy    = p1(1) / m_resolution;
-		    coord_t ixb   = p2(0) / m_resolution;
-		    coord_t iyb   = p2(1) / m_resolution;
-			assert(ix >= 0 && size_t(ix) < m_cols);
-			assert(iy >= 0 && size_t(iy) < m_rows);
-			assert(ixb >= 0 && size_t(ixb) < m_cols);
-			assert(iyb >= 0 && size_t(iyb) < m_rows);
-			// Account for the end points.
-			++ m_cells[iy*m_cols+ix].end;
-			if (ix == ixb && iy == iyb)
-				// Both ends fall into the same cell.
-				continue;
-		    // Raster the centeral part of the line.
-			coord_t dx = std::abs(p2(0) - p1(0));
-			coord_t dy = std::abs(p2(1) - p1(1));
-			if (p1(0) < p2(0)) {
-				int64_t ex = int64_t((ix + 1)*m_resolution - p1(0)) * int64_t(dy);
-				if (p1(1) < p2(1)) {
-					// x positive, y positive
-					int64_t ey = int64_t((iy + 1)*m_resolution - p1(1)) * int64_t(dx);
-					do {
-						assert(ix <= ixb && iy <= iyb);
-						if (ex < ey) {
-							ey -= ex;
-							ex = int64_t(dy) * m_resolution;
-							ix += 1;
-						}
-						else if (ex == ey) {
-							ex = int64_t(dy) * m_resolution;
-							ey = int64_t(dx) * m_resolution;
-							ix += 1;
-							iy += 1;
-						}
-						else {
-							assert(ex > ey);
-							ex -= ey;
-							ey = int64_t(dx) * m_resolution;
-							iy += 1;
-						}
-						++m_cells[iy*m_cols + ix].end;
-					} while (ix != ixb || iy != iyb);
-				}
-				else {
-					// x positive, y non positive
-					int64_t ey = int64_t(p1(1) - iy*m_resolution) * int64_t(dx);
-					do {
-						assert(ix <= ixb && iy >= iyb);
-						if (ex <= ey) {
-							ey -= ex;
-							ex = int64_t(dy) * m_resolution;
-							ix += 1;
-						}
-						else {
-							ex -= ey;
-							ey = int64_t(dx) * m_resolution;
-							iy -= 1;
-						}
-						++m_cells[iy*m_cols + ix].end;
-					} while (ix != ixb || iy != iyb);
-				}
-			}
-			else {
-				int64_t ex = int64_t(p1(0) - ix*m_resolution) * int64_t(dy);
-				if (p1(1) < p2(1)) {
-					// x non positive, y positive
-					int64_t ey = int64_t((iy + 1)*m_resolution - p1(1)) * int64_t(dx);
-					do {
-						assert(ix >= ixb && iy <= iyb);
-						if (ex < ey) {
-							ey -= ex;
-							ex = int64_t(dy) * m_resolution;
-							ix -= 1;
-						}
-						else {
-							assert(ex >= ey);
-							ex -= ey;
-							ey = int64_t(dx) * m_resolution;
-							iy += 1;
-						}
-						++m_cells[iy*m_cols + ix].end;
-					} while (ix != ixb || iy != iyb);
-				}
-				else {
-					// x non positive, y non positive
-					int64_t ey = int64_t(p1(1) - iy*m_resolution) * int64_t(dx);
-					do {
-						assert(ix >= ixb && iy >= iyb);
-						if (ex < ey) {
-							ey -= ex;
-							ex = int64_t(dy) * m_resolution;
-							ix -= 1;
-						}
-						else if (ex == ey) {
-							// The lower edge of a grid cell belongs to the cell.
-							// Handle the case where the ray may cross the lower left corner of a cell in a general case,
-							// or a left or lower edge in a degenerate case (horizontal or vertical line).
-							if (dx > 0) {
-								ex = int64_t(dy) * m_resolution;
-								ix -= 1;
-							}
-							if (dy > 0) {
-								ey = int64_t(dx) * m_resolution;
-								iy -= 1;
-							}
-						}
-						else {
-							assert(ex > ey);
-							ex -= ey;
-							ey = int64_t(dx) * m_resolution;
-							iy -= 1;
-						}
-						++m_cells[iy*m_cols + ix].end;
-					} while (ix != ixb || iy != iyb);
+	// 3) Rasterize the contour segments in parallel over chunks of segments.
+	// Each chunk sorts its hits into horizontal bands of grid rows, so that the cells of a band
+	// are counted and filled by a single thread without any synchronization.
+	std::vector<size_t> segment_offsets(m_contours.size() + 1, 0);
+	for (size_t i = 0; i < m_contours.size(); ++ i)
+		segment_offsets[i + 1] = segment_offsets[i] + m_contours[i].num_segments();
+	const size_t num_segments = segment_offsets.back();
+	const size_t num_chunks   = std::max<size_t>(1, (num_segments + EDGE_GRID_SEGMENTS_PER_CHUNK - 1) / EDGE_GRID_SEGMENTS_PER_CHUNK);
+	const size_t num_bands    = num_chunks == 1 ? 1 : std::min(m_rows, EDGE_GRID_MAX_BANDS);
+	const size_t rows_per_band = (m_rows + num_bands - 1) / num_bands;
+
+	struct CellHit {
+		size_t cell;
+		size_t contour;
+		size_t segment;
+	};
+	// Hits per chunk and band.
+	std::vector<std::vector<std::vector<CellHit>>> hits(num_chunks, std::vector<std::vector<CellHit>>(num_bands));
+	tbb::parallel_for(tbb::blocked_range<size_t>(0, num_chunks, 1),
+		[this, &segment_offsets, &hits, num_segments, rows_per_band](const tbb::blocked_range<size_t> &range) {
+		for (size_t ichunk = range.begin(); ichunk < range.end(); ++ ichunk) {
+			struct Visitor {
+				inline bool operator()(coord_t iy, coord_t ix) {
+					bands[size_t(iy) / rows_per_band].push_back({ size_t(iy) * cols + size_t(ix), i, j });
+					// Continue traversing the grid along the edge.
+					return true;
 				}
+				std::vector<std::vector<CellHit>> &bands;
+				size_t 							   cols;
+				size_t 							   rows_per_band;
+				size_t 							   i;
+				size_t 							   j;
+			} visitor { hits[ichunk], m_cols, rows_per_band, 0, 0 };
+			size_t iseg_begin = ichunk * EDGE_GRID_SEGMENTS_PER_CHUNK;
+			size_t iseg_end   = std::min(iseg_begin + EDGE_GRID_SEGMENTS_PER_CHUNK, num_segments);
+			// Contour containing the first segment of this chunk.
+			visitor.i = std::upper_bound(segment_offsets.begin(), segment_offsets.end(), iseg_begin) - segment_offsets.begin() - 1;
+			for (size_t iseg = iseg_begin; iseg < iseg_end; ++ iseg) {
+				while (iseg >= segment_offsets[visitor.i + 1])
+					++ visitor.i;
+				const Contour &contour = m_contours[visitor.i];
+				visitor.j = iseg - segment_offsets[visitor.i];
+				this->visit_cells_intersecting_line(contour.segment_start(visitor.j), contour.segment_end(visitor.j), visitor);
 			}
 		}
+	});
+
+	// 4) Allocate the cell data, each band occupies a continuous block of m_cell_data starting at band_offsets[band].
+	std::vector<size_t> band_offsets(num_bands + 1, 0);
+	for (size_t band = 0; band < num_bands; ++ band) {
+		size_t cnt = 0;
+		for (size_t ichunk = 0; ichunk < num_chunks; ++ ichunk)
+			cnt += hits[ichunk][band].size();
+		band_offsets[band + 1] = band_offsets[band] + cnt;
 	}
-
-	// 4) Prefix sum the numbers of hits per cells to get an index into m_cell_data.
-	size_t cnt = m_cells.front().end;
-	for (size_t i = 1; i < m_cells.size(); ++ i) {
-		m_cells[i].begin = cnt;
-		cnt += m_cells[i].end;
-		m_cells[i].end = cnt;
-	}
-
-	// 5) Allocate the cell data.
-	m_cell_data.assign(cnt, std::pair<size_t, size_t>(size_t(-1), size_t(-1)));
-
-	// 6) Finally fill in m_cell_data by rasterizing the lines once again.
-	for (size_t i = 0; i < m_cells.size(); ++i)
-		m_cells[i].end = m_cells[i].begin;
-
-	struct Visitor {
-		Visitor(std::vector<std::pair<size_t, size_t>> &cell_data, std::vector<Cell> &cells, size_t cols) :
-			cell_data(cell_data), cells(cells), cols(cols), i(0), j(0) {}
-
-		inline bool operator()(coord_t iy, coord_t ix) {
-			cell_data[cells[iy*cols + ix].end++] = std::pair<size_t, size_t>(i, j);
-			// Continue traversing the grid along the edge.
-			return true;
+	m_cell_data.assign(band_offsets.back(), std::pair<size_t, size_t>(size_t(-1), size_t(-1)));
+
+	// 5) Count the hits per cell, prefix sum them to get an index into m_cell_data and fill in m_cell_data.
+	// The hits are visited in the order of the chunks, thus the edges of a cell are stored in the order
+	// of the contours and their segments independently of the number of chunks and bands.
+	tbb::parallel_for(tbb::blocked_range<size_t>(0, num_bands, 1),
+		[this, &hits, &band_offsets, num_chunks, rows_per_band](const tbb::blocked_range<size_t> &range) {
+		for (size_t band = range.begin(); band < range.end(); ++ band) {
+			size_t icell_begin = std::min(band * rows_per_band, m_rows) * m_cols;
+			size_t icell_end   = std::min((band + 1) * rows_per_band, m_rows) * m_cols;
+			for (size_t ichunk = 0; ichunk < num_chunks; ++ ichunk)
+				for (const CellHit &hit : hits[ichunk][band])
+					++ m_cells[hit.cell].end;
+			size_t cnt = band_offsets[band];
+			for (size_t i = icell_begin; i < icell_end; ++ i) {
+				Cell &cell = m_cells[i];
+				cell.begin = cnt;
+				cnt += cell.end;
+				// The end index is incremented while filling in m_cell_data.
+				cell.end = cell.begin;
+			}
+			assert(cnt == band_offsets[band + 1]);
+			for (size_t ichunk = 0; ichunk < num_chunks; ++ ichunk)
+				for (const CellHit &hit : hits[ichunk][band])
+					m_cell_data[m_cells[hit.cell].end ++] = std::pair<size_t, size_t>(hit.contour, hit.segment);
 		}
-
-		std::vector<std::pair<size_t, size_t>> &cell_data;
-		std::vector<Cell> 					   &cells;
-		size_t									cols;
-		size_t 									i;
-		size_t 									j;
-	} visitor(m_cell_data, m_cells, m_cols);
-
-	assert(visitor.i == 0);
-	for (; visitor.i < m_contours.size(); ++ visitor.i) {
-		const Contour &contour = m_contours[visitor.i];
-		for (visitor.j = 0; visitor.j < contour.num_segments(); ++ visitor.j)
-			this->visit_cells_intersecting_line(contour.segment_start(visitor.j), contour.segment_end(visitor.j), visitor);
-	}
+	});
 }
 
 #if 0
@@ -1047,8 +967,9 @@ float EdgeGrid::Grid::signed_distance_bilinear(const Point &pt) const
 	return f;
 }
 
-EdgeGrid::Grid::ClosestPointResult EdgeGrid::Grid::closest_point_signed_distance(const Point &pt, coord_t search_radius) const 
+EdgeGrid::Grid::ClosestPointResult EdgeGrid::Grid::closest_edge(const Point &pt, coord_t search_radius, bool &on_segment) const
 {
+	on_segment = false;
 	BoundingBox bbox;
 	bbox.min = bbox.max = Point(pt(0) - m_bbox.min(0), pt(1) - m_bbox.min(1));
 	bbox.defined = true;
@@ -1093,6 +1014,11 @@ EdgeGrid::Grid::ClosestPointResult EdgeGrid::Grid::closest_point_signed_distance
 				// End points of the line segment.
 				const Slic3r::Point &p1 = contour.segment_start(ipt);
 				const Slic3r::Point &p2 = contour.segment_end(ipt);
+				// Reject the segments, which are not closer than d_min along the x or y axis. Most of the segments
+				// of the visited cells are rejected by this cheap test before calculating the exact distance.
+				if (double(std::max(int64_t(std::min(p1.x(), p2.x())) - pt.x(), int64_t(pt.x()) - std::max(p1.x(), p2.x()))) >= d_min ||
+					double(std::max(int64_t(std::min(p1.y(), p2.y())) - pt.y(), int64_t(pt.y()) - std::max(p1.y(), p2.y()))) >= d_min)
+					continue;
 				const Slic3r::Point v_seg = p2 - p1;
 				const Slic3r::Point v_pt  = pt - p1;
 				// dot(p2-p1, pt-p1)
@@ -1114,6 +1040,7 @@ EdgeGrid::Grid::ClosestPointResult EdgeGrid::Grid::closest_point_signed_distance
 							int64_t det = int64_t(v_seg_prev(0)) * int64_t(v_seg(1)) - int64_t(v_seg_prev(1)) * int64_t(v_seg(0));
 							assert(det != 0);
 							sign_min = (det > 0) ? 1 : -1;
+							on_segment = false;
 							result.contour_idx = contour_idx;
 							result.start_point_idx = ipt;
 							result.t = 0.;
@@ -1139,6 +1066,7 @@ EdgeGrid::Grid::ClosestPointResult EdgeGrid::Grid::closest_point_signed_distance
 						d_min = dabs;
 						sign_min = (d_seg < 0) ? -1 : ((d_seg == 0) ? 0 : 1);
 						l2_seg_min = l2_seg;
+						on_segment = true;
 						result.contour_idx = contour_idx;
 						result.start_point_idx = ipt;
 						result.t = t_pt;
@@ -1178,96 +1106,29 @@ EdgeGrid::Grid::ClosestPointResult EdgeGrid::Grid::closest_point_signed_distance
 	return result;
 }
 
+EdgeGrid::Grid::ClosestPointResult EdgeGrid::Grid::closest_point_signed_distance(const Point &pt, coord_t search_radius) const
+{
+	bool on_segment;
+	return this->closest_edge(pt, search_radius, on_segment);
+}
+
+std::vector<EdgeGrid::Grid::ClosestPointResult> EdgeGrid::Grid::closest_points_signed_distance(const Points &pts, coord_t search_radius) const
+{
+	std::vector<ClosestPointResult> out(pts.size());
+	tbb::parallel_for(tbb::blocked_range<size_t>(0, pts.size(), 64), [this, &pts, &out, search_radius](const tbb::blocked_range<size_t> &range) {
+		for (size_t i = range.begin(); i < range.end(); ++ i)
+			out[i] = this->closest_point_signed_distance(pts[i], search_radius);
+	});
+	return out;
+}
+
 bool EdgeGrid::Grid::signed_distance_edges(const Point &pt, coord_t search_radius, coordf_t &result_min_dist, bool *pon_segment) const 
 {
-	BoundingBox bbox;
-	bbox.min = bbox.max = Point(pt(0) - m_bbox.min(0), pt(1) - m_bbox.min(1));
-	bbox.defined = true;
-	// Upper boundary, round to grid and test validity.
-	bbox.max(0) += search_radius;
-	bbox.max(1) += search_radius;
-	if (bbox.max(0) < 0 || bbox.max(1) < 0)
-		return false;
-	bbox.max(0) /= m_resolution;
-	bbox.max(1) /= m_resolution;
-	if ((size_t)bbox.max(0) >= m_cols)
-		bbox.max(0) = m_cols - 1;
-	if ((size_t)bbox.max(1) >= m_rows)
-		bbox.max(1) = m_rows - 1;
-	// Lower boundary, round to grid and test validity.
-	bbox.min(0) -= search_radius;
-	bbox.min(1) -= search_radius;
-	if (bbox.min(0) < 0)
-		bbox.min(0) = 0;
-	if (bbox.min(1) < 0)
-		bbox.min(1) = 0;
-	bbox.min(0) /= m_resolution;
-	bbox.min(1) /= m_resolution;
-	// Is the interval empty?
-	if (bbox.min(0) > bbox.max(0) ||
-		bbox.min(1) > bbox.max(1))
-		return false;
-	// Traverse all cells in the bounding box.
-	double d_min = double(search_radius);
-	// Signum of the distance field at pt.
-	int sign_min = 0;
 	bool on_segment = false;
-	for (int r = bbox.min(1); r <= bbox.max(1); ++ r) {
-		for (int c = bbox.min(0); c <= bbox.max(0); ++ c) {
-			const Cell &cell = m_cells[r * m_cols + c];
-			for (size_t i = cell.begin; i < cell.end; ++ i) {
-				const Contour &contour = m_contours[m_cell_data[i].first];
-				assert(contour.closed());
-				size_t ipt = m_cell_data[i].second;
-				// End points of the line segment.
-				const Slic3r::Point &p1 = contour.segment_start(ipt);
-				const Slic3r::Point &p2 = contour.segment_end(ipt);
-				Slic3r::Point v_seg = p2 - p1;
-				Slic3r::Point v_pt  = pt - p1;
-				// dot(p2-p1, pt-p1)
-				int64_t t_pt = int64_t(v_seg(0)) * int64_t(v_pt(0)) + int64_t(v_seg(1)) * int64_t(v_pt(1));
-				// l2 of seg
-				int64_t l2_seg = int64_t(v_seg(0)) * int64_t(v_seg(0)) + int64_t(v_seg(1)) * int64_t(v_seg(1));
-				if (t_pt < 0) {
-					// Closest to p1.
-					double dabs = sqrt(int64_t(v_pt(0)) * int64_t(v_pt(0)) + int64_t(v_pt(1)) * int64_t(v_pt(1)));
-					if (dabs < d_min) {
-						// Previous point.
-						const Slic3r::Point &p0 = contour.segment_prev(ipt);
-						Slic3r::Point v_seg_prev = p1 - p0;
-						int64_t t2_pt = int64_t(v_seg_prev(0)) * int64_t(v_pt(0)) + int64_t(v_seg_prev(1)) * int64_t(v_pt(1));
-						if (t2_pt > 0) {
-							// Inside the wedge between the previous and the next segment.
-							d_min = dabs;
-							// Set the signum depending on whether the vertex is convex or reflex.
-							int64_t det = int64_t(v_seg_prev(0)) * int64_t(v_seg(1)) - int64_t(v_seg_prev(1)) * int64_t(v_seg(0));
-							assert(det != 0);
-							sign_min = (det > 0) ? 1 : -1;
-							on_segment = false;
-						}
-					}
-				}
-				else if (t_pt > l2_seg) {
-					// Closest to p2. Then p2 is the starting point of another segment, which shall be discovered in the same cell.
-					continue;
-				} else {
-					// Closest to the segment.
-					assert(t_pt >= 0 && t_pt <= l2_seg);
-					int64_t d_seg = int64_t(v_seg(1)) * int64_t(v_pt(0)) - int64_t(v_seg(0)) * int64_t(v_pt(1));
-					double d = double(d_seg) / sqrt(double(l2_seg));
-					double dabs = std::abs(d);
-					if (dabs < d_min) {
-						d_min = dabs;
-						sign_min = (d_seg < 0) ? -1 : ((d_seg == 0) ? 0 : 1);
-						on_segment = true;
-					}
-				}
-			}
-		}
-	}
-	if (d_min >= search_radius)
+	ClosestPointResult result = this->closest_edge(pt, search_radius, on_segment);
+	if (! result.valid())
 		return false;
-	result_min_dist = d_min * sign_min;
+	result_min_dist = result.distance;
 	if (pon_segment != NULL)
 		*pon_segment = on_segment;
 	return true;
@@ -1283,6 +1144,16 @@ bool EdgeGrid::Grid::signed_distance(const Point &pt, coord_t search_radius, coo
 	return true;
 }
 
+std::vector<coordf_t> EdgeGrid::Grid::signed_distances(const Points &pts, coord_t search_radius) const
+{
+	std::vector<coordf_t> out(pts.size(), std::numeric_limits<coordf_t>::max());
+	tbb::parallel_for(tbb::blocked_range<size_t>(0, pts.size(), 64), [this, &pts, &out, search_radius](const tbb::blocked_range<size_t> &range) {
+		for (size_t i = range.begin(); i < range.end(); ++ i)
+			this->signed_distance(pts[i], search_radius, out[i]);
+	});
+	return out;
+}
+
 Polygons EdgeGrid::Grid::contours_simplified(coord_t offset, bool fill_holes) const
 {
 	assert(std::abs(2 * offset) < m_resolution);
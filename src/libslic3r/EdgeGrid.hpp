@@ -130,6 +130,8 @@ public:
 		bool valid() const { return contour_idx != size_t(-1); }
 	};
 	ClosestPointResult closest_point_signed_distance(const Point &pt, coord_t search_radius) const;
+	// Batched closest_point_signed_distance(), the points are processed in parallel.
+	std::vector<ClosestPointResult> closest_points_signed_distance(const Points &pts, coord_t search_radius) const;
 
 	// Only call this function for closed contours!
 	bool signed_distance_edges(const Point &pt, coord_t search_radius, coordf_t &result_min_dist, bool *pon_segment = nullptr) const;
@@ -138,6 +140,9 @@ public:
 	// return an interpolated value from m_signed_distance_field, if it exists.
 	// Only call this function for closed contours!
 	bool signed_distance(const Point &pt, coord_t search_radius, coordf_t &result_min_dist) const;
+	// Batched signed_distance(), the points are processed in parallel.
+	// std::numeric_limits<coordf_t>::max() is returned for the points, for which signed_distance() fails.
+	std::vector<coordf_t> signed_distances(const Points &pts, coord_t search_radius) const;
 
 	const BoundingBox& 	bbox() const { return m_bbox; }
 	const coord_t 		resolution() const { return m_resolution; }
@@ -346,6 +351,9 @@ protected:
 	};
 
 	void create_from_m_contours(coord_t resolution);
+	// Closest edge in search_radius to pt, shared by closest_point_signed_distance() and signed_distance_edges().
+	// on_segment is set if the closest point is inside an edge, not at its start point.
+	ClosestPointResult closest_edge(const Point &pt, coord_t search_radius, bool &on_segment) const;
 #if 0
 	bool line_cell_intersect(const Point &p1, const Point &p2, const Cell &cell);
 #endif
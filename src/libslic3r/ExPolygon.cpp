@@ -197,10 +197,19 @@ void ExPolygon::simplify(double tolerance, ExPolygons* expolygons) const
 }
 
 void
-ExPolygon::medial_axis(double max_width, double min_width, ThickPolylines* polylines) const
+ExPolygon::medial_axis(double max_width, double min_width, ThickPolylines* polylines, Geometry::VoronoiDiagramBuilder* builder) const
 {
+    // The medial axis is not wider than the bounding box of the expolygon. If the bounding box is narrower than min_width,
+    // all the Voronoi edges would be rejected by MedialAxis::validate_edge(), don't construct the Voronoi diagram at all.
+    // This is common for the slivers left over by the offsets in the perimeter generator.
+    {
+        Point size = get_extents(this->contour).size();
+        if (double(std::min(size.x(), size.y())) < min_width)
+            return;
+    }
+
     // init helper object
-    Slic3r::Geometry::MedialAxis ma(max_width, min_width, this);
+    Slic3r::Geometry::MedialAxis ma(max_width, min_width, this, builder);
     ma.lines = this->lines();
     
     // compute the Voronoi diagram and extract medial axis polylines
@@ -309,10 +318,10 @@ ExPolygon::medial_axis(double max_width, double min_width, ThickPolylines* polyl
 }
 
 void
-ExPolygon::medial_axis(double max_width, double min_width, Polylines* polylines) const
+ExPolygon::medial_axis(double max_width, double min_width, Polylines* polylines, Geometry::VoronoiDiagramBuilder* builder) const
 {
     ThickPolylines tp;
-    this->medial_axis(max_width, min_width, &tp);
+    this->medial_axis(max_width, min_width, &tp, builder);
     polylines->insert(polylines->end(), tp.begin(), tp.end());
 }
 
@@ -11,6 +11,8 @@ namespace Slic3r {
 class ExPolygon;
 typedef std::vector<ExPolygon> ExPolygons;
 
+namespace Geometry { class VoronoiDiagramBuilder; }
+
 class ExPolygon
 {
 public:
@@ -65,8 +67,9 @@ public:
     Polygons simplify_p(double tolerance) const;
     ExPolygons simplify(double tolerance) const;
     void simplify(double tolerance, ExPolygons* expolygons) const;
-    void medial_axis(double max_width, double min_width, ThickPolylines* polylines) const;
-    void medial_axis(double max_width, double min_width, Polylines* polylines) const;
+    // Pass a Voronoi builder to reuse its buffers when calculating the medial axes of many expolygons.
+    void medial_axis(double max_width, double min_width, ThickPolylines* polylines, Geometry::VoronoiDiagramBuilder* builder = nullptr) const;
+    void medial_axis(double max_width, double min_width, Polylines* polylines, Geometry::VoronoiDiagramBuilder* builder = nullptr) const;
     Lines lines() const;
 
     // Number of contours (outer contour with holes).
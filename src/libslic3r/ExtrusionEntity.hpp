@@ -114,6 +114,29 @@ public:
 
 typedef std::vector<ExtrusionEntity*> ExtrusionEntitiesPtr;
 
+// Non-owning reference to an extrusion entity with its printing direction.
+// Chaining produces references instead of reversing the extrusion entities in place or cloning them,
+// so the extrusions stored in the layers are never modified and copied during the G-code export.
+class ExtrusionEntityReference
+{
+public:
+    ExtrusionEntityReference() = delete;
+    ExtrusionEntityReference(const ExtrusionEntity &extrusion_entity, bool flipped) :
+        m_extrusion_entity(&extrusion_entity), m_flipped(flipped) {}
+
+    const ExtrusionEntity&  extrusion_entity() const { return *m_extrusion_entity; }
+    template<typename Type>
+    const Type*             cast() const { return dynamic_cast<const Type*>(m_extrusion_entity); }
+    // Is the extrusion entity to be printed in the reverse direction?
+    bool                    flipped() const { return m_flipped; }
+
+private:
+    const ExtrusionEntity  *m_extrusion_entity;
+    bool                    m_flipped;
+};
+
+using ExtrusionEntityReferences = std::vector<ExtrusionEntityReference>;
+
 class ExtrusionPath : public ExtrusionEntity
 {
 public:
@@ -371,6 +371,7 @@ void Layer::make_fills(FillAdaptive::Octree* adaptive_fill_octree, FillAdaptive:
 		params.dont_adjust		 = false; //  surface_fill.params.dont_adjust;
         params.anchor_length     = surface_fill.params.anchor_length;
 		params.anchor_length_max = surface_fill.params.anchor_length_max;
+		params.monotonic_max_rounds = this->object()->config().monotonic_infill_rounds.value;
 
         for (ExPolygon &expoly : surface_fill.expolygons) {
 			// Spacing is modified by the filler to indicate adjustments. Reset it for each expolygon.
@@ -536,6 +537,7 @@ void Layer::make_ironing()
     fill.overlap 			 = 0;
     fill_params.density 	 = 1.;
     fill_params.monotonic    = true;
+    fill_params.monotonic_max_rounds = this->object()->config().monotonic_infill_rounds.value;
 
 	for (size_t i = 0; i < by_extruder.size(); ++ i) {
 		// Find span of regions equivalent to the ironing operation.
@@ -3,6 +3,7 @@
 #include "../Surface.hpp"
 
 #include "Fill3DHoneycomb.hpp"
+#include "FillPatternCache.hpp"
 
 namespace Slic3r {
 
@@ -144,25 +145,28 @@ void Fill3DHoneycomb::_fill_surface_single(
     BoundingBox bb = expolygon.contour.bounding_box();
     coord_t     distance = coord_t(scale_(this->spacing) / params.density);
 
-    // align bounding box to a multiple of our honeycomb grid module
+    // generate pattern in tiles aligned to a multiple of our honeycomb grid module
     // (a module is 2*$distance since one $distance half-module is 
-    // growing while the other $distance half-module is shrinking)
-    bb.merge(align_to_grid(bb.min, Point(2*distance, 2*distance)));
-    
-    // generate pattern
-    Polylines   polylines = makeGrid(
-        scale_(this->z),
-        distance,
-        ceil(bb.size()(0) / distance) + 1,
-        ceil(bb.size()(1) / distance) + 1,
-        ((this->layer_id/thickness_layers) % 2) + 1);
-    
-    // move pattern in place
-	for (Polyline &pl : polylines)
-		pl.translate(bb.min);
+    // growing while the other $distance half-module is shrinking),
+    // shared by all the surfaces of all the objects printed at this Z with the same density and spacing
+    size_t      curve_type = ((this->layer_id/thickness_layers) % 2) + 1;
+    FillPatternTiles pattern = FillPatternCache::instance().periodic(
+        FillPatternKey(typeid(*this), { this->z, double(distance), double(curve_type) }), bb, Point(2*distance, 2*distance),
+        [this, distance, curve_type](const BoundingBox &bbox) {
+            Polylines polylines = makeGrid(
+                scale_(this->z),
+                distance,
+                ceil(bbox.size()(0) / distance) + 1,
+                ceil(bbox.size()(1) / distance) + 1,
+                curve_type);
+            // move pattern in place
+            for (Polyline &pl : polylines)
+                pl.translate(bbox.min);
+            return polylines;
+        });
 
     // clip pattern to boundaries, chain the clipped polylines
-    polylines = intersection_pl(polylines, expolygon);
+    Polylines   polylines = clip_fill_pattern(pattern, expolygon);
 
     // connect lines if needed
     if (params.dont_connect() || polylines.size() <= 1)
@@ -49,6 +49,9 @@ struct FillParams
 
     // Monotonic infill - strictly left to right for better surface quality of top infills.
     bool 		monotonic		{ false };
+    // Monotonic infill: Maximum number of rounds of the ant colony optimization ordering the monotonic regions.
+    // Fewer rounds are run for surfaces split into many regions.
+    int         monotonic_max_rounds { 25 };
 
     // For Honeycomb.
     // we were requested to complete each loop;
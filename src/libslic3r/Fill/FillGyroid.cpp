@@ -6,6 +6,7 @@
 #include <iostream>
 
 #include "FillGyroid.hpp"
+#include "FillPatternCache.hpp"
 
 namespace Slic3r {
 
@@ -165,22 +166,24 @@ void FillGyroid::_fill_surface_single(
     // Distance between the gyroid waves in scaled coordinates.
     coord_t     distance = coord_t(scale_(this->spacing) / density_adjusted);
 
-    // align bounding box to a multiple of our grid module
-    bb.merge(align_to_grid(bb.min, Point(2*M_PI*distance, 2*M_PI*distance)));
-
-    // generate pattern
-    Polylines polylines = make_gyroid_waves(
-        scale_(this->z),
-        density_adjusted,
-        this->spacing,
-        ceil(bb.size()(0) / distance) + 1.,
-        ceil(bb.size()(1) / distance) + 1.);
-
-	// shift the polyline to the grid origin
-	for (Polyline &pl : polylines)
-		pl.translate(bb.min);
-
-	polylines = intersection_pl(polylines, expolygon);
+    // generate pattern in tiles aligned to a multiple of our grid module,
+    // shared by all the surfaces of all the objects printed at this Z with the same density, spacing and angle
+    FillPatternTiles pattern = FillPatternCache::instance().periodic(
+        FillPatternKey(typeid(*this), { this->z, this->spacing, density_adjusted, infill_angle }), bb, Point(2*M_PI*distance, 2*M_PI*distance),
+        [this, density_adjusted, distance](const BoundingBox &bbox) {
+            Polylines polylines = make_gyroid_waves(
+                scale_(this->z),
+                density_adjusted,
+                this->spacing,
+                ceil(bbox.size()(0) / distance) + 1.,
+                ceil(bbox.size()(1) / distance) + 1.);
+            // shift the polyline to the grid origin
+            for (Polyline &pl : polylines)
+                pl.translate(bbox.min);
+            return polylines;
+        });
+
+	Polylines polylines = clip_fill_pattern(pattern, expolygon);
 
     if (! polylines.empty()) {
 		// Remove very small bits, but be careful to not remove infill lines connecting thin walls!
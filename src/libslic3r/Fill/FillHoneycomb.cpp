@@ -3,6 +3,7 @@
 #include "../Surface.hpp"
 
 #include "FillHoneycomb.hpp"
+#include "FillPatternCache.hpp"
 
 namespace Slic3r {
 
@@ -32,48 +33,44 @@ void FillHoneycomb::_fill_surface_single(
     }
     CacheData &m = it_m->second;
 
-    Polylines all_polylines;
-    {
-        // adjust actual bounding box to the nearest multiple of our hex pattern
-        // and align it so that it matches across layers
-        
-        BoundingBox bounding_box = expolygon.contour.bounding_box();
-        {
-            // rotate bounding box according to infill direction
-            Polygon bb_polygon = bounding_box.polygon();
-            bb_polygon.rotate(direction.first, m.hex_center);
-            bounding_box = bb_polygon.bounding_box();
-            
-            // extend bounding box so that our pattern will be aligned with other layers
-            // $bounding_box->[X1] and [Y1] represent the displacement between new bounding box offset and old one
-            // The infill is not aligned to the object bounding box, but to a world coordinate system. Supposedly good enough.
-            bounding_box.merge(align_to_grid(bounding_box.min, Point(m.hex_width, m.pattern_height)));
-        }
+    // rotate the expolygon according to infill direction, the pattern is generated and clipped in the rotated coordinate system
+    ExPolygon expolygon_rotated = expolygon;
+    expolygon_rotated.rotate(direction.first, m.hex_center);
 
-        coord_t x = bounding_box.min(0);
-        while (x <= bounding_box.max(0)) {
-            Polyline p;
-            coord_t ax[2] = { x + m.x_offset, x + m.distance - m.x_offset };
-            for (size_t i = 0; i < 2; ++ i) {
-                std::reverse(p.points.begin(), p.points.end()); // turn first half upside down
-                for (coord_t y = bounding_box.min(1); y <= bounding_box.max(1); y += m.y_short + m.hex_side + m.y_short + m.hex_side) {
-                    p.points.push_back(Point(ax[1], y + m.y_offset));
-                    p.points.push_back(Point(ax[0], y + m.y_short - m.y_offset));
-                    p.points.push_back(Point(ax[0], y + m.y_short + m.hex_side + m.y_offset));
-                    p.points.push_back(Point(ax[1], y + m.y_short + m.hex_side + m.y_short - m.y_offset));
-                    p.points.push_back(Point(ax[1], y + m.y_short + m.hex_side + m.y_short + m.hex_side + m.y_offset));
+    // The pattern does not depend on Z, it is shared by all the layers and objects with the same density, spacing and direction.
+    // It is generated in tiles aligned to a multiple of our hex pattern, so that it matches across layers.
+    // The infill is not aligned to the object bounding box, but to a world coordinate system. Supposedly good enough.
+    FillPatternTiles pattern = FillPatternCache::instance().periodic(
+        FillPatternKey(typeid(*this), { params.density, this->spacing, direction.first }),
+        expolygon_rotated.contour.bounding_box(), Point(m.hex_width, m.pattern_height),
+        [&m](const BoundingBox &bbox) {
+            Polylines all_polylines;
+            coord_t x = bbox.min(0);
+            while (x <= bbox.max(0)) {
+                Polyline p;
+                coord_t ax[2] = { x + m.x_offset, x + m.distance - m.x_offset };
+                for (size_t i = 0; i < 2; ++ i) {
+                    std::reverse(p.points.begin(), p.points.end()); // turn first half upside down
+                    for (coord_t y = bbox.min(1); y <= bbox.max(1); y += m.y_short + m.hex_side + m.y_short + m.hex_side) {
+                        p.points.push_back(Point(ax[1], y + m.y_offset));
+                        p.points.push_back(Point(ax[0], y + m.y_short - m.y_offset));
+                        p.points.push_back(Point(ax[0], y + m.y_short + m.hex_side + m.y_offset));
+                        p.points.push_back(Point(ax[1], y + m.y_short + m.hex_side + m.y_short - m.y_offset));
+                        p.points.push_back(Point(ax[1], y + m.y_short + m.hex_side + m.y_short + m.hex_side + m.y_offset));
+                    }
+                    ax[0] = ax[0] + m.distance;
+                    ax[1] = ax[1] + m.distance;
+                    std::swap(ax[0], ax[1]); // draw symmetrical pattern
+                    x += m.distance;
                 }
-                ax[0] = ax[0] + m.distance;
-                ax[1] = ax[1] + m.distance;
-                std::swap(ax[0], ax[1]); // draw symmetrical pattern
-                x += m.distance;
+                all_polylines.push_back(p);
             }
-            p.rotate(-direction.first, m.hex_center);
-            all_polylines.push_back(p);
-        }
-    }
+            return all_polylines;
+    });
     
-    all_polylines = intersection_pl(std::move(all_polylines), expolygon);
+    Polylines all_polylines = clip_fill_pattern(pattern, expolygon_rotated);
+    for (Polyline &pl : all_polylines)
+        pl.rotate(-direction.first, m.hex_center);
     if (params.dont_connect() || all_polylines.size() <= 1)
         append(polylines_out, chain_polylines(std::move(all_polylines)));
     else
@@ -0,0 +1,272 @@
+#include "../ClipperUtils.hpp"
+#include "../ExPolygon.hpp"
+
+#include "FillPatternCache.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include <boost/log/trivial.hpp>
+
+namespace Slic3r {
+
+// Memory occupied by the cached patterns, above which the least recently used patterns are released.
+static constexpr const size_t FILL_PATTERN_CACHE_MEMORY_LIMIT = 256 * 1024 * 1024;
+
+static size_t polylines_memory_usage(const Polylines &polylines)
+{
+    size_t out = polylines.capacity() * sizeof(Polyline);
+    for (const Polyline &pl : polylines)
+        out += pl.points.capacity() * sizeof(Point);
+    return out;
+}
+
+FillPatternCache& FillPatternCache::instance()
+{
+    static FillPatternCache cache;
+    return cache;
+}
+
+// Size of the tiles of the periodic patterns, rounded to a multiple of the period. Small enough not to generate the pattern
+// far away from the islands, large enough not to split the lines of the pattern too often.
+static constexpr const double FILL_PATTERN_TILE_SIZE = 20.;
+
+// Clip a segment to a bounding box (Liang-Barsky), return false if the segment is fully outside.
+static bool clip_segment(Vec2d &a, Vec2d &b, const BoundingBox &bbox)
+{
+    const Vec2d v  = b - a;
+    double      t0 = 0.;
+    double      t1 = 1.;
+    for (int axis = 0; axis < 2; ++ axis) {
+        const double p[2] = { - v[axis], v[axis] };
+        const double q[2] = { a[axis] - double(bbox.min[axis]), double(bbox.max[axis]) - a[axis] };
+        for (int i = 0; i < 2; ++ i) {
+            if (p[i] == 0.) {
+                if (q[i] < 0.)
+                    return false;
+            } else {
+                const double t = q[i] / p[i];
+                if (p[i] < 0.) {
+                    if (t > t1)
+                        return false;
+                    t0 = std::max(t0, t);
+                } else {
+                    if (t < t0)
+                        return false;
+                    t1 = std::min(t1, t);
+                }
+            }
+        }
+    }
+    const Vec2d a0 = a;
+    a = a0 + t0 * v;
+    b = a0 + t1 * v;
+    return true;
+}
+
+// Crop a pattern generated with a margin to its tile. The segments lying on the upper boundaries of the tile belong to the next tile.
+static Polylines crop_to_tile(Polylines &&pattern, const BoundingBox &tile)
+{
+    Polylines out;
+    for (const Polyline &pl : pattern) {
+        bool open = false;
+        for (size_t i = 1; i < pl.points.size(); ++ i) {
+            Vec2d a = pl.points[i - 1].cast<double>();
+            Vec2d b = pl.points[i].cast<double>();
+            if (! clip_segment(a, b, tile)) {
+                open = false;
+                continue;
+            }
+            const Point pa(coord_t(std::round(a.x())), coord_t(std::round(a.y())));
+            const Point pb(coord_t(std::round(b.x())), coord_t(std::round(b.y())));
+            if (pa == pb || (pa.x() == tile.max.x() && pb.x() == tile.max.x()) || (pa.y() == tile.max.y() && pb.y() == tile.max.y())) {
+                open = false;
+                continue;
+            }
+            if (! open || out.back().points.back() != pa) {
+                out.emplace_back();
+                out.back().points.emplace_back(pa);
+            }
+            out.back().points.emplace_back(pb);
+            // The polyline continues with the next segment only if this segment ends inside the tile.
+            open = pb == pl.points[i];
+        }
+    }
+    return out;
+}
+
+// Floor of the division, the tiles are indexed from the origin to both sides.
+static coord_t tile_index(coord_t c, coord_t tile_size)
+{
+    return c >= 0 ? c / tile_size : - ((- c - 1) / tile_size) - 1;
+}
+
+FillPatternTiles FillPatternCache::periodic(const FillPatternKey &key, const BoundingBox &bbox, const Point &period, const std::function<Polylines(const BoundingBox&)> &generate)
+{
+    assert(period.x() > 0 && period.y() > 0);
+    const coord_t tile_size_x = period.x() * std::max<coord_t>(1, coord_t(std::round(scale_(FILL_PATTERN_TILE_SIZE) / double(period.x()))));
+    const coord_t tile_size_y = period.y() * std::max<coord_t>(1, coord_t(std::round(scale_(FILL_PATTERN_TILE_SIZE) / double(period.y()))));
+    const coord_t ix_min      = tile_index(bbox.min.x(), tile_size_x);
+    const coord_t ix_max      = tile_index(bbox.max.x(), tile_size_x);
+    const coord_t iy_min      = tile_index(bbox.min.y(), tile_size_y);
+    const coord_t iy_max      = tile_index(bbox.max.y(), tile_size_y);
+
+    FillPatternTiles out;
+    out.reserve(size_t(ix_max - ix_min + 1) * size_t(iy_max - iy_min + 1));
+    for (coord_t iy = iy_min; iy <= iy_max; ++ iy)
+        for (coord_t ix = ix_min; ix <= ix_max; ++ ix) {
+            TileKey tile_key { key, ix, iy };
+            std::shared_ptr<const Polylines> tile = this->find(tile_key);
+            if (! tile) {
+                // Generate outside of the lock, the other tiles are generated concurrently.
+                BoundingBox tile_bbox(Point(ix * tile_size_x, iy * tile_size_y), Point((ix + 1) * tile_size_x, (iy + 1) * tile_size_y));
+                BoundingBox bbox_generate(tile_bbox.min - period, tile_bbox.max + period);
+                tile = this->insert(tile_key, crop_to_tile(generate(bbox_generate), tile_bbox));
+            }
+            out.emplace_back(std::move(tile));
+        }
+    return out;
+}
+
+std::shared_ptr<const Polylines> FillPatternCache::fixed(const FillPatternKey &key, const std::function<Polylines()> &generate)
+{
+    TileKey tile_key { key, 0, 0 };
+    if (std::shared_ptr<const Polylines> pattern = this->find(tile_key); pattern)
+        return pattern;
+    return this->insert(tile_key, generate());
+}
+
+std::shared_ptr<const Polylines> FillPatternCache::find(const TileKey &key)
+{
+    std::scoped_lock<std::mutex> lock(m_mutex);
+    if (auto it = m_entries.find(key); it != m_entries.end()) {
+        it->second.last_used = ++ m_timestamp;
+        return it->second.polylines;
+    }
+    return {};
+}
+
+std::shared_ptr<const Polylines> FillPatternCache::insert(const TileKey &key, Polylines &&polylines)
+{
+    auto   pattern = std::make_shared<const Polylines>(std::move(polylines));
+    size_t memory  = polylines_memory_usage(*pattern);
+
+    std::scoped_lock<std::mutex> lock(m_mutex);
+    Entry &entry = m_entries[key];
+    entry.last_used = ++ m_timestamp;
+    // The same pattern may have been generated by another thread in the meantime, keep the cached one.
+    if (entry.polylines)
+        return entry.polylines;
+    entry.polylines = pattern;
+    entry.memory    = memory;
+    m_memory += memory;
+
+    // Release the least recently used patterns. The patterns still in use by the infill threads are released once the threads are done with them.
+    while (m_memory > FILL_PATTERN_CACHE_MEMORY_LIMIT && m_entries.size() > 1) {
+        auto it_lru = m_entries.end();
+        for (auto it = m_entries.begin(); it != m_entries.end(); ++ it)
+            if (it->second.last_used != entry.last_used && (it_lru == m_entries.end() || it->second.last_used < it_lru->second.last_used))
+                it_lru = it;
+        m_memory -= it_lru->second.memory;
+        m_entries.erase(it_lru);
+    }
+    return pattern;
+}
+
+void FillPatternCache::clear()
+{
+    std::scoped_lock<std::mutex> lock(m_mutex);
+    if (! m_entries.empty())
+        BOOST_LOG_TRIVIAL(debug) << "Releasing " << m_entries.size() << " infill pattern tiles occupying " << m_memory << " bytes";
+    m_entries.clear();
+    m_memory = 0;
+}
+
+// Keep the runs of the pattern segments overlapping the bounding box.
+static void crop_to_bbox(const Polylines &pattern, const BoundingBox &bbox, Polylines &out)
+{
+    for (const Polyline &pl : pattern) {
+        bool inside = false;
+        for (size_t i = 1; i < pl.points.size(); ++ i) {
+            const Point &a = pl.points[i - 1];
+            const Point &b = pl.points[i];
+            if (std::max(a.x(), b.x()) < bbox.min.x() || std::min(a.x(), b.x()) > bbox.max.x() ||
+                std::max(a.y(), b.y()) < bbox.min.y() || std::min(a.y(), b.y()) > bbox.max.y())
+                inside = false;
+            else {
+                if (! inside) {
+                    out.emplace_back();
+                    out.back().points.emplace_back(a);
+                    inside = true;
+                }
+                out.back().points.emplace_back(b);
+            }
+        }
+    }
+}
+
+Polylines clip_fill_pattern(const Polylines &pattern, const ExPolygon &expolygon)
+{
+    BoundingBox bbox = get_extents(expolygon.contour);
+    bbox.offset(SCALED_EPSILON);
+    Polylines cropped;
+    crop_to_bbox(pattern, bbox, cropped);
+    return intersection_pl(std::move(cropped), expolygon);
+}
+
+// Join the polylines split at the tile boundaries: A polyline continues with the polyline starting at its end.
+// The neighbor tiles are generated over differently aligned bounding boxes, thus the split points may differ by a rounding error.
+static Polylines join_tile_polylines(Polylines &&polylines)
+{
+    const coord_t                           eps = SCALED_EPSILON;
+    std::vector<std::pair<Point, size_t>>   starts;
+    starts.reserve(polylines.size());
+    for (size_t i = 0; i < polylines.size(); ++ i)
+        starts.emplace_back(polylines[i].first_point(), i);
+    std::sort(starts.begin(), starts.end(), [](const auto &l, const auto &r) { return l.first.x() < r.first.x() || (l.first.x() == r.first.x() && l.first.y() < r.first.y()); });
+
+    static constexpr const size_t npos = size_t(-1);
+    std::vector<size_t> next(polylines.size(), npos);
+    std::vector<char>   has_prev(polylines.size(), false);
+    for (size_t i = 0; i < polylines.size(); ++ i) {
+        const Point end = polylines[i].last_point();
+        for (auto it = std::lower_bound(starts.begin(), starts.end(), end.x() - eps, [](const auto &l, coord_t x) { return l.first.x() < x; });
+             it != starts.end() && it->first.x() <= end.x() + eps; ++ it)
+            if (size_t j = it->second; j != i && ! has_prev[j] && std::abs(it->first.y() - end.y()) <= eps) {
+                next[i]     = j;
+                has_prev[j] = true;
+                break;
+            }
+    }
+
+    Polylines         out;
+    std::vector<char> done(polylines.size(), false);
+    auto chain = [&polylines, &next, &done, &out](size_t i) {
+        done[i] = true;
+        Polyline &pl = out.emplace_back(std::move(polylines[i]));
+        for (size_t j = next[i]; j != npos && ! done[j]; j = next[j]) {
+            done[j] = true;
+            pl.points.insert(pl.points.end(), polylines[j].points.begin() + 1, polylines[j].points.end());
+        }
+    };
+    for (size_t i = 0; i < polylines.size(); ++ i)
+        if (! has_prev[i])
+            chain(i);
+    // Closed loops split into several polylines.
+    for (size_t i = 0; i < polylines.size(); ++ i)
+        if (! done[i])
+            chain(i);
+    return out;
+}
+
+Polylines clip_fill_pattern(const FillPatternTiles &tiles, const ExPolygon &expolygon)
+{
+    BoundingBox bbox = get_extents(expolygon.contour);
+    bbox.offset(SCALED_EPSILON);
+    Polylines cropped;
+    for (const std::shared_ptr<const Polylines> &tile : tiles)
+        crop_to_bbox(*tile, bbox, cropped);
+    return intersection_pl(join_tile_polylines(std::move(cropped)), expolygon);
+}
+
+} // namespace Slic3r
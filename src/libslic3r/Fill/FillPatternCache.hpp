@@ -0,0 +1,98 @@
+#ifndef slic3r_FillPatternCache_hpp_
+#define slic3r_FillPatternCache_hpp_
+
+#include "../libslic3r.h"
+#include "../BoundingBox.hpp"
+#include "../Polyline.hpp"
+
+#include <array>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <typeindex>
+#include <vector>
+
+namespace Slic3r {
+
+class ExPolygon;
+
+// Identification of an infill pattern: The type of the Fill generating the pattern and the parameters of the pattern,
+// for example Z, spacing and angle. The meaning of the parameters depends on the Fill type, the unused parameters are zero.
+struct FillPatternKey
+{
+    FillPatternKey(std::type_index type, std::initializer_list<double> values) : type(type) {
+        assert(values.size() <= params.size());
+        params.fill(0.);
+        std::copy(values.begin(), values.end(), params.begin());
+    }
+
+    std::type_index         type;
+    std::array<double, 6>   params;
+
+    bool operator<(const FillPatternKey &rhs) const { return type < rhs.type || (type == rhs.type && params < rhs.params); }
+};
+
+// Tiles of a periodic pattern overlapping a bounding box.
+using FillPatternTiles = std::vector<std::shared_ptr<const Polylines>>;
+
+// Infill patterns shared by all the Fill instances, thus by all the regions, islands and objects printed
+// with the same pattern parameters. Thread safe, the infill is generated in parallel over layers.
+// The least recently used patterns are released above a memory limit.
+class FillPatternCache
+{
+public:
+    static FillPatternCache& instance();
+
+    // Tiles of a periodic pattern overlapping bbox. The plane is split into tiles of a fixed size, a multiple of the period
+    // of the pattern, starting at the origin. Only the tiles not cached yet are generated, thus filling the objects
+    // one after another generates each tile of the plate once. generate(bbox) shall generate the pattern over bbox aligned
+    // to the period, the tile is generated with a margin of one period and cropped, so that the ends of the generated lines
+    // do not show up inside the tile.
+    FillPatternTiles                 periodic(const FillPatternKey &key, const BoundingBox &bbox, const Point &period, const std::function<Polylines(const BoundingBox&)> &generate);
+    // Pattern fully identified by its key.
+    std::shared_ptr<const Polylines> fixed(const FillPatternKey &key, const std::function<Polylines()> &generate);
+
+    // Release all the cached patterns, to be called once the infill is generated.
+    void    clear();
+    size_t  memory_usage() const { std::scoped_lock<std::mutex> lock(m_mutex); return m_memory; }
+
+private:
+    FillPatternCache() = default;
+
+    struct TileKey {
+        FillPatternKey  pattern;
+        // Index of the tile, zero for the fixed patterns.
+        coord_t         ix;
+        coord_t         iy;
+
+        bool operator<(const TileKey &rhs) const {
+            return pattern < rhs.pattern || (! (rhs.pattern < pattern) && (ix < rhs.ix || (ix == rhs.ix && iy < rhs.iy)));
+        }
+    };
+
+    struct Entry {
+        std::shared_ptr<const Polylines>    polylines;
+        size_t                              memory    { 0 };
+        size_t                              last_used { 0 };
+    };
+
+    std::shared_ptr<const Polylines> find(const TileKey &key);
+    std::shared_ptr<const Polylines> insert(const TileKey &key, Polylines &&polylines);
+
+    mutable std::mutex                      m_mutex;
+    std::map<TileKey, Entry>                m_entries;
+    size_t                                  m_memory    { 0 };
+    size_t                                  m_timestamp { 0 };
+};
+
+// Clip a pattern with an expolygon. The pattern is first cropped to the bounding box of the expolygon in a single linear pass
+// before clipping with Clipper.
+Polylines clip_fill_pattern(const Polylines &pattern, const ExPolygon &expolygon);
+// Clip the tiles of a periodic pattern with an expolygon. Only the tiles overlapping the bounding box of the expolygon
+// shall be passed, the lines of the pattern split at the tile boundaries are joined again before clipping.
+Polylines clip_fill_pattern(const FillPatternTiles &tiles, const ExPolygon &expolygon);
+
+} // namespace Slic3r
+
+#endif // slic3r_FillPatternCache_hpp_
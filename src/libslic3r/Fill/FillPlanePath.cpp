@@ -2,6 +2,7 @@
 #include "../ShortestPath.hpp"
 #include "../Surface.hpp"
 
+#include "FillPatternCache.hpp"
 #include "FillPlanePath.hpp"
 
 namespace Slic3r {
@@ -27,22 +28,30 @@ void FillPlanePath::_fill_surface_single(
     expolygon.translate(-shift.x(), -shift.y());
     bounding_box.translate(-shift.x(), -shift.y());
 
-    Pointfs pts = _generate(
-        coord_t(ceil(coordf_t(bounding_box.min.x()) / distance_between_lines)),
-        coord_t(ceil(coordf_t(bounding_box.min.y()) / distance_between_lines)),
-        coord_t(ceil(coordf_t(bounding_box.max.x()) / distance_between_lines)),
-        coord_t(ceil(coordf_t(bounding_box.max.y()) / distance_between_lines)));
+    coord_t min_x = coord_t(ceil(coordf_t(bounding_box.min.x()) / distance_between_lines));
+    coord_t min_y = coord_t(ceil(coordf_t(bounding_box.min.y()) / distance_between_lines));
+    coord_t max_x = coord_t(ceil(coordf_t(bounding_box.max.x()) / distance_between_lines));
+    coord_t max_y = coord_t(ceil(coordf_t(bounding_box.max.y()) / distance_between_lines));
+    // The path only depends on the extents of the object, it is shared by all the layers and by the objects of the same size.
+    std::shared_ptr<const Polylines> pattern = FillPatternCache::instance().fixed(
+        FillPatternKey(typeid(*this), { double(distance_between_lines), double(min_x), double(min_y), double(max_x), double(max_y) }),
+        [this, distance_between_lines, min_x, min_y, max_x, max_y]() {
+            Polylines polylines;
+            Pointfs pts = _generate(min_x, min_y, max_x, max_y);
+            if (pts.size() >= 2) {
+                // Convert points to a polyline, upscale.
+                Polyline &polyline = polylines.emplace_back();
+                polyline.points.reserve(pts.size());
+                for (const Vec2d &pt : pts)
+                    polyline.points.emplace_back(
+                        coord_t(floor(pt.x() * distance_between_lines + 0.5)),
+                        coord_t(floor(pt.y() * distance_between_lines + 0.5)));
+            }
+            return polylines;
+        });
 
-    if (pts.size() >= 2) {
-        // Convert points to a polyline, upscale.
-        Polylines polylines(1, Polyline());
-        Polyline &polyline = polylines.front();
-        polyline.points.reserve(pts.size());
-        for (const Vec2d &pt : pts)
-            polyline.points.emplace_back(
-                coord_t(floor(pt.x() * distance_between_lines + 0.5)),
-                coord_t(floor(pt.y() * distance_between_lines + 0.5)));
-        polylines = intersection_pl(polylines, expolygon);
+    if (! pattern->empty()) {
+        Polylines polylines = clip_fill_pattern(*pattern, expolygon);
         Polylines chained;
         if (params.dont_connect() || params.density > 0.5 || polylines.size() <= 1)
             chained = chain_polylines(std::move(polylines));
@@ -10,6 +10,8 @@
 #include <boost/log/trivial.hpp>
 #include <boost/static_assert.hpp>
 
+#include <tbb/parallel_for.h>
+
 #include "../ClipperUtils.hpp"
 #include "../ExPolygon.hpp"
 #include "../Geometry.hpp"
@@ -2213,8 +2215,11 @@ inline void print_ant(const std::string& fmt, TArgs&&... args) {
 
 // Find a run through monotonic infill blocks using an 'Ant colony" optimization method.
 // http://www.scholarpedia.org/article/Ant_colony_optimization
-static std::vector<MonotonicRegionLink> chain_monotonic_regions(
-	std::vector<MonotonicRegion> &regions, const ExPolygonWithOffset &poly_with_offset, const std::vector<SegmentedIntersectionLine> &segs, std::mt19937_64 &rng)
+// A single ant colony running for at most num_rounds rounds, returns the shortest path found and its length.
+// The regions are only read, thus multiple colonies may run in parallel over the same regions.
+static std::vector<MonotonicRegionLink> chain_monotonic_regions_ant_colony(
+	std::vector<MonotonicRegion> &regions, const ExPolygonWithOffset &poly_with_offset, const std::vector<SegmentedIntersectionLine> &segs, 
+	std::mt19937_64 &rng, const int num_rounds, float &path_length_out)
 {
 	// Number of left neighbors (regions that this region depends on, this region cannot be printed before the regions left of it are printed) + self.
 	std::vector<int32_t>			left_neighbors_unprocessed(regions.size(), 1);
@@ -2302,8 +2307,6 @@ static std::vector<MonotonicRegionLink> chain_monotonic_regions(
         };
 #endif /* NDEBUG */
 
-	// How many times to repeat the ant simulation (number of ant generations).
-	constexpr int const   num_rounds = 25;
 	// After how many rounds without an improvement to exit?
 	constexpr int const   num_rounds_no_change_exit = 8;
 	// With how many ants each of the run will be performed?
@@ -2574,9 +2577,51 @@ static std::vector<MonotonicRegionLink> chain_monotonic_regions(
 	}
 
 end:
+    path_length_out = best_path_length;
     return best_path;
 }
 
+// Maximum number of regions visited by the ants of a single colony, limits the number of rounds for surfaces split into many regions.
+static constexpr const size_t MONOTONIC_MAX_ANT_STEPS        = 100000;
+// Surfaces split into fewer regions are chained by a single colony, their paths are short and the infill is already parallel over the surfaces.
+static constexpr const size_t MONOTONIC_MIN_REGIONS_COLONIES = 32;
+// Number of ant colonies running in parallel, fixed so that the result does not depend on the number of threads.
+static constexpr const size_t MONOTONIC_MAX_COLONIES         = 4;
+// Maximum memory of the path matrices of the ant colonies running in parallel.
+static constexpr const size_t MONOTONIC_MAX_COLONIES_MEMORY  = 64 * 1024 * 1024;
+
+// Chain the regions by an ant colony, keep the shortest path. Each colony runs the full number of rounds and exits early
+// if its path does not improve, thus the total work is at most num_colonies * num_rounds rounds and usually much less.
+// Only surfaces split into many regions, whose chaining dominates the infill step, run additional colonies in parallel.
+// The number of colonies depends on the regions only and each colony is seeded with its index, the shortest path
+// of the colony with the lowest index wins a tie, thus the result is reproducible on any number of threads.
+static std::vector<MonotonicRegionLink> chain_monotonic_regions(
+	std::vector<MonotonicRegion> &regions, const ExPolygonWithOffset &poly_with_offset, const std::vector<SegmentedIntersectionLine> &segs, int max_rounds)
+{
+	const size_t num_ants      = std::min<size_t>(regions.size(), 10);
+	const int    num_rounds    = int(std::clamp<size_t>(MONOTONIC_MAX_ANT_STEPS / (num_ants * regions.size()), 1, size_t(std::max(1, max_rounds))));
+	const size_t matrix_memory = regions.size() * regions.size() * 4 * sizeof(AntPath);
+	const size_t num_colonies  = regions.size() < MONOTONIC_MIN_REGIONS_COLONIES ? 1 :
+		std::clamp<size_t>(MONOTONIC_MAX_COLONIES_MEMORY / matrix_memory, 1, MONOTONIC_MAX_COLONIES);
+
+	if (num_colonies == 1) {
+		std::mt19937_64 rng;
+		float           length;
+		return chain_monotonic_regions_ant_colony(regions, poly_with_offset, segs, rng, num_rounds, length);
+	}
+
+	std::vector<std::vector<MonotonicRegionLink>> paths(num_colonies);
+	std::vector<float>                            lengths(num_colonies, std::numeric_limits<float>::max());
+	tbb::parallel_for(tbb::blocked_range<size_t>(0, num_colonies), 
+		[&regions, &poly_with_offset, &segs, num_rounds, &paths, &lengths](const tbb::blocked_range<size_t> &range) {
+		for (size_t colony = range.begin(); colony < range.end(); ++ colony) {
+			std::mt19937_64 rng(std::mt19937_64::default_seed + colony);
+			paths[colony] = chain_monotonic_regions_ant_colony(regions, poly_with_offset, segs, rng, num_rounds, lengths[colony]);
+		}
+	});
+	return std::move(paths[std::min_element(lengths.begin(), lengths.end()) - lengths.begin()]);
+}
+
 // Traverse path, produce polylines.
 static void polylines_from_paths(const std::vector<MonotonicRegionLink> &path, const ExPolygonWithOffset &poly_with_offset, const std::vector<SegmentedIntersectionLine> &segs, Polylines &polylines_out)
 {
@@ -2840,8 +2885,7 @@ bool FillRectilinear::fill_surface_by_lines(const Surface *surface, const FillPa
 #endif // INFILL_DEBUG_OUTPUT
 		connect_monotonic_regions(regions, poly_with_offset, segs);
         if (! regions.empty()) {
-		    std::mt19937_64 rng;
-		    std::vector<MonotonicRegionLink> path = chain_monotonic_regions(regions, poly_with_offset, segs, rng);
+		    std::vector<MonotonicRegionLink> path = chain_monotonic_regions(regions, poly_with_offset, segs, params.monotonic_max_rounds);
 		    polylines_from_paths(path, poly_with_offset, segs, polylines_out);
         }
 	} else
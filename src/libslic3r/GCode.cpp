@@ -7,6 +7,7 @@
 #include "Geometry.hpp"
 #include "GCode/PrintExtents.hpp"
 #include "GCode/WipeTower.hpp"
+#include "LayerSpill.hpp"
 #include "ShortestPath.hpp"
 #include "Print.hpp"
 #include "Utils.hpp"
@@ -34,6 +35,7 @@
 #include "SVG.hpp"
 
 #include <tbb/parallel_for.h>
+#include <tbb/pipeline.h>
 
 #include <Shiny/Shiny.h>
 
@@ -57,6 +59,9 @@ namespace Slic3r {
 #define L(s) (s)
 #define _(s) Slic3r::I18N::translate(s)
 
+// Number of layers in flight in the G-code export pipeline of a sequential print.
+static constexpr const size_t GCODE_EXPORT_PIPELINE_MAX_LAYERS = 8;
+
 // Only add a newline in case the current G-code does not end with a newline.
     static inline void check_add_eol(std::string& gcode)
     {
@@ -517,8 +522,9 @@ std::vector<GCode::LayerToPrint> GCode::collect_layers_to_print(const PrintObjec
 
         layers_to_print.emplace_back(layer_to_print);
 
-        bool has_extrusions = (layer_to_print.object_layer && layer_to_print.object_layer->has_extrusions())
-            || (layer_to_print.support_layer && layer_to_print.support_layer->has_extrusions());
+        const LayerSpill *layer_spill = object.print()->layer_spill();
+        bool has_extrusions = (layer_to_print.object_layer && layer_has_extrusions(layer_spill, *layer_to_print.object_layer))
+            || (layer_to_print.support_layer && layer_has_extrusions(layer_spill, *layer_to_print.support_layer));
 
         // Check that there are extrusions on the very first layer.
         if (layers_to_print.size() == 1u) {
@@ -527,7 +533,7 @@ std::vector<GCode::LayerToPrint> GCode::collect_layers_to_print(const PrintObjec
         }
 
         // In case there are extrusions on this layer, check there is a layer to lay it on.
-        if ((layer_to_print.object_layer && layer_to_print.object_layer->has_extrusions())
+        if ((layer_to_print.object_layer && layer_has_extrusions(layer_spill, *layer_to_print.object_layer))
             // Allow empty support layers, as the support generator may produce no extrusions for non-empty support regions.
             || (layer_to_print.support_layer /* && layer_to_print.support_layer->has_extrusions() */)) {
             double support_contact_z = (last_extrusion_layer && last_extrusion_layer->support_layer)
@@ -716,7 +722,7 @@ namespace DoExport {
 #endif // ENABLE_VALIDATE_CUSTOM_GCODE
 } // namespace DoExport
 
-void GCode::do_export(Print* print, const char* path, GCodeProcessor::Result* result, ThumbnailsGeneratorCallback thumbnail_cb)
+void GCode::do_export(Print* print, const char* path, GCodeProcessor::Result* result, ThumbnailsGeneratorCallback thumbnail_cb, GCodeCompressedOutput compressed_output)
 {
     PROFILE_CLEAR();
 
@@ -749,6 +755,13 @@ void GCode::do_export(Print* print, const char* path, GCodeProcessor::Result* re
     // Remove the old g-code if it exists.
     boost::nowide::remove(path);
 
+    const GCodeCompression compression = print->config().gcode_compression.value;
+    if (compression == GCodeCompression::None)
+        compressed_output = GCodeCompressedOutput::None;
+    const std::string compressed_path = compressed_output == GCodeCompressedOutput::None ? std::string() : compressed_gcode_path(path, compression);
+    if (! compressed_path.empty())
+        boost::nowide::remove(compressed_path.c_str());
+
     std::string path_tmp(path);
     path_tmp += ".tmp";
 
@@ -789,8 +802,25 @@ void GCode::do_export(Print* print, const char* path, GCodeProcessor::Result* re
         throw Slic3r::PlaceholderParserError(msg);
     }
 
-    BOOST_LOG_TRIVIAL(debug) << "Start processing gcode, " << log_memory_info();
-    m_processor.process_file(path_tmp, true, [print]() { print->throw_if_canceled(); });
+    // The G-code has already been processed while being exported, only the M73 lines remain to be inserted.
+    // The compressed G-code is written by the same pass over the G-code, if the G-code is post-processed at all.
+    try {
+        if (m_processor.needs_postprocess()) {
+            BOOST_LOG_TRIVIAL(debug) << "Start post-processing gcode, " << log_memory_info();
+            if (compressed_path.empty())
+                m_processor.post_process(path_tmp);
+            else {
+                GCodeCompressor compressor(compressed_path, compression);
+                m_processor.post_process(path_tmp, &compressor, compressed_output == GCodeCompressedOutput::WithPlain);
+                compressor.close();
+            }
+        } else if (! compressed_path.empty())
+            compress_gcode_file(path_tmp, compressed_path, compression);
+    } catch (std::exception & /* ex */) {
+        if (! compressed_path.empty())
+            boost::nowide::remove(compressed_path.c_str());
+        throw;
+    }
 //    DoExport::update_print_estimated_times_stats(m_processor, print->m_print_statistics);
     DoExport::update_print_estimated_stats(m_processor, m_writer.extruders(), print->m_print_statistics);
 #if ENABLE_GCODE_WINDOW
@@ -803,9 +833,11 @@ void GCode::do_export(Print* print, const char* path, GCodeProcessor::Result* re
     if (result != nullptr)
         *result = std::move(m_processor.extract_result());
 #endif // ENABLE_GCODE_WINDOW
-    BOOST_LOG_TRIVIAL(debug) << "Finished processing gcode, " << log_memory_info();
+    BOOST_LOG_TRIVIAL(debug) << "Finished post-processing gcode, " << log_memory_info();
 
-    if (rename_file(path_tmp, path))
+    if (compressed_output == GCodeCompressedOutput::Only)
+        boost::nowide::remove(path_tmp.c_str());
+    else if (rename_file(path_tmp, path))
         throw Slic3r::RuntimeError(
             std::string("Failed to rename the output G-code file from ") + path_tmp + " to " + path + '\n' +
             "Is " + path_tmp + " locked?" + '\n');
@@ -834,9 +866,11 @@ namespace DoExport {
 	    // get the minimum cross-section used in the print
 	    std::vector<double> mm3_per_mm;
 	    for (auto object : print.objects()) {
-	        for (size_t region_id = 0; region_id < object->num_printing_regions(); ++ region_id) {
-	            const PrintRegion &region = object->printing_region(region_id);
-	            for (auto layer : object->layers()) {
+	        // Layers in the outer loop to load each spilled layer back just once.
+	        for (auto layer : object->layers()) {
+	            RestoredLayers restored(print.layer_spill(), { layer });
+	            for (size_t region_id = 0; region_id < object->num_printing_regions(); ++ region_id) {
+	                const PrintRegion &region = object->printing_region(region_id);
 	                const LayerRegion* layerm = layer->regions()[region_id];
 	                if (region.config().get_abs_value("perimeter_speed") == 0 ||
 	                    region.config().get_abs_value("small_perimeter_speed") == 0 ||
@@ -865,8 +899,10 @@ namespace DoExport {
 	        }
 	        if (object->config().get_abs_value("support_material_speed") == 0 ||
 	            object->config().get_abs_value("support_material_interface_speed") == 0)
-	            for (auto layer : object->support_layers())
+	            for (auto layer : object->support_layers()) {
+	                RestoredLayers restored(print.layer_spill(), { layer });
 	                mm3_per_mm.push_back(layer->support_fills.min_mm3_per_mm());
+	            }
 	    }
 	    // filter out 0-width segments
 	    mm3_per_mm.erase(std::remove_if(mm3_per_mm.begin(), mm3_per_mm.end(), [](double v) { return v < 0.000001; }), mm3_per_mm.end());
@@ -1022,6 +1058,28 @@ namespace DoExport {
     }
 }
 
+// Object and support layers exported together by a single call to GCode::process_layer().
+static std::vector<const Layer*> layers_of_layers_to_print(const std::vector<GCode::LayerToPrint> &layers_to_print)
+{
+    std::vector<const Layer*> out;
+    out.reserve(2 * layers_to_print.size());
+    for (const GCode::LayerToPrint &ltp : layers_to_print) {
+        if (ltp.object_layer != nullptr)
+            out.emplace_back(ltp.object_layer);
+        if (ltp.support_layer != nullptr)
+            out.emplace_back(ltp.support_layer);
+    }
+    return out;
+}
+
+// Memory budget for the boundaries of AvoidCrossingPerimeters precomputed ahead of the layer being exported,
+// limited further by the budget of the layers kept in memory if the user set one.
+static size_t avoid_crossing_perimeters_memory_budget(const Print &print)
+{
+    size_t budget = AvoidCrossingPerimeters::DEFAULT_MEMORY_BUDGET;
+    return print.layer_memory_budget() > 0 ? std::min(budget, print.layer_memory_budget()) : budget;
+}
+
 #if 0
 // Sort the PrintObjects by their increasing Z, likely useful for avoiding colisions on Deltas during sequential prints.
 static inline std::vector<const PrintInstance*> sort_object_instances_by_max_z(const Print &print)
@@ -1065,6 +1123,9 @@ void GCode::_do_export(Print& print, FILE* file, ThumbnailsGeneratorCallback thu
 
     // modifies m_silent_time_estimator_enabled
     DoExport::init_gcode_processor(print.config(), m_processor, m_silent_time_estimator_enabled);
+    m_processor.initialize();
+    m_gcode_tail.clear();
+    m_gcode_tail_hold = false;
 
     // resets analyzer's tracking data
     m_last_height  = 0.f;
@@ -1114,6 +1175,8 @@ void GCode::_do_export(Print& print, FILE* file, ThumbnailsGeneratorCallback thu
     m_cooling_buffer = make_unique<CoolingBuffer>(*this);
     if (print.config().spiral_vase.value)
         m_spiral_vase = make_unique<SpiralVase>(print.config());
+    if (ArcFitter::enabled(print.config()))
+        m_arc_fitter = make_unique<ArcFitter>(print.config());
 #ifdef HAS_PRESSURE_EQUALIZER
     if (print.config().max_volumetric_extrusion_rate_slope_positive.value > 0 ||
         print.config().max_volumetric_extrusion_rate_slope_negative.value > 0)
@@ -1358,13 +1421,43 @@ void GCode::_do_export(Print& print, FILE* file, ThumbnailsGeneratorCallback thu
             m_cooling_buffer->set_current_extruder(initial_extruder_id);
             // Pair the object layers with the support layers by z, extrude them.
             std::vector<LayerToPrint> layers_to_print = collect_layers_to_print(object);
-            for (const LayerToPrint &ltp : layers_to_print) {
-                std::vector<LayerToPrint> lrs;
-                lrs.emplace_back(std::move(ltp));
-                this->process_layer(file, print, lrs, tool_ordering.tools_for_layer(ltp.print_z()), &ltp == &layers_to_print.back(), 
-                    nullptr, *print_object_instance_sequential_active - object.instances().data());
-                print.throw_if_canceled();
+            if (print.config().avoid_crossing_perimeters) {
+                std::vector<std::vector<const Layer*>> layer_groups;
+                layer_groups.reserve(layers_to_print.size());
+                for (const LayerToPrint &ltp : layers_to_print)
+                    layer_groups.emplace_back(layers_of_layers_to_print({ ltp }));
+                m_avoid_crossing_perimeters.init_layers(std::move(layer_groups), avoid_crossing_perimeters_memory_budget(print));
             }
+            // The layers of the object are generated, post-processed by the cooling buffer and written into the file in a pipeline.
+            // Each stage carries its state from one layer to the next (the G-code writer, the cooling buffer, the G-code processor),
+            // thus each stage processes the layers in order, while the stages work on different layers concurrently.
+            const size_t single_object_instance_idx = *print_object_instance_sequential_active - object.instances().data();
+            size_t       layer_to_print_idx         = 0;
+            tbb::parallel_pipeline(GCODE_EXPORT_PIPELINE_MAX_LAYERS,
+                tbb::make_filter<void, LayerResult>(tbb::filter::serial_in_order,
+                    [this, &print, &layers_to_print, &layer_to_print_idx, &tool_ordering, single_object_instance_idx](tbb::flow_control &fc) -> LayerResult {
+                        if (layer_to_print_idx == layers_to_print.size()) {
+                            fc.stop();
+                            return LayerResult();
+                        }
+                        print.throw_if_canceled();
+                        const LayerToPrint &ltp = layers_to_print[layer_to_print_idx ++];
+                        // Load the spilled extrusions back for the time of generating the G-code of this layer.
+                        RestoredLayers restored(print.layer_spill(), { ltp.object_layer, ltp.support_layer });
+                        return this->process_layer(print, { ltp }, tool_ordering.tools_for_layer(ltp.print_z()), layer_to_print_idx == layers_to_print.size(),
+                            nullptr, single_object_instance_idx);
+                    }) &
+                tbb::make_filter<LayerResult, LayerResult>(tbb::filter::serial_in_order,
+                    [this](LayerResult layer_result) -> LayerResult {
+                        this->postprocess_layer(layer_result);
+                        return layer_result;
+                    }) &
+                tbb::make_filter<LayerResult, void>(tbb::filter::serial_in_order,
+                    [this, file](LayerResult layer_result) {
+                        if (! layer_result.nop_layer_result)
+                            _write_layer(file, std::move(layer_result.gcode));
+                    }));
+            print.throw_if_canceled();
 #ifdef HAS_PRESSURE_EQUALIZER
             if (m_pressure_equalizer)
                 _write(file, m_pressure_equalizer->process("", true));
@@ -1421,12 +1514,27 @@ void GCode::_do_export(Print& print, FILE* file, ThumbnailsGeneratorCallback thu
             }
             print.throw_if_canceled();
         }
+        if (print.config().avoid_crossing_perimeters) {
+            std::vector<std::vector<const Layer*>> layer_groups;
+            layer_groups.reserve(layers_to_print.size());
+            for (const auto &layer : layers_to_print)
+                layer_groups.emplace_back(layers_of_layers_to_print(layer.second));
+            m_avoid_crossing_perimeters.init_layers(std::move(layer_groups), avoid_crossing_perimeters_memory_budget(print));
+        }
         // Extrude the layers.
         for (auto &layer : layers_to_print) {
             const LayerTools &layer_tools = tool_ordering.tools_for_layer(layer.first);
             if (m_wipe_tower && layer_tools.has_wipe_tower)
                 m_wipe_tower->next_layer();
-            this->process_layer(file, print, layer.second, layer_tools, &layer == &layers_to_print.back(), &print_object_instances_ordering, size_t(-1));
+            LayerResult layer_result;
+            {
+                // Load the spilled extrusions back for the time of generating the G-code of this layer.
+                RestoredLayers restored(print.layer_spill(), layers_of_layers_to_print(layer.second));
+                layer_result = this->process_layer(print, layer.second, layer_tools, &layer == &layers_to_print.back(), &print_object_instances_ordering, size_t(-1));
+            }
+            this->postprocess_layer(layer_result);
+            if (! layer_result.nop_layer_result)
+                _write_layer(file, std::move(layer_result.gcode));
             print.throw_if_canceled();
         }
 #ifdef HAS_PRESSURE_EQUALIZER
@@ -1494,6 +1602,8 @@ void GCode::_do_export(Print& print, FILE* file, ThumbnailsGeneratorCallback thu
     _write_format(file, "; total filament cost = %.2lf\n", print.m_print_statistics.total_cost);
     if (print.m_print_statistics.total_toolchanges > 0)
     	_write_format(file, "; total toolchanges = %i\n", print.m_print_statistics.total_toolchanges);
+    // Hold back the rest of the G-code, so that the placeholder may be replaced once the print time is known.
+    m_gcode_tail_hold = true;
 #if ENABLE_VALIDATE_CUSTOM_GCODE
     _write_format(file, ";%s\n", GCodeProcessor::reserved_tag(GCodeProcessor::ETags::Estimated_Printing_Time_Placeholder).c_str());
 #else
@@ -1509,6 +1619,8 @@ void GCode::_do_export(Print& print, FILE* file, ThumbnailsGeneratorCallback thu
             _write(file, full_config);
     }
     print.throw_if_canceled();
+
+    _write_gcode_tail(file);
 }
 
 std::string GCode::placeholder_parser_process(const std::string &name, const std::string &templ, unsigned int current_extruder_id, const DynamicConfig *config_override)
@@ -1600,12 +1712,12 @@ void GCode::print_machine_envelope(FILE *file, Print &print)
 {
     if ((print.config().gcode_flavor.value == gcfMarlinLegacy || print.config().gcode_flavor.value == gcfMarlinFirmware)
      && print.config().machine_limits_usage.value == MachineLimitsUsage::EmitToGCode) {
-        fprintf(file, "M201 X%d Y%d Z%d E%d ; sets maximum accelerations, mm/sec^2\n",
+        _write_format(file, "M201 X%d Y%d Z%d E%d ; sets maximum accelerations, mm/sec^2\n",
             int(print.config().machine_max_acceleration_x.values.front() + 0.5),
             int(print.config().machine_max_acceleration_y.values.front() + 0.5),
             int(print.config().machine_max_acceleration_z.values.front() + 0.5),
             int(print.config().machine_max_acceleration_e.values.front() + 0.5));
-        fprintf(file, "M203 X%d Y%d Z%d E%d ; sets maximum feedrates, mm/sec\n",
+        _write_format(file, "M203 X%d Y%d Z%d E%d ; sets maximum feedrates, mm/sec\n",
             int(print.config().machine_max_feedrate_x.values.front() + 0.5),
             int(print.config().machine_max_feedrate_y.values.front() + 0.5),
             int(print.config().machine_max_feedrate_z.values.front() + 0.5),
@@ -1618,18 +1730,18 @@ void GCode::print_machine_envelope(FILE *file, Print &print)
         int travel_acc = print.config().gcode_flavor == gcfMarlinLegacy
                        ? int(print.config().machine_max_acceleration_extruding.values.front() + 0.5)
                        : int(print.config().machine_max_acceleration_travel.values.front() + 0.5);
-        fprintf(file, "M204 P%d R%d T%d ; sets acceleration (P, T) and retract acceleration (R), mm/sec^2\n",
+        _write_format(file, "M204 P%d R%d T%d ; sets acceleration (P, T) and retract acceleration (R), mm/sec^2\n",
             int(print.config().machine_max_acceleration_extruding.values.front() + 0.5),
             int(print.config().machine_max_acceleration_retracting.values.front() + 0.5),
             travel_acc);
 
         assert(is_decimal_separator_point());
-        fprintf(file, "M205 X%.2lf Y%.2lf Z%.2lf E%.2lf ; sets the jerk limits, mm/sec\n",
+        _write_format(file, "M205 X%.2lf Y%.2lf Z%.2lf E%.2lf ; sets the jerk limits, mm/sec\n",
             print.config().machine_max_jerk_x.values.front(),
             print.config().machine_max_jerk_y.values.front(),
             print.config().machine_max_jerk_z.values.front(),
             print.config().machine_max_jerk_e.values.front());
-        fprintf(file, "M205 S%d T%d ; sets the minimum extruding and travel feed rate, mm/sec\n",
+        _write_format(file, "M205 S%d T%d ; sets the minimum extruding and travel feed rate, mm/sec\n",
             int(print.config().machine_min_extruding_rate.values.front() + 0.5),
             int(print.config().machine_min_travel_rate.values.front() + 0.5));
     }
@@ -1928,9 +2040,7 @@ namespace Skirt {
 // In non-sequential mode, process_layer is called per each print_z height with all object and support layers accumulated.
 // For multi-material prints, this routine minimizes extruder switches by gathering extruder specific extrusion paths
 // and performing the extruder specific extrusions together.
-void GCode::process_layer(
-    // Write into the output file.
-    FILE                            		*file,
+GCode::LayerResult GCode::process_layer(
     const Print                    			&print,
     // Set of object & print layers of the same PrintObject and with the same print_z.
     const std::vector<LayerToPrint> 		&layers,
@@ -1946,9 +2056,12 @@ void GCode::process_layer(
     // Either printing all copies of all objects, or just a single copy of a single object.
     assert(single_object_instance_idx == size_t(-1) || layers.size() == 1);
 
-    if (layer_tools.extruders.empty())
+    if (layer_tools.extruders.empty()) {
         // Nothing to extrude.
-        return;
+        LayerResult result;
+        result.nop_layer_result = true;
+        return result;
+    }
 
     // Extract 1st object_layer and support_layer of this set of layers with an equal print_z.
     const Layer         *object_layer  = nullptr;
@@ -2222,7 +2335,6 @@ void GCode::process_layer(
     } // for objects
 
     // Extrude the skirt, brim, support, perimeters, infill ordered by the extruders.
-    std::vector<std::unique_ptr<EdgeGrid::Grid>> lower_layer_edge_grids(layers.size());
     for (unsigned int extruder_id : layer_tools.extruders)
     {
         gcode += (layer_tools.has_wipe_tower && m_wipe_tower) ?
@@ -2287,7 +2399,7 @@ void GCode::process_layer(
                 if (m_config.avoid_crossing_perimeters)
                     m_avoid_crossing_perimeters.init_layer(*m_layer);
                 if (this->config().gcode_label_objects)
-                    gcode += std::string("; printing object ") + instance_to_print.print_object.model_object()->name + " id:" + std::to_string(instance_to_print.layer_id) + " copy " + std::to_string(instance_to_print.instance_id) + "\n";
+                    gcode += std::string("; printing object ") + instance_to_print.print_object.instances()[instance_to_print.instance_id].model_instance->get_object()->name + " id:" + std::to_string(instance_to_print.layer_id) + " copy " + std::to_string(instance_to_print.instance_id) + "\n";
                 // When starting a new object, use the external motion planner for the first travel move.
                 const Point &offset = instance_to_print.print_object.instances()[instance_to_print.instance_id].shift;
                 std::pair<const PrintObject*, Point> this_object_copy(&instance_to_print.print_object, offset);
@@ -2297,9 +2409,11 @@ void GCode::process_layer(
                 this->set_origin(unscale(offset));
                 if (instance_to_print.object_by_extruder.support != nullptr && !print_wipe_extrusions) {
                     m_layer = layers[instance_to_print.layer_id].support_layer;
-                    gcode += this->extrude_support(
+                    const ExtrusionEntityCollection &support = *instance_to_print.object_by_extruder.support;
+                    gcode += this->extrude_support(support.no_sort ?
+                        chain_extrusion_references(support) :
                         // support_extrusion_role is erSupportMaterial, erSupportMaterialInterface or erMixed for all extrusion paths.
-                        instance_to_print.object_by_extruder.support->chained_path_from(m_last_pos, instance_to_print.object_by_extruder.support_extrusion_role));
+                        chain_extrusion_references(filter_by_extrusion_role(support.entities, instance_to_print.object_by_extruder.support_extrusion_role), &m_last_pos));
                     m_layer = layers[instance_to_print.layer_id].layer();
                 }
                 //FIXME order islands?
@@ -2309,16 +2423,16 @@ void GCode::process_layer(
                     //FIXME the following code prints regions in the order they are defined, the path is not optimized in any way.
                     if (print.config().infill_first) {
                         gcode += this->extrude_infill(print, by_region_specific, false);
-                        gcode += this->extrude_perimeters(print, by_region_specific, lower_layer_edge_grids[instance_to_print.layer_id]);
+                        gcode += this->extrude_perimeters(print, by_region_specific);
                     } else {
-                        gcode += this->extrude_perimeters(print, by_region_specific, lower_layer_edge_grids[instance_to_print.layer_id]);
+                        gcode += this->extrude_perimeters(print, by_region_specific);
                         gcode += this->extrude_infill(print,by_region_specific, false);
                     }
                     // ironing
                     gcode += this->extrude_infill(print,by_region_specific, true);
                 }
                 if (this->config().gcode_label_objects)
-                    gcode += std::string("; stop printing object ") + instance_to_print.print_object.model_object()->name + " id:" + std::to_string(instance_to_print.layer_id) + " copy " + std::to_string(instance_to_print.instance_id) + "\n";
+                    gcode += std::string("; stop printing object ") + instance_to_print.print_object.instances()[instance_to_print.instance_id].model_instance->get_object()->name + " id:" + std::to_string(instance_to_print.layer_id) + " copy " + std::to_string(instance_to_print.instance_id) + "\n";
             }
         }
     }
@@ -2331,23 +2445,33 @@ void GCode::process_layer(
     if (m_spiral_vase)
         gcode = m_spiral_vase->process_layer(std::move(gcode));
 
+    BOOST_LOG_TRIVIAL(trace) << "Exported layer " << layer.id() << " print_z " << print_z <<
+    log_memory_info();
+
+    LayerResult result;
+    result.gcode                = std::move(gcode);
+    result.layer_id             = layer.id();
+    // Flush the cooling buffer at each object layer or possibly at the last layer, even if it contains just supports (This should not happen).
+    result.cooling_buffer_flush = object_layer || last_layer;
+    return result;
+}
+
+void GCode::postprocess_layer(LayerResult &layer_result)
+{
+    if (layer_result.nop_layer_result)
+        return;
+
     // Apply cooling logic; this may alter speeds.
     if (m_cooling_buffer)
-        gcode = m_cooling_buffer->process_layer(std::move(gcode), layer.id(),
-            // Flush the cooling buffer at each object layer or possibly at the last layer, even if it contains just supports (This should not happen).
-            object_layer || last_layer);
+        layer_result.gcode = m_cooling_buffer->process_layer(std::move(layer_result.gcode), layer_result.layer_id, layer_result.cooling_buffer_flush);
 
 #ifdef HAS_PRESSURE_EQUALIZER
     // Apply pressure equalization if enabled;
     // printf("G-code before filter:\n%s\n", gcode.c_str());
     if (m_pressure_equalizer)
-        gcode = m_pressure_equalizer->process(gcode.c_str(), false);
+        layer_result.gcode = m_pressure_equalizer->process(layer_result.gcode.c_str(), false);
     // printf("G-code after filter:\n%s\n", out.c_str());
 #endif /* HAS_PRESSURE_EQUALIZER */
-
-    _write(file, gcode);
-    BOOST_LOG_TRIVIAL(trace) << "Exported layer " << layer.id() << " print_z " << print_z <<
-    log_memory_info();
 }
 
 void GCode::apply_print_config(const PrintConfig &print_config)
@@ -2440,31 +2564,22 @@ std::string GCode::change_layer(coordf_t print_z)
 
 
 
-std::string GCode::extrude_loop(ExtrusionLoop loop, std::string description, double speed, std::unique_ptr<EdgeGrid::Grid> *lower_layer_edge_grid)
+std::string GCode::extrude_loop(ExtrusionLoop loop, std::string description, double speed, const EdgeGrid::Grid *lower_layer_edge_grid)
 {
     // get a copy; don't modify the orientation of the original loop object otherwise
     // next copies (if any) would not detect the correct orientation
 
-    if (m_layer->lower_layer != nullptr && lower_layer_edge_grid != nullptr) {
-        if (! *lower_layer_edge_grid) {
-            // Create the distance field for a layer below.
-            const coord_t distance_field_resolution = coord_t(scale_(1.) + 0.5);
-            *lower_layer_edge_grid = make_unique<EdgeGrid::Grid>();
-            (*lower_layer_edge_grid)->create(m_layer->lower_layer->lslices, distance_field_resolution);
-            (*lower_layer_edge_grid)->calculate_sdf();
-            #if 0
-            {
-                static int iRun = 0;
-                BoundingBox bbox = (*lower_layer_edge_grid)->bbox();
-                bbox.min(0) -= scale_(5.f);
-                bbox.min(1) -= scale_(5.f);
-                bbox.max(0) += scale_(5.f);
-                bbox.max(1) += scale_(5.f);
-                EdgeGrid::save_png(*(*lower_layer_edge_grid), bbox, scale_(0.1f), debug_out_path("GCode_extrude_loop_edge_grid-%d.png", iRun++));
-            }
-            #endif
-        }
+    #if 0
+    if (lower_layer_edge_grid != nullptr) {
+        static int iRun = 0;
+        BoundingBox bbox = lower_layer_edge_grid->bbox();
+        bbox.min(0) -= scale_(5.f);
+        bbox.min(1) -= scale_(5.f);
+        bbox.max(0) += scale_(5.f);
+        bbox.max(1) += scale_(5.f);
+        EdgeGrid::save_png(*lower_layer_edge_grid, bbox, scale_(0.1f), debug_out_path("GCode_extrude_loop_edge_grid-%d.png", iRun++));
     }
+    #endif
 
     // extrude all loops ccw
     bool was_clockwise = loop.make_counter_clockwise();
@@ -2479,13 +2594,10 @@ std::string GCode::extrude_loop(ExtrusionLoop loop, std::string description, dou
     if (m_config.spiral_vase) {
         loop.split_at(last_pos, false);
     } else {
-        const EdgeGrid::Grid* edge_grid_ptr = (lower_layer_edge_grid && *lower_layer_edge_grid)
-                                                ? lower_layer_edge_grid->get()
-                                                : nullptr;
         Point seam = m_seam_placer.get_seam(*m_layer, seam_position, loop,
                          last_pos, EXTRUDER_CONFIG(nozzle_diameter),
                          (m_layer == NULL ? nullptr : m_layer->object()),
-                         was_clockwise, edge_grid_ptr);
+                         was_clockwise, lower_layer_edge_grid);
         // Split the loop at the point with a minium penalty.
         if (!loop.split_at_vertex(seam))
             // The point is not in the original loop. Insert it.
@@ -2560,42 +2672,52 @@ std::string GCode::extrude_loop(ExtrusionLoop loop, std::string description, dou
     return gcode;
 }
 
-std::string GCode::extrude_multi_path(ExtrusionMultiPath multipath, std::string description, double speed)
+// Copy of the source path simplified for the G-code export, optionally reversed.
+static inline ExtrusionPath simplified_extrusion_path(const ExtrusionPath &path, bool reverse)
+{
+    if (reverse)
+        return ExtrusionPath(Polyline(MultiPoint::_douglas_peucker(Points(path.polyline.points.rbegin(), path.polyline.points.rend()), SCALED_RESOLUTION)), path);
+    return ExtrusionPath(Polyline(MultiPoint::_douglas_peucker(path.polyline.points, SCALED_RESOLUTION)), path);
+}
+
+std::string GCode::extrude_multi_path(const ExtrusionMultiPath &multipath, bool reverse, std::string description, double speed)
 {
     // extrude along the path
     std::string gcode;
-    for (ExtrusionPath path : multipath.paths) {
+    for (size_t i = 0; i < multipath.paths.size(); ++ i) {
 //    description += ExtrusionLoop::role_to_string(loop.loop_role());
 //    description += ExtrusionEntity::role_to_string(path->role);
-        path.simplify(SCALED_RESOLUTION);
+        ExtrusionPath path = simplified_extrusion_path(multipath.paths[reverse ? multipath.paths.size() - i - 1 : i], reverse);
         gcode += this->_extrude(path, description, speed);
     }
     if (m_wipe.enable) {
-        m_wipe.path = std::move(multipath.paths.back().polyline);  // TODO: don't limit wipe to last path
-        m_wipe.path.reverse();
+        // Wipe back along the last extruded path.
+        m_wipe.path = reverse ? multipath.paths.front().polyline : multipath.paths.back().polyline;  // TODO: don't limit wipe to last path
+        if (! reverse)
+            m_wipe.path.reverse();
     }
     // reset acceleration
     gcode += m_writer.set_acceleration((unsigned int)floor(m_config.default_acceleration.value + 0.5));
     return gcode;
 }
 
-std::string GCode::extrude_entity(const ExtrusionEntity &entity, std::string description, double speed, std::unique_ptr<EdgeGrid::Grid> *lower_layer_edge_grid)
+std::string GCode::extrude_entity(const ExtrusionEntityReference &entity, std::string description, double speed, const EdgeGrid::Grid *lower_layer_edge_grid)
 {
-    if (const ExtrusionPath* path = dynamic_cast<const ExtrusionPath*>(&entity))
-        return this->extrude_path(*path, description, speed);
-    else if (const ExtrusionMultiPath* multipath = dynamic_cast<const ExtrusionMultiPath*>(&entity))
-        return this->extrude_multi_path(*multipath, description, speed);
-    else if (const ExtrusionLoop* loop = dynamic_cast<const ExtrusionLoop*>(&entity))
+    if (const ExtrusionPath* path = entity.cast<ExtrusionPath>())
+        return this->extrude_path(*path, entity.flipped(), description, speed);
+    else if (const ExtrusionMultiPath* multipath = entity.cast<ExtrusionMultiPath>())
+        return this->extrude_multi_path(*multipath, entity.flipped(), description, speed);
+    else if (const ExtrusionLoop* loop = entity.cast<ExtrusionLoop>())
         return this->extrude_loop(*loop, description, speed, lower_layer_edge_grid);
     else
         throw Slic3r::InvalidArgument("Invalid argument supplied to extrude()");
     return "";
 }
 
-std::string GCode::extrude_path(ExtrusionPath path, std::string description, double speed)
+std::string GCode::extrude_path(const ExtrusionPath &path_src, bool reverse, std::string description, double speed)
 {
 //    description += ExtrusionEntity::role_to_string(path.role());
-    path.simplify(SCALED_RESOLUTION);
+    ExtrusionPath path = simplified_extrusion_path(path_src, reverse);
     std::string gcode = this->_extrude(path, description, speed);
     if (m_wipe.enable) {
         m_wipe.path = std::move(path.polyline);
@@ -2607,14 +2729,22 @@ std::string GCode::extrude_path(ExtrusionPath path, std::string description, dou
 }
 
 // Extrude perimeters: Decide where to put seams (hide or align seams).
-std::string GCode::extrude_perimeters(const Print &print, const std::vector<ObjectByExtruder::Island::Region> &by_region, std::unique_ptr<EdgeGrid::Grid> &lower_layer_edge_grid)
+std::string GCode::extrude_perimeters(const Print &print, const std::vector<ObjectByExtruder::Island::Region> &by_region)
 {
     std::string gcode;
+    // Distance field over the layer below, shared by all instances and extruders printing this layer.
+    // Precomputed by the seam placer in parallel batches of layers.
+    const EdgeGrid::Grid *lower_layer_edge_grid = nullptr;
+    bool                  lower_layer_edge_grid_valid = false;
     for (const ObjectByExtruder::Island::Region &region : by_region)
         if (! region.perimeters.empty()) {
+            if (! lower_layer_edge_grid_valid) {
+                lower_layer_edge_grid       = m_seam_placer.get_lower_layer_edge_grid(*m_layer);
+                lower_layer_edge_grid_valid = true;
+            }
             m_config.apply(print.get_print_region(&region - &by_region.front()).config());
             for (const ExtrusionEntity *ee : region.perimeters)
-                gcode += this->extrude_entity(*ee, "perimeter", -1., &lower_layer_edge_grid);
+                gcode += this->extrude_entity(*ee, "perimeter", -1., lower_layer_edge_grid);
         }
     return gcode;
 }
@@ -2634,46 +2764,45 @@ std::string GCode::extrude_infill(const Print &print, const std::vector<ObjectBy
                     extrusions.emplace_back(ee);
             if (! extrusions.empty()) {
                 m_config.apply(print.get_print_region(&region - &by_region.front()).config());
-                chain_and_reorder_extrusion_entities(extrusions, &m_last_pos);
-                for (const ExtrusionEntity *fill : extrusions) {
-                    auto *eec = dynamic_cast<const ExtrusionEntityCollection*>(fill);
-                    if (eec) {
-                        for (ExtrusionEntity *ee : eec->chained_path_from(m_last_pos).entities)
-                            gcode += this->extrude_entity(*ee, extrusion_name);
+                // The extrusions are chained by references, neither reversed in place nor cloned.
+                for (const ExtrusionEntityReference &fill : chain_extrusion_references(extrusions, &m_last_pos)) {
+                    if (auto *eec = fill.cast<ExtrusionEntityCollection>(); eec) {
+                        for (const ExtrusionEntityReference &ee : chain_extrusion_references(*eec, &m_last_pos, fill.flipped()))
+                            gcode += this->extrude_entity(ee, extrusion_name);
                     } else
-                        gcode += this->extrude_entity(*fill, extrusion_name);
+                        gcode += this->extrude_entity(fill, extrusion_name);
                 }
             }
         }
     return gcode;
 }
 
-std::string GCode::extrude_support(const ExtrusionEntityCollection &support_fills)
+std::string GCode::extrude_support(const ExtrusionEntityReferences &support_fills)
 {
     static constexpr const char *support_label            = "support material";
     static constexpr const char *support_interface_label  = "support material interface";
 
     std::string gcode;
-    if (! support_fills.entities.empty()) {
+    if (! support_fills.empty()) {
         const double  support_speed            = m_config.support_material_speed.value;
         const double  support_interface_speed  = m_config.support_material_interface_speed.get_abs_value(support_speed);
-        for (const ExtrusionEntity *ee : support_fills.entities) {
-            ExtrusionRole role = ee->role();
+        for (const ExtrusionEntityReference &ee : support_fills) {
+            ExtrusionRole role = ee.extrusion_entity().role();
             assert(role == erSupportMaterial || role == erSupportMaterialInterface);
             const char  *label = (role == erSupportMaterial) ? support_label : support_interface_label;
             const double speed = (role == erSupportMaterial) ? support_speed : support_interface_speed;
-            const ExtrusionPath *path = dynamic_cast<const ExtrusionPath*>(ee);
+            const ExtrusionPath *path = ee.cast<ExtrusionPath>();
             if (path)
-                gcode += this->extrude_path(*path, label, speed);
+                gcode += this->extrude_path(*path, ee.flipped(), label, speed);
             else {
-                const ExtrusionMultiPath *multipath = dynamic_cast<const ExtrusionMultiPath*>(ee);
+                const ExtrusionMultiPath *multipath = ee.cast<ExtrusionMultiPath>();
                 if (multipath)
-                    gcode += this->extrude_multi_path(*multipath, label, speed);
+                    gcode += this->extrude_multi_path(*multipath, ee.flipped(), label, speed);
                 else {
-                    const ExtrusionEntityCollection *eec = dynamic_cast<const ExtrusionEntityCollection*>(ee);
+                    const ExtrusionEntityCollection *eec = ee.cast<ExtrusionEntityCollection>();
                     assert(eec);
                     if (eec)
-                        gcode += this->extrude_support(*eec);
+                        gcode += this->extrude_support(chain_extrusion_references(*eec, nullptr, ee.flipped()));
                 }
             }
         }
@@ -2683,13 +2812,67 @@ std::string GCode::extrude_support(const ExtrusionEntityCollection &support_fill
 
 void GCode::_write(FILE* file, const char *what)
 {
+    // Keep the order of the layers queued for arc fitting and of the rest of the G-code.
+    if (! m_arc_fitter_layers.empty())
+        this->_flush_arc_fitter_layers(file);
     if (what != nullptr) {
         const char* gcode = what;
-        // writes string to file
-        fwrite(gcode, 1, ::strlen(gcode), file);
+        size_t      len   = ::strlen(gcode);
+        // The G-code processor parses the G-code in memory, the file is not read back.
+        m_processor.process_buffer(gcode, len);
+        if (m_gcode_tail_hold)
+            m_gcode_tail.append(gcode, len);
+        else
+            // writes string to file
+            fwrite(gcode, 1, len, file);
     }
 }
 
+void GCode::_write_gcode_tail(FILE* file)
+{
+    m_processor.finalize();
+    m_gcode_tail_hold = false;
+    if (! m_processor.needs_postprocess()) {
+        // No M73 lines to be inserted, thus the only placeholder is in the tail. Resolve it here, so that the file is written just once.
+#if ENABLE_VALIDATE_CUSTOM_GCODE
+        const std::string placeholder = ";" + GCodeProcessor::reserved_tag(GCodeProcessor::ETags::Estimated_Printing_Time_Placeholder) + "\n";
+#else
+        const std::string placeholder = GCodeProcessor::Estimated_Printing_Time_Placeholder_Tag + "\n";
+#endif // ENABLE_VALIDATE_CUSTOM_GCODE
+        if (size_t pos = m_gcode_tail.find(placeholder); pos != std::string::npos)
+            m_gcode_tail.replace(pos, placeholder.size(), m_processor.get_estimated_printing_time_lines());
+    }
+    fwrite(m_gcode_tail.data(), 1, m_gcode_tail.size(), file);
+    m_gcode_tail.clear();
+    m_gcode_tail.shrink_to_fit();
+}
+
+void GCode::_write_layer(FILE* file, std::string &&gcode)
+{
+    if (! m_arc_fitter) {
+        _write(file, gcode);
+        return;
+    }
+    // Number of layers, over which the arcs are fitted in parallel.
+    static constexpr const size_t arc_fitter_batch_size = 64;
+    m_arc_fitter_layers.emplace_back(std::move(gcode));
+    if (m_arc_fitter_layers.size() >= arc_fitter_batch_size)
+        this->_flush_arc_fitter_layers(file);
+}
+
+void GCode::_flush_arc_fitter_layers(FILE* file)
+{
+    assert(m_arc_fitter);
+    std::vector<std::string> layers = std::move(m_arc_fitter_layers);
+    m_arc_fitter_layers.clear();
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, layers.size()), [this, &layers](const tbb::blocked_range<size_t> &range) {
+        for (size_t i = range.begin(); i < range.end(); ++ i)
+            layers[i] = m_arc_fitter->process_layer(layers[i]);
+    });
+    for (const std::string &layer : layers)
+        _write(file, layer);
+}
+
 void GCode::_writeln(FILE* file, const std::string &what)
 {
     if (! what.empty())
@@ -2888,7 +3071,8 @@ std::string GCode::_extrude(const ExtrusionPath &path, std::string description,
         for (const Line &line : path.polyline.lines()) {
             const double line_length = line.length() * SCALING_FACTOR;
             path_length += line_length;
-            gcode += m_writer.extrude_to_xy(
+            m_writer.extrude_to_xy(
+                gcode,
                 this->point_to_gcode(line.b),
                 e_per_mm * line_length,
                 comment);
@@ -2957,7 +3141,7 @@ std::string GCode::travel_to(const Point &point, ExtrusionRole role, std::string
     // use G1 because we rely on paths being straight (G0 may make round paths)
     if (travel.size() >= 2) {
         for (size_t i = 1; i < travel.size(); ++ i)
-            gcode += m_writer.travel_to_xy(this->point_to_gcode(travel.points[i]), comment);
+            m_writer.travel_to_xy(gcode, this->point_to_gcode(travel.points[i]), comment);
         this->set_last_pos(travel.points.back());
     }
     return gcode;
@@ -8,6 +8,7 @@
 #include "Point.hpp"
 #include "PlaceholderParser.hpp"
 #include "PrintConfig.hpp"
+#include "GCode/ArcFitter.hpp"
 #include "GCode/AvoidCrossingPerimeters.hpp"
 #include "GCode/CoolingBuffer.hpp"
 #include "GCode/SpiralVase.hpp"
@@ -15,6 +16,7 @@
 #include "GCode/WipeTower.hpp"
 #include "GCode/SeamPlacer.hpp"
 #include "GCode/GCodeProcessor.hpp"
+#include "GCode/GCodeCompressor.hpp"
 #include "EdgeGrid.hpp"
 #include "GCode/ThumbnailData.hpp"
 
@@ -142,7 +144,10 @@ public:
 
     // throws std::runtime_exception on error,
     // throws CanceledException through print->throw_if_canceled().
-    void            do_export(Print* print, const char* path, GCodeProcessor::Result* result = nullptr, ThumbnailsGeneratorCallback thumbnail_cb = nullptr);
+    // With compressed_output other than None and the gcode_compression enabled, the G-code is also written compressed
+    // into compressed_gcode_path(path) while being post-processed. With GCodeCompressedOutput::Only the plain text G-code is not kept.
+    void            do_export(Print* print, const char* path, GCodeProcessor::Result* result = nullptr, ThumbnailsGeneratorCallback thumbnail_cb = nullptr,
+                              GCodeCompressedOutput compressed_output = GCodeCompressedOutput::None);
 
     // Exported for the helper classes (OozePrevention, Wipe) and for the Perl binding for unit tests.
     const Vec2d&    origin() const { return m_origin; }
@@ -187,9 +192,17 @@ private:
 
     static std::vector<LayerToPrint>        		                   collect_layers_to_print(const PrintObject &object);
     static std::vector<std::pair<coordf_t, std::vector<LayerToPrint>>> collect_layers_to_print(const Print &print);
-    void            process_layer(
-        // Write into the output file.
-        FILE                            *file,
+    // G-code of a single layer generated by process_layer(), which is post-processed by postprocess_layer() before
+    // being written into the output file.
+    struct LayerResult {
+        std::string gcode;
+        size_t      layer_id             { 0 };
+        // Flush the cooling buffer at the end of this layer.
+        bool        cooling_buffer_flush { false };
+        // Nothing was extruded at this layer, nothing is to be written.
+        bool        nop_layer_result     { false };
+    };
+    LayerResult     process_layer(
         const Print                     &print,
         // Set of object & print layers of the same PrintObject and with the same print_z.
         const std::vector<LayerToPrint> &layers,
@@ -200,16 +213,22 @@ private:
         // If set to size_t(-1), then print all copies of all objects.
         // Otherwise print a single copy of a single object.
         const size_t                     single_object_idx = size_t(-1));
+    // Apply the cooling buffer and the pressure equalizer to the G-code of a layer produced by process_layer().
+    // The post-processing may run concurrently with process_layer() of the following layers.
+    void            postprocess_layer(LayerResult &layer_result);
 
     void            set_last_pos(const Point &pos) { m_last_pos = pos; m_last_pos_defined = true; }
     bool            last_pos_defined() const { return m_last_pos_defined; }
     void            set_extruders(const std::vector<unsigned int> &extruder_ids);
     std::string     preamble();
     std::string     change_layer(coordf_t print_z);
-    std::string     extrude_entity(const ExtrusionEntity &entity, std::string description = "", double speed = -1., std::unique_ptr<EdgeGrid::Grid> *lower_layer_edge_grid = nullptr);
-    std::string     extrude_loop(ExtrusionLoop loop, std::string description, double speed = -1., std::unique_ptr<EdgeGrid::Grid> *lower_layer_edge_grid = nullptr);
-    std::string     extrude_multi_path(ExtrusionMultiPath multipath, std::string description = "", double speed = -1.);
-    std::string     extrude_path(ExtrusionPath path, std::string description = "", double speed = -1.);
+    std::string     extrude_entity(const ExtrusionEntityReference &entity, std::string description = "", double speed = -1., const EdgeGrid::Grid *lower_layer_edge_grid = nullptr);
+    std::string     extrude_entity(const ExtrusionEntity &entity, std::string description = "", double speed = -1., const EdgeGrid::Grid *lower_layer_edge_grid = nullptr)
+        { return this->extrude_entity(ExtrusionEntityReference(entity, false), std::move(description), speed, lower_layer_edge_grid); }
+    std::string     extrude_loop(ExtrusionLoop loop, std::string description, double speed = -1., const EdgeGrid::Grid *lower_layer_edge_grid = nullptr);
+    // The source extrusions are not modified, reverse indicates that they are to be printed in the reverse direction.
+    std::string     extrude_multi_path(const ExtrusionMultiPath &multipath, bool reverse, std::string description = "", double speed = -1.);
+    std::string     extrude_path(const ExtrusionPath &path, bool reverse, std::string description = "", double speed = -1.);
 
     // Extruding multiple objects with soluble / non-soluble / combined supports
     // on a multi-material printer, trying to minimize tool switches.
@@ -274,9 +293,9 @@ private:
 		// For sequential print, the instance of the object to be printing has to be defined.
 		const size_t                     				 single_object_instance_idx);
 
-    std::string     extrude_perimeters(const Print &print, const std::vector<ObjectByExtruder::Island::Region> &by_region, std::unique_ptr<EdgeGrid::Grid> &lower_layer_edge_grid);
+    std::string     extrude_perimeters(const Print &print, const std::vector<ObjectByExtruder::Island::Region> &by_region);
     std::string     extrude_infill(const Print &print, const std::vector<ObjectByExtruder::Island::Region> &by_region, bool ironing);
-    std::string     extrude_support(const ExtrusionEntityCollection &support_fills);
+    std::string     extrude_support(const ExtrusionEntityReferences &support_fills);
 
     std::string     travel_to(const Point &point, ExtrusionRole role, std::string comment);
     bool            needs_retraction(const Polyline &travel, ExtrusionRole role = erNone);
@@ -336,6 +355,9 @@ private:
 
     std::unique_ptr<CoolingBuffer>      m_cooling_buffer;
     std::unique_ptr<SpiralVase>         m_spiral_vase;
+    std::unique_ptr<ArcFitter>          m_arc_fitter;
+    // G-code of layers waiting for the arc fitting, which is applied to a batch of layers in parallel.
+    std::vector<std::string>            m_arc_fitter_layers;
 #ifdef HAS_PRESSURE_EQUALIZER
     std::unique_ptr<PressureEqualizer>  m_pressure_equalizer;
 #endif /* HAS_PRESSURE_EQUALIZER */
@@ -352,12 +374,22 @@ private:
 
     bool m_silent_time_estimator_enabled;
 
-    // Processor
+    // Processor, fed with the G-code while it is being written.
     GCodeProcessor m_processor;
+    // G-code following the estimated printing time placeholder, held back until the G-code processor
+    // is finalized and the placeholder may be resolved without post-processing the whole file.
+    std::string    m_gcode_tail;
+    bool           m_gcode_tail_hold { false };
 
     // Write a string into a file.
     void _write(FILE* file, const std::string& what) { this->_write(file, what.c_str()); }
     void _write(FILE* file, const char *what);
+    // Write G-code of a complete layer into a file, possibly delayed to fit arcs over a batch of layers.
+    void _write_layer(FILE* file, std::string &&gcode);
+    // Fit arcs over the layers queued by _write_layer() in parallel and write them into a file.
+    void _flush_arc_fitter_layers(FILE* file);
+    // Finalize the G-code processor, resolve the placeholders in the held back G-code tail and write the tail into a file.
+    void _write_gcode_tail(FILE* file);
 
     // Write a string into a file. 
     // Add a newline, if the string does not end with a newline already.
@@ -0,0 +1,295 @@
+#include "ArcFitter.hpp"
+
+#include "../GCodeWriter.hpp"
+#include "../LocalesUtils.hpp"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+namespace Slic3r {
+
+// Minimum number of G1 moves to be replaced by a single arc.
+static constexpr const size_t ARC_MIN_MOVES   = 3;
+// Maximum number of G1 moves to be replaced by a single arc, limits the quadratic complexity of the fitting.
+static constexpr const size_t ARC_MAX_MOVES   = 500;
+// Arcs with a larger radius are better represented by straight lines.
+static constexpr const double ARC_MAX_RADIUS  = 1000.;
+// Maximum relative deviation of the extrusion rate of a move from the average extrusion rate along the arc.
+static constexpr const double ARC_MAX_E_RATE_DEVIATION = 0.05;
+
+namespace {
+
+// A G1 extrusion move, which may be replaced by an arc together with its neighbors.
+struct ArcFitterMove
+{
+    // End point of the move.
+    Vec2d               pos;
+    // Extrusion of the move.
+    double              de;
+    // The complete source G-code line including the trailing new line.
+    std::string_view    line;
+    // The "X.. Y.." words of the source line.
+    std::string_view    xy;
+    // The value of the E word of the source line.
+    std::string_view    e;
+    // Rest of the source line following the E word (a comment), without the trailing new line.
+    std::string_view    tail;
+};
+
+// State of the machine tracked over a single layer.
+struct ArcFitterState
+{
+    bool    x_known     = false;
+    bool    y_known     = false;
+    bool    e_known     = false;
+    bool    absolute_xy = true;
+    bool    relative_e  = false;
+    Vec2d   pos         = Vec2d::Zero();
+    double  e           = 0.;
+};
+
+struct ArcFitterArc
+{
+    Vec2d   center;
+    bool    ccw;
+};
+
+inline const char* skip_whitespaces(const char *c, const char *end)
+{
+    for (; c != end && (*c == ' ' || *c == '\t'); ++ c);
+    return c;
+}
+
+inline const char* skip_word(const char *c, const char *end)
+{
+    for (; c != end && *c != ' ' && *c != '\t' && *c != ';' && *c != '\n' && *c != '\r'; ++ c);
+    return c;
+}
+
+// Parse a number starting at c, terminated by the end of the word. Returns the end of the number or nullptr.
+inline const char* parse_number(const char *c, const char *end, double &value)
+{
+    assert(is_decimal_separator_point()); // for strtod
+    char *pend = nullptr;
+    value = strtod(c, &pend);
+    return (pend == c || pend > end || skip_word(pend, end) != pend) ? nullptr : pend;
+}
+
+// Parse a line "G1 X<x> Y<y> E<e>" optionally followed by a comment, as emitted by GCodeWriter::extrude_to_xy().
+bool parse_extrusion_move(std::string_view line, char extrusion_axis, ArcFitterMove &move, double &e)
+{
+    if (line.size() < 4 || line.compare(0, 4, "G1 X") != 0)
+        return false;
+    const char *end = line.data() + line.size();
+    const char *c   = line.data() + 4;
+    const char *xy  = c - 1;
+    if ((c = parse_number(c, end, move.pos.x())) == nullptr || c == end || *c != ' ' || ++ c == end || *c != 'Y' ||
+        (c = parse_number(c + 1, end, move.pos.y())) == nullptr)
+        return false;
+    move.xy = std::string_view(xy, c - xy);
+    if (c == end || *c != ' ' || ++ c == end || *c != extrusion_axis)
+        return false;
+    const char *e_start = ++ c;
+    if ((c = parse_number(c, end, e)) == nullptr)
+        return false;
+    move.e = std::string_view(e_start, c - e_start);
+    // Only a comment may follow.
+    const char *tail = c;
+    c = skip_whitespaces(c, end);
+    if (c != end && *c != ';' && *c != '\n' && *c != '\r')
+        return false;
+    const char *tail_end = end;
+    for (; tail_end != tail && (tail_end[-1] == '\n' || tail_end[-1] == '\r'); -- tail_end);
+    move.tail = std::string_view(tail, tail_end - tail);
+    move.line = line;
+    return true;
+}
+
+// Update the machine state by a G-code line, which was not replaced by an arc.
+void update_state(std::string_view line, char extrusion_axis, ArcFitterState &state)
+{
+    const char *end = line.data() + line.size();
+    const char *c   = skip_whitespaces(line.data(), end);
+    const char *cmd_end = skip_word(c, end);
+    std::string_view cmd(c, cmd_end - c);
+    if (cmd == "G90")
+        state.absolute_xy = true;
+    else if (cmd == "G91")
+        state.absolute_xy = false;
+    else if (cmd == "M82")
+        state.relative_e = false;
+    else if (cmd == "M83")
+        state.relative_e = true;
+    else if (cmd == "G28")
+        state.x_known = state.y_known = false;
+    else if (cmd == "G0" || cmd == "G1" || cmd == "G2" || cmd == "G3" || cmd == "G92") {
+        bool set_position = cmd == "G92";
+        for (c = cmd_end;;) {
+            c = skip_whitespaces(c, end);
+            if (c == end || *c == ';' || *c == '\n' || *c == '\r')
+                break;
+            char   axis = *c;
+            double value;
+            const char *number_end = parse_number(c + 1, end, value);
+            if (number_end != nullptr) {
+                if (axis == 'X' || axis == 'Y') {
+                    bool &known = (axis == 'X') ? state.x_known : state.y_known;
+                    if (state.absolute_xy || set_position) {
+                        state.pos[axis - 'X'] = value;
+                        known = true;
+                    } else
+                        known = false;
+                } else if (axis == extrusion_axis && ! state.relative_e) {
+                    state.e       = value;
+                    state.e_known = true;
+                }
+            }
+            c = skip_word(c, end);
+        }
+    }
+}
+
+// Try to fit an arc through the points pts[begin] to pts[end], which are the start and end points of moves[begin] to moves[end - 1].
+bool fit_arc(const std::vector<Vec2d> &pts, const std::vector<ArcFitterMove> &moves, size_t begin, size_t end, double tolerance, ArcFitterArc &arc)
+{
+    // Circle passing through the first, middle and the last point.
+    const Vec2d &p0 = pts[begin];
+    const Vec2d  a  = pts[(begin + end) / 2] - p0;
+    const Vec2d  b  = pts[end] - p0;
+    const double d  = 2. * cross2(a, b);
+    if (std::abs(d) < EPSILON * EPSILON)
+        // Collinear points.
+        return false;
+    arc.center = p0 + Vec2d(b.y() * a.squaredNorm() - a.y() * b.squaredNorm(), a.x() * b.squaredNorm() - b.x() * a.squaredNorm()) / d;
+    arc.ccw    = d > 0.;
+    const double radius = (p0 - arc.center).norm();
+    if (radius > ARC_MAX_RADIUS)
+        return false;
+
+    // All the points shall lie on the circle, all the moves shall turn in the same direction
+    // and the arc shall not deviate from the moves by more than tolerance.
+    double sweep   = 0.;
+    double length  = 0.;
+    double de      = 0.;
+    for (size_t i = begin; i <= end; ++ i)
+        if (std::abs((pts[i] - arc.center).norm() - radius) > tolerance)
+            return false;
+    for (size_t i = begin; i < end; ++ i) {
+        const Vec2d  v1    = pts[i] - arc.center;
+        const Vec2d  v2    = pts[i + 1] - arc.center;
+        const double angle = atan2(cross2(v1, v2), v1.dot(v2));
+        if ((angle > 0.) != arc.ccw || angle == 0.)
+            return false;
+        sweep += std::abs(angle);
+        const double l = (pts[i + 1] - pts[i]).norm();
+        if (radius - std::sqrt(std::max(0., sqr(radius) - 0.25 * sqr(l))) > tolerance)
+            return false;
+        length += l;
+        de     += moves[i].de;
+    }
+    if (sweep > 2. * M_PI - 0.1)
+        // Close to a full circle, the arc end points would be ambiguous.
+        return false;
+
+    // The extrusion rate shall be constant along the arc.
+    const double rate = de / length;
+    for (size_t i = begin; i < end; ++ i) {
+        const double l = (pts[i + 1] - pts[i]).norm();
+        if (std::abs(moves[i].de - rate * l) > ARC_MAX_E_RATE_DEVIATION * std::abs(rate) * l + EPSILON)
+            return false;
+    }
+    return true;
+}
+
+} // namespace
+
+std::string ArcFitter::process_layer(const std::string &gcode) const
+{
+    assert(! m_extrusion_axis.empty());
+    const char extrusion_axis = m_extrusion_axis.front();
+
+    std::string out;
+    out.reserve(gcode.size());
+
+    ArcFitterState             state;
+    state.relative_e = m_relative_e;
+    std::vector<ArcFitterMove> run;
+    std::vector<Vec2d>         pts;
+
+    // Emit the collected run of extrusion moves, replacing as many moves as possible with arcs.
+    auto flush_run = [this, &run, &pts, &out, extrusion_axis, &state]() {
+        if (run.empty())
+            return;
+        assert(pts.size() == run.size() + 1);
+        for (size_t i = 0; i < run.size();) {
+            size_t       best_end = 0;
+            ArcFitterArc best_arc;
+            for (size_t j = i + ARC_MIN_MOVES; j <= run.size() && j - i <= ARC_MAX_MOVES; ++ j) {
+                ArcFitterArc arc;
+                if (! fit_arc(pts, run, i, j, m_tolerance, arc))
+                    break;
+                best_end = j;
+                best_arc = arc;
+            }
+            if (best_end == 0) {
+                out += run[i ++].line;
+                continue;
+            }
+            const ArcFitterMove &last = run[best_end - 1];
+            out += best_arc.ccw ? "G3 " : "G2 ";
+            out += last.xy;
+            out += " I";
+            GCodeFormatter::append_fixed(out, best_arc.center.x() - pts[i].x(), GCodeFormatter::XYZF_PRECISION);
+            out += " J";
+            GCodeFormatter::append_fixed(out, best_arc.center.y() - pts[i].y(), GCodeFormatter::XYZF_PRECISION);
+            out += ' ';
+            out += extrusion_axis;
+            if (state.relative_e) {
+                double de = 0.;
+                for (size_t k = i; k < best_end; ++ k)
+                    de += run[k].de;
+                GCodeFormatter::append_fixed(out, de, GCodeFormatter::E_PRECISION);
+            } else
+                out += last.e;
+            out += last.tail;
+            out += '\n';
+            i = best_end;
+        }
+        run.clear();
+        pts.clear();
+    };
+
+    const char *gcode_end = gcode.data() + gcode.size();
+    for (const char *line_start = gcode.data(), *line_end; line_start != gcode_end; line_start = line_end) {
+        line_end = static_cast<const char*>(memchr(line_start, '\n', gcode_end - line_start));
+        line_end = (line_end == nullptr) ? gcode_end : line_end + 1;
+        std::string_view line(line_start, line_end - line_start);
+
+        ArcFitterMove move;
+        double        e;
+        if (state.x_known && state.y_known && state.absolute_xy && parse_extrusion_move(line, extrusion_axis, move, e) &&
+            (state.relative_e || state.e_known)) {
+            move.de = state.relative_e ? e : e - state.e;
+            if (run.empty())
+                pts.emplace_back(state.pos);
+            pts.emplace_back(move.pos);
+            run.emplace_back(move);
+            state.pos = move.pos;
+            if (! state.relative_e)
+                state.e = e;
+            continue;
+        }
+
+        flush_run();
+        update_state(line, extrusion_axis, state);
+        out += line;
+    }
+    flush_run();
+
+    return out;
+}
+
+}
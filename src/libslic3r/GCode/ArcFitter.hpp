@@ -0,0 +1,41 @@
+#ifndef slic3r_ArcFitter_hpp_
+#define slic3r_ArcFitter_hpp_
+
+#include "../libslic3r.h"
+#include "../PrintConfig.hpp"
+
+#include <string>
+
+namespace Slic3r {
+
+// A G-code post-processor replacing runs of G1 extrusion moves, which approximate a circular arc
+// within a tolerance, with G2 / G3 arc moves. Finely tessellated curves (gyroid infill, organic models)
+// produce smaller G-code and relieve the firmware planner.
+//
+// A layer is processed independently of the other layers: Only the moves following a move with known
+// XY coordinates in the same layer are considered. Thus the layers may be processed in parallel.
+class ArcFitter {
+public:
+    ArcFitter(const PrintConfig &config) :
+        m_tolerance(config.arc_fitting_tolerance.value),
+        m_relative_e(config.use_relative_e_distances.value),
+        m_extrusion_axis(get_extrusion_axis(config))
+    {}
+
+    // Is arc fitting enabled by the configuration?
+    static bool enabled(const PrintConfig &config)
+        { return config.arc_fitting_tolerance.value > 0. && ! get_extrusion_axis(config).empty(); }
+
+    // Replace the G1 runs of a single layer with arcs. Thread safe.
+    std::string process_layer(const std::string &gcode) const;
+
+private:
+    // Maximum deviation of the arc from the original polyline, in mm.
+    double      m_tolerance;
+    bool        m_relative_e;
+    std::string m_extrusion_axis;
+};
+
+}
+
+#endif
@@ -12,6 +12,8 @@
 #include <numeric>
 #include <unordered_set>
 
+#include <tbb/parallel_for.h>
+
 namespace Slic3r {
 
 struct TravelPoint
@@ -888,6 +890,7 @@ static void init_boundary_distances(AvoidCrossingPerimeters::Boundary *boundary)
 static void init_boundary(AvoidCrossingPerimeters::Boundary *boundary, Polygons &&boundary_polygons)
 {
     boundary->clear();
+    boundary->initialized = true;
     boundary->boundaries = std::move(boundary_polygons);
 
     BoundingBox bbox(get_extents(boundary->boundaries));
@@ -918,25 +921,33 @@ Polyline AvoidCrossingPerimeters::travel_to(const GCode &gcodegen, const Point &
     const ExPolygons               &lslices          = gcodegen.layer()->lslices;
     const std::vector<BoundingBox> &lslices_bboxes   = gcodegen.layer()->lslices_bboxes;
     bool                            is_support_layer = dynamic_cast<const SupportLayer *>(gcodegen.layer()) != nullptr;
-    if (!use_external && (is_support_layer || (!lslices.empty() && !any_expolygon_contains(lslices, lslices_bboxes, m_grid_lslice, travel)))) {
-        // Initialize m_internal only when it is necessary.
-        if (m_internal.boundaries.empty())
-            init_boundary(&m_internal, to_polygons(get_boundary(*gcodegen.layer())));
+    const EdgeGrid::Grid           &grid_lslice      = m_current->grid_lslice;
+    // Boundaries of the layer being extruded, which may be a support layer of the layer passed to init_layer().
+    // Use the precomputed ones if available, otherwise initialize them on demand.
+    LayerBoundaries                *layer_boundaries = this->precomputed_boundaries(gcodegen.layer());
+    if (layer_boundaries == nullptr)
+        layer_boundaries = m_current;
+    Boundary                       &internal         = layer_boundaries->internal;
+    Boundary                       &external         = layer_boundaries->external;
+    if (!use_external && (is_support_layer || (!lslices.empty() && !any_expolygon_contains(lslices, lslices_bboxes, grid_lslice, travel)))) {
+        // Initialize internal boundaries only when it is necessary.
+        if (!internal.initialized)
+            init_boundary(&internal, to_polygons(get_boundary(*gcodegen.layer())));
 
         // Trim the travel line by the bounding box.
-        if (!m_internal.boundaries.empty() && Geometry::liang_barsky_line_clipping(startf, endf, m_internal.bbox)) {
-            travel_intersection_count = avoid_perimeters(m_internal, startf.cast<coord_t>(), endf.cast<coord_t>(), result_pl);
+        if (!internal.boundaries.empty() && Geometry::liang_barsky_line_clipping(startf, endf, internal.bbox)) {
+            travel_intersection_count = avoid_perimeters(internal, startf.cast<coord_t>(), endf.cast<coord_t>(), result_pl);
             result_pl.points.front()  = start;
             result_pl.points.back()   = end;
         }
     } else if(use_external) {
-        // Initialize m_external only when exist any external travel for the current layer.
-        if (m_external.boundaries.empty())
-            init_boundary(&m_external, get_boundary_external(*gcodegen.layer()));
+        // Initialize external boundaries only when exist any external travel for the current layer.
+        if (!external.initialized)
+            init_boundary(&external, get_boundary_external(*gcodegen.layer()));
 
         // Trim the travel line by the bounding box.
-        if (!m_external.boundaries.empty() && Geometry::liang_barsky_line_clipping(startf, endf, m_external.bbox)) {
-            travel_intersection_count = avoid_perimeters(m_external, startf.cast<coord_t>(), endf.cast<coord_t>(), result_pl);
+        if (!external.boundaries.empty() && Geometry::liang_barsky_line_clipping(startf, endf, external.bbox)) {
+            travel_intersection_count = avoid_perimeters(external, startf.cast<coord_t>(), endf.cast<coord_t>(), result_pl);
             result_pl.points.front()  = start;
             result_pl.points.back()   = end;
         }
@@ -968,24 +979,113 @@ Polyline AvoidCrossingPerimeters::travel_to(const GCode &gcodegen, const Point &
     } else if (max_detour_length_exceeded) {
         *could_be_wipe_disabled = false;
     } else
-        *could_be_wipe_disabled = !need_wipe(gcodegen, m_grid_lslice, travel, result_pl, travel_intersection_count);
+        *could_be_wipe_disabled = !need_wipe(gcodegen, grid_lslice, travel, result_pl, travel_intersection_count);
 
     return result_pl;
 }
 
 // ************************************* AvoidCrossingPerimeters::init_layer() *****************************************
 
-void AvoidCrossingPerimeters::init_layer(const Layer &layer)
+static void init_grid_lslice(EdgeGrid::Grid &grid_lslice, const Layer &layer)
 {
-    m_internal.clear();
-    m_external.clear();
-
     BoundingBox bbox_slice(get_extents(layer.lslices));
     bbox_slice.offset(SCALED_EPSILON);
 
-    m_grid_lslice.set_bbox(bbox_slice);
+    grid_lslice.set_bbox(bbox_slice);
     //FIXME 1mm grid?
-    m_grid_lslice.create(layer.lslices, coord_t(scale_(1.)));
+    grid_lslice.create(layer.lslices, coord_t(scale_(1.)));
+}
+
+// Rough estimate of the memory occupied by LayerBoundaries of a layer: Three grids with 1mm cells spanning the bounding box
+// of the slices (the lslices, the internal and the external boundaries), the internal and the external boundaries
+// with their precomputed distances and the edges of the three grids registered with the grid cells.
+static size_t estimate_layer_boundaries_memsize(const Layer &layer)
+{
+    BoundingBox bbox       = get_extents(layer.lslices);
+    size_t      num_cells  = bbox.defined ? size_t(unscale<double>(bbox.size().x()) + 2.) * size_t(unscale<double>(bbox.size().y()) + 2.) : 0;
+    size_t      num_points = 0;
+    for (const ExPolygon &expoly : layer.lslices) {
+        num_points += expoly.contour.points.size();
+        for (const Polygon &hole : expoly.holes)
+            num_points += hole.points.size();
+    }
+    return 3 * num_cells * 2 * sizeof(size_t) + num_points * (2 * (sizeof(Point) + sizeof(float)) + 3 * sizeof(std::pair<size_t, size_t>));
+}
+
+void AvoidCrossingPerimeters::init_layers(std::vector<std::vector<const Layer*>> layer_groups, size_t memory_budget)
+{
+    m_layer_groups      = std::move(layer_groups);
+    m_memory_budget     = memory_budget;
+    m_layer_to_group.clear();
+    m_layer_boundaries.clear();
+    m_precomputed_begin = 0;
+    m_precomputed_end   = 0;
+    m_current           = &m_lazy;
+    for (size_t group_idx = 0; group_idx < m_layer_groups.size(); ++ group_idx)
+        for (const Layer *layer : m_layer_groups[group_idx])
+            m_layer_to_group.insert({ layer, group_idx });
+}
+
+// Returns boundaries of a layer registered by init_layers(). If the layer is not precomputed yet, then a new batch of layers
+// starting with the group of this layer is precomputed in parallel and all layers of the preceding groups are released.
+// Returns nullptr for layers not registered by init_layers() and for groups already released.
+AvoidCrossingPerimeters::LayerBoundaries* AvoidCrossingPerimeters::precomputed_boundaries(const Layer *layer)
+{
+    auto it_group = m_layer_to_group.find(layer);
+    if (it_group == m_layer_to_group.end() || it_group->second < m_precomputed_begin)
+        return nullptr;
+
+    if (const size_t group_idx = it_group->second; group_idx >= m_precomputed_end) {
+        // Collect a new batch of groups fitting the memory budget, but at least a single group.
+        size_t new_end = group_idx;
+        for (size_t memsize = 0; new_end < m_layer_groups.size(); ++ new_end) {
+            for (const Layer *l : m_layer_groups[new_end])
+                memsize += estimate_layer_boundaries_memsize(*l);
+            if (new_end > group_idx && memsize > m_memory_budget)
+                break;
+        }
+        // Release the groups that were already exported.
+        for (size_t idx = m_precomputed_begin; idx < std::min(group_idx, m_precomputed_end); ++ idx)
+            for (const Layer *l : m_layer_groups[idx])
+                m_layer_boundaries.erase(l);
+        m_precomputed_begin = group_idx;
+        m_precomputed_end   = new_end;
+
+        std::vector<std::pair<const Layer*, LayerBoundaries*>> to_precompute;
+        for (size_t idx = m_precomputed_begin; idx < m_precomputed_end; ++ idx)
+            for (const Layer *l : m_layer_groups[idx])
+                if (std::unique_ptr<LayerBoundaries> &lb = m_layer_boundaries[l]; ! lb) {
+                    lb = std::make_unique<LayerBoundaries>();
+                    to_precompute.emplace_back(l, lb.get());
+                }
+
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, to_precompute.size()), [&to_precompute](const tbb::blocked_range<size_t> &range) {
+            for (size_t idx = range.begin(); idx < range.end(); ++ idx) {
+                const Layer     &l  = *to_precompute[idx].first;
+                LayerBoundaries &lb = *to_precompute[idx].second;
+                init_grid_lslice(lb.grid_lslice, l);
+                init_boundary(&lb.internal, to_polygons(get_boundary(l)));
+                init_boundary(&lb.external, get_boundary_external(l));
+            }
+        });
+    }
+
+    auto it_boundaries = m_layer_boundaries.find(layer);
+    assert(it_boundaries != m_layer_boundaries.end() && it_boundaries->second);
+    return it_boundaries->second.get();
+}
+
+void AvoidCrossingPerimeters::init_layer(const Layer &layer)
+{
+    if (LayerBoundaries *layer_boundaries = this->precomputed_boundaries(&layer); layer_boundaries != nullptr) {
+        m_current = layer_boundaries;
+        return;
+    }
+
+    m_current = &m_lazy;
+    m_lazy.internal.clear();
+    m_lazy.external.clear();
+    init_grid_lslice(m_lazy.grid_lslice, layer);
 }
 
 #if 0
@@ -5,6 +5,9 @@
 #include "../ExPolygon.hpp"
 #include "../EdgeGrid.hpp"
 
+#include <memory>
+#include <unordered_map>
+
 namespace Slic3r {
 
 // Forward declarations.
@@ -23,6 +26,11 @@ public:
     bool        disabled_once() const   { return m_disabled_once; }
     void        reset_once_modifiers()  { m_use_external_mp_once = false; m_disabled_once = false; }
 
+    // Register all layers in the order in which they will be exported, grouped by the layers exported together
+    // (the same print_z). Boundaries of these layers are then precomputed in parallel in batches ahead of the layer
+    // being exported. Each batch spans as many groups as fit into memory_budget (in bytes, at least one group),
+    // based on an estimate of the memory occupied by the boundaries of each layer.
+    void        init_layers(std::vector<std::vector<const Layer*>> layer_groups, size_t memory_budget = DEFAULT_MEMORY_BUDGET);
     void        init_layer(const Layer &layer);
 
     Polyline    travel_to(const GCode& gcodegen, const Point& point)
@@ -42,14 +50,32 @@ public:
         std::vector<std::vector<float>> boundaries_params;
         // Used for detection of intersection between line and any polygon from boundaries
         EdgeGrid::Grid grid;
+        // Were the boundaries already calculated? They may be calculated and still empty.
+        bool initialized { false };
 
         void clear()
         {
             boundaries.clear();
             boundaries_params.clear();
+            initialized = false;
         }
     };
 
+    // All data needed for travel planning at a single layer.
+    struct LayerBoundaries {
+        // Used for detection of line or polyline is inside of any polygon.
+        EdgeGrid::Grid grid_lslice;
+        // Store all needed data for travels inside object
+        Boundary       internal;
+        // Store all needed data for travels outside object
+        Boundary       external;
+    };
+
+    // Memory budget for the precomputed boundaries if not limited by Print::layer_memory_budget(). The boundaries
+    // of a large layer spanning a 250x210mm bed occupy about 3MB, thus about 80 of such layers are precomputed
+    // in a single batch, enough to keep all the threads busy, while a batch of small layers spans thousands of layers.
+    static constexpr size_t DEFAULT_MEMORY_BUDGET = 256 << 20;
+
 private:
     bool           m_use_external_mp { false };
     // just for the next travel move
@@ -58,12 +84,20 @@ private:
     // we enable it by default for the first travel move in print
     bool           m_disabled_once { true };
 
-    // Used for detection of line or polyline is inside of any polygon.
-    EdgeGrid::Grid m_grid_lslice;
-    // Store all needed data for travels inside object
-    Boundary m_internal;
-    // Store all needed data for travels outside object
-    Boundary m_external;
+    // Boundaries of the layer passed to init_layer(), either precomputed or calculated on demand into m_lazy.
+    LayerBoundaries  m_lazy;
+    LayerBoundaries *m_current { &m_lazy };
+
+    // Groups of layers registered by init_layers() in the order of export and the precomputed boundaries.
+    std::vector<std::vector<const Layer*>>                               m_layer_groups;
+    std::unordered_map<const Layer*, size_t>                             m_layer_to_group;
+    std::unordered_map<const Layer*, std::unique_ptr<LayerBoundaries>>   m_layer_boundaries;
+    // Range of m_layer_groups, for which m_layer_boundaries are precomputed.
+    size_t                                                               m_precomputed_begin { 0 };
+    size_t                                                               m_precomputed_end { 0 };
+    size_t                                                               m_memory_budget { DEFAULT_MEMORY_BUDGET };
+
+    LayerBoundaries* precomputed_boundaries(const Layer *layer);
 };
 
 } // namespace Slic3r
@@ -1,9 +1,11 @@
 #include "../GCode.hpp"
 #include "CoolingBuffer.hpp"
 #include <boost/algorithm/string/predicate.hpp>
-#include <boost/algorithm/string/replace.hpp>
 #include <boost/log/trivial.hpp>
+#include <array>
+#include <cstring>
 #include <iostream>
+#include <string_view>
 #include <float.h>
 
 #if 0
@@ -16,6 +18,25 @@
 
 namespace Slic3r {
 
+// End of the G-code word starting at c: A white space, a comment or the end of the line.
+static inline const char* gcode_word_end(const char *c, const char *c_end)
+{
+    for (; c != c_end && *c != ' ' && *c != '\t' && *c != ';'; ++ c);
+    return c;
+}
+
+// Parse the number of a G-code word [begin, end). The G-code lines are views into the layer G-code,
+// thus the number is copied into a zero terminated buffer to not let atof() read past the word.
+static inline float parse_gcode_number(const char *begin, const char *end)
+{
+    char   buf[64];
+    size_t len = std::min(size_t(end - begin), sizeof(buf) - 1);
+    memcpy(buf, begin, len);
+    buf[len] = 0;
+    assert(is_decimal_separator_point()); // for atof
+    return float(atof(buf));
+}
+
 CoolingBuffer::CoolingBuffer(GCode &gcodegen) : m_gcodegen(gcodegen), m_current_extruder(0)
 {
     this->reset();
@@ -324,23 +345,25 @@ std::vector<PerExtruderAdjustments> CoolingBuffer::parse_layer_gcode(const std::
     const std::string toolchange_prefix = m_gcodegen.writer().toolchange_prefix();
     unsigned int      current_extruder  = m_current_extruder;
     PerExtruderAdjustments *adjustment  = &per_extruder_adjustments[map_extruder_to_per_extruder_adjustment[current_extruder]];
-    const char       *line_start = gcode.c_str();
-    const char       *line_end   = line_start;
+    const char       *gcode_begin = gcode.c_str();
+    const char       *gcode_end   = gcode_begin + gcode.size();
     const char        extrusion_axis = get_extrusion_axis(config)[0];
     // Index of an existing CoolingLine of the current adjustment, which holds the feedrate setting command
     // for a sequence of extrusion moves.
     size_t            active_speed_modifier = size_t(-1);
 
-    for (; *line_start != 0; line_start = line_end) 
+    for (const char *line_start = gcode_begin, *line_end; line_start != gcode_end; line_start = line_end)
     {
-        while (*line_end != '\n' && *line_end != 0)
-            ++ line_end;
-        // sline will not contain the trailing '\n'.
-        std::string sline(line_start, line_end);
+        // Find the end of line using memchr(), which is vectorized by the C runtime.
+        // sline will not contain the trailing '\n'. It is a view into the source G-code, nothing is copied.
+        line_end = static_cast<const char*>(memchr(line_start, '\n', gcode_end - line_start));
+        if (line_end == nullptr)
+            line_end = gcode_end;
+        std::string_view sline(line_start, line_end - line_start);
         // CoolingLine will contain the trailing '\n'.
-        if (*line_end == '\n')
+        if (line_end != gcode_end)
             ++ line_end;
-        CoolingLine line(0, line_start - gcode.c_str(), line_end - gcode.c_str());
+        CoolingLine line(0, line_start - gcode_begin, line_end - gcode_begin);
         if (boost::starts_with(sline, "G0 "))
             line.type = CoolingLine::TYPE_G0;
         else if (boost::starts_with(sline, "G1 "))
@@ -350,20 +373,22 @@ std::vector<PerExtruderAdjustments> CoolingBuffer::parse_layer_gcode(const std::
         if (line.type) {
             // G0, G1 or G92
             // Parse the G-code line.
-            std::vector<float> new_pos(current_pos);
-            const char *c = sline.data() + 3;
+            std::array<float, 5> new_pos;
+            std::copy(current_pos.begin(), current_pos.end(), new_pos.begin());
+            const char *c     = sline.data() + 3;
+            const char *c_end = sline.data() + sline.size();
             for (;;) {
                 // Skip whitespaces.
-                for (; *c == ' ' || *c == '\t'; ++ c);
-                if (*c == 0 || *c == ';')
+                for (; c != c_end && (*c == ' ' || *c == '\t'); ++ c);
+                if (c == c_end || *c == ';')
                     break;
 
-                assert(is_decimal_separator_point()); // for atof
                 // Parse the axis.
                 size_t axis = (*c >= 'X' && *c <= 'Z') ? (*c - 'X') :
                               (*c == extrusion_axis) ? 3 : (*c == 'F') ? 4 : size_t(-1);
+                const char *word_end = gcode_word_end(c, c_end);
                 if (axis != size_t(-1)) {
-                    new_pos[axis] = float(atof(++c));
+                    new_pos[axis] = parse_gcode_number(c + 1, word_end);
                     if (axis == 4) {
                         // Convert mm/min to mm/sec.
                         new_pos[4] /= 60.f;
@@ -373,15 +398,19 @@ std::vector<PerExtruderAdjustments> CoolingBuffer::parse_layer_gcode(const std::
                     }
                 }
                 // Skip this word.
-                for (; *c != ' ' && *c != '\t' && *c != 0; ++ c);
+                c = word_end;
             }
-            bool external_perimeter = boost::contains(sline, ";_EXTERNAL_PERIMETER");
-            bool wipe               = boost::contains(sline, ";_WIPE");
+            // The cooling markers are all comments, search for them in the comment part of the line only.
+            // Note that the cooling marker may follow a G-code word without a separating white space.
+            size_t           comment_start = sline.find(';', 3);
+            std::string_view comment    = (comment_start == std::string_view::npos) ? std::string_view() : sline.substr(comment_start);
+            bool external_perimeter     = comment.find(";_EXTERNAL_PERIMETER") != std::string_view::npos;
+            bool wipe                   = comment.find(";_WIPE") != std::string_view::npos;
             if (external_perimeter)
                 line.type |= CoolingLine::TYPE_EXTERNAL_PERIMETER;
             if (wipe)
                 line.type |= CoolingLine::TYPE_WIPE;
-            if (boost::contains(sline, ";_EXTRUDE_SET_SPEED") && ! wipe) {
+            if (! wipe && comment.find(";_EXTRUDE_SET_SPEED") != std::string_view::npos) {
                 line.type |= CoolingLine::TYPE_ADJUSTABLE;
                 active_speed_modifier = adjustment->lines.size();
             }
@@ -426,12 +455,12 @@ std::vector<PerExtruderAdjustments> CoolingBuffer::parse_layer_gcode(const std::
                     line.type = 0;
                 }
             }
-            current_pos = std::move(new_pos);
+            std::copy(new_pos.begin(), new_pos.end(), current_pos.begin());
         } else if (boost::starts_with(sline, ";_EXTRUDE_END")) {
             line.type = CoolingLine::TYPE_EXTRUDE_END;
             active_speed_modifier = size_t(-1);
         } else if (boost::starts_with(sline, toolchange_prefix)) {
-            unsigned int new_extruder = (unsigned int)atoi(sline.c_str() + toolchange_prefix.size());
+            unsigned int new_extruder = (unsigned int)atoi(sline.data() + toolchange_prefix.size());
             // Only change extruder in case the number is meaningful. User could provide an out-of-range index through custom gcodes - those shall be ignored.
             if (new_extruder < map_extruder_to_per_extruder_adjustment.size()) {
                 if (new_extruder != current_extruder) {
@@ -454,12 +483,17 @@ std::vector<PerExtruderAdjustments> CoolingBuffer::parse_layer_gcode(const std::
         } else if (boost::starts_with(sline, "G4 ")) {
             // Parse the wait time.
             line.type = CoolingLine::TYPE_G4;
-            size_t pos_S = sline.find('S', 3);
-            size_t pos_P = sline.find('P', 3);
-            assert(is_decimal_separator_point()); // for atof
-            line.time = line.time_max = float(
-                (pos_S > 0) ? atof(sline.c_str() + pos_S + 1) :
-                (pos_P > 0) ? atof(sline.c_str() + pos_P + 1) * 0.001 : 0.);
+            // S is the time in seconds, P in milliseconds.
+            const char *c_end = sline.data() + sline.size();
+            for (const char *c = sline.data() + 3; c != c_end && *c != ';';) {
+                const char *word_end = gcode_word_end(c, c_end);
+                if (*c == 'S' || *c == 'P')
+                    line.time = line.time_max = parse_gcode_number(c + 1, word_end) * (*c == 'S' ? 1.f : 0.001f);
+                if (*c == 'S')
+                    // S takes precedence over P.
+                    break;
+                for (c = word_end; c != c_end && (*c == ' ' || *c == '\t'); ++ c);
+            }
         }
         if (line.type != 0)
             adjustment->lines.emplace_back(std::move(line));
@@ -689,7 +723,9 @@ std::string CoolingBuffer::apply_layer_cooldown(
     }
     // Second generate the adjusted G-code.
     std::string new_gcode;
-    new_gcode.reserve(gcode.size() * 2);
+    // The cooling markers are removed and the feedrates are only ever shortened or dropped, thus the output
+    // is not expected to grow much over the source G-code, apart from the fan control commands.
+    new_gcode.reserve(gcode.size() + gcode.size() / 16 + 256);
     int  fan_speed          = -1;
     bool bridge_fan_control = false;
     int  bridge_fan_speed   = 0;
@@ -819,13 +855,28 @@ std::string CoolingBuffer::apply_layer_cooldown(
             if (end < line_end) {
                 if (line->type & (CoolingLine::TYPE_ADJUSTABLE | CoolingLine::TYPE_EXTERNAL_PERIMETER | CoolingLine::TYPE_WIPE)) {
                     // Process comments, remove ";_EXTRUDE_SET_SPEED", ";_EXTERNAL_PERIMETER", ";_WIPE"
-                    std::string comment(end, line_end);
-                    boost::replace_all(comment, ";_EXTRUDE_SET_SPEED", "");
-                    if (line->type & CoolingLine::TYPE_EXTERNAL_PERIMETER)
-                        boost::replace_all(comment, ";_EXTERNAL_PERIMETER", "");
-                    if (line->type & CoolingLine::TYPE_WIPE)
-                        boost::replace_all(comment, ";_WIPE", "");
-                    new_gcode += comment;
+                    // while appending the comment to the output, without creating a temporary string.
+                    std::string_view comment(end, line_end - end);
+                    for (size_t i = 0;;) {
+                        size_t j = comment.find(";_", i);
+                        if (j == std::string_view::npos) {
+                            new_gcode.append(comment.data() + i, comment.size() - i);
+                            break;
+                        }
+                        new_gcode.append(comment.data() + i, j - i);
+                        std::string_view rest = comment.substr(j);
+                        if (boost::starts_with(rest, ";_EXTRUDE_SET_SPEED"))
+                            i = j + strlen(";_EXTRUDE_SET_SPEED");
+                        else if ((line->type & CoolingLine::TYPE_EXTERNAL_PERIMETER) && boost::starts_with(rest, ";_EXTERNAL_PERIMETER"))
+                            i = j + strlen(";_EXTERNAL_PERIMETER");
+                        else if ((line->type & CoolingLine::TYPE_WIPE) && boost::starts_with(rest, ";_WIPE"))
+                            i = j + strlen(";_WIPE");
+                        else {
+                            // Not a cooling marker, keep it.
+                            new_gcode.append(comment.data() + j, 2);
+                            i = j + 2;
+                        }
+                    }
                 } else {
                     // Just attach the rest of the source line.
                     new_gcode.append(end, line_end - end);
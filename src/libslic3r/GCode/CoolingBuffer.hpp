@@ -30,6 +30,9 @@ public:
 
 private:
 	CoolingBuffer& operator=(const CoolingBuffer&) = delete;
+    // Parse the G-code of a layer into the CoolingLine records, which refer to the G-code lines by their offsets.
+    // The records are recovered from the text rather than emitted by GCode, as the custom G-code, the wipe tower
+    // and the placeholder parser output reach the cooling buffer as text only.
     std::vector<PerExtruderAdjustments> parse_layer_gcode(const std::string &gcode, std::vector<float> &current_pos) const;
     float       calculate_layer_slowdown(std::vector<PerExtruderAdjustments> &per_extruder_adjustments);
     // Apply slow down over G-code lines stored in per_extruder_adjustments, enable fan if needed.
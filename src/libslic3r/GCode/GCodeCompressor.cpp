@@ -0,0 +1,297 @@
+#include "GCodeCompressor.hpp"
+#include "../Exception.hpp"
+
+#include <array>
+#include <cstring>
+#include <vector>
+
+#include <boost/algorithm/string/predicate.hpp>
+#include <boost/log/trivial.hpp>
+#include <boost/nowide/cstdio.hpp>
+
+#include <miniz.h>
+
+namespace Slic3r {
+
+// Size of the chunks the source G-code is read in and the encoded data is written in.
+static constexpr const size_t GCODE_COMPRESSOR_CHUNK = 65536;
+
+class GCodeCompressor::Encoder {
+public:
+    Encoder(GCodeCompressor &owner) : m_owner(owner) {}
+    virtual ~Encoder() = default;
+    virtual void encode(const char *data, size_t len) = 0;
+    virtual void finish() = 0;
+
+protected:
+    void write_raw(const void *data, size_t len) { m_owner.write_raw(data, len); }
+
+private:
+    GCodeCompressor &m_owner;
+};
+
+namespace {
+
+class PlainEncoder : public GCodeCompressor::Encoder {
+public:
+    PlainEncoder(GCodeCompressor &owner) : GCodeCompressor::Encoder(owner) {}
+    void encode(const char *data, size_t len) override { this->write_raw(data, len); }
+    void finish() override {}
+};
+
+// gzip (RFC 1952) stream: Header, raw deflate stream produced by miniz, CRC32 and size of the input.
+class GzipEncoder : public GCodeCompressor::Encoder {
+public:
+    GzipEncoder(GCodeCompressor &owner) : GCodeCompressor::Encoder(owner), m_deflate(new tdefl_compressor)
+    {
+        // Magic, deflate, no flags, no modification time, no extra flags, unknown OS.
+        static constexpr const unsigned char header[10] = { 0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 0xff };
+        this->write_raw(header, sizeof(header));
+        // Negative window bits: Raw deflate stream without the zlib header.
+        mz_uint flags = tdefl_create_comp_flags_from_zip_params(MZ_DEFAULT_LEVEL, - MZ_DEFAULT_WINDOW_BITS, MZ_DEFAULT_STRATEGY);
+        if (tdefl_init(m_deflate.get(), put_buf, this, int(flags)) != TDEFL_STATUS_OKAY)
+            throw Slic3r::RuntimeError("Failed to initialize the G-code gzip compressor");
+    }
+
+    void encode(const char *data, size_t len) override
+    {
+        m_crc32 = mz_crc32(m_crc32, reinterpret_cast<const unsigned char*>(data), len);
+        m_size += len;
+        this->compress(data, len, TDEFL_NO_FLUSH);
+    }
+
+    void finish() override
+    {
+        this->compress(nullptr, 0, TDEFL_FINISH);
+        // Both the CRC32 and the size modulo 2^32 are stored little endian.
+        unsigned char trailer[8];
+        for (int i = 0; i < 4; ++ i) {
+            trailer[i]     = (unsigned char)((m_crc32 >> (8 * i)) & 0x0ff);
+            trailer[i + 4] = (unsigned char)((m_size  >> (8 * i)) & 0x0ff);
+        }
+        this->write_raw(trailer, sizeof(trailer));
+    }
+
+private:
+    void compress(const char *data, size_t len, tdefl_flush flush)
+    {
+        tdefl_status status = tdefl_compress_buffer(m_deflate.get(), data, len, flush);
+        if (! m_error.empty())
+            throw Slic3r::RuntimeError(m_error);
+        if (status != (flush == TDEFL_FINISH ? TDEFL_STATUS_DONE : TDEFL_STATUS_OKAY))
+            throw Slic3r::RuntimeError("G-code gzip compression failed");
+    }
+
+    // Called by miniz, exceptions must not pass through the C code.
+    static mz_bool put_buf(const void *buf, int len, void *user)
+    {
+        auto *self = static_cast<GzipEncoder*>(user);
+        try {
+            self->write_raw(buf, size_t(len));
+        } catch (const std::exception &ex) {
+            self->m_error = ex.what();
+            return MZ_FALSE;
+        }
+        return MZ_TRUE;
+    }
+
+    std::unique_ptr<tdefl_compressor>   m_deflate;
+    mz_ulong                            m_crc32 { MZ_CRC32_INIT };
+    uint64_t                            m_size  { 0 };
+    std::string                         m_error;
+};
+
+// MeatPack packs the most frequent G-code characters into 4 bits, two characters per byte.
+// A nibble of 0b1111 signals that a full width character follows the packed byte.
+// The firmware is switched into the packing mode by a command sequence at the start of the stream.
+// The comments are not interpreted by the firmware, they are stripped together with the whitespace in front of them
+// and the lines left empty are dropped, thus the source is packed line by line.
+class MeatPackEncoder : public GCodeCompressor::Encoder {
+public:
+    MeatPackEncoder(GCodeCompressor &owner) : GCodeCompressor::Encoder(owner)
+    {
+        m_table.fill(FULL_WIDTH);
+        for (char c = '0'; c <= '9'; ++ c)
+            m_table[(unsigned char)c] = (unsigned char)(c - '0');
+        m_table[(unsigned char)'.']  = 10;
+        m_table[(unsigned char)' ']  = 11;
+        m_table[(unsigned char)'\n'] = 12;
+        m_table[(unsigned char)'G']  = 13;
+        m_table[(unsigned char)'X']  = 14;
+        m_buffer.reserve(GCODE_COMPRESSOR_CHUNK + 4);
+        m_line.reserve(256);
+        // Signal byte twice, followed by the "enable packing" command.
+        m_buffer.push_back(char(0xff));
+        m_buffer.push_back(char(0xff));
+        m_buffer.push_back(char(0xfb));
+    }
+
+    void encode(const char *data, size_t len) override
+    {
+        for (const char *c = data, *end = data + len; c != end; ++ c) {
+            if (*c == '\n') {
+                this->pack_line();
+                m_comment = false;
+            } else if (*c == ';')
+                m_comment = true;
+            else if (! m_comment)
+                m_line += *c;
+        }
+    }
+
+    void finish() override
+    {
+        // The last line may not be terminated with a new line.
+        this->pack_line();
+        if (m_pending) {
+            // Odd number of characters: Terminate the last one with a new line.
+            m_pending = false;
+            this->emit(m_pending_char, '\n');
+        }
+        this->flush();
+    }
+
+private:
+    static constexpr const unsigned char FULL_WIDTH = 0x0f;
+
+    // Pack the current line without its comment and trailing whitespace, terminated with a new line. Empty lines are dropped.
+    void pack_line()
+    {
+        size_t len = m_line.size();
+        while (len > 0 && (m_line[len - 1] == ' ' || m_line[len - 1] == '\t' || m_line[len - 1] == '\r'))
+            -- len;
+        if (len > 0) {
+            for (size_t i = 0; i < len; ++ i)
+                this->pack(m_line[i]);
+            this->pack('\n');
+        }
+        m_line.clear();
+    }
+
+    void pack(char c)
+    {
+        if (! m_pending) {
+            if (c == '\n') {
+                // The firmware ignores the second nibble of a byte starting with a new line.
+                this->emit('\n', ' ');
+            } else {
+                m_pending      = true;
+                m_pending_char = c;
+            }
+        } else {
+            m_pending = false;
+            this->emit(m_pending_char, c);
+        }
+    }
+
+    void emit(char c1, char c2)
+    {
+        unsigned char n1 = m_table[(unsigned char)c1];
+        unsigned char n2 = m_table[(unsigned char)c2];
+        m_buffer.push_back(char((n2 << 4) | n1));
+        if (n1 == FULL_WIDTH)
+            m_buffer.push_back(c1);
+        if (n2 == FULL_WIDTH && c1 != '\n')
+            m_buffer.push_back(c2);
+        if (m_buffer.size() >= GCODE_COMPRESSOR_CHUNK)
+            this->flush();
+    }
+
+    void flush()
+    {
+        this->write_raw(m_buffer.data(), m_buffer.size());
+        m_buffer.clear();
+    }
+
+    std::array<unsigned char, 256>  m_table;
+    std::string                     m_buffer;
+    // Current source line without its comment.
+    std::string                     m_line;
+    bool                            m_comment { false };
+    bool                            m_pending { false };
+    char                            m_pending_char { 0 };
+};
+
+} // namespace
+
+GCodeCompressor::GCodeCompressor(const std::string &path, GCodeCompression compression) : m_path(path)
+{
+    m_file = boost::nowide::fopen(path.c_str(), "wb");
+    if (m_file == nullptr)
+        throw Slic3r::RuntimeError(std::string("G-code export to ") + path + " failed.\nCannot open the file for writing.\n");
+    switch (compression) {
+    case GCodeCompression::Gzip:     m_encoder = std::make_unique<GzipEncoder>(*this); break;
+    case GCodeCompression::MeatPack: m_encoder = std::make_unique<MeatPackEncoder>(*this); break;
+    default:                         m_encoder = std::make_unique<PlainEncoder>(*this); break;
+    }
+}
+
+GCodeCompressor::~GCodeCompressor()
+{
+    if (m_file != nullptr)
+        fclose(m_file);
+}
+
+void GCodeCompressor::write(const char *data, size_t len)
+{
+    assert(m_file != nullptr);
+    m_encoder->encode(data, len);
+}
+
+void GCodeCompressor::close()
+{
+    assert(m_file != nullptr);
+    m_encoder->finish();
+    FILE *file = m_file;
+    m_file = nullptr;
+    if (fclose(file) != 0)
+        throw Slic3r::RuntimeError(std::string("G-code export to ") + m_path + " failed.\nIs the disk full?\n");
+}
+
+void GCodeCompressor::write_raw(const void *data, size_t len)
+{
+    if (len > 0 && ::fwrite(data, 1, len, m_file) != len)
+        throw Slic3r::RuntimeError(std::string("G-code export to ") + m_path + " failed.\nIs the disk full?\n");
+    m_bytes_written += len;
+}
+
+std::string compressed_gcode_path(const std::string &path, GCodeCompression compression)
+{
+    const char *suffix = compression == GCodeCompression::Gzip ? ".gz" : compression == GCodeCompression::MeatPack ? ".mp" : nullptr;
+    return suffix == nullptr || boost::iends_with(path, suffix) ? path : path + suffix;
+}
+
+void compress_gcode_file(const std::string &src, const std::string &dst, GCodeCompression compression)
+{
+    FILE *in = boost::nowide::fopen(src.c_str(), "rb");
+    if (in == nullptr)
+        throw Slic3r::RuntimeError(std::string("Failed to open the G-code file ") + src + " for compression.");
+    size_t in_size = 0;
+    size_t out_size = 0;
+    try {
+        GCodeCompressor         compressor(dst, compression);
+        std::vector<char>       buffer(GCODE_COMPRESSOR_CHUNK);
+        for (;;) {
+            size_t len = ::fread(buffer.data(), 1, buffer.size(), in);
+            if (len > 0) {
+                compressor.write(buffer.data(), len);
+                in_size += len;
+            }
+            if (len < buffer.size()) {
+                if (ferror(in))
+                    throw Slic3r::RuntimeError(std::string("Failed to read the G-code file ") + src + " for compression.");
+                break;
+            }
+        }
+        compressor.close();
+        out_size = compressor.bytes_written();
+    } catch (...) {
+        fclose(in);
+        boost::nowide::remove(dst.c_str());
+        throw;
+    }
+    fclose(in);
+    BOOST_LOG_TRIVIAL(debug) << "G-code " << src << " compressed into " << dst << ": " << in_size << " -> " << out_size << " bytes";
+}
+
+} // namespace Slic3r
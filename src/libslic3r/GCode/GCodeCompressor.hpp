@@ -0,0 +1,70 @@
+#ifndef slic3r_GCodeCompressor_hpp_
+#define slic3r_GCodeCompressor_hpp_
+
+#include "../libslic3r.h"
+#include "../PrintConfig.hpp"
+
+#include <cstdio>
+#include <memory>
+#include <string>
+
+namespace Slic3r {
+
+// Writer of G-code into a file, optionally gzip compressed or MeatPack packed while being written.
+// The G-code is written in chunks of arbitrary size, the whole file is never held in memory.
+class GCodeCompressor {
+public:
+    // Opens the output file, throws Slic3r::RuntimeError if the file cannot be created.
+    GCodeCompressor(const std::string &path, GCodeCompression compression);
+    // Closes the file. If close() was not called, the output is incomplete.
+    ~GCodeCompressor();
+
+    GCodeCompressor(const GCodeCompressor&) = delete;
+    GCodeCompressor& operator=(const GCodeCompressor&) = delete;
+
+    // Append a chunk of G-code. Throws Slic3r::RuntimeError on a write failure.
+    void write(const char *data, size_t len);
+    void write(const std::string &data) { this->write(data.data(), data.size()); }
+    // Flush the encoder state (gzip trailer, MeatPack padding) and close the file.
+    // Throws Slic3r::RuntimeError on a write failure.
+    void close();
+
+    // Number of bytes written into the output file so far.
+    size_t bytes_written() const { return m_bytes_written; }
+
+    class Encoder;
+
+private:
+    void write_raw(const void *data, size_t len);
+
+    std::string              m_path;
+    FILE                    *m_file { nullptr };
+    std::unique_ptr<Encoder> m_encoder;
+    size_t                   m_bytes_written { 0 };
+};
+
+// Whether the G-code export writes the compressed G-code into compressed_gcode_path() while post-processing the exported G-code,
+// saving a separate compression pass over the finished file. The post-processing scripts expect plain text, thus with the scripts
+// configured the G-code is compressed by compress_gcode_file() after the scripts finished.
+enum class GCodeCompressedOutput {
+    // Plain text G-code only.
+    None,
+    // Plain text G-code and the compressed G-code, for example if the plain text G-code is shown by the G-code preview.
+    WithPlain,
+    // Compressed G-code only.
+    Only,
+};
+
+// File name of the compressed G-code: ".gz" is appended for the gzip compression, ".mp" for MeatPack, if not already there.
+// The MeatPack packed G-code is binary, it must not be mistaken for a plain text .gcode file.
+std::string compressed_gcode_path(const std::string &path, GCodeCompression compression);
+
+// Compress the plain text G-code file src into dst with the compression method, reading and writing it in chunks.
+// This is a separate pass over the finished G-code file, run after the post-processing scripts, which expect plain text.
+// Without the scripts the G-code is compressed while being exported, see GCodeCompressedOutput.
+// Throws Slic3r::RuntimeError on failure, in that case the incomplete dst is removed.
+void compress_gcode_file(const std::string &src, const std::string &dst, GCodeCompression compression);
+
+} // namespace Slic3r
+
+#endif // slic3r_GCodeCompressor_hpp_
@@ -3,6 +3,7 @@
 #include "libslic3r/Print.hpp"
 #include "libslic3r/LocalesUtils.hpp"
 #include "GCodeProcessor.hpp"
+#include "GCodeCompressor.hpp"
 
 #include <boost/log/trivial.hpp>
 #if ENABLE_VALIDATE_CUSTOM_GCODE
@@ -360,21 +361,49 @@ void GCodeProcessor::TimeProcessor::reset()
     machines[static_cast<size_t>(PrintEstimatedStatistics::ETimeMode::Normal)].enabled = true;
 }
 
+std::string GCodeProcessor::TimeProcessor::estimated_printing_time_lines() const
+{
+    std::string ret;
+    for (size_t i = 0; i < static_cast<size_t>(PrintEstimatedStatistics::ETimeMode::Count); ++i) {
+        const TimeMachine& machine = machines[i];
+        PrintEstimatedStatistics::ETimeMode mode = static_cast<PrintEstimatedStatistics::ETimeMode>(i);
+        if (mode == PrintEstimatedStatistics::ETimeMode::Normal || machine.enabled) {
+            char buf[128];
+            sprintf(buf, "; estimated printing time (%s mode) = %s\n",
+                (mode == PrintEstimatedStatistics::ETimeMode::Normal) ? "normal" : "silent",
+                get_time_dhms(machine.time).c_str());
+            ret += buf;
+        }
+    }
+    return ret;
+}
+
 #if ENABLE_GCODE_LINES_ID_IN_H_SLIDER
-void GCodeProcessor::TimeProcessor::post_process(const std::string& filename, std::vector<MoveVertex>& moves)
+void GCodeProcessor::TimeProcessor::post_process(const std::string& filename, std::vector<MoveVertex>& moves, GCodeCompressor* compressed, bool keep_plain)
 #else
-void GCodeProcessor::TimeProcessor::post_process(const std::string& filename)
+void GCodeProcessor::TimeProcessor::post_process(const std::string& filename, GCodeCompressor* compressed, bool keep_plain)
 #endif // ENABLE_GCODE_LINES_ID_IN_H_SLIDER
 {
+    assert(keep_plain || compressed != nullptr);
+
     boost::nowide::ifstream in(filename);
     if (!in.good())
         throw Slic3r::RuntimeError(std::string("Time estimator post process export failed.\nCannot open file for reading.\n"));
 
-    // temporary file to contain modified gcode
+    // temporary file to contain modified gcode, not needed if the modified gcode is only written compressed
     std::string out_path = filename + ".postprocess";
-    FILE* out = boost::nowide::fopen(out_path.c_str(), "wb");
-    if (out == nullptr)
-        throw Slic3r::RuntimeError(std::string("Time estimator post process export failed.\nCannot open file for writing.\n"));
+    FILE* out = nullptr;
+    if (keep_plain) {
+        out = boost::nowide::fopen(out_path.c_str(), "wb");
+        if (out == nullptr)
+            throw Slic3r::RuntimeError(std::string("Time estimator post process export failed.\nCannot open file for writing.\n"));
+    }
+    auto close_out = [&out]() {
+        if (out != nullptr) {
+            fclose(out);
+            out = nullptr;
+        }
+    };
 
     auto time_in_minutes = [](float time_in_seconds) {
         return int(::roundf(time_in_seconds / 60.0f));
@@ -501,17 +530,7 @@ void GCodeProcessor::TimeProcessor::post_process(const std::string& filename)
         }
         else if (line == Estimated_Printing_Time_Placeholder_Tag) {
 #endif // ENABLE_VALIDATE_CUSTOM_GCODE
-                for (size_t i = 0; i < static_cast<size_t>(PrintEstimatedStatistics::ETimeMode::Count); ++i) {
-                    const TimeMachine& machine = machines[i];
-                    PrintEstimatedStatistics::ETimeMode mode = static_cast<PrintEstimatedStatistics::ETimeMode>(i);
-                    if (mode == PrintEstimatedStatistics::ETimeMode::Normal || machine.enabled) {
-                        char buf[128];
-                        sprintf(buf, "; estimated printing time (%s mode) = %s\n",
-                            (mode == PrintEstimatedStatistics::ETimeMode::Normal) ? "normal" : "silent",
-                            get_time_dhms(machine.time).c_str());
-                        ret += buf;
-                    }
-                }
+                ret += estimated_printing_time_lines();
             }
 #if ENABLE_VALIDATE_CUSTOM_GCODE
         }
@@ -638,12 +657,26 @@ void GCodeProcessor::TimeProcessor::post_process(const std::string& filename)
 
     // helper function to write to disk
     auto write_string = [&](const std::string& str) {
-        fwrite((const void*)export_line.c_str(), 1, export_line.length(), out);
-        if (ferror(out)) {
-            in.close();
-            fclose(out);
-            boost::nowide::remove(out_path.c_str());
-            throw Slic3r::RuntimeError(std::string("Time estimator post process export failed.\nIs the disk full?\n"));
+        if (out != nullptr) {
+            fwrite((const void*)export_line.c_str(), 1, export_line.length(), out);
+            if (ferror(out)) {
+                in.close();
+                close_out();
+                boost::nowide::remove(out_path.c_str());
+                throw Slic3r::RuntimeError(std::string("Time estimator post process export failed.\nIs the disk full?\n"));
+            }
+        }
+        if (compressed != nullptr) {
+            try {
+                compressed->write(export_line);
+            } catch (...) {
+                in.close();
+                if (out != nullptr) {
+                    close_out();
+                    boost::nowide::remove(out_path.c_str());
+                }
+                throw;
+            }
         }
         export_line.clear();
     };
@@ -655,7 +688,7 @@ void GCodeProcessor::TimeProcessor::post_process(const std::string& filename)
 
     while (std::getline(in, gcode_line)) {
         if (!in.good()) {
-            fclose(out);
+            close_out();
             throw Slic3r::RuntimeError(std::string("Time estimator post process export failed.\nError while reading from file.\n"));
         }
 
@@ -681,7 +714,8 @@ void GCodeProcessor::TimeProcessor::post_process(const std::string& filename)
             // add lines M73 where needed
             parser.parse_line(gcode_line,
                 [&](GCodeReader& reader, const GCodeReader::GCodeLine& line) {
-                    if (line.cmd_is("G1")) {
+                    // Arcs are counted as a single G1 line each, see GCodeProcessor::process_G2_G3().
+                    if (line.cmd_is("G1") || line.cmd_is("G2") || line.cmd_is("G3")) {
 #if ENABLE_GCODE_LINES_ID_IN_H_SLIDER
                         unsigned int extra_lines_count = process_line_G1();
                         ++g1_lines_counter;
@@ -703,7 +737,7 @@ void GCodeProcessor::TimeProcessor::post_process(const std::string& filename)
     if (!export_line.empty())
         write_string(export_line);
 
-    fclose(out);
+    close_out();
     in.close();
 
 #if ENABLE_GCODE_LINES_ID_IN_H_SLIDER
@@ -719,7 +753,7 @@ void GCodeProcessor::TimeProcessor::post_process(const std::string& filename)
     }
 #endif // ENABLE_GCODE_LINES_ID_IN_H_SLIDER
 
-    if (rename_file(out_path, filename))
+    if (keep_plain && rename_file(out_path, filename))
         throw Slic3r::RuntimeError(std::string("Failed to rename the output G-code file from ") + out_path + " to " + filename + '\n' +
             "Is " + out_path + " locked?" + '\n');
 }
@@ -792,6 +826,7 @@ void GCodeProcessor::UsedFilaments::process_caches(GCodeProcessor* processor)
 
 #if ENABLE_GCODE_VIEWER_STATISTICS
 void GCodeProcessor::Result::reset() {
+    gcode_hash = 0;
     moves = std::vector<GCodeProcessor::MoveVertex>();
     bed_shape = Pointfs();
     settings_ids.reset();
@@ -803,6 +838,7 @@ void GCodeProcessor::Result::reset() {
 }
 #else
 void GCodeProcessor::Result::reset() {
+    gcode_hash = 0;
     moves = std::vector<GCodeProcessor::MoveVertex>();
     bed_shape = Pointfs();
     settings_ids.reset();
@@ -1292,13 +1328,19 @@ void GCodeProcessor::process_file(const std::string& filename, bool apply_postpr
     }
 
     // process gcode
+    this->initialize();
 #if ENABLE_GCODE_WINDOW
     m_result.filename = filename;
 #endif // ENABLE_GCODE_WINDOW
-    m_result.id = ++s_result_id;
-    // 1st move must be a dummy move
-    m_result.moves.emplace_back(MoveVertex());
-    m_parser.parse_file(filename, [this, cancel_callback, &last_cancel_callback_time](GCodeReader& reader, const GCodeReader::GCodeLine& line) {
+    // 64-bit FNV-1a hash of the lines, independent of the platform, thus the hash of a file copied to another machine matches.
+    uint64_t gcode_hash = 0xcbf29ce484222325ull;
+    auto     hash_line  = [&gcode_hash](const std::string& line) {
+        for (char c : line)
+            gcode_hash = (gcode_hash ^ uint64_t((unsigned char)c)) * 0x100000001b3ull;
+        gcode_hash = (gcode_hash ^ uint64_t('\n')) * 0x100000001b3ull;
+    };
+    m_parser.parse_file(filename, [this, cancel_callback, &last_cancel_callback_time, &hash_line](GCodeReader& reader, const GCodeReader::GCodeLine& line) {
+        hash_line(line.raw());
         if (cancel_callback != nullptr) {
             // call the cancel callback every 100 ms
             auto curr_time = std::chrono::high_resolution_clock::now();
@@ -1310,6 +1352,70 @@ void GCodeProcessor::process_file(const std::string& filename, bool apply_postpr
         process_gcode_line(line);
         });
 
+    this->finalize();
+    m_result.gcode_hash = gcode_hash;
+
+    // post-process to add M73 lines into the gcode
+    if (apply_postprocess) {
+        this->post_process(filename);
+        // The file no longer matches the hash.
+        m_result.gcode_hash = 0;
+    }
+
+#if ENABLE_GCODE_VIEWER_DATA_CHECKING
+    std::cout << "\n";
+    m_mm3_per_mm_compare.output();
+    m_height_compare.output();
+    m_width_compare.output();
+#endif // ENABLE_GCODE_VIEWER_DATA_CHECKING
+
+#if ENABLE_GCODE_VIEWER_STATISTICS
+    m_result.time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start_time).count();
+#endif // ENABLE_GCODE_VIEWER_STATISTICS
+}
+
+void GCodeProcessor::initialize()
+{
+    m_parser_buffer.clear();
+    m_result.id = ++s_result_id;
+    // 1st move must be a dummy move
+    m_result.moves.emplace_back(MoveVertex());
+}
+
+void GCodeProcessor::process_buffer(const char* buffer, size_t length)
+{
+    auto callback = [this](GCodeReader& reader, const GCodeReader::GCodeLine& line) { process_gcode_line(line); };
+    const char* end = buffer + length;
+    if (! m_parser_buffer.empty()) {
+        // Complete the line split by the previous call.
+        const char* eol = static_cast<const char*>(memchr(buffer, '\n', length));
+        if (eol == nullptr) {
+            m_parser_buffer.append(buffer, length);
+            return;
+        }
+        m_parser_buffer.append(buffer, eol + 1);
+        buffer = eol + 1;
+        m_parser.parse_line(m_parser_buffer, callback);
+        m_parser_buffer.clear();
+    }
+    // Parse the complete lines in place, keep the incomplete last line for the next call.
+    const char* last_line = end;
+    for (; last_line != buffer && last_line[-1] != '\n'; -- last_line);
+    m_parser_buffer.assign(last_line, end);
+    GCodeReader::GCodeLine gline;
+    while (buffer < last_line) {
+        gline.reset();
+        buffer = m_parser.parse_line(buffer, gline, callback);
+    }
+}
+
+void GCodeProcessor::finalize()
+{
+    if (! m_parser_buffer.empty()) {
+        m_parser.parse_line(m_parser_buffer, [this](GCodeReader& reader, const GCodeReader::GCodeLine& line) { process_gcode_line(line); });
+        m_parser_buffer.clear();
+    }
+
     // update width/height of wipe moves
     for (MoveVertex& move : m_result.moves) {
         if (move.type == EMoveType::Wipe) {
@@ -1330,25 +1436,15 @@ void GCodeProcessor::process_file(const std::string& filename, bool apply_postpr
     m_used_filaments.process_caches(this);
 
     update_estimated_times_stats();
+}
 
-    // post-process to add M73 lines into the gcode
-    if (apply_postprocess)
+void GCodeProcessor::post_process(const std::string& filename, GCodeCompressor* compressed, bool keep_plain)
+{
 #if ENABLE_GCODE_LINES_ID_IN_H_SLIDER
-        m_time_processor.post_process(filename, m_result.moves);
+    m_time_processor.post_process(filename, m_result.moves, compressed, keep_plain);
 #else
-        m_time_processor.post_process(filename);
+    m_time_processor.post_process(filename, compressed, keep_plain);
 #endif // ENABLE_GCODE_LINES_ID_IN_H_SLIDER
-
-#if ENABLE_GCODE_VIEWER_DATA_CHECKING
-    std::cout << "\n";
-    m_mm3_per_mm_compare.output();
-    m_height_compare.output();
-    m_width_compare.output();
-#endif // ENABLE_GCODE_VIEWER_DATA_CHECKING
-
-#if ENABLE_GCODE_VIEWER_STATISTICS
-    m_result.time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start_time).count();
-#endif // ENABLE_GCODE_VIEWER_STATISTICS
 }
 
 float GCodeProcessor::get_time(PrintEstimatedStatistics::ETimeMode mode) const
@@ -1484,6 +1580,8 @@ void GCodeProcessor::process_gcode_line(const GCodeReader::GCodeLine& line)
                 {
                 case 0:  { process_G0(line); break; }  // Move
                 case 1:  { process_G1(line); break; }  // Move
+                case 2:  { process_G2_G3(line, true); break; }  // Clockwise arc
+                case 3:  { process_G2_G3(line, false); break; } // Counterclockwise arc
                 case 10: { process_G10(line); break; } // Retract
                 case 11: { process_G11(line); break; } // Unretract
                 case 20: { process_G20(line); break; } // Set Units to Inches
@@ -2575,6 +2673,112 @@ void GCodeProcessor::process_G1(const GCodeReader::GCodeLine& line)
     store_move_vertex(type);
 }
 
+void GCodeProcessor::process_G2_G3(const GCodeReader::GCodeLine& line, bool clockwise)
+{
+    float center_x = 0.0f;
+    float center_y = 0.0f;
+    bool  has_i = line.has_value('I', center_x);
+    bool  has_j = line.has_value('J', center_y);
+    if (!has_i && !has_j) {
+        // Arcs defined by the radius (R word) are not supported, process the move as a straight line.
+        process_G1(line);
+        return;
+    }
+
+    float filament_diameter = (static_cast<size_t>(m_extruder_id) < m_result.filament_diameters.size()) ? m_result.filament_diameters[m_extruder_id] : m_result.filament_diameters.back();
+    float filament_radius = 0.5f * filament_diameter;
+    float area_filament_cross_section = static_cast<float>(M_PI) * sqr(filament_radius);
+    float lengthsScaleFactor = (m_units == EUnits::Inches) ? INCHES_TO_MM : 1.0f;
+    auto absolute_position = [this, area_filament_cross_section, lengthsScaleFactor](Axis axis, const GCodeReader::GCodeLine& lineG2) {
+        bool is_relative = (m_global_positioning_type == EPositioningType::Relative);
+        if (axis == E)
+            is_relative |= (m_e_local_positioning_type == EPositioningType::Relative);
+
+        if (lineG2.has(Slic3r::Axis(axis))) {
+            float ret = lineG2.value(Slic3r::Axis(axis)) * lengthsScaleFactor;
+            if (axis == E && m_use_volumetric_e)
+                ret /= area_filament_cross_section;
+            return is_relative ? m_start_position[axis] + ret : m_origin[axis] + ret;
+        }
+        else
+            return m_start_position[axis];
+    };
+
+    AxisCoords start_position = m_start_position;
+    AxisCoords end_position;
+    for (unsigned char a = X; a <= E; ++a) {
+        end_position[a] = absolute_position((Axis)a, line);
+    }
+
+    // The center of the arc is always relative to the start point.
+    const Vec2d start(start_position[X], start_position[Y]);
+    const Vec2d end(end_position[X], end_position[Y]);
+    const Vec2d center = start + Vec2d(center_x, center_y) * lengthsScaleFactor;
+    const double radius = (start - center).norm();
+    const double angle_start = atan2(start.y() - center.y(), start.x() - center.x());
+    double       sweep = atan2(end.y() - center.y(), end.x() - center.x()) - angle_start;
+    // Counterclockwise sweep is positive, clockwise sweep is negative. Equal start and end points define a full circle.
+    if (clockwise) {
+        if (sweep >= 0.0)
+            sweep -= 2.0 * M_PI;
+    }
+    else if (sweep <= 0.0)
+        sweep += 2.0 * M_PI;
+
+    // Tessellate the arc into straight segments, at most 0.5 mm long and spanning at most 5 degrees.
+    static constexpr const double max_segment_length = 0.5;
+    static constexpr const double max_segment_angle  = 5.0 * M_PI / 180.0;
+    const size_t segments = std::clamp<size_t>(size_t(std::ceil(std::max(std::abs(sweep) * radius / max_segment_length, std::abs(sweep) / max_segment_angle))), 1, 1000);
+
+    // The segments are fed into process_G1() as absolute moves in millimeters.
+    const EUnits           units                     = m_units;
+    const EPositioningType global_positioning_type   = m_global_positioning_type;
+    const EPositioningType e_local_positioning_type  = m_e_local_positioning_type;
+    const bool             use_volumetric_e          = m_use_volumetric_e;
+    const AxisCoords       origin                    = m_origin;
+    m_units                    = EUnits::Millimeters;
+    m_global_positioning_type  = EPositioningType::Absolute;
+    m_e_local_positioning_type = EPositioningType::Absolute;
+    m_use_volumetric_e         = false;
+    m_origin                   = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+    float feedrate = 0.0f;
+    bool  has_f    = line.has_value('F', feedrate);
+    GCodeReader reader;
+    for (size_t i = 1; i <= segments; ++i) {
+        const double t = double(i) / double(segments);
+        Vec2d pos = (i == segments) ? end : Vec2d(center + radius * Vec2d(cos(angle_start + t * sweep), sin(angle_start + t * sweep)));
+        std::string new_line_raw = "G1 X";
+        new_line_raw += float_to_string_decimal_point(pos.x(), 5);
+        new_line_raw += " Y";
+        new_line_raw += float_to_string_decimal_point(pos.y(), 5);
+        new_line_raw += " Z";
+        new_line_raw += float_to_string_decimal_point(start_position[Z] + t * (end_position[Z] - start_position[Z]), 5);
+        new_line_raw += " E";
+        new_line_raw += float_to_string_decimal_point(start_position[E] + t * (end_position[E] - start_position[E]), 5);
+        if (has_f && i == 1) {
+            new_line_raw += " F";
+            new_line_raw += float_to_string_decimal_point(feedrate, 3);
+        }
+        GCodeReader::GCodeLine new_gline;
+        reader.parse_line(new_line_raw, [&new_gline](GCodeReader& reader, const GCodeReader::GCodeLine& gline) { new_gline = gline; });
+        if (i > 1) {
+            // All the segments belong to a single G-code line.
+            --m_g1_line_id;
+            m_start_position = m_end_position;
+        }
+        process_G1(new_gline);
+    }
+
+    m_units                    = units;
+    m_global_positioning_type  = global_positioning_type;
+    m_e_local_positioning_type = e_local_positioning_type;
+    m_use_volumetric_e         = use_volumetric_e;
+    m_origin                   = origin;
+    // Avoid accumulating the rounding errors of the tessellated segments.
+    m_end_position = end_position;
+}
+
 void GCodeProcessor::process_G10(const GCodeReader::GCodeLine& line)
 {
     // stores retract move
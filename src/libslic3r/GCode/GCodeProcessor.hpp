@@ -18,6 +18,8 @@
 
 namespace Slic3r {
 
+    class GCodeCompressor;
+
     enum class EMoveType : unsigned char
     {
         Noop,
@@ -325,12 +327,17 @@ namespace Slic3r {
 
             void reset();
 
+            // lines replacing the estimated printing time placeholder
+            std::string estimated_printing_time_lines() const;
+
             // post process the file with the given filename to add remaining time lines M73
+            // if compressed is not null, the post processed gcode is also written through it
+            // if keep_plain is false, the post processed gcode is only written through compressed and the file is left unchanged
 #if ENABLE_GCODE_LINES_ID_IN_H_SLIDER
             // and updates moves' gcode ids accordingly
-            void post_process(const std::string& filename, std::vector<MoveVertex>& moves);
+            void post_process(const std::string& filename, std::vector<MoveVertex>& moves, GCodeCompressor* compressed, bool keep_plain);
 #else
-            void post_process(const std::string& filename);
+            void post_process(const std::string& filename, GCodeCompressor* compressed, bool keep_plain);
 #endif // ENABLE_GCODE_LINES_ID_IN_H_SLIDER
         };
 
@@ -397,6 +404,9 @@ namespace Slic3r {
             std::string filename;
 #endif // ENABLE_GCODE_WINDOW
             unsigned int id;
+            // Hash of the lines of the processed G-code file identifying its content, see GCodeProcessor::process_file().
+            // Zero if the file was changed by the post-processing afterwards.
+            uint64_t gcode_hash{ 0 };
             std::vector<MoveVertex> moves;
             Pointfs bed_shape;
             SettingsIds settings_ids;
@@ -505,6 +515,8 @@ namespace Slic3r {
 
     private:
         GCodeReader m_parser;
+        // Incomplete last line of the gcode passed to process_buffer().
+        std::string m_parser_buffer;
 
         EUnits m_units;
         EPositioningType m_global_positioning_type;
@@ -596,6 +608,21 @@ namespace Slic3r {
         // throws CanceledException through print->throw_if_canceled() (sent by the caller as callback).
         void process_file(const std::string& filename, bool apply_postprocess, std::function<void()> cancel_callback = nullptr);
 
+        // Process the gcode in memory while it is being generated, without reading it back from a file:
+        // initialize(), process_buffer() for consecutive chunks of the gcode (the chunks may split lines), finalize().
+        void initialize();
+        void process_buffer(const char* buffer, size_t length);
+        void process_buffer(const std::string& buffer) { this->process_buffer(buffer.data(), buffer.size()); }
+        void finalize();
+        // Whether the gcode file needs to be post processed to insert lines M73 once finalized.
+        bool needs_postprocess() const { return m_time_processor.export_remaining_time_enabled; }
+        // Post process the gcode file to add remaining time lines M73 and to replace the placeholders.
+        // If compressed is not null, the post processed gcode is also written through it, saving a separate compression pass.
+        // If keep_plain is false, the post processed gcode is only written through compressed, the file is left as it is.
+        void post_process(const std::string& filename, GCodeCompressor* compressed = nullptr, bool keep_plain = true);
+        // Lines replacing the estimated printing time placeholder, valid after finalize().
+        std::string get_estimated_printing_time_lines() const { return m_time_processor.estimated_printing_time_lines(); }
+
         float get_time(PrintEstimatedStatistics::ETimeMode mode) const;
         std::string get_time_dhm(PrintEstimatedStatistics::ETimeMode mode) const;
         std::vector<std::pair<CustomGCode::Type, std::pair<float, float>>> get_custom_gcode_times(PrintEstimatedStatistics::ETimeMode mode, bool include_remaining) const;
@@ -624,6 +651,8 @@ namespace Slic3r {
         // Move
         void process_G0(const GCodeReader::GCodeLine& line);
         void process_G1(const GCodeReader::GCodeLine& line);
+        // Arc move, tessellated into straight moves for the time estimate and the preview.
+        void process_G2_G3(const GCodeReader::GCodeLine& line, bool clockwise);
 
         // Retract
         void process_G10(const GCodeReader::GCodeLine& line);
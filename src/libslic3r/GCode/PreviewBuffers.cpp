@@ -0,0 +1,1031 @@
+#include "PreviewBuffers.hpp"
+
+#include "../Exception.hpp"
+#include "../Utils.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <tuple>
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <boost/log/trivial.hpp>
+#include <boost/nowide/cstdio.hpp>
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_invoke.h>
+
+namespace Slic3r {
+
+// max index buffer size, in bytes
+static constexpr const size_t IBUFFER_THRESHOLD_BYTES = 64 * 1024 * 1024;
+
+// Header of the file with the saved preview buffers, bump the version with any change of the layout of the buffers.
+static constexpr const char     PREVIEW_BUFFERS_MAGIC[8] = { 'P', 'S', 'G', 'P', 'R', 'E', 'V', 'W' };
+static constexpr const uint32_t PREVIEW_BUFFERS_VERSION  = 2;
+
+using MoveVertex = GCodeProcessor::MoveVertex;
+
+static float round_to_nearest(float value, unsigned int decimals)
+{
+    float res = 0.0f;
+    if (decimals == 0)
+        res = std::round(value);
+    else {
+        char buf[64];
+        // locales should not matter, both sprintf and stof are sensitive, so...
+        sprintf(buf, "%.*g", decimals, value);
+        res = std::stof(buf);
+    }
+    return res;
+}
+
+bool GCodePreviewBuffers::Path::matches(const MoveVertex& move) const
+{
+    auto matches_percent = [](float value1, float value2, float max_percent) {
+        return std::abs(value2 - value1) / value1 <= max_percent;
+    };
+
+    switch (move.type)
+    {
+    case EMoveType::Tool_change:
+    case EMoveType::Color_change:
+    case EMoveType::Pause_Print:
+    case EMoveType::Custom_GCode:
+    case EMoveType::Retract:
+    case EMoveType::Unretract:
+#if ENABLE_SEAMS_VISUALIZATION
+    case EMoveType::Seam:
+#endif // ENABLE_SEAMS_VISUALIZATION
+    case EMoveType::Extrude: {
+        // use rounding to reduce the number of generated paths
+        return type == move.type && extruder_id == move.extruder_id && cp_color_id == move.cp_color_id && role == move.extrusion_role &&
+            move.position[2] <= sub_paths.front().first.position[2] && feedrate == move.feedrate && fan_speed == move.fan_speed &&
+            height == round_to_nearest(move.height, 2) && width == round_to_nearest(move.width, 2) &&
+            matches_percent(volumetric_rate, move.volumetric_rate(), 0.05f);
+    }
+    case EMoveType::Travel: {
+        return type == move.type && feedrate == move.feedrate && extruder_id == move.extruder_id && cp_color_id == move.cp_color_id;
+    }
+    default: { return false; }
+    }
+}
+
+void GCodePreviewBuffers::Buffer::add_path(const MoveVertex& move, unsigned int b_id, size_t i_id, size_t s_id)
+{
+    Path::Endpoint endpoint = { b_id, i_id, s_id, move.position };
+    // use rounding to reduce the number of generated paths
+    paths.push_back({ move.type, move.extrusion_role, move.delta_extruder,
+        round_to_nearest(move.height, 2), round_to_nearest(move.width, 2),
+        move.feedrate, move.fan_speed, move.temperature,
+        move.volumetric_rate(), move.extruder_id, move.cp_color_id, { { endpoint, endpoint } } });
+}
+
+std::pair<GCodePreviewBuffers::ERenderPrimitiveType, GCodePreviewBuffers::EVertexFormat> GCodePreviewBuffers::buffer_layout(EMoveType type)
+{
+    switch (type)
+    {
+    case EMoveType::Wipe:
+    case EMoveType::Extrude: { return { ERenderPrimitiveType::Triangle, EVertexFormat::PositionNormal3 }; }
+    case EMoveType::Travel:  { return { ERenderPrimitiveType::Line, EVertexFormat::PositionNormal1 }; }
+    // options: Tool_change, Color_change, Pause_Print, Custom_GCode, Retract, Unretract, Seam
+    default:                 { return { ERenderPrimitiveType::Point, EVertexFormat::Position }; }
+    }
+}
+
+size_t GCodePreviewBuffers::vertex_size_floats(EVertexFormat format)
+{
+    switch (format)
+    {
+    case EVertexFormat::PositionNormal1: { return 3 + 1; }
+    case EVertexFormat::PositionNormal3: { return 3 + 3; }
+    default:                             { return 3; }
+    }
+}
+
+unsigned int GCodePreviewBuffers::max_vertices_per_segment(ERenderPrimitiveType type)
+{
+    switch (type)
+    {
+    case ERenderPrimitiveType::Point:    { return 1; }
+    case ERenderPrimitiveType::Line:     { return 2; }
+    case ERenderPrimitiveType::Triangle: { return 8; }
+    default:                             { return 0; }
+    }
+}
+
+unsigned int GCodePreviewBuffers::indices_per_segment(ERenderPrimitiveType type)
+{
+    switch (type)
+    {
+    case ERenderPrimitiveType::Point:    { return 1; }
+    case ERenderPrimitiveType::Line:     { return 2; }
+    case ERenderPrimitiveType::Triangle: { return 30; } // 3 indices x 10 triangles
+    default:                             { return 0; }
+    }
+}
+
+unsigned int GCodePreviewBuffers::max_indices_per_segment(ERenderPrimitiveType type)
+{
+    switch (type)
+    {
+    case ERenderPrimitiveType::Point:    { return 1; }
+    case ERenderPrimitiveType::Line:     { return 2; }
+    case ERenderPrimitiveType::Triangle: { return 36; } // 3 indices x 12 triangles
+    default:                             { return 0; }
+    }
+}
+
+// Generate the vertex and index buffers of the moves of a single move type.
+// Only the buffer of the given move type is modified, thus the buffers of the move types are generated in parallel.
+static void generate_buffer(const std::vector<MoveVertex>& moves, unsigned char id, GCodePreviewBuffers::Buffer& buffer)
+{
+    using Buffer               = GCodePreviewBuffers::Buffer;
+    using Path                 = GCodePreviewBuffers::Path;
+    using IBufferType          = GCodePreviewBuffers::IBufferType;
+    using VertexBuffer         = GCodePreviewBuffers::VertexBuffer;
+    using MultiVertexBuffer    = GCodePreviewBuffers::MultiVertexBuffer;
+    using IndexBuffer          = GCodePreviewBuffers::IndexBuffer;
+    using MultiIndexBuffer     = GCodePreviewBuffers::MultiIndexBuffer;
+    using ERenderPrimitiveType = GCodePreviewBuffers::ERenderPrimitiveType;
+
+    const size_t       moves_count = moves.size();
+    const unsigned int max_vertices_per_segment = GCodePreviewBuffers::max_vertices_per_segment(buffer.render_primitive_type);
+
+    // format data into the buffers to be rendered as points
+    auto add_vertices_as_point = [](const MoveVertex& curr, VertexBuffer& vertices) {
+        vertices.push_back(curr.position[0]);
+        vertices.push_back(curr.position[1]);
+        vertices.push_back(curr.position[2]);
+    };
+    auto add_indices_as_point = [](const MoveVertex& curr, Buffer& buffer,
+        unsigned int ibuffer_id, IndexBuffer& indices, size_t move_id) {
+            buffer.add_path(curr, ibuffer_id, indices.size(), move_id);
+            indices.push_back(static_cast<IBufferType>(indices.size()));
+    };
+
+    // format data into the buffers to be rendered as lines
+    auto add_vertices_as_line = [](const MoveVertex& prev, const MoveVertex& curr, VertexBuffer& vertices) {
+        // x component of the normal to the current segment (the normal is parallel to the XY plane)
+        float normal_x = (curr.position - prev.position).normalized()[1];
+
+        auto add_vertex = [&vertices, normal_x](const MoveVertex& vertex) {
+            // add position
+            vertices.push_back(vertex.position[0]);
+            vertices.push_back(vertex.position[1]);
+            vertices.push_back(vertex.position[2]);
+            // add normal x component
+            vertices.push_back(normal_x);
+        };
+
+        // add previous vertex
+        add_vertex(prev);
+        // add current vertex
+        add_vertex(curr);
+    };
+    auto add_indices_as_line = [](const MoveVertex& prev, const MoveVertex& curr, Buffer& buffer,
+        unsigned int ibuffer_id, IndexBuffer& indices, size_t move_id) {
+            if (prev.type != curr.type || !buffer.paths.back().matches(curr)) {
+                // add starting index
+                indices.push_back(static_cast<unsigned int>(indices.size()));
+                buffer.add_path(curr, ibuffer_id, indices.size() - 1, move_id - 1);
+                buffer.paths.back().sub_paths.front().first.position = prev.position;
+            }
+
+            Path& last_path = buffer.paths.back();
+            if (last_path.sub_paths.front().first.i_id != last_path.sub_paths.back().last.i_id) {
+                // add previous index
+                indices.push_back(static_cast<unsigned int>(indices.size()));
+            }
+
+            // add current index
+            indices.push_back(static_cast<unsigned int>(indices.size()));
+            last_path.sub_paths.back().last = { ibuffer_id, indices.size() - 1, move_id, curr.position };
+    };
+
+    // format data into the buffers to be rendered as solid
+    auto add_vertices_as_solid = [](const MoveVertex& prev, const MoveVertex& curr, Buffer& buffer, unsigned int vbuffer_id, VertexBuffer& vertices, size_t move_id) {
+        auto store_vertex = [](VertexBuffer& vertices, const Vec3f& position, const Vec3f& normal) {
+            // append position
+            vertices.push_back(position[0]);
+            vertices.push_back(position[1]);
+            vertices.push_back(position[2]);
+            // append normal
+            vertices.push_back(normal[0]);
+            vertices.push_back(normal[1]);
+            vertices.push_back(normal[2]);
+        };
+
+        if (prev.type != curr.type || !buffer.paths.back().matches(curr)) {
+            buffer.add_path(curr, vbuffer_id, vertices.size(), move_id - 1);
+            buffer.paths.back().sub_paths.back().first.position = prev.position;
+        }
+
+        Path& last_path = buffer.paths.back();
+
+        Vec3f dir = (curr.position - prev.position).normalized();
+        Vec3f right = Vec3f(dir[1], -dir[0], 0.0f).normalized();
+        Vec3f left = -right;
+        Vec3f up = right.cross(dir);
+        Vec3f down = -up;
+        float half_width = 0.5f * last_path.width;
+        float half_height = 0.5f * last_path.height;
+        Vec3f prev_pos = prev.position - half_height * up;
+        Vec3f curr_pos = curr.position - half_height * up;
+        Vec3f d_up = half_height * up;
+        Vec3f d_down = -half_height * up;
+        Vec3f d_right = half_width * right;
+        Vec3f d_left = -half_width * right;
+
+        // vertices 1st endpoint
+        if (last_path.vertices_count() == 1 || vertices.empty()) {
+            // 1st segment or restart into a new vertex buffer
+            // ===============================================
+            store_vertex(vertices, prev_pos + d_up, up);
+            store_vertex(vertices, prev_pos + d_right, right);
+            store_vertex(vertices, prev_pos + d_down, down);
+            store_vertex(vertices, prev_pos + d_left, left);
+        }
+        else {
+            // any other segment
+            // =================
+            store_vertex(vertices, prev_pos + d_right, right);
+            store_vertex(vertices, prev_pos + d_left, left);
+        }
+
+        // vertices 2nd endpoint
+        store_vertex(vertices, curr_pos + d_up, up);
+        store_vertex(vertices, curr_pos + d_right, right);
+        store_vertex(vertices, curr_pos + d_down, down);
+        store_vertex(vertices, curr_pos + d_left, left);
+
+        last_path.sub_paths.back().last = { vbuffer_id, vertices.size(), move_id, curr.position };
+    };
+    // direction, up vector and squared length of the previous segment of the current path
+    Vec3f prev_dir;
+    Vec3f prev_up;
+    float sq_prev_length = 0.0f;
+    auto add_indices_as_solid = [&](const MoveVertex& prev, const MoveVertex& curr, const MoveVertex* next,
+        Buffer& buffer, size_t& vbuffer_size, unsigned int ibuffer_id, IndexBuffer& indices, size_t move_id) {
+            auto store_triangle = [](IndexBuffer& indices, IBufferType i1, IBufferType i2, IBufferType i3) {
+                indices.push_back(i1);
+                indices.push_back(i2);
+                indices.push_back(i3);
+            };
+            auto append_dummy_cap = [store_triangle](IndexBuffer& indices, IBufferType id) {
+                store_triangle(indices, id, id, id);
+                store_triangle(indices, id, id, id);
+            };
+            auto convert_vertices_offset = [](size_t vbuffer_size, const std::array<int, 8>& v_offsets) {
+                std::array<IBufferType, 8> ret = {
+                    static_cast<IBufferType>(static_cast<int>(vbuffer_size) + v_offsets[0]),
+                    static_cast<IBufferType>(static_cast<int>(vbuffer_size) + v_offsets[1]),
+                    static_cast<IBufferType>(static_cast<int>(vbuffer_size) + v_offsets[2]),
+                    static_cast<IBufferType>(static_cast<int>(vbuffer_size) + v_offsets[3]),
+                    static_cast<IBufferType>(static_cast<int>(vbuffer_size) + v_offsets[4]),
+                    static_cast<IBufferType>(static_cast<int>(vbuffer_size) + v_offsets[5]),
+                    static_cast<IBufferType>(static_cast<int>(vbuffer_size) + v_offsets[6]),
+                    static_cast<IBufferType>(static_cast<int>(vbuffer_size) + v_offsets[7])
+                };
+                return ret;
+            };
+            auto append_starting_cap_triangles = [&](IndexBuffer& indices, const std::array<IBufferType, 8>& v_offsets) {
+                store_triangle(indices, v_offsets[0], v_offsets[2], v_offsets[1]);
+                store_triangle(indices, v_offsets[0], v_offsets[3], v_offsets[2]);
+            };
+            auto append_stem_triangles = [&](IndexBuffer& indices, const std::array<IBufferType, 8>& v_offsets) {
+                store_triangle(indices, v_offsets[0], v_offsets[1], v_offsets[4]);
+                store_triangle(indices, v_offsets[1], v_offsets[5], v_offsets[4]);
+                store_triangle(indices, v_offsets[1], v_offsets[2], v_offsets[5]);
+                store_triangle(indices, v_offsets[2], v_offsets[6], v_offsets[5]);
+                store_triangle(indices, v_offsets[2], v_offsets[3], v_offsets[6]);
+                store_triangle(indices, v_offsets[3], v_offsets[7], v_offsets[6]);
+                store_triangle(indices, v_offsets[3], v_offsets[0], v_offsets[7]);
+                store_triangle(indices, v_offsets[0], v_offsets[4], v_offsets[7]);
+            };
+            auto append_ending_cap_triangles = [&](IndexBuffer& indices, const std::array<IBufferType, 8>& v_offsets) {
+                store_triangle(indices, v_offsets[4], v_offsets[6], v_offsets[7]);
+                store_triangle(indices, v_offsets[4], v_offsets[5], v_offsets[6]);
+            };
+
+            if (prev.type != curr.type || !buffer.paths.back().matches(curr)) {
+                buffer.add_path(curr, ibuffer_id, indices.size(), move_id - 1);
+                buffer.paths.back().sub_paths.back().first.position = prev.position;
+            }
+
+            Path& last_path = buffer.paths.back();
+
+            Vec3f dir = (curr.position - prev.position).normalized();
+            Vec3f right = Vec3f(dir[1], -dir[0], 0.0f).normalized();
+            Vec3f up = right.cross(dir);
+            float sq_length = (curr.position - prev.position).squaredNorm();
+
+            const std::array<IBufferType, 8> first_seg_v_offsets = convert_vertices_offset(vbuffer_size, { 0, 1, 2, 3, 4, 5, 6, 7 });
+            const std::array<IBufferType, 8> non_first_seg_v_offsets = convert_vertices_offset(vbuffer_size, { -4, 0, -2, 1, 2, 3, 4, 5 });
+            bool is_first_segment = (last_path.vertices_count() == 1);
+            if (is_first_segment || vbuffer_size == 0) {
+                // 1st segment or restart into a new vertex buffer
+                // ===============================================
+                if (is_first_segment)
+                    // starting cap triangles
+                    append_starting_cap_triangles(indices, first_seg_v_offsets);
+                // dummy triangles outer corner cap
+                append_dummy_cap(indices, vbuffer_size);
+
+                // stem triangles
+                append_stem_triangles(indices, first_seg_v_offsets);
+
+                vbuffer_size += 8;
+            }
+            else {
+                // any other segment
+                // =================
+                float displacement = 0.0f;
+                float cos_dir = prev_dir.dot(dir);
+                if (cos_dir > -0.9998477f) {
+                    // if the angle between adjacent segments is smaller than 179 degrees
+                    Vec3f med_dir = (prev_dir + dir).normalized();
+                    float half_width = 0.5f * last_path.width;
+                    displacement = half_width * ::tan(::acos(std::clamp(dir.dot(med_dir), -1.0f, 1.0f)));
+                }
+
+                float sq_displacement = sqr(displacement);
+                bool can_displace = displacement > 0.0f && sq_displacement < sq_prev_length && sq_displacement < sq_length;
+
+                bool is_right_turn = prev_up.dot(prev_dir.cross(dir)) <= 0.0f;
+                // whether the angle between adjacent segments is greater than 45 degrees
+                bool is_sharp = cos_dir < 0.7071068f;
+
+                bool right_displaced = false;
+                bool left_displaced = false;
+
+                if (!is_sharp && can_displace) {
+                    if (is_right_turn)
+                        left_displaced = true;
+                    else
+                        right_displaced = true;
+                }
+
+                // triangles outer corner cap
+                if (is_right_turn) {
+                    if (left_displaced)
+                        // dummy triangles
+                        append_dummy_cap(indices, vbuffer_size);
+                    else {
+                        store_triangle(indices, vbuffer_size - 4, vbuffer_size + 1, vbuffer_size - 1);
+                        store_triangle(indices, vbuffer_size + 1, vbuffer_size - 2, vbuffer_size - 1);
+                    }
+                }
+                else {
+                    if (right_displaced)
+                        // dummy triangles
+                        append_dummy_cap(indices, vbuffer_size);
+                    else {
+                        store_triangle(indices, vbuffer_size - 4, vbuffer_size - 3, vbuffer_size + 0);
+                        store_triangle(indices, vbuffer_size - 3, vbuffer_size - 2, vbuffer_size + 0);
+                    }
+                }
+
+                // stem triangles
+                append_stem_triangles(indices, non_first_seg_v_offsets);
+
+                vbuffer_size += 6;
+            }
+
+            if (next != nullptr && (curr.type != next->type || !last_path.matches(*next)))
+                // ending cap triangles
+                append_ending_cap_triangles(indices, is_first_segment ? first_seg_v_offsets : non_first_seg_v_offsets);
+
+            last_path.sub_paths.back().last = { ibuffer_id, indices.size() - 1, move_id, curr.position };
+            prev_dir = dir;
+            prev_up = up;
+            sq_prev_length = sq_length;
+    };
+
+    // smooth toolpaths corners for the given buffer using triangles
+    auto smooth_triangle_toolpaths_corners = [&moves](const Buffer& buffer, MultiVertexBuffer& v_multibuffer) {
+        auto extract_position_at = [](const VertexBuffer& vertices, size_t offset) {
+            return Vec3f(vertices[offset + 0], vertices[offset + 1], vertices[offset + 2]);
+        };
+        auto update_position_at = [](VertexBuffer& vertices, size_t offset, const Vec3f& position) {
+            vertices[offset + 0] = position[0];
+            vertices[offset + 1] = position[1];
+            vertices[offset + 2] = position[2];
+        };
+        auto match_right_vertices = [&](const Path::Sub_Path& prev_sub_path, const Path::Sub_Path& next_sub_path,
+            size_t curr_s_id, size_t vertex_size_floats, const Vec3f& displacement_vec) {
+                if (&prev_sub_path == &next_sub_path) { // previous and next segment are both contained into to the same vertex buffer
+                    VertexBuffer& vbuffer = v_multibuffer[prev_sub_path.first.b_id];
+                    // offset into the vertex buffer of the next segment 1st vertex
+                    size_t next_1st_offset = (prev_sub_path.last.s_id - curr_s_id) * 6 * vertex_size_floats;
+                    // offset into the vertex buffer of the right vertex of the previous segment
+                    size_t prev_right_offset = prev_sub_path.last.i_id - next_1st_offset - 3 * vertex_size_floats;
+                    // new position of the right vertices
+                    Vec3f shared_vertex = extract_position_at(vbuffer, prev_right_offset) + displacement_vec;
+                    // update previous segment
+                    update_position_at(vbuffer, prev_right_offset, shared_vertex);
+                    // offset into the vertex buffer of the right vertex of the next segment
+                    size_t next_right_offset = next_sub_path.last.i_id - next_1st_offset;
+                    // update next segment
+                    update_position_at(vbuffer, next_right_offset, shared_vertex);
+                }
+                else { // previous and next segment are contained into different vertex buffers
+                    VertexBuffer& prev_vbuffer = v_multibuffer[prev_sub_path.first.b_id];
+                    VertexBuffer& next_vbuffer = v_multibuffer[next_sub_path.first.b_id];
+                    // offset into the previous vertex buffer of the right vertex of the previous segment
+                    size_t prev_right_offset = prev_sub_path.last.i_id - 3 * vertex_size_floats;
+                    // new position of the right vertices
+                    Vec3f shared_vertex = extract_position_at(prev_vbuffer, prev_right_offset) + displacement_vec;
+                    // update previous segment
+                    update_position_at(prev_vbuffer, prev_right_offset, shared_vertex);
+                    // offset into the next vertex buffer of the right vertex of the next segment
+                    size_t next_right_offset = next_sub_path.first.i_id + 1 * vertex_size_floats;
+                    // update next segment
+                    update_position_at(next_vbuffer, next_right_offset, shared_vertex);
+                }
+        };
+        auto match_left_vertices = [&](const Path::Sub_Path& prev_sub_path, const Path::Sub_Path& next_sub_path,
+            size_t curr_s_id, size_t vertex_size_floats, const Vec3f& displacement_vec) {
+                if (&prev_sub_path == &next_sub_path) { // previous and next segment are both contained into to the same vertex buffer
+                    VertexBuffer& vbuffer = v_multibuffer[prev_sub_path.first.b_id];
+                    // offset into the vertex buffer of the next segment 1st vertex
+                    size_t next_1st_offset = (prev_sub_path.last.s_id - curr_s_id) * 6 * vertex_size_floats;
+                    // offset into the vertex buffer of the left vertex of the previous segment
+                    size_t prev_left_offset = prev_sub_path.last.i_id - next_1st_offset - 1 * vertex_size_floats;
+                    // new position of the left vertices
+                    Vec3f shared_vertex = extract_position_at(vbuffer, prev_left_offset) + displacement_vec;
+                    // update previous segment
+                    update_position_at(vbuffer, prev_left_offset, shared_vertex);
+                    // offset into the vertex buffer of the left vertex of the next segment
+                    size_t next_left_offset = next_sub_path.last.i_id - next_1st_offset + 1 * vertex_size_floats;
+                    // update next segment
+                    update_position_at(vbuffer, next_left_offset, shared_vertex);
+                }
+                else { // previous and next segment are contained into different vertex buffers
+                    VertexBuffer& prev_vbuffer = v_multibuffer[prev_sub_path.first.b_id];
+                    VertexBuffer& next_vbuffer = v_multibuffer[next_sub_path.first.b_id];
+                    // offset into the previous vertex buffer of the left vertex of the previous segment
+                    size_t prev_left_offset = prev_sub_path.last.i_id - 1 * vertex_size_floats;
+                    // new position of the left vertices
+                    Vec3f shared_vertex = extract_position_at(prev_vbuffer, prev_left_offset) + displacement_vec;
+                    // update previous segment
+                    update_position_at(prev_vbuffer, prev_left_offset, shared_vertex);
+                    // offset into the next vertex buffer of the left vertex of the next segment
+                    size_t next_left_offset = next_sub_path.first.i_id + 3 * vertex_size_floats;
+                    // update next segment
+                    update_position_at(next_vbuffer, next_left_offset, shared_vertex);
+                }
+        };
+
+        size_t vertex_size_floats = buffer.vertex_size_floats();
+        for (const Path& path : buffer.paths) {
+            // the two segments of the path sharing the current vertex may belong
+            // to two different vertex buffers
+            size_t prev_sub_path_id = 0;
+            size_t next_sub_path_id = 0;
+            size_t path_vertices_count = path.vertices_count();
+            float half_width = 0.5f * path.width;
+            for (size_t j = 1; j < path_vertices_count - 1; ++j) {
+                size_t curr_s_id = path.sub_paths.front().first.s_id + j;
+                const Vec3f& prev = moves[curr_s_id - 1].position;
+                const Vec3f& curr = moves[curr_s_id].position;
+                const Vec3f& next = moves[curr_s_id + 1].position;
+
+                // select the subpaths which contains the previous/next segments
+                if (!path.sub_paths[prev_sub_path_id].contains(curr_s_id))
+                    ++prev_sub_path_id;
+                if (!path.sub_paths[next_sub_path_id].contains(curr_s_id + 1))
+                    ++next_sub_path_id;
+                const Path::Sub_Path& prev_sub_path = path.sub_paths[prev_sub_path_id];
+                const Path::Sub_Path& next_sub_path = path.sub_paths[next_sub_path_id];
+
+                Vec3f prev_dir = (curr - prev).normalized();
+                Vec3f prev_right = Vec3f(prev_dir[1], -prev_dir[0], 0.0f).normalized();
+                Vec3f prev_up = prev_right.cross(prev_dir);
+
+                Vec3f next_dir = (next - curr).normalized();
+
+                bool is_right_turn = prev_up.dot(prev_dir.cross(next_dir)) <= 0.0f;
+                float cos_dir = prev_dir.dot(next_dir);
+                // whether the angle between adjacent segments is greater than 45 degrees
+                bool is_sharp = cos_dir < 0.7071068f;
+
+                float displacement = 0.0f;
+                if (cos_dir > -0.9998477f) {
+                    // if the angle between adjacent segments is smaller than 179 degrees
+                    Vec3f med_dir = (prev_dir + next_dir).normalized();
+                    displacement = half_width * ::tan(::acos(std::clamp(next_dir.dot(med_dir), -1.0f, 1.0f)));
+                }
+
+                float sq_prev_length = (curr - prev).squaredNorm();
+                float sq_next_length = (next - curr).squaredNorm();
+                float sq_displacement = sqr(displacement);
+                bool can_displace = displacement > 0.0f && sq_displacement < sq_prev_length && sq_displacement < sq_next_length;
+
+                if (can_displace) {
+                    // displacement to apply to the vertices to match
+                    Vec3f displacement_vec = displacement * prev_dir;
+                    // matches inner corner vertices
+                    if (is_right_turn)
+                        match_right_vertices(prev_sub_path, next_sub_path, curr_s_id, vertex_size_floats, -displacement_vec);
+                    else
+                        match_left_vertices(prev_sub_path, next_sub_path, curr_s_id, vertex_size_floats, -displacement_vec);
+
+                    if (!is_sharp) {
+                        // matches outer corner vertices
+                        if (is_right_turn)
+                            match_left_vertices(prev_sub_path, next_sub_path, curr_s_id, vertex_size_floats, displacement_vec);
+                        else
+                            match_right_vertices(prev_sub_path, next_sub_path, curr_s_id, vertex_size_floats, displacement_vec);
+                    }
+                }
+            }
+        }
+    };
+
+    // toolpaths data -> extract vertices from result
+    MultiVertexBuffer& v_multibuffer = buffer.vertices;
+    for (size_t i = 1; i < moves_count; ++i) {
+        const MoveVertex& curr = moves[i];
+        if (GCodePreviewBuffers::buffer_id(curr.type) != id)
+            continue;
+
+        const MoveVertex& prev = moves[i - 1];
+
+        // ensure there is at least one vertex buffer
+        if (v_multibuffer.empty())
+            v_multibuffer.push_back(VertexBuffer());
+
+        // if adding the vertices for the current segment exceeds the threshold size of the current vertex buffer
+        // add another vertex buffer
+        if (v_multibuffer.back().size() * sizeof(float) > buffer.max_vertex_buffer_size_bytes() - buffer.max_vertices_per_segment_size_bytes()) {
+            v_multibuffer.push_back(VertexBuffer());
+            if (buffer.render_primitive_type == ERenderPrimitiveType::Triangle) {
+                Path& last_path = buffer.paths.back();
+                if (prev.type == curr.type && last_path.matches(curr))
+                    last_path.add_sub_path(prev, static_cast<unsigned int>(v_multibuffer.size()) - 1, 0, i - 1);
+            }
+        }
+
+        VertexBuffer& v_buffer = v_multibuffer.back();
+
+        switch (buffer.render_primitive_type)
+        {
+        case ERenderPrimitiveType::Point:    { add_vertices_as_point(curr, v_buffer); break; }
+        case ERenderPrimitiveType::Line:     { add_vertices_as_line(prev, curr, v_buffer); break; }
+        case ERenderPrimitiveType::Triangle: { add_vertices_as_solid(prev, curr, buffer, static_cast<unsigned int>(v_multibuffer.size()) - 1, v_buffer, i); break; }
+        }
+    }
+
+    if (buffer.render_primitive_type == ERenderPrimitiveType::Triangle)
+        smooth_triangle_toolpaths_corners(buffer, v_multibuffer);
+
+    for (VertexBuffer& v_buffer : v_multibuffer) {
+        v_buffer.shrink_to_fit();
+    }
+
+    // move the wipe toolpaths half height up to render them on proper position
+    if (GCodePreviewBuffers::buffer_type(id) == EMoveType::Wipe) {
+        for (VertexBuffer& v_buffer : v_multibuffer) {
+            for (size_t i = 2; i < v_buffer.size(); i += 3) {
+                v_buffer[i] += 0.5f * GCodeProcessor::Wipe_Height;
+            }
+        }
+    }
+
+    // toolpaths data -> extract indices from result
+    // paths have been filled while extracting vertices,
+    // so reset them, they will be filled again while extracting indices
+    buffer.paths.clear();
+
+    // current vertex buffer index and size
+    std::pair<unsigned int, size_t> curr_vertex_buffer = { 0, 0 };
+    MultiIndexBuffer& i_multibuffer = buffer.indices;
+
+    for (size_t i = 1; i < moves_count; ++i) {
+        const MoveVertex& curr = moves[i];
+        if (GCodePreviewBuffers::buffer_id(curr.type) != id)
+            continue;
+
+        const MoveVertex& prev = moves[i - 1];
+        const MoveVertex* next = nullptr;
+        if (i < moves_count - 1)
+            next = &moves[i + 1];
+
+        // ensure there is at least one index buffer
+        if (i_multibuffer.empty()) {
+            i_multibuffer.push_back(IndexBuffer());
+            buffer.indices_vbuffer_ids.push_back(curr_vertex_buffer.first);
+        }
+
+        // if adding the indices for the current segment exceeds the threshold size of the current index buffer
+        // create another index buffer
+        if (i_multibuffer.back().size() * sizeof(IBufferType) >= IBUFFER_THRESHOLD_BYTES - buffer.max_indices_per_segment_size_bytes()) {
+            i_multibuffer.push_back(IndexBuffer());
+            buffer.indices_vbuffer_ids.push_back(curr_vertex_buffer.first);
+            if (buffer.render_primitive_type != ERenderPrimitiveType::Point) {
+                Path& last_path = buffer.paths.back();
+                last_path.add_sub_path(prev, static_cast<unsigned int>(i_multibuffer.size()) - 1, 0, i - 1);
+            }
+        }
+
+        // if adding the vertices for the current segment exceeds the threshold size of the current vertex buffer
+        // create another index buffer
+        if (curr_vertex_buffer.second * buffer.vertex_size_bytes() > buffer.max_vertex_buffer_size_bytes() - buffer.max_vertices_per_segment_size_bytes()) {
+            i_multibuffer.push_back(IndexBuffer());
+
+            ++curr_vertex_buffer.first;
+            curr_vertex_buffer.second = 0;
+            buffer.indices_vbuffer_ids.push_back(curr_vertex_buffer.first);
+
+            if (buffer.render_primitive_type != ERenderPrimitiveType::Point) {
+                Path& last_path = buffer.paths.back();
+                last_path.add_sub_path(prev, static_cast<unsigned int>(i_multibuffer.size()) - 1, 0, i - 1);
+            }
+        }
+
+        IndexBuffer& i_buffer = i_multibuffer.back();
+
+        switch (buffer.render_primitive_type)
+        {
+        case ERenderPrimitiveType::Point: {
+            add_indices_as_point(curr, buffer, static_cast<unsigned int>(i_multibuffer.size()) - 1, i_buffer, i);
+            curr_vertex_buffer.second += max_vertices_per_segment;
+            break;
+        }
+        case ERenderPrimitiveType::Line: {
+            add_indices_as_line(prev, curr, buffer, static_cast<unsigned int>(i_multibuffer.size()) - 1, i_buffer, i);
+            curr_vertex_buffer.second += max_vertices_per_segment;
+            break;
+        }
+        case ERenderPrimitiveType::Triangle: {
+            add_indices_as_solid(prev, curr, next, buffer, curr_vertex_buffer.second, static_cast<unsigned int>(i_multibuffer.size()) - 1, i_buffer, i);
+            break;
+        }
+        }
+    }
+
+    for (IndexBuffer& i_buffer : i_multibuffer) {
+        i_buffer.shrink_to_fit();
+    }
+}
+
+void GCodePreviewBuffers::generate(const GCodeProcessor::Result& gcode_result, bool bounding_box_all_moves)
+{
+    this->clear();
+    this->bounding_box_all_moves = bounding_box_all_moves;
+    this->moves_count = gcode_result.moves.size();
+    this->gcode_hash  = gcode_result.gcode_hash;
+    if (this->moves_count == 0)
+        return;
+
+    const std::vector<MoveVertex> &moves = gcode_result.moves;
+    // zs of the pause prints and of the custom G-codes, the extrusions of these layers are recolored
+    std::vector<float> options_zs;
+
+    tbb::parallel_invoke(
+        [this, &moves]() {
+            tbb::parallel_for(tbb::blocked_range<size_t>(0, this->buffers.size(), 1),
+                [this, &moves](const tbb::blocked_range<size_t>& range) {
+                    for (size_t id = range.begin(); id < range.end(); ++ id)
+                        generate_buffer(moves, static_cast<unsigned char>(id), this->buffers[id]);
+                });
+        },
+        [this, &moves, &options_zs, bounding_box_all_moves]() {
+            // layers zs / roles / extruder ids / bounding box -> extract from result
+            size_t last_travel_s_id = 0;
+            for (size_t i = 0; i < this->moves_count; ++i) {
+                const MoveVertex& move = moves[i];
+                if (bounding_box_all_moves)
+                    // for the gcode viewer we need to take in account all moves to correctly size the printbed
+                    this->paths_bounding_box.merge(move.position.cast<double>());
+#if ENABLE_START_GCODE_VISUALIZATION
+                else if (move.type == EMoveType::Extrude && move.extrusion_role != erCustom && move.width != 0.0f && move.height != 0.0f)
+#else
+                else if (move.type == EMoveType::Extrude && move.width != 0.0f && move.height != 0.0f)
+#endif // ENABLE_START_GCODE_VISUALIZATION
+                    this->paths_bounding_box.merge(move.position.cast<double>());
+
+                if (move.type == EMoveType::Extrude) {
+                    // layers zs
+                    const double* const last_z = this->layers_zs.empty() ? nullptr : &this->layers_zs.back();
+                    double z = static_cast<double>(move.position[2]);
+                    if (last_z == nullptr || z < *last_z - EPSILON || *last_z + EPSILON < z) {
+                        this->layers_zs.emplace_back(z);
+                        this->layers_endpoints.push_back({ last_travel_s_id, i });
+                    }
+                    else
+                        this->layers_endpoints.back().last = i;
+                    // extruder ids
+                    this->extruder_ids.emplace_back(move.extruder_id);
+                    // roles
+                    if (i > 0)
+                        this->roles.emplace_back(move.extrusion_role);
+                }
+                else if (move.type == EMoveType::Travel) {
+                    if (i - last_travel_s_id > 1 && !this->layers_zs.empty())
+                        this->layers_endpoints.back().last = i;
+
+                    last_travel_s_id = i;
+                }
+                else if (i > 0 && (move.type == EMoveType::Pause_Print || move.type == EMoveType::Custom_GCode)) {
+                    // collect options zs for later use
+                    const float* const last_z = options_zs.empty() ? nullptr : &options_zs.back();
+                    if (last_z == nullptr || move.position[2] < *last_z - EPSILON || *last_z + EPSILON < move.position[2])
+                        options_zs.emplace_back(move.position[2]);
+                }
+            }
+
+            // roles -> remove duplicates
+            sort_remove_duplicates(this->roles);
+            this->roles.shrink_to_fit();
+
+            // extruder ids -> remove duplicates
+            sort_remove_duplicates(this->extruder_ids);
+            this->extruder_ids.shrink_to_fit();
+        });
+
+    // change color of paths whose layer contains option points
+    if (!options_zs.empty()) {
+        for (Path& path : this->buffers[buffer_id(EMoveType::Extrude)].paths) {
+            float z = path.sub_paths.front().first.position[2];
+            if (std::find_if(options_zs.begin(), options_zs.end(), [z](float f) { return f - EPSILON <= z && z <= f + EPSILON; }) != options_zs.end())
+                path.cp_color_id = 255 - path.cp_color_id;
+        }
+    }
+}
+
+void GCodePreviewBuffers::clear()
+{
+    this->buffers.assign(buffers_count(), Buffer());
+    for (size_t i = 0; i < this->buffers.size(); ++i)
+        std::tie(this->buffers[i].render_primitive_type, this->buffers[i].vertex_format) = buffer_layout(buffer_type(static_cast<unsigned char>(i)));
+    this->paths_bounding_box.reset();
+    this->bounding_box_all_moves = false;
+    this->layers_zs.clear();
+    this->layers_endpoints.clear();
+    this->roles.clear();
+    this->extruder_ids.clear();
+    this->moves_count = 0;
+    this->gcode_hash  = 0;
+}
+
+size_t GCodePreviewBuffers::memsize() const
+{
+    size_t out = 0;
+    for (const Buffer& buffer : this->buffers) {
+        for (const Path& path : buffer.paths)
+            out += sizeof(Path) + SLIC3R_STDVEC_MEMSIZE(path.sub_paths, Path::Sub_Path);
+        for (const VertexBuffer& v_buffer : buffer.vertices)
+            out += SLIC3R_STDVEC_MEMSIZE(v_buffer, float);
+        for (const IndexBuffer& i_buffer : buffer.indices)
+            out += SLIC3R_STDVEC_MEMSIZE(i_buffer, IBufferType);
+    }
+    return out;
+}
+
+namespace {
+
+class PreviewBuffersWriter
+{
+public:
+    PreviewBuffersWriter(const std::string& path) : m_path(path) {
+        m_file = boost::nowide::fopen(path.c_str(), "wb");
+        if (m_file == nullptr)
+            throw Slic3r::RuntimeError(std::string("Cannot create the G-code preview file ") + path);
+    }
+    ~PreviewBuffersWriter() { if (m_file != nullptr) fclose(m_file); }
+
+    template<typename T> void write_pod(const T& value) { this->write(&value, sizeof(T)); }
+    template<typename T> void write_vector(const std::vector<T>& data) {
+        static_assert(std::is_trivially_copyable<T>::value, "Only vectors of trivially copyable types are saved as a block");
+        this->write_pod<uint64_t>(data.size());
+        this->write(data.data(), data.size() * sizeof(T));
+    }
+    void write(const void* data, size_t len) {
+        if (len > 0 && ::fwrite(data, 1, len, m_file) != len)
+            throw Slic3r::RuntimeError(std::string("Writing the G-code preview file ") + m_path + " failed.\nIs the disk full?\n");
+    }
+    void close() {
+        FILE* file = m_file;
+        m_file = nullptr;
+        if (fclose(file) != 0)
+            throw Slic3r::RuntimeError(std::string("Writing the G-code preview file ") + m_path + " failed.\nIs the disk full?\n");
+    }
+
+private:
+    std::string m_path;
+    FILE*       m_file { nullptr };
+};
+
+// Reading past the end of a truncated or corrupted file throws, the file is then rejected.
+class PreviewBuffersReader
+{
+public:
+    PreviewBuffersReader(const char* begin, const char* end) : m_ptr(begin), m_end(end) {}
+
+    template<typename T> T read_pod() {
+        T value;
+        this->read(&value, sizeof(T));
+        return value;
+    }
+    template<typename T> void read_vector(std::vector<T>& data) {
+        data.resize(this->read_count(sizeof(T)));
+        this->read(data.data(), data.size() * sizeof(T));
+    }
+    // Read the number of items following, each stored in at least min_item_size bytes.
+    // The count is checked against the remaining bytes before anything is allocated for the items.
+    size_t read_count(size_t min_item_size) {
+        uint64_t count = this->read_pod<uint64_t>();
+        if (count > uint64_t(m_end - m_ptr) / min_item_size)
+            throw Slic3r::RuntimeError("Truncated G-code preview file");
+        return size_t(count);
+    }
+    void read(void* data, size_t len) {
+        if (len > size_t(m_end - m_ptr))
+            throw Slic3r::RuntimeError("Truncated G-code preview file");
+        if (len > 0)
+            memcpy(data, m_ptr, len);
+        m_ptr += len;
+    }
+    bool at_end() const { return m_ptr == m_end; }
+
+private:
+    const char* m_ptr;
+    const char* m_end;
+};
+
+// Number of bytes of a saved Endpoint, of a saved Path without its sub paths and of an empty saved vector.
+static constexpr const size_t ENDPOINT_SIZE     = sizeof(uint32_t) + 2 * sizeof(uint64_t) + 3 * sizeof(float);
+static constexpr const size_t PATH_SIZE_MIN     = 4 * sizeof(uint8_t) + 7 * sizeof(float) + sizeof(uint64_t);
+static constexpr const size_t VECTOR_SIZE_MIN   = sizeof(uint64_t);
+
+void write_endpoint(PreviewBuffersWriter& out, const GCodePreviewBuffers::Path::Endpoint& endpoint)
+{
+    out.write_pod<uint32_t>(endpoint.b_id);
+    out.write_pod<uint64_t>(endpoint.i_id);
+    out.write_pod<uint64_t>(endpoint.s_id);
+    out.write(endpoint.position.data(), 3 * sizeof(float));
+}
+
+GCodePreviewBuffers::Path::Endpoint read_endpoint(PreviewBuffersReader& in)
+{
+    GCodePreviewBuffers::Path::Endpoint endpoint;
+    endpoint.b_id = in.read_pod<uint32_t>();
+    endpoint.i_id = size_t(in.read_pod<uint64_t>());
+    endpoint.s_id = size_t(in.read_pod<uint64_t>());
+    in.read(endpoint.position.data(), 3 * sizeof(float));
+    return endpoint;
+}
+
+} // namespace
+
+void GCodePreviewBuffers::save(const std::string& path) const
+{
+    if (this->gcode_hash == 0)
+        throw Slic3r::RuntimeError(std::string("The G-code preview ") + path + " is not generated from a G-code file");
+    // Write into a temporary file first, so that a viewer never picks up a partially written file.
+    std::string path_tmp = path + ".tmp";
+    {
+        PreviewBuffersWriter out(path_tmp);
+        out.write(PREVIEW_BUFFERS_MAGIC, sizeof(PREVIEW_BUFFERS_MAGIC));
+        out.write_pod<uint32_t>(PREVIEW_BUFFERS_VERSION);
+        out.write_pod<uint32_t>(uint32_t(this->buffers.size()));
+        out.write_pod<uint64_t>(this->gcode_hash);
+        out.write_pod<uint8_t>(this->bounding_box_all_moves);
+        out.write_pod<uint64_t>(this->moves_count);
+        out.write_pod<uint8_t>(this->paths_bounding_box.defined);
+        out.write(this->paths_bounding_box.min.data(), 3 * sizeof(double));
+        out.write(this->paths_bounding_box.max.data(), 3 * sizeof(double));
+        out.write_vector(this->layers_zs);
+        out.write_vector(this->layers_endpoints);
+        out.write_vector(this->roles);
+        out.write_vector(this->extruder_ids);
+        for (const Buffer& buffer : this->buffers) {
+            out.write_pod<uint8_t>(uint8_t(buffer.render_primitive_type));
+            out.write_pod<uint8_t>(uint8_t(buffer.vertex_format));
+            out.write_pod<uint64_t>(buffer.paths.size());
+            for (const Path& path : buffer.paths) {
+                out.write_pod<uint8_t>(uint8_t(path.type));
+                out.write_pod<uint8_t>(uint8_t(path.role));
+                out.write_pod<float>(path.delta_extruder);
+                out.write_pod<float>(path.height);
+                out.write_pod<float>(path.width);
+                out.write_pod<float>(path.feedrate);
+                out.write_pod<float>(path.fan_speed);
+                out.write_pod<float>(path.temperature);
+                out.write_pod<float>(path.volumetric_rate);
+                out.write_pod<uint8_t>(path.extruder_id);
+                out.write_pod<uint8_t>(path.cp_color_id);
+                out.write_pod<uint64_t>(path.sub_paths.size());
+                for (const Path::Sub_Path& sub_path : path.sub_paths) {
+                    write_endpoint(out, sub_path.first);
+                    write_endpoint(out, sub_path.last);
+                }
+            }
+            out.write_pod<uint64_t>(buffer.vertices.size());
+            for (const VertexBuffer& v_buffer : buffer.vertices)
+                out.write_vector(v_buffer);
+            out.write_pod<uint64_t>(buffer.indices.size());
+            for (const IndexBuffer& i_buffer : buffer.indices)
+                out.write_vector(i_buffer);
+            out.write_vector(buffer.indices_vbuffer_ids);
+        }
+        out.close();
+    }
+    if (rename_file(path_tmp, path))
+        throw Slic3r::RuntimeError(std::string("Failed to rename the G-code preview file ") + path_tmp + " to " + path);
+}
+
+bool GCodePreviewBuffers::load(const std::string& path, uint64_t gcode_hash, bool bounding_box_all_moves)
+{
+    this->clear();
+
+    boost::system::error_code ec;
+    if (gcode_hash == 0 || ! boost::filesystem::exists(path, ec) || ec)
+        return false;
+
+    try {
+        boost::iostreams::mapped_file_source file(path);
+        PreviewBuffersReader in(file.data(), file.data() + file.size());
+
+        char magic[sizeof(PREVIEW_BUFFERS_MAGIC)];
+        in.read(magic, sizeof(magic));
+        if (memcmp(magic, PREVIEW_BUFFERS_MAGIC, sizeof(magic)) != 0 ||
+            in.read_pod<uint32_t>() != PREVIEW_BUFFERS_VERSION ||
+            in.read_pod<uint32_t>() != this->buffers.size())
+            return false;
+        if (in.read_pod<uint64_t>() != gcode_hash || bool(in.read_pod<uint8_t>()) != bounding_box_all_moves)
+            return false;
+
+        this->bounding_box_all_moves     = bounding_box_all_moves;
+        this->gcode_hash                 = gcode_hash;
+        this->moves_count                = size_t(in.read_pod<uint64_t>());
+        this->paths_bounding_box.defined = bool(in.read_pod<uint8_t>());
+        in.read(this->paths_bounding_box.min.data(), 3 * sizeof(double));
+        in.read(this->paths_bounding_box.max.data(), 3 * sizeof(double));
+        in.read_vector(this->layers_zs);
+        in.read_vector(this->layers_endpoints);
+        in.read_vector(this->roles);
+        in.read_vector(this->extruder_ids);
+        for (Buffer& buffer : this->buffers) {
+            if (ERenderPrimitiveType(in.read_pod<uint8_t>()) != buffer.render_primitive_type ||
+                EVertexFormat(in.read_pod<uint8_t>()) != buffer.vertex_format)
+                throw Slic3r::RuntimeError("Unexpected layout of the G-code preview buffers");
+            buffer.paths.resize(in.read_count(PATH_SIZE_MIN));
+            for (Path& path : buffer.paths) {
+                path.type            = EMoveType(in.read_pod<uint8_t>());
+                path.role            = ExtrusionRole(in.read_pod<uint8_t>());
+                path.delta_extruder  = in.read_pod<float>();
+                path.height          = in.read_pod<float>();
+                path.width           = in.read_pod<float>();
+                path.feedrate        = in.read_pod<float>();
+                path.fan_speed       = in.read_pod<float>();
+                path.temperature     = in.read_pod<float>();
+                path.volumetric_rate = in.read_pod<float>();
+                path.extruder_id     = in.read_pod<uint8_t>();
+                path.cp_color_id     = in.read_pod<uint8_t>();
+                path.sub_paths.resize(in.read_count(2 * ENDPOINT_SIZE));
+                for (Path::Sub_Path& sub_path : path.sub_paths) {
+                    sub_path.first = read_endpoint(in);
+                    sub_path.last  = read_endpoint(in);
+                }
+            }
+            buffer.vertices.resize(in.read_count(VECTOR_SIZE_MIN));
+            for (VertexBuffer& v_buffer : buffer.vertices)
+                in.read_vector(v_buffer);
+            buffer.indices.resize(in.read_count(VECTOR_SIZE_MIN));
+            for (IndexBuffer& i_buffer : buffer.indices)
+                in.read_vector(i_buffer);
+            in.read_vector(buffer.indices_vbuffer_ids);
+            if (buffer.indices_vbuffer_ids.size() != buffer.indices.size() ||
+                std::any_of(buffer.indices_vbuffer_ids.begin(), buffer.indices_vbuffer_ids.end(), [&buffer](unsigned int id) { return id >= buffer.vertices.size(); }))
+                throw Slic3r::RuntimeError("Inconsistent G-code preview buffers");
+            // The endpoints of the sub paths point into the index buffers and to the moves.
+            auto endpoint_valid = [this, &buffer](const Path::Endpoint& endpoint) {
+                return endpoint.b_id < buffer.indices.size() && endpoint.i_id <= buffer.indices[endpoint.b_id].size() && endpoint.s_id < this->moves_count;
+            };
+            for (const Path& path : buffer.paths)
+                for (const Path::Sub_Path& sub_path : path.sub_paths)
+                    if (! endpoint_valid(sub_path.first) || ! endpoint_valid(sub_path.last) || sub_path.first.b_id != sub_path.last.b_id ||
+                        sub_path.first.i_id > sub_path.last.i_id || sub_path.first.s_id > sub_path.last.s_id)
+                        throw Slic3r::RuntimeError("Inconsistent G-code preview buffers");
+        }
+        if (! in.at_end())
+            throw Slic3r::RuntimeError("Unexpected data at the end of the G-code preview file");
+    } catch (const std::exception& ex) {
+        BOOST_LOG_TRIVIAL(error) << "Failed to load the G-code preview file " << path << ": " << ex.what();
+        this->clear();
+        return false;
+    }
+    return true;
+}
+
+std::string gcode_preview_buffers_path(const std::string& gcode_path)
+{
+    return gcode_path + ".preview";
+}
+
+} // namespace Slic3r
@@ -0,0 +1,191 @@
+#ifndef slic3r_GCode_PreviewBuffers_hpp_
+#define slic3r_GCode_PreviewBuffers_hpp_
+
+#include "../libslic3r.h"
+#include "../BoundingBox.hpp"
+#include "../ExtrusionEntity.hpp"
+#include "GCodeProcessor.hpp"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Slic3r {
+
+// Vertex and index buffers of the G-code preview generated on the CPU side out of GCodeProcessor::Result,
+// without any OpenGL context, so that the preview may be generated on a headless machine and saved next to the G-code.
+// The G-code viewer only uploads the buffers to the GPU.
+// There is a buffer per move type from EMoveType::Retract to EMoveType::Extrude, see buffer_id().
+class GCodePreviewBuffers
+{
+public:
+    using IBufferType       = unsigned short;
+    using VertexBuffer      = std::vector<float>;
+    using MultiVertexBuffer = std::vector<VertexBuffer>;
+    using IndexBuffer       = std::vector<IBufferType>;
+    using MultiIndexBuffer  = std::vector<IndexBuffer>;
+
+    enum class ERenderPrimitiveType : unsigned char
+    {
+        Point,
+        Line,
+        Triangle
+    };
+
+    enum class EVertexFormat : unsigned char
+    {
+        // vertex format: 3 floats -> position.x|position.y|position.z
+        Position,
+        // vertex format: 4 floats -> position.x|position.y|position.z|normal.x
+        PositionNormal1,
+        // vertex format: 6 floats -> position.x|position.y|position.z|normal.x|normal.y|normal.z
+        PositionNormal3
+    };
+
+    // Used to identify different toolpath sub-types inside an index buffer
+    struct Path
+    {
+        struct Endpoint
+        {
+            // index of the buffer in the multibuffer vector
+            // the buffer type may change:
+            // it is the vertex buffer while extracting vertices data,
+            // the index buffer while extracting indices data
+            unsigned int b_id{ 0 };
+            // index into the buffer
+            size_t i_id{ 0 };
+            // move id
+            size_t s_id{ 0 };
+            Vec3f position{ Vec3f::Zero() };
+        };
+
+        struct Sub_Path
+        {
+            Endpoint first;
+            Endpoint last;
+
+            bool contains(size_t s_id) const {
+                return first.s_id <= s_id && s_id <= last.s_id;
+            }
+        };
+
+        EMoveType type{ EMoveType::Noop };
+        ExtrusionRole role{ erNone };
+        float delta_extruder{ 0.0f };
+        float height{ 0.0f };
+        float width{ 0.0f };
+        float feedrate{ 0.0f };
+        float fan_speed{ 0.0f };
+        float temperature{ 0.0f };
+        float volumetric_rate{ 0.0f };
+        unsigned char extruder_id{ 0 };
+        unsigned char cp_color_id{ 0 };
+        std::vector<Sub_Path> sub_paths;
+
+        bool matches(const GCodeProcessor::MoveVertex& move) const;
+        size_t vertices_count() const {
+            return sub_paths.empty() ? 0 : sub_paths.back().last.s_id - sub_paths.front().first.s_id + 1;
+        }
+        bool contains(size_t s_id) const {
+            return sub_paths.empty() ? false : sub_paths.front().first.s_id <= s_id && s_id <= sub_paths.back().last.s_id;
+        }
+        int get_id_of_sub_path_containing(size_t s_id) const {
+            if (sub_paths.empty())
+                return -1;
+            else {
+                for (int i = 0; i < static_cast<int>(sub_paths.size()); ++i) {
+                    if (sub_paths[i].contains(s_id))
+                        return i;
+                }
+                return -1;
+            }
+        }
+        void add_sub_path(const GCodeProcessor::MoveVertex& move, unsigned int b_id, size_t i_id, size_t s_id) {
+            Endpoint endpoint = { b_id, i_id, s_id, move.position };
+            sub_paths.push_back({ endpoint , endpoint });
+        }
+    };
+
+    // Buffers of a single move type.
+    struct Buffer
+    {
+        ERenderPrimitiveType    render_primitive_type { ERenderPrimitiveType::Point };
+        EVertexFormat           vertex_format         { EVertexFormat::Position };
+        std::vector<Path>       paths;
+        MultiVertexBuffer       vertices;
+        MultiIndexBuffer        indices;
+        // Index into vertices of the vertex buffer referenced by each of the index buffers.
+        std::vector<unsigned int> indices_vbuffer_ids;
+
+        // b_id index of buffer contained in this->indices
+        // i_id index of first index contained in this->indices[b_id]
+        // s_id index of first vertex contained in this->vertices
+        void add_path(const GCodeProcessor::MoveVertex& move, unsigned int b_id, size_t i_id, size_t s_id);
+
+        size_t vertex_size_floats() const { return GCodePreviewBuffers::vertex_size_floats(vertex_format); }
+        size_t vertex_size_bytes() const { return vertex_size_floats() * sizeof(float); }
+        // We set 65536 as max count of vertices inside a vertex buffer to allow
+        // to use unsigned short in place of unsigned int for indices in the index buffer, to save memory
+        size_t max_vertex_buffer_size_bytes() const { return 65536 * vertex_size_bytes(); }
+        size_t max_vertices_per_segment_size_bytes() const { return vertex_size_bytes() * static_cast<size_t>(GCodePreviewBuffers::max_vertices_per_segment(render_primitive_type)); }
+        size_t max_indices_per_segment_size_bytes() const { return GCodePreviewBuffers::max_indices_per_segment(render_primitive_type) * sizeof(IBufferType); }
+    };
+
+    static unsigned char buffer_id(EMoveType type) {
+        return static_cast<unsigned char>(type) - static_cast<unsigned char>(EMoveType::Retract);
+    }
+    static EMoveType buffer_type(unsigned char id) {
+        return static_cast<EMoveType>(static_cast<unsigned char>(EMoveType::Retract) + id);
+    }
+    static constexpr size_t buffers_count() { return static_cast<size_t>(EMoveType::Extrude); }
+    // How the toolpaths of the given move type are rendered.
+    static std::pair<ERenderPrimitiveType, EVertexFormat> buffer_layout(EMoveType type);
+
+    static size_t vertex_size_floats(EVertexFormat format);
+    static unsigned int max_vertices_per_segment(ERenderPrimitiveType type);
+    static unsigned int indices_per_segment(ERenderPrimitiveType type);
+    static unsigned int max_indices_per_segment(ERenderPrimitiveType type);
+
+    // Indices of the first and of the last move of a layer.
+    struct LayerEndpoints
+    {
+        size_t first{ 0 };
+        size_t last{ 0 };
+    };
+
+    std::vector<Buffer>         buffers;
+    // Approximate bounding box of the extrusions, or of all the moves if generated with bounding_box_all_moves.
+    BoundingBoxf3               paths_bounding_box;
+    bool                        bounding_box_all_moves { false };
+    std::vector<double>         layers_zs;
+    std::vector<LayerEndpoints> layers_endpoints;
+    // Extrusion roles and extruders present in the G-code, sorted.
+    std::vector<ExtrusionRole>  roles;
+    std::vector<unsigned char>  extruder_ids;
+    size_t                      moves_count { 0 };
+    // Hash of the content of the G-code file the buffers were generated from, see GCodeProcessor::Result::gcode_hash.
+    uint64_t                    gcode_hash { 0 };
+
+    // Generate the buffers out of the processed G-code. The buffers of the individual move types are generated in parallel,
+    // in parallel with the extraction of the layers. bounding_box_all_moves is set by the G-code viewer to size the bed
+    // by all the moves, otherwise only the extrusions are considered.
+    void generate(const GCodeProcessor::Result& gcode_result, bool bounding_box_all_moves);
+    void clear();
+    bool empty() const { return moves_count == 0; }
+    size_t memsize() const;
+
+    // Save the buffers into a binary file, stamped with the hash of the content of the G-code file the buffers were generated from.
+    // Throws Slic3r::RuntimeError on failure or if the hash is not known.
+    void save(const std::string& path) const;
+    // Load the buffers saved by save(). Returns false and leaves the buffers empty if the file does not exist,
+    // if it was written by a different version, with a different bounding_box_all_moves, for a different content
+    // of the G-code file (gcode_hash) or if it is corrupted.
+    bool load(const std::string& path, uint64_t gcode_hash, bool bounding_box_all_moves);
+};
+
+// Path of the preview buffers cached next to the G-code file.
+std::string gcode_preview_buffers_path(const std::string& gcode_path);
+
+} // namespace Slic3r
+
+#endif // slic3r_GCode_PreviewBuffers_hpp_
@@ -111,6 +111,7 @@ BoundingBoxf get_print_object_extrusions_extents(const PrintObject &print_object
     for (const Layer *layer : print_object.layers()) {
         if (layer->print_z > max_print_z)
             break;
+        RestoredLayers restored(print_object.print()->layer_spill(), { layer });
         BoundingBoxf bbox_this;
         for (const LayerRegion *layerm : layer->regions()) {
             bbox_this.merge(extrusionentity_extents(layerm->perimeters));
@@ -8,6 +8,8 @@
 #include "libslic3r/SVG.hpp"
 #include "libslic3r/Layer.hpp"
 
+#include <tbb/parallel_for.h>
+
 namespace Slic3r {
 
 // This penalty is added to all points inside custom blockers (subtracted from pts inside enforcers).
@@ -194,73 +196,48 @@ void SeamPlacer::init(const Print& print)
     m_blockers.clear();
     m_seam_history.clear();
     m_po_list.clear();
+    m_lower_layer_edge_grids.clear();
 
     const std::vector<double>& nozzle_dmrs = print.config().nozzle_diameter.values;
     float max_nozzle_dmr = *std::max_element(nozzle_dmrs.begin(), nozzle_dmrs.end());
 
+    // Remember the PrintObjects and initialize a store of enforcers and blockers for them.
+    m_po_list.assign(print.objects().begin(), print.objects().end());
+    m_enforcers.assign(m_po_list.size(), std::vector<CustomTrianglesPerLayer>());
+    m_blockers.assign(m_po_list.size(), std::vector<CustomTrianglesPerLayer>());
+    for (const PrintObject* po : m_po_list)
+        m_lower_layer_edge_grids[po].grids.resize(po->layer_count());
+
+    // A helper class to store data to build the AABB tree from.
+    class CustomTriangleRef {
+    public:
+        CustomTriangleRef(size_t idx,
+                          Point&& centroid,
+                          BoundingBox&& bb)
+            : m_idx{idx}, m_centroid{centroid},
+              m_bbox{AlignedBoxType(bb.min, bb.max)}
+        {}
+        size_t idx() const              { return m_idx;      }
+        const Point& centroid() const   { return m_centroid; }
+        const TreeType::BoundingBox& bbox() const { return m_bbox; }
+
+    private:
+        size_t m_idx;
+        Point m_centroid;
+        AlignedBoxType m_bbox;
+    };
 
-    std::vector<ExPolygons> temp_enf;
-    std::vector<ExPolygons> temp_blk;
-
-    for (const PrintObject* po : print.objects()) {
-        temp_enf.clear();
-        temp_blk.clear();
-        po->project_and_append_custom_facets(true, EnforcerBlockerType::ENFORCER, temp_enf);
-        po->project_and_append_custom_facets(true, EnforcerBlockerType::BLOCKER, temp_blk);
-
-        // Offset the triangles out slightly.
-        for (auto* custom_per_object : {&temp_enf, &temp_blk}) {
-            float offset = max_nozzle_dmr + po->config().elefant_foot_compensation;
-            for (ExPolygons& explgs : *custom_per_object) {
-                explgs = Slic3r::offset_ex(explgs, scale_(offset));
-                offset = max_nozzle_dmr;
-            }
-        }
+    // A lambda to offset the ExPolygons and save them into the member AABB tree.
+    // Will be called for enforcers and blockers separately. The layers are independent, they are processed in parallel.
+    auto add_custom = [max_nozzle_dmr](std::vector<ExPolygons>& src, std::vector<CustomTrianglesPerLayer>& dest, float elefant_foot_compensation) {
+        dest.assign(src.size(), CustomTrianglesPerLayer());
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, src.size()), [&src, &dest, max_nozzle_dmr, elefant_foot_compensation](const tbb::blocked_range<size_t>& range) {
+            for (size_t layer_idx = range.begin(); layer_idx < range.end(); ++ layer_idx) {
+                // Offset the triangles out slightly.
+                //FIXME: Offsetting should be done somehow cheaper, offsetting each ExPolygon separately does not work.
+                ExPolygons expolys_on_layer = Slic3r::offset_ex(src[layer_idx], scale_(layer_idx == 0 ? max_nozzle_dmr + elefant_foot_compensation : max_nozzle_dmr));
+                src[layer_idx].clear();
 
-//     FIXME: Offsetting should be done somehow cheaper, but following does not work
-//        for (auto* custom_per_object : {&temp_enf, &temp_blk}) {
-//            for (ExPolygons& plgs : *custom_per_object) {
-//                for (ExPolygon& plg : plgs) {
-//                    auto out = Slic3r::offset_ex(plg, scale_(max_nozzle_dmr));
-//                    plg = out.empty() ? ExPolygon() : out.front();
-//                    assert(out.empty() || out.size() == 1);
-//                }
-//            }
-//        }
-
-
-
-        // Remember this PrintObject and initialize a store of enforcers and blockers for it.
-        m_po_list.push_back(po);
-        size_t po_idx = m_po_list.size() - 1;
-        m_enforcers.emplace_back(std::vector<CustomTrianglesPerLayer>(temp_enf.size()));
-        m_blockers.emplace_back(std::vector<CustomTrianglesPerLayer>(temp_blk.size()));
-
-        // A helper class to store data to build the AABB tree from.
-        class CustomTriangleRef {
-        public:
-            CustomTriangleRef(size_t idx,
-                              Point&& centroid,
-                              BoundingBox&& bb)
-                : m_idx{idx}, m_centroid{centroid},
-                  m_bbox{AlignedBoxType(bb.min, bb.max)}
-            {}
-            size_t idx() const              { return m_idx;      }
-            const Point& centroid() const   { return m_centroid; }
-            const TreeType::BoundingBox& bbox() const { return m_bbox; }
-
-        private:
-            size_t m_idx;
-            Point m_centroid;
-            AlignedBoxType m_bbox;
-        };
-
-        // A lambda to extract the ExPolygons and save them into the member AABB tree.
-        // Will be called for enforcers and blockers separately.
-        auto add_custom = [](std::vector<ExPolygons>& src, std::vector<CustomTrianglesPerLayer>& dest) {
-            // Go layer by layer, and append all the ExPolygons into the AABB tree.
-            size_t layer_idx = 0;
-            for (ExPolygons& expolys_on_layer : src) {
                 CustomTrianglesPerLayer& layer_data = dest[layer_idx];
                 std::vector<CustomTriangleRef> triangles_data;
                 layer_data.polys.reserve(expolys_on_layer.size());
@@ -276,13 +253,78 @@ void SeamPlacer::init(const Print& print)
                 }
                 // All polygons are saved, build the AABB tree for them.
                 layer_data.tree.build(std::move(triangles_data));
-                ++layer_idx;
             }
-        };
+        });
+    };
+
+    // PrintObjects are independent of each other, collect their custom seams in parallel.
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, m_po_list.size()), [this, &add_custom](const tbb::blocked_range<size_t>& range) {
+        for (size_t po_idx = range.begin(); po_idx < range.end(); ++ po_idx) {
+            const PrintObject* po = m_po_list[po_idx];
+            std::vector<ExPolygons> temp_enf;
+            std::vector<ExPolygons> temp_blk;
+            po->project_and_append_custom_facets(true, EnforcerBlockerType::ENFORCER, temp_enf);
+            po->project_and_append_custom_facets(true, EnforcerBlockerType::BLOCKER, temp_blk);
+            add_custom(temp_enf, m_enforcers[po_idx], float(po->config().elefant_foot_compensation));
+            add_custom(temp_blk, m_blockers[po_idx], float(po->config().elefant_foot_compensation));
+        }
+    });
+}
 
-        add_custom(temp_enf, m_enforcers.at(po_idx));
-        add_custom(temp_blk, m_blockers.at(po_idx));
+
+
+const EdgeGrid::Grid* SeamPlacer::get_lower_layer_edge_grid(const Layer& layer)
+{
+    if (layer.lower_layer == nullptr)
+        return nullptr;
+
+    auto it_po = m_lower_layer_edge_grids.find(layer.object());
+    if (it_po == m_lower_layer_edge_grids.end())
+        return nullptr;
+
+    LowerLayerEdgeGrids &lower_grids = it_po->second;
+    const PrintObject   *po          = layer.object();
+    const size_t         layer_idx   = layer.id() - po->layers().front()->id(); // raft layers
+    assert(layer_idx < lower_grids.grids.size());
+
+    auto build_grid = [po](size_t idx) {
+        // Create the distance field for a layer below.
+        const Layer  *lower_layer = po->layers()[idx]->lower_layer;
+        if (lower_layer == nullptr)
+            return std::unique_ptr<EdgeGrid::Grid>();
+        const coord_t distance_field_resolution = coord_t(scale_(1.) + 0.5);
+        auto grid = std::make_unique<EdgeGrid::Grid>();
+        grid->create(lower_layer->lslices, distance_field_resolution);
+        grid->calculate_sdf();
+        return grid;
+    };
+
+    if (! lower_grids.grids[layer_idx]) {
+        // Release the grids of the current batch not part of the new one and build a new batch of layers starting with this one
+        // in parallel. The export jumps back to the first layer with each further instance of the object with complete_objects.
+        size_t begin = layer_idx;
+        size_t end   = std::min(lower_grids.grids.size(), layer_idx + LOWER_LAYER_EDGE_GRIDS_BATCH);
+        for (size_t idx = lower_grids.begin; idx < lower_grids.end; ++ idx)
+            if (idx < begin || idx >= end)
+                lower_grids.grids[idx].reset();
+        lower_grids.begin = begin;
+        lower_grids.end   = end;
+        tbb::parallel_for(tbb::blocked_range<size_t>(begin, end), [&lower_grids, &build_grid](const tbb::blocked_range<size_t>& range) {
+            for (size_t idx = range.begin(); idx < range.end(); ++ idx)
+                if (! lower_grids.grids[idx])
+                    lower_grids.grids[idx] = build_grid(idx);
+        });
     }
+
+    return lower_grids.grids[layer_idx].get();
+}
+
+size_t SeamPlacer::lower_layer_edge_grids_count() const
+{
+    size_t count = 0;
+    for (const auto &lower_grids : m_lower_layer_edge_grids)
+        count += std::count_if(lower_grids.second.grids.begin(), lower_grids.second.grids.end(), [](const std::unique_ptr<EdgeGrid::Grid> &grid) { return bool(grid); });
+    return count;
 }
 
 
@@ -396,17 +438,15 @@ Point SeamPlacer::get_seam(const Layer& layer, const SeamPosition seam_position,
             // Use the edge grid distance field structure over the lower layer to calculate overhangs.
             coord_t nozzle_r = coord_t(std::floor(scale_(0.5 * nozzle_dmr) + 0.5));
             coord_t search_r = coord_t(std::floor(scale_(0.8 * nozzle_dmr) + 0.5));
+            // Signed distance is positive outside the object, negative inside the object.
+            // The point is considered at an overhang, if it is more than nozzle radius
+            // outside of the lower layer contour.
+            std::vector<coordf_t> dists = lower_layer_edge_grid->signed_distances(polygon.points, search_r);
             for (size_t i = 0; i < polygon.points.size(); ++ i) {
-                const Point &p = polygon.points[i];
-                coordf_t dist;
-                // Signed distance is positive outside the object, negative inside the object.
-                // The point is considered at an overhang, if it is more than nozzle radius
-                // outside of the lower layer contour.
-                [[maybe_unused]] bool found = lower_layer_edge_grid->signed_distance(p, search_r, dist);
                 // If the approximate Signed Distance Field was initialized over lower_layer_edge_grid,
                 // then the signed distnace shall always be known.
-                assert(found);
-                penalties[i] += extrudate_overlap_penalty(float(nozzle_r), penaltyOverhangHalf, float(dist));
+                assert(dists[i] != std::numeric_limits<coordf_t>::max());
+                penalties[i] += extrudate_overlap_penalty(float(nozzle_r), penaltyOverhangHalf, float(dists[i]));
             }
         }
 
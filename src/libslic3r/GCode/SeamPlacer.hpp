@@ -2,6 +2,8 @@
 #define libslic3r_SeamPlacer_hpp_
 
 #include <optional>
+#include <map>
+#include <memory>
 
 #include "libslic3r/Polygon.hpp"
 #include "libslic3r/PrintConfig.hpp"
@@ -41,6 +43,13 @@ class SeamPlacer {
 public:
     void init(const Print& print);
 
+    // Distance field over the layer below the passed object layer, used to penalize seams at overhangs.
+    // The distance fields are built in parallel in batches of layers ahead of the layer being exported
+    // and shared by all the instances and extruders printing the layer. Returns nullptr for the first layer.
+    const EdgeGrid::Grid* get_lower_layer_edge_grid(const Layer& layer);
+    // Number of the lower layer distance fields currently held in memory.
+    size_t lower_layer_edge_grids_count() const;
+
     Point get_seam(const Layer& layer, const SeamPosition seam_position,
                    const ExtrusionLoop& loop, Point last_pos,
                    coordf_t nozzle_diameter, const PrintObject* po,
@@ -70,6 +79,18 @@ private:
     //std::map<const PrintObject*, Point>  m_last_seam_position;
     SeamHistory  m_seam_history;
 
+    // Number of layers of a single PrintObject, for which the lower layer distance fields are built at once.
+    static constexpr size_t LOWER_LAYER_EDGE_GRIDS_BATCH = 32;
+
+    struct LowerLayerEdgeGrids {
+        // Indexed by the index of a layer in its PrintObject.
+        std::vector<std::unique_ptr<EdgeGrid::Grid>> grids;
+        // Range of layers of the last built batch.
+        size_t begin = 0;
+        size_t end   = 0;
+    };
+    std::map<const PrintObject*, LowerLayerEdgeGrids> m_lower_layer_edge_grids;
+
     // Get indices of points inside enforcers and blockers.
     void get_enforcers_and_blockers(size_t layer_id,
                                     const Polygon& polygon,
@@ -136,7 +136,7 @@ ToolOrdering::ToolOrdering(const Print &print, unsigned int first_extruder, bool
 
             // Find first object layer that is not empty and save its print_z
             for (const Layer* layer : object->layers())
-                if (layer->has_extrusions()) {
+                if (layer_has_extrusions(print.layer_spill(), *layer)) {
                     object_bottom_z = layer->print_z - layer->height;
                     break;
                 }
@@ -192,6 +192,7 @@ void ToolOrdering::collect_extruders(const PrintObject &object, const std::vecto
 {
     // Collect the support extruders.
     for (auto support_layer : object.support_layers()) {
+        RestoredLayers restored(object.print()->layer_spill(), { support_layer });
         LayerTools   &layer_tools = this->tools_for_layer(support_layer->print_z);
         ExtrusionRole role = support_layer->support_fills.role();
         bool         has_support        = role == erMixed || role == erSupportMaterial;
@@ -213,6 +214,7 @@ void ToolOrdering::collect_extruders(const PrintObject &object, const std::vecto
 
     // Collect the object extruders.
     for (auto layer : object.layers()) {
+        RestoredLayers restored(object.print()->layer_spill(), { layer });
         LayerTools &layer_tools = this->tools_for_layer(layer->print_z);
 
         // Override extruder with the next 
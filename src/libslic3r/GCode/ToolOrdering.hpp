@@ -27,6 +27,9 @@ public:
         return something_overridden;
     }
 
+    // Some of the extrusions of this layer may be used for wiping, mark_wiping_extrusions() will have to look at them.
+    bool is_anything_overridable() const { return something_overridable; }
+
     // When allocating extruder overrides of an object's ExtrusionEntity, overrides for maximum 3 copies are allocated in place.
     typedef boost::container::small_vector<int32_t, 3> ExtruderPerCopy;
 
@@ -1,6 +1,9 @@
 #include "GCodeWriter.hpp"
 #include "CustomGCode.hpp"
+#include "LocalesUtils.hpp"
 #include <algorithm>
+#include <charconv>
+#include <cstdio>
 #include <iomanip>
 #include <iostream>
 #include <map>
@@ -15,6 +18,30 @@
 
 namespace Slic3r {
 
+void GCodeFormatter::append_fixed(std::string &out, double v, int precision)
+{
+    char buf[64];
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+    // Formats as printf("%.*f") in the "C" locale would, which is what std::fixed << std::setprecision() produces.
+    std::to_chars_result res = std::to_chars(buf, buf + sizeof(buf), v, std::chars_format::fixed, precision);
+    if (res.ec == std::errc()) {
+        out.append(buf, res.ptr - buf);
+        return;
+    }
+#else
+    // Floating point std::to_chars() is not available, for example with older libc++.
+    // G-code is exported with LC_NUMERIC set to "C", see CNumericLocalesSetter.
+    assert(is_decimal_separator_point());
+    int len = snprintf(buf, sizeof(buf), "%.*f", precision, v);
+    if (len > 0 && len < int(sizeof(buf))) {
+        out.append(buf, len);
+        return;
+    }
+#endif
+    // Huge number not fitting the buffer, not expected in a valid G-code.
+    out += float_to_string_decimal_point(v, precision);
+}
+
 void GCodeWriter::apply_print_config(const PrintConfig &print_config)
 {
     this->config.apply(print_config, true);
@@ -292,26 +319,34 @@ std::string GCodeWriter::set_speed(double F, const std::string &comment, const s
 {
     assert(F > 0.);
     assert(F < 100000.);
-    std::ostringstream gcode;
-    gcode << "G1 F" << XYZF_NUM(F);
-    COMMENT(comment);
-    gcode << cooling_marker;
-    gcode << "\n";
-    return gcode.str();
+    std::string    out;
+    GCodeFormatter gcode(out);
+    gcode.emit_string("G1");
+    gcode.emit_f(F);
+    gcode.emit_comment(this->config.gcode_comments, comment);
+    out += cooling_marker;
+    gcode.end_line();
+    return out;
 }
 
 std::string GCodeWriter::travel_to_xy(const Vec2d &point, const std::string &comment)
+{
+    std::string out;
+    this->travel_to_xy(out, point, comment);
+    return out;
+}
+
+void GCodeWriter::travel_to_xy(std::string &out, const Vec2d &point, const std::string &comment)
 {
     m_pos(0) = point(0);
     m_pos(1) = point(1);
-    
-    std::ostringstream gcode;
-    gcode << "G1 X" << XYZF_NUM(point(0))
-          <<   " Y" << XYZF_NUM(point(1))
-          <<   " F" << XYZF_NUM(this->config.travel_speed.value * 60.0);
-    COMMENT(comment);
-    gcode << "\n";
-    return gcode.str();
+
+    GCodeFormatter gcode(out);
+    gcode.emit_string("G1");
+    gcode.emit_xy(point);
+    gcode.emit_f(this->config.travel_speed.value * 60.0);
+    gcode.emit_comment(this->config.gcode_comments, comment);
+    gcode.end_line();
 }
 
 std::string GCodeWriter::travel_to_xyz(const Vec3d &point, const std::string &comment)
@@ -340,14 +375,14 @@ std::string GCodeWriter::travel_to_xyz(const Vec3d &point, const std::string &co
     m_lifted = 0;
     m_pos = point;
     
-    std::ostringstream gcode;
-    gcode << "G1 X" << XYZF_NUM(point(0))
-          <<   " Y" << XYZF_NUM(point(1))
-          <<   " Z" << XYZF_NUM(point(2))
-          <<   " F" << XYZF_NUM(this->config.travel_speed.value * 60.0);
-    COMMENT(comment);
-    gcode << "\n";
-    return gcode.str();
+    std::string    out;
+    GCodeFormatter gcode(out);
+    gcode.emit_string("G1");
+    gcode.emit_xyz(point);
+    gcode.emit_f(this->config.travel_speed.value * 60.0);
+    gcode.emit_comment(this->config.gcode_comments, comment);
+    gcode.end_line();
+    return out;
 }
 
 std::string GCodeWriter::travel_to_z(double z, const std::string &comment)
@@ -377,12 +412,14 @@ std::string GCodeWriter::_travel_to_z(double z, const std::string &comment)
     if (speed == 0.)
         speed = this->config.travel_speed.value;
     
-    std::ostringstream gcode;
-    gcode << "G1 Z" << XYZF_NUM(z)
-          <<   " F" << XYZF_NUM(speed * 60.0);
-    COMMENT(comment);
-    gcode << "\n";
-    return gcode.str();
+    std::string    out;
+    GCodeFormatter gcode(out);
+    gcode.emit_string("G1");
+    gcode.emit_z(z);
+    gcode.emit_f(speed * 60.0);
+    gcode.emit_comment(this->config.gcode_comments, comment);
+    gcode.end_line();
+    return out;
 }
 
 bool GCodeWriter::will_move_z(double z) const
@@ -398,18 +435,24 @@ bool GCodeWriter::will_move_z(double z) const
 }
 
 std::string GCodeWriter::extrude_to_xy(const Vec2d &point, double dE, const std::string &comment)
+{
+    std::string out;
+    this->extrude_to_xy(out, point, dE, comment);
+    return out;
+}
+
+void GCodeWriter::extrude_to_xy(std::string &out, const Vec2d &point, double dE, const std::string &comment)
 {
     m_pos(0) = point(0);
     m_pos(1) = point(1);
     m_extruder->extrude(dE);
-    
-    std::ostringstream gcode;
-    gcode << "G1 X" << XYZF_NUM(point(0))
-          <<   " Y" << XYZF_NUM(point(1))
-          <<    " " << m_extrusion_axis << E_NUM(m_extruder->E());
-    COMMENT(comment);
-    gcode << "\n";
-    return gcode.str();
+
+    GCodeFormatter gcode(out);
+    gcode.emit_string("G1");
+    gcode.emit_xy(point);
+    gcode.emit_e(m_extrusion_axis, m_extruder->E());
+    gcode.emit_comment(this->config.gcode_comments, comment);
+    gcode.end_line();
 }
 
 std::string GCodeWriter::extrude_to_xyz(const Vec3d &point, double dE, const std::string &comment)
@@ -418,14 +461,14 @@ std::string GCodeWriter::extrude_to_xyz(const Vec3d &point, double dE, const std
     m_lifted = 0;
     m_extruder->extrude(dE);
     
-    std::ostringstream gcode;
-    gcode << "G1 X" << XYZF_NUM(point(0))
-          <<   " Y" << XYZF_NUM(point(1))
-          <<   " Z" << XYZF_NUM(point(2))
-          <<    " " << m_extrusion_axis << E_NUM(m_extruder->E());
-    COMMENT(comment);
-    gcode << "\n";
-    return gcode.str();
+    std::string    out;
+    GCodeFormatter gcode(out);
+    gcode.emit_string("G1");
+    gcode.emit_xyz(point);
+    gcode.emit_e(m_extrusion_axis, m_extruder->E());
+    gcode.emit_comment(this->config.gcode_comments, comment);
+    gcode.end_line();
+    return out;
 }
 
 std::string GCodeWriter::retract(bool before_wipe)
@@ -10,6 +10,39 @@
 
 namespace Slic3r {
 
+// Builds G-code lines by appending directly to a G-code buffer.
+// The numbers are formatted in a fixed notation with the same result as std::ostream with std::fixed
+// and std::setprecision(), but without a locale aware stream and without temporary strings.
+class GCodeFormatter {
+public:
+    GCodeFormatter(std::string &out) : m_out(out) {}
+
+    static constexpr const int XYZF_PRECISION = 3;
+    static constexpr const int E_PRECISION    = 5;
+
+    // Append a number with a fixed number of decimal digits.
+    static void append_fixed(std::string &out, double v, int precision);
+
+    void emit_string(const char *s)                     { m_out += s; }
+    void emit_axis(char axis, double v, int precision)  { m_out += ' '; m_out += axis; append_fixed(m_out, v, precision); }
+    void emit_xy(const Vec2d &point)                    { this->emit_axis('X', point.x(), XYZF_PRECISION); this->emit_axis('Y', point.y(), XYZF_PRECISION); }
+    void emit_xyz(const Vec3d &point)                   { this->emit_xy(Vec2d(point.x(), point.y())); this->emit_z(point.z()); }
+    void emit_z(double z)                               { this->emit_axis('Z', z, XYZF_PRECISION); }
+    // The extrusion axis may be empty for gcfNoExtrusion, the separating space is emitted anyway.
+    void emit_e(const std::string &axis, double v)      { m_out += ' '; m_out += axis; append_fixed(m_out, v, E_PRECISION); }
+    void emit_f(double speed)                           { this->emit_axis('F', speed, XYZF_PRECISION); }
+    void emit_comment(bool allow_comments, const std::string &comment) {
+        if (allow_comments && ! comment.empty()) {
+            m_out += " ; ";
+            m_out += comment;
+        }
+    }
+    void end_line()                                     { m_out += '\n'; }
+
+private:
+    std::string &m_out;
+};
+
 class GCodeWriter {
 public:
     GCodeConfig config;
@@ -56,10 +89,14 @@ public:
     std::string toolchange(unsigned int extruder_id);
     std::string set_speed(double F, const std::string &comment = std::string(), const std::string &cooling_marker = std::string()) const;
     std::string travel_to_xy(const Vec2d &point, const std::string &comment = std::string());
+    // Append the travel move to the output G-code buffer.
+    void        travel_to_xy(std::string &out, const Vec2d &point, const std::string &comment = std::string());
     std::string travel_to_xyz(const Vec3d &point, const std::string &comment = std::string());
     std::string travel_to_z(double z, const std::string &comment = std::string());
     bool        will_move_z(double z) const;
     std::string extrude_to_xy(const Vec2d &point, double dE, const std::string &comment = std::string());
+    // Append the extrusion move to the output G-code buffer.
+    void        extrude_to_xy(std::string &out, const Vec2d &point, double dE, const std::string &comment = std::string());
     std::string extrude_to_xyz(const Vec3d &point, double dE, const std::string &comment = std::string());
     std::string retract(bool before_wipe = false);
     std::string retract_for_toolchange(bool before_wipe = false);
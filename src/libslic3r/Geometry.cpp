@@ -4,6 +4,7 @@
 #include "ClipperUtils.hpp"
 #include "ExPolygon.hpp"
 #include "Line.hpp"
+#include "VoronoiOffset.hpp"
 #include "clipper.hpp"
 #include <algorithm>
 #include <cassert>
@@ -924,12 +925,20 @@ private:
 void
 MedialAxis::build(ThickPolylines* polylines)
 {
-    construct_voronoi(this->lines.begin(), this->lines.end(), &this->vd);
+    if (this->builder == NULL) {
+        this->own_builder = std::make_unique<VoronoiDiagramBuilder>();
+        this->builder     = this->own_builder.get();
+    }
+    this->vd = &this->builder->construct(this->lines.begin(), this->lines.end());
+    if (this->expolygon != NULL)
+        // Classify the Voronoi vertices as inside / outside of the expolygon in a single pass,
+        // so that validate_edge() does not need to clip each Voronoi edge with the expolygon.
+        Voronoi::annotate_inside_outside(*this->vd, this->lines);
     
     /*
     // DEBUG: dump all Voronoi edges
     {
-        for (VD::const_edge_iterator edge = this->vd.edges().begin(); edge != this->vd.edges().end(); ++edge) {
+        for (VD::const_edge_iterator edge = this->vd->edges().begin(); edge != this->vd->edges().end(); ++edge) {
             if (edge->is_infinite()) continue;
             
             ThickPolyline polyline;
@@ -946,40 +955,38 @@ MedialAxis::build(ThickPolylines* polylines)
     
     // collect valid edges (i.e. prune those not belonging to MAT)
     // note: this keeps twins, so it inserts twice the number of the valid edges
-    this->valid_edges.clear();
-    {
-        std::set<const VD::edge_type*> seen_edges;
-        for (VD::const_edge_iterator edge = this->vd.edges().begin(); edge != this->vd.edges().end(); ++edge) {
-            // if we only process segments representing closed loops, none if the
-            // infinite edges (if any) would be part of our MAT anyway
-            if (edge->is_secondary() || edge->is_infinite()) continue;
+    const size_t num_edges = this->vd->num_edges();
+    this->valid_edges.assign(num_edges, false);
+    this->thickness.assign(num_edges, std::make_pair(0., 0.));
+    for (VD::const_edge_iterator edge = this->vd->edges().begin(); edge != this->vd->edges().end(); ++edge) {
+        // if we only process segments representing closed loops, none if the
+        // infinite edges (if any) would be part of our MAT anyway
+        if (edge->is_secondary() || edge->is_infinite()) continue;
+    
+        // don't re-validate twins, the twin half-edges are stored next to each other
+        if (this->edge_idx(edge->twin()) < this->edge_idx(&*edge)) continue;
         
-            // don't re-validate twins
-            if (seen_edges.find(&*edge) != seen_edges.end()) continue;  // TODO: is this needed?
-            seen_edges.insert(&*edge);
-            seen_edges.insert(edge->twin());
-            
-            if (!this->validate_edge(&*edge)) continue;
-            this->valid_edges.insert(&*edge);
-            this->valid_edges.insert(edge->twin());
-        }
+        if (!this->validate_edge(&*edge)) continue;
+        this->valid_edges[this->edge_idx(&*edge)] = true;
+        this->valid_edges[this->edge_idx(edge->twin())] = true;
     }
     this->edges = this->valid_edges;
     
-    // iterate through the valid edges to build polylines
-    while (!this->edges.empty()) {
-        const edge_t* edge = *this->edges.begin();
+    // iterate through the valid edges to build polylines, in the order of the Voronoi edges
+    for (size_t idx = 0; idx < num_edges; ++ idx) {
+        if (! this->edges[idx]) continue;
+        const edge_t* edge = &this->vd->edges()[idx];
         
         // start a polyline
         ThickPolyline polyline;
         polyline.points.push_back(Point( edge->vertex0()->x(), edge->vertex0()->y() ));
         polyline.points.push_back(Point( edge->vertex1()->x(), edge->vertex1()->y() ));
-        polyline.width.push_back(this->thickness[edge].first);
-        polyline.width.push_back(this->thickness[edge].second);
+        polyline.width.push_back(this->thickness[idx].first);
+        polyline.width.push_back(this->thickness[idx].second);
         
         // remove this edge and its twin from the available edges
-        (void)this->edges.erase(edge);
-        (void)this->edges.erase(edge->twin());
+        this->edges[idx] = false;
+        this->edges[this->edge_idx(edge->twin())] = false;
         
         // get next points
         this->process_edge_neighbors(edge, &polyline);
@@ -1008,7 +1015,7 @@ MedialAxis::build(ThickPolylines* polylines)
     #ifdef SLIC3R_DEBUG
     {
         static int iRun = 0;
-        dump_voronoi_to_svg(this->lines, this->vd, polylines, debug_out_path("MedialAxis-%d.svg", iRun ++).c_str());
+        dump_voronoi_to_svg(this->lines, *this->vd, polylines, debug_out_path("MedialAxis-%d.svg", iRun ++).c_str());
         printf("Thick lines: ");
         for (ThickPolylines::const_iterator it = polylines->begin(); it != polylines->end(); ++ it) {
             ThickLines lines = it->thicklines();
@@ -1042,7 +1049,7 @@ MedialAxis::process_edge_neighbors(const VD::edge_type* edge, ThickPolyline* pol
         std::vector<const VD::edge_type*> neighbors;
         for (const VD::edge_type* neighbor = twin->rot_next(); neighbor != twin;
             neighbor = neighbor->rot_next()) {
-            if (this->valid_edges.count(neighbor) > 0) neighbors.push_back(neighbor);
+            if (this->valid_edges[this->edge_idx(neighbor)]) neighbors.push_back(neighbor);
         }
     
         // if we have a single neighbor then we can continue recursively
@@ -1050,14 +1057,15 @@ MedialAxis::process_edge_neighbors(const VD::edge_type* edge, ThickPolyline* pol
             const VD::edge_type* neighbor = neighbors.front();
             
             // break if this is a closed loop
-            if (this->edges.count(neighbor) == 0) return;
+            size_t idx = this->edge_idx(neighbor);
+            if (! this->edges[idx]) return;
             
             Point new_point(neighbor->vertex1()->x(), neighbor->vertex1()->y());
             polyline->points.push_back(new_point);
-            polyline->width.push_back(this->thickness[neighbor].first);
-            polyline->width.push_back(this->thickness[neighbor].second);
-            (void)this->edges.erase(neighbor);
-            (void)this->edges.erase(neighbor->twin());
+            polyline->width.push_back(this->thickness[idx].first);
+            polyline->width.push_back(this->thickness[idx].second);
+            this->edges[idx] = false;
+            this->edges[this->edge_idx(neighbor->twin())] = false;
             edge = neighbor;
         } else if (neighbors.size() == 0) {
             polyline->endpoints.second = true;
@@ -1090,11 +1098,20 @@ bool MedialAxis::validate_edge(const VD::edge_type* edge)
     // this could maybe be optimized (checking inclusion of the endpoints
     // might give false positives as they might belong to the contour itself)
     if (this->expolygon != NULL) {
-        if (line.a == line.b) {
-            // in this case, contains(line) returns a false positive
-            if (!this->expolygon->contains(line.a)) return false;
-        } else {
-            if (!this->expolygon->contains(line)) return false;
+        // The Voronoi edges never cross the input segments, thus an edge is inside the expolygon
+        // if none of its end points was annotated as outside by annotate_inside_outside().
+        // Only the edges touching the contour at both ends are clipped.
+        Voronoi::VertexCategory c0 = Voronoi::vertex_category(edge->vertex0());
+        Voronoi::VertexCategory c1 = Voronoi::vertex_category(edge->vertex1());
+        if (c0 == Voronoi::VertexCategory::Outside || c1 == Voronoi::VertexCategory::Outside)
+            return false;
+        if (c0 != Voronoi::VertexCategory::Inside && c1 != Voronoi::VertexCategory::Inside) {
+            if (line.a == line.b) {
+                // in this case, contains(line) returns a false positive
+                if (!this->expolygon->contains(line.a)) return false;
+            } else {
+                if (!this->expolygon->contains(line)) return false;
+            }
         }
     }
     
@@ -1167,8 +1184,8 @@ bool MedialAxis::validate_edge(const VD::edge_type* edge)
     if (w0 > this->max_width && w1 > this->max_width)
         return false;
     
-    this->thickness[edge]         = std::make_pair(w0, w1);
-    this->thickness[edge->twin()] = std::make_pair(w1, w0);
+    this->thickness[this->edge_idx(edge)]         = std::make_pair(w0, w1);
+    this->thickness[this->edge_idx(edge->twin())] = std::make_pair(w1, w0);
     
     return true;
 }
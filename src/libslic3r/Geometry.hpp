@@ -7,6 +7,8 @@
 #include "Polygon.hpp"
 #include "Polyline.hpp"
 
+#include <memory>
+
 // Serialization through the Cereal library
 #include <cereal/access.hpp>
 
@@ -380,22 +382,48 @@ public:
     typedef boost::polygon::rectangle_data<coordinate_type> rect_type;
 };
 
+// Constructs Voronoi diagrams of line segments. The buffers of the diagram and of the builder are reused
+// between the calls, for example for all the islands of a layer region processed by the same thread.
+class VoronoiDiagramBuilder {
+public:
+    // The returned diagram is valid until the next call to construct().
+    template<typename SegmentIterator>
+    VoronoiDiagram& construct(SegmentIterator first, SegmentIterator last) {
+        // construct_voronoi() doesn't clear the output, it only appends to it.
+        m_vd.clear();
+        m_builder.clear();
+        boost::polygon::insert(first, last, &m_builder);
+        m_builder.construct(&m_vd);
+        return m_vd;
+    }
+
+private:
+    VoronoiDiagram                              m_vd;
+    boost::polygon::default_voronoi_builder     m_builder;
+};
+
 class MedialAxis {
 public:
     Lines lines;
     const ExPolygon* expolygon;
     double max_width;
     double min_width;
-    MedialAxis(double _max_width, double _min_width, const ExPolygon* _expolygon = NULL)
-        : expolygon(_expolygon), max_width(_max_width), min_width(_min_width) {};
+    // If a builder is provided, its buffers are reused, otherwise a new Voronoi diagram is allocated.
+    MedialAxis(double _max_width, double _min_width, const ExPolygon* _expolygon = NULL, VoronoiDiagramBuilder* _builder = NULL)
+        : expolygon(_expolygon), max_width(_max_width), min_width(_min_width), builder(_builder) {};
     void build(ThickPolylines* polylines);
     void build(Polylines* polylines);
     
 private:
     using VD = VoronoiDiagram;
-    VD vd;
-    std::set<const VD::edge_type*> edges, valid_edges;
-    std::map<const VD::edge_type*, std::pair<coordf_t,coordf_t> > thickness;
+    VoronoiDiagramBuilder* builder;
+    std::unique_ptr<VoronoiDiagramBuilder> own_builder;
+    VD* vd { nullptr };
+    // Indexed by the Voronoi edges: Edges of the medial axis, edges not yet chained into polylines
+    // and the thickness at the edge end points.
+    std::vector<char> edges, valid_edges;
+    std::vector<std::pair<coordf_t,coordf_t>> thickness;
+    size_t edge_idx(const VD::edge_type* edge) const { return edge - &this->vd->edges().front(); }
     void process_edge_neighbors(const VD::edge_type* edge, ThickPolyline* polyline);
     bool validate_edge(const VD::edge_type* edge);
     const Line& retrieve_segment(const VD::cell_type* cell) const;
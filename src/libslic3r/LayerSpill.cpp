@@ -0,0 +1,415 @@
+#include "LayerSpill.hpp"
+
+#include "BoundingBox.hpp"
+#include "Exception.hpp"
+#include "ExtrusionEntityCollection.hpp"
+#include "Layer.hpp"
+#include "libslic3r_version.h"
+
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/filesystem/path.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <boost/log/trivial.hpp>
+#include <boost/nowide/cstdio.hpp>
+
+namespace Slic3r {
+
+namespace {
+
+// Tags of the serialized extrusion entities.
+enum SpillTag : uint8_t {
+    stCollection,
+    stPath,
+    stMultiPath,
+    stLoop,
+};
+
+template<typename T> inline void write_pod(std::string &out, const T &value)
+{
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template<typename T> inline T read_pod(const char *&in)
+{
+    T value;
+    memcpy(&value, in, sizeof(T));
+    in += sizeof(T);
+    return value;
+}
+
+void write_path(std::string &out, const ExtrusionPath &path)
+{
+    write_pod<uint8_t>(out, path.role());
+    write_pod<double>(out, path.mm3_per_mm);
+    write_pod<float>(out, path.width);
+    write_pod<float>(out, path.height);
+    write_pod<uint32_t>(out, uint32_t(path.polyline.points.size()));
+    out.append(reinterpret_cast<const char*>(path.polyline.points.data()), path.polyline.points.size() * sizeof(Point));
+}
+
+ExtrusionPath read_path(const char *&in)
+{
+    auto          role       = ExtrusionRole(read_pod<uint8_t>(in));
+    auto          mm3_per_mm = read_pod<double>(in);
+    auto          width      = read_pod<float>(in);
+    auto          height     = read_pod<float>(in);
+    ExtrusionPath path(role, mm3_per_mm, width, height);
+    auto          num_points = read_pod<uint32_t>(in);
+    path.polyline.points.resize(num_points);
+    memcpy(path.polyline.points.data(), in, num_points * sizeof(Point));
+    in += num_points * sizeof(Point);
+    return path;
+}
+
+void write_paths(std::string &out, const ExtrusionPaths &paths)
+{
+    write_pod<uint32_t>(out, uint32_t(paths.size()));
+    for (const ExtrusionPath &path : paths)
+        write_path(out, path);
+}
+
+ExtrusionPaths read_paths(const char *&in)
+{
+    ExtrusionPaths paths;
+    auto           num_paths = read_pod<uint32_t>(in);
+    paths.reserve(num_paths);
+    for (size_t i = 0; i < num_paths; ++ i)
+        paths.emplace_back(read_path(in));
+    return paths;
+}
+
+void write_collection(std::string &out, const ExtrusionEntityCollection &collection)
+{
+    write_pod<uint8_t>(out, collection.no_sort);
+    write_pod<uint32_t>(out, uint32_t(collection.entities.size()));
+    for (const ExtrusionEntity *ee : collection.entities) {
+        if (auto *path = dynamic_cast<const ExtrusionPath*>(ee)) {
+            write_pod<uint8_t>(out, stPath);
+            write_path(out, *path);
+        } else if (auto *multipath = dynamic_cast<const ExtrusionMultiPath*>(ee)) {
+            write_pod<uint8_t>(out, stMultiPath);
+            write_paths(out, multipath->paths);
+        } else if (auto *loop = dynamic_cast<const ExtrusionLoop*>(ee)) {
+            write_pod<uint8_t>(out, stLoop);
+            write_pod<uint8_t>(out, uint8_t(loop->loop_role()));
+            write_paths(out, loop->paths);
+        } else {
+            auto *sub_collection = dynamic_cast<const ExtrusionEntityCollection*>(ee);
+            assert(sub_collection != nullptr);
+            write_pod<uint8_t>(out, stCollection);
+            write_collection(out, *sub_collection);
+        }
+    }
+}
+
+void read_collection(const char *&in, ExtrusionEntityCollection &collection)
+{
+    assert(collection.entities.empty());
+    collection.no_sort = read_pod<uint8_t>(in) != 0;
+    auto num_entities = read_pod<uint32_t>(in);
+    collection.entities.reserve(num_entities);
+    for (size_t i = 0; i < num_entities; ++ i)
+        switch (read_pod<uint8_t>(in)) {
+        case stPath:
+            collection.entities.emplace_back(new ExtrusionPath(read_path(in)));
+            break;
+        case stMultiPath:
+            collection.entities.emplace_back(new ExtrusionMultiPath(read_paths(in)));
+            break;
+        case stLoop:
+        {
+            auto loop_role = ExtrusionLoopRole(read_pod<uint8_t>(in));
+            collection.entities.emplace_back(new ExtrusionLoop(read_paths(in), loop_role));
+            break;
+        }
+        default:
+        {
+            auto *sub_collection = new ExtrusionEntityCollection();
+            collection.entities.emplace_back(sub_collection);
+            read_collection(in, *sub_collection);
+        }
+        }
+}
+
+// Call fn on all the extrusion collections of a layer, which are consumed by the G-code export.
+template<typename LayerType, typename Fn>
+void foreach_layer_extrusions(LayerType &layer, Fn fn)
+{
+    for (auto *layerm : layer.regions()) {
+        fn(layerm->perimeters);
+        fn(layerm->fills);
+    }
+    using SupportLayerType = std::conditional_t<std::is_const<LayerType>::value, const SupportLayer, SupportLayer>;
+    if (auto *support_layer = dynamic_cast<SupportLayerType*>(&layer))
+        fn(support_layer->support_fills);
+}
+
+} // namespace
+
+size_t extrusions_memory_usage(const ExtrusionEntityCollection &extrusions)
+{
+    auto paths_memory_usage = [](const ExtrusionPaths &paths) {
+        size_t out = paths.capacity() * sizeof(ExtrusionPath);
+        for (const ExtrusionPath &path : paths)
+            out += path.polyline.points.capacity() * sizeof(Point);
+        return out;
+    };
+    size_t out = sizeof(ExtrusionEntityCollection) + extrusions.entities.capacity() * sizeof(ExtrusionEntity*);
+    for (const ExtrusionEntity *ee : extrusions.entities) {
+        if (auto *path = dynamic_cast<const ExtrusionPath*>(ee))
+            out += sizeof(ExtrusionPath) + path->polyline.points.capacity() * sizeof(Point);
+        else if (auto *multipath = dynamic_cast<const ExtrusionMultiPath*>(ee))
+            out += sizeof(ExtrusionMultiPath) + paths_memory_usage(multipath->paths);
+        else if (auto *loop = dynamic_cast<const ExtrusionLoop*>(ee))
+            out += sizeof(ExtrusionLoop) + paths_memory_usage(loop->paths);
+        else if (auto *collection = dynamic_cast<const ExtrusionEntityCollection*>(ee))
+            out += extrusions_memory_usage(*collection);
+    }
+    return out;
+}
+
+size_t layer_extrusions_memory_usage(const Layer &layer)
+{
+    size_t out = 0;
+    foreach_layer_extrusions(layer, [&out](const ExtrusionEntityCollection &extrusions) { out += extrusions_memory_usage(extrusions); });
+    return out;
+}
+
+bool layer_has_extrusions(const LayerSpill *layer_spill, const Layer &layer)
+{
+    return layer_spill ? layer_spill->has_extrusions(layer) : layer.has_extrusions();
+}
+
+LayerSpill::LayerSpill(size_t budget) : m_budget(budget)
+{
+    boost::filesystem::path path = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("." SLIC3R_APP_KEY ".layers.%%%%-%%%%-%%%%-%%%%");
+    m_path = path.string();
+    m_file = boost::nowide::fopen(m_path.c_str(), "wb");
+    if (m_file == nullptr)
+        throw Slic3r::RuntimeError(std::string("Cannot create the layer scratch file ") + m_path);
+    BOOST_LOG_TRIVIAL(debug) << "Layer scratch file created: " << m_path;
+}
+
+LayerSpill::~LayerSpill()
+{
+    this->close_mapping();
+    if (m_file != nullptr)
+        fclose(m_file);
+    boost::system::error_code ec;
+    boost::filesystem::remove(m_path, ec);
+    if (ec)
+        BOOST_LOG_TRIVIAL(error) << "Failed to remove the layer scratch file " << m_path << ": " << ec.message();
+}
+
+void LayerSpill::set_budget(size_t budget)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_budget = budget;
+}
+
+void LayerSpill::spill_over_budget(Layer &layer)
+{
+    // Measure and serialize the layer outside of the lock, the layer is only accessed by the calling slicing step.
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_layers.find(&layer) != m_layers.end())
+            return;
+    }
+    const size_t memory = layer_extrusions_memory_usage(layer);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto   it_resident = m_resident_layers.find(&layer);
+        size_t accounted   = it_resident == m_resident_layers.end() ? 0 : it_resident->second;
+        if (m_budget == 0 || m_resident - accounted + memory <= m_budget) {
+            // Keep the layer in memory.
+            m_resident = m_resident - accounted + memory;
+            m_resident_layers[&layer] = memory;
+            return;
+        }
+        if (it_resident != m_resident_layers.end()) {
+            m_resident -= accounted;
+            m_resident_layers.erase(it_resident);
+        }
+    }
+
+    std::string data;
+    foreach_layer_extrusions(layer, [&data](const ExtrusionEntityCollection &extrusions) { write_collection(data, extrusions); });
+    bool has_extrusions = layer.has_extrusions();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        // The records are appended, the mapping of the file is kept, it is only extended by the next read of a record past its end.
+        if (m_file == nullptr && (m_file = boost::nowide::fopen(m_path.c_str(), "ab")) == nullptr)
+            throw Slic3r::RuntimeError(std::string("Cannot open the layer scratch file ") + m_path);
+        if (fwrite(data.data(), 1, data.size(), m_file) != data.size() || fflush(m_file) != 0)
+            throw Slic3r::RuntimeError(std::string("Failed to write the layer scratch file ") + m_path);
+        m_layers[&layer] = { &layer, m_size, data.size(), has_extrusions, 0 };
+        m_size      += data.size();
+        m_live_size += data.size();
+    }
+
+    foreach_layer_extrusions(layer, [](ExtrusionEntityCollection &extrusions) { extrusions.clear(); });
+}
+
+void LayerSpill::unspill(Layer &layer)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_layers.find(&layer);
+    if (it == m_layers.end())
+        return;
+    assert(it->second.num_restored == 0);
+    if (it->second.size > 0) {
+        this->open_mapping(it->second.offset + it->second.size);
+        const char *in = m_mapping->data() + it->second.offset;
+        foreach_layer_extrusions(layer, [&in](ExtrusionEntityCollection &extrusions) { read_collection(in, extrusions); });
+        assert(in == m_mapping->data() + it->second.offset + it->second.size);
+    }
+    this->erase(it);
+}
+
+void LayerSpill::forget(const Layer &layer)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (auto it = m_layers.find(&layer); it != m_layers.end())
+        this->erase(it);
+    if (auto it = m_resident_layers.find(&layer); it != m_resident_layers.end()) {
+        m_resident -= it->second;
+        m_resident_layers.erase(it);
+    }
+}
+
+void LayerSpill::erase(std::unordered_map<const Layer*, SpilledLayer>::iterator it)
+{
+    m_live_size -= it->second.size;
+    m_layers.erase(it);
+    if (m_layers.empty() && m_size > 0) {
+        // No records remain, truncate the scratch file.
+        assert(m_live_size == 0);
+        this->close_mapping();
+        if (m_file != nullptr)
+            fclose(m_file);
+        if ((m_file = boost::nowide::fopen(m_path.c_str(), "wb")) == nullptr)
+            throw Slic3r::RuntimeError(std::string("Cannot truncate the layer scratch file ") + m_path);
+        m_size = 0;
+    }
+}
+
+void LayerSpill::restore(const Layer &layer)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_layers.find(&layer);
+    if (it == m_layers.end() || it->second.num_restored ++ > 0 || it->second.size == 0)
+        return;
+    this->open_mapping(it->second.offset + it->second.size);
+    const char *in = m_mapping->data() + it->second.offset;
+    foreach_layer_extrusions(*it->second.layer, [&in](ExtrusionEntityCollection &extrusions) { read_collection(in, extrusions); });
+    assert(in == m_mapping->data() + it->second.offset + it->second.size);
+}
+
+void LayerSpill::release(const Layer &layer)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_layers.find(&layer);
+    if (it == m_layers.end())
+        return;
+    assert(it->second.num_restored > 0);
+    if (-- it->second.num_restored == 0)
+        foreach_layer_extrusions(*it->second.layer, [](ExtrusionEntityCollection &extrusions) { extrusions.clear(); });
+}
+
+bool LayerSpill::spilled(const Layer &layer) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_layers.find(&layer) != m_layers.end();
+}
+
+bool LayerSpill::has_extrusions(const Layer &layer) const
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (auto it = m_layers.find(&layer); it != m_layers.end())
+            return it->second.has_extrusions;
+    }
+    return layer.has_extrusions();
+}
+
+size_t LayerSpill::size() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_size;
+}
+
+size_t LayerSpill::live_size() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_live_size;
+}
+
+void LayerSpill::compact()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // Keep the scratch file if at least half of it is live.
+    if (m_size - m_live_size <= m_live_size)
+        return;
+    assert(std::all_of(m_layers.begin(), m_layers.end(), [](const auto &kvp) { return kvp.second.num_restored == 0; }));
+    this->open_mapping(m_size);
+    boost::filesystem::path path = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("." SLIC3R_APP_KEY ".layers.%%%%-%%%%-%%%%-%%%%");
+    FILE *file = boost::nowide::fopen(path.string().c_str(), "wb");
+    if (file == nullptr)
+        throw Slic3r::RuntimeError(std::string("Cannot create the layer scratch file ") + path.string());
+    size_t size = 0;
+    for (auto &[layer, spilled] : m_layers) {
+        if (fwrite(m_mapping->data() + spilled.offset, 1, spilled.size, file) != spilled.size) {
+            fclose(file);
+            boost::system::error_code ec;
+            boost::filesystem::remove(path, ec);
+            throw Slic3r::RuntimeError(std::string("Failed to write the layer scratch file ") + path.string());
+        }
+        spilled.offset = size;
+        size += spilled.size;
+    }
+    assert(size == m_live_size);
+    BOOST_LOG_TRIVIAL(debug) << "Layer scratch file compacted from " << m_size << " to " << size << " bytes: " << path.string();
+    this->close_mapping();
+    if (m_file != nullptr)
+        fclose(m_file);
+    boost::system::error_code ec;
+    boost::filesystem::remove(m_path, ec);
+    m_path = path.string();
+    m_file = file;
+    m_size = size;
+}
+
+void LayerSpill::open_mapping(size_t size)
+{
+    assert(size <= m_size);
+    if (m_mapping) {
+        if (m_mapping->size() >= size)
+            return;
+        // The records were appended past the end of the mapping.
+        this->close_mapping();
+    }
+    if (m_file != nullptr)
+        fflush(m_file);
+    m_mapping = std::make_unique<boost::iostreams::mapped_file_source>();
+    try {
+        m_mapping->open(m_path);
+    } catch (const std::exception &ex) {
+        m_mapping.reset();
+        throw Slic3r::RuntimeError(std::string("Cannot map the layer scratch file ") + m_path + ": " + ex.what());
+    }
+}
+
+void LayerSpill::close_mapping()
+{
+    if (m_mapping) {
+        m_mapping->close();
+        m_mapping.reset();
+    }
+}
+
+} // namespace Slic3r
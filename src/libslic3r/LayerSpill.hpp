@@ -0,0 +1,135 @@
+#ifndef slic3r_LayerSpill_hpp_
+#define slic3r_LayerSpill_hpp_
+
+#include "libslic3r.h"
+
+#include <cstdio>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace boost { namespace iostreams { class mapped_file_source; } }
+
+namespace Slic3r {
+
+class ExtrusionEntityCollection;
+class Layer;
+
+// Approximate heap memory occupied by an extrusion collection, including the collection itself.
+size_t extrusions_memory_usage(const ExtrusionEntityCollection &extrusions);
+// Approximate heap memory occupied by the extrusions of a layer: Perimeters and fills of its regions, support extrusions.
+size_t layer_extrusions_memory_usage(const Layer &layer);
+
+// Scratch file storing the extrusions of the sliced layers over a memory budget.
+// The slicing steps modifying the extrusions of a layer (perimeters, infill, ironing) load the layer back with unspill()
+// if it was spilled by a previous slicing run. Once the last step producing the extrusions of a layer is done (ironing
+// for the object layers, support generation for the support layers), the layer is handed over to spill_over_budget().
+// The layer is kept in memory while the extrusions of all the layers kept in memory fit the budget, otherwise its extrusions
+// are serialized into the scratch file and released. The steps reading the extrusions after slicing (tool ordering, skirt,
+// brim, preview, G-code export) load the spilled layers back one by one with restore() / release(), see RestoredLayers.
+// The records of the layers loaded back for good or deleted are superseded, the scratch file is truncated once no records
+// remain and it is compacted by compact(). The scratch file is memory mapped for reading and it is deleted together with the LayerSpill.
+// Thread safe, the layers are spilled and restored by the parallel slicing steps.
+class LayerSpill
+{
+public:
+    // budget: Bytes of extrusions kept in memory, zero keeps all the layers in memory.
+    explicit LayerSpill(size_t budget);
+    ~LayerSpill();
+
+    size_t  budget() const { return m_budget; }
+    // The layers already spilled stay spilled, the new budget applies to the layers handed over to spill_over_budget() later on.
+    void    set_budget(size_t budget);
+
+    // To be called once the last slicing step producing the extrusions of a layer is done. No-op if the layer is spilled already.
+    // Keep the layer in memory if it fits the budget, otherwise serialize its extrusions into the scratch file and release them.
+    void    spill_over_budget(Layer &layer);
+    // Load the extrusions of a spilled layer back to memory for good, before a slicing step modifies them
+    // or before they are referenced by pointers (wiping into infill or objects). No-op if the layer is not spilled.
+    void    unspill(Layer &layer);
+    // Drop a layer, which is being deleted, or whose extrusions are being regenerated from scratch.
+    void    forget(const Layer &layer);
+
+    // Load the extrusions of a spilled layer back from the scratch file to be read. No-op if the layer is not spilled.
+    // Reference counted, the layer may be restored by multiple readers at the same time.
+    void    restore(const Layer &layer);
+    // Release the extrusions of a restored layer from memory once its last reader is done. They are still stored in the scratch file.
+    void    release(const Layer &layer);
+
+    bool    spilled(const Layer &layer) const;
+    // Does the layer have any extrusions, either in memory or in the scratch file?
+    bool    has_extrusions(const Layer &layer) const;
+    // Number of bytes of the scratch file, including the superseded records.
+    size_t  size() const;
+    // Number of bytes of the records of the spilled layers.
+    size_t  live_size() const;
+    // Rewrite the records of the spilled layers into a new scratch file if most of the scratch file is superseded.
+    // To be called at the start of a slicing run, when no layers are restored.
+    void    compact();
+
+private:
+    struct SpilledLayer {
+        Layer  *layer;
+        size_t  offset;
+        size_t  size;
+        bool    has_extrusions;
+        // Number of readers of a restored layer.
+        size_t  num_restored;
+    };
+
+    // Map the scratch file for reading, so that the mapping covers at least the first size bytes.
+    void    open_mapping(size_t size);
+    void    close_mapping();
+    // Drop the record of a spilled layer, truncate the scratch file if no records remain.
+    void    erase(std::unordered_map<const Layer*, SpilledLayer>::iterator it);
+
+    size_t                                                    m_budget;
+    mutable std::mutex                                        m_mutex;
+    std::string                                               m_path;
+    FILE                                                     *m_file { nullptr };
+    size_t                                                    m_size { 0 };
+    size_t                                                    m_live_size { 0 };
+    std::unique_ptr<boost::iostreams::mapped_file_source>    m_mapping;
+    std::unordered_map<const Layer*, SpilledLayer>            m_layers;
+    // Layers kept in memory and the bytes of their extrusions accounted against the budget.
+    std::unordered_map<const Layer*, size_t>                  m_resident_layers;
+    size_t                                                    m_resident { 0 };
+};
+
+// Keeps the extrusions of spilled layers loaded for the lifetime of this object. The layers not spilled and null layers are ignored.
+class RestoredLayers
+{
+public:
+    RestoredLayers(LayerSpill *layer_spill, std::initializer_list<const Layer*> layers) : m_layer_spill(layer_spill) { this->restore(layers.begin(), layers.end()); }
+    RestoredLayers(LayerSpill *layer_spill, const std::vector<const Layer*> &layers) : m_layer_spill(layer_spill) { this->restore(layers.begin(), layers.end()); }
+    ~RestoredLayers() {
+        for (const Layer *layer : m_layers)
+            m_layer_spill->release(*layer);
+    }
+    RestoredLayers(const RestoredLayers &) = delete;
+    RestoredLayers& operator=(const RestoredLayers &) = delete;
+
+private:
+    template<typename It>
+    void restore(It begin, It end) {
+        if (m_layer_spill)
+            for (It it = begin; it != end; ++ it)
+                if (const Layer *layer = *it; layer) {
+                    m_layer_spill->restore(*layer);
+                    m_layers.emplace_back(layer);
+                }
+    }
+
+    LayerSpill                 *m_layer_spill;
+    std::vector<const Layer*>   m_layers;
+};
+
+// Does the layer have any extrusions, either in memory or spilled? layer_spill may be null.
+bool layer_has_extrusions(const LayerSpill *layer_spill, const Layer &layer);
+
+} // namespace Slic3r
+
+#endif /* slic3r_LayerSpill_hpp_ */
@@ -17,6 +17,7 @@
 
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/algorithm/string/replace.hpp>
+#include <boost/functional/hash.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/log/trivial.hpp>
 #include <boost/nowide/iostream.hpp>
@@ -1639,6 +1640,7 @@ void ModelVolume::center_geometry_after_creation(bool update_source_offset)
     {
     	if (m_mesh)
         	const_cast<TriangleMesh*>(m_mesh.get())->translate(-(float)shift(0), -(float)shift(1), -(float)shift(2));
+        m_mesh_hash_mesh.reset();
         if (m_convex_hull)
 			const_cast<TriangleMesh*>(m_convex_hull.get())->translate(-(float)shift(0), -(float)shift(1), -(float)shift(2));
         translate(shift);
@@ -1810,11 +1812,27 @@ void ModelVolume::mirror(Axis axis)
     set_mirror(mirror);
 }
 
+size_t ModelVolume::mesh_hash() const
+{
+    if (m_mesh_hash_mesh.expired() || m_mesh_hash_mesh.lock() != m_mesh) {
+        const indexed_triangle_set &its = m_mesh->its;
+        size_t seed = 0;
+        if (! its.vertices.empty())
+            boost::hash_range(seed, its.vertices.front().data(), its.vertices.front().data() + 3 * its.vertices.size());
+        if (! its.indices.empty())
+            boost::hash_range(seed, its.indices.front().data(), its.indices.front().data() + 3 * its.indices.size());
+        m_mesh_hash      = seed;
+        m_mesh_hash_mesh = m_mesh;
+    }
+    return m_mesh_hash;
+}
+
 // This method could only be called before the meshes of this ModelVolumes are not shared!
 void ModelVolume::scale_geometry_after_creation(const Vec3d& versor)
 {
 	const_cast<TriangleMesh*>(m_mesh.get())->scale(versor);
 	const_cast<TriangleMesh*>(m_convex_hull.get())->scale(versor);
+	m_mesh_hash_mesh.reset();
 }
 
 void ModelVolume::transform_this_mesh(const Transform3d &mesh_trafo, bool fix_left_handed)
@@ -1952,21 +1970,65 @@ indexed_triangle_set FacetsAnnotation::get_facets(const ModelVolume& mv, Enforce
 
 bool FacetsAnnotation::set(const TriangleSelector& selector)
 {
-    std::map<int, std::vector<bool>> sel_map = selector.serialize();
-    if (sel_map != m_data) {
-        m_data = sel_map;
+    const std::map<int, std::vector<bool>> &sel_map = selector.serialize();
+    std::vector<int>                        touched;
+    if (! selector.take_touched_triangles(touched)) {
+        // The selector was reset or loaded with a non-default state, compare and copy all of it.
+        if (sel_map != m_data) {
+            m_data = sel_map;
+            m_data_hash_valid = false;
+            this->touch();
+            return true;
+        }
+        return false;
+    }
+    // The selector was loaded from m_data, patch just the triangles touched since then.
+    bool changed = false;
+    for (int triangle_id : touched) {
+        auto it_sel  = sel_map.find(triangle_id);
+        auto it_data = m_data.find(triangle_id);
+        if (it_sel == sel_map.end()) {
+            if (it_data != m_data.end()) {
+                m_data.erase(it_data);
+                changed = true;
+            }
+        } else if (it_data == m_data.end()) {
+            m_data.emplace(triangle_id, it_sel->second);
+            changed = true;
+        } else if (it_data->second != it_sel->second) {
+            it_data->second = it_sel->second;
+            changed = true;
+        }
+    }
+    assert(m_data == sel_map);
+    if (changed) {
+        m_data_hash_valid = false;
         this->touch();
-        return true;
     }
-    return false;
+    return changed;
 }
 
 void FacetsAnnotation::clear()
 {
     m_data.clear();
+    m_data_hash_valid = false;
     this->reset_timestamp();
 }
 
+size_t FacetsAnnotation::data_hash() const
+{
+    if (! m_data_hash_valid) {
+        size_t seed = 0;
+        for (const auto &[triangle_id, code] : m_data) {
+            boost::hash_combine(seed, triangle_id);
+            boost::hash_combine(seed, std::hash<std::vector<bool>>()(code));
+        }
+        m_data_hash       = seed;
+        m_data_hash_valid = true;
+    }
+    return m_data_hash;
+}
+
 // Following function takes data from a triangle and encodes it as string
 // of hexadecimal numbers (one digit per triangle). Used for 3MF export,
 // changing it may break backwards compatibility !!!!!
@@ -1999,6 +2061,7 @@ std::string FacetsAnnotation::get_triangle_as_string(int triangle_idx) const
 void FacetsAnnotation::set_triangle_from_string(int triangle_id, const std::string& str)
 {
     assert(! str.empty());
+    m_data_hash_valid = false;
     m_data[triangle_id] = std::vector<bool>(); // zero current state or create new
     std::vector<bool>& code = m_data[triangle_id];
 
@@ -510,9 +510,14 @@ enum class ConversionType : int {
 class FacetsAnnotation final : public ObjectWithTimestamp {
 public:
     // Assign the content if the timestamp differs, don't assign an ObjectID.
-    void assign(const FacetsAnnotation& rhs) { if (! this->timestamp_matches(rhs)) { m_data = rhs.m_data; this->copy_timestamp(rhs); } }
-    void assign(FacetsAnnotation&& rhs) { if (! this->timestamp_matches(rhs)) { m_data = std::move(rhs.m_data); this->copy_timestamp(rhs); } }
+    void assign(const FacetsAnnotation& rhs) { if (! this->timestamp_matches(rhs)) { m_data = rhs.m_data; this->copy_data_hash(rhs); this->copy_timestamp(rhs); } }
+    void assign(FacetsAnnotation&& rhs) { if (! this->timestamp_matches(rhs)) { m_data = std::move(rhs.m_data); this->copy_data_hash(rhs); this->copy_timestamp(rhs); } }
     const std::map<int, std::vector<bool>>& get_data() const throw() { return m_data; }
+    // Hash of get_data(), calculated on demand and cached until the data change. Equal data have equal hashes,
+    // thus the hashes are compared first to avoid comparing the data of differently painted volumes.
+    size_t data_hash() const;
+    // Update from the selector, which was loaded from get_data() of this annotation. Only the triangles
+    // touched since then are compared and copied. Returns true if the data changed.
     bool set(const TriangleSelector& selector);
     indexed_triangle_set get_facets(const ModelVolume& mv, EnforcerBlockerType type) const;
     bool empty() const { return m_data.empty(); }
@@ -542,9 +547,14 @@ private:
     template<class Archive> void serialize(Archive &ar)
     {
         ar(cereal::base_class<ObjectWithTimestamp>(this), m_data);
+        m_data_hash_valid = false;
     }
 
+    void copy_data_hash(const FacetsAnnotation &rhs) { m_data_hash = rhs.m_data_hash; m_data_hash_valid = rhs.m_data_hash_valid; }
+
     std::map<int, std::vector<bool>> m_data;
+    mutable size_t                   m_data_hash { 0 };
+    mutable bool                     m_data_hash_valid { false };
 
     // To access set_new_unique_id() when copy / pasting a ModelVolume.
     friend class ModelVolume;
@@ -577,6 +587,9 @@ public:
 
     // The triangular model.
     const TriangleMesh& mesh() const { return *m_mesh.get(); }
+    // Hash of the vertices and indices of the mesh, calculated on demand and cached until the mesh is replaced or modified.
+    // Equal meshes have equal hashes, thus the hashes are compared first to avoid comparing the content of different meshes.
+    size_t              mesh_hash() const;
     void                set_mesh(const TriangleMesh &mesh) { m_mesh = std::make_shared<const TriangleMesh>(mesh); }
     void                set_mesh(TriangleMesh &&mesh) { m_mesh = std::make_shared<const TriangleMesh>(std::move(mesh)); }
     void                set_mesh(std::shared_ptr<const TriangleMesh> &mesh) { m_mesh = mesh; }
@@ -717,6 +730,9 @@ private:
     //      0   ->   is not splittable
     //      1   ->   is splittable
     mutable int               		m_is_splittable{ -1 };
+    // Cached mesh_hash() and the mesh it was calculated for.
+    mutable std::weak_ptr<const TriangleMesh> m_mesh_hash_mesh;
+    mutable size_t                  	m_mesh_hash{ 0 };
 
 	ModelVolume(ModelObject *object, const TriangleMesh &mesh, ModelVolumeType type = ModelVolumeType::MODEL_PART) : m_mesh(new TriangleMesh(mesh)), m_type(type), object(object)
     {
@@ -750,6 +766,7 @@ private:
         ObjectBase(other),
         name(other.name), source(other.source), m_mesh(other.m_mesh), m_convex_hull(other.m_convex_hull),
         config(other.config), m_type(other.m_type), object(object), m_transformation(other.m_transformation),
+        m_mesh_hash_mesh(other.m_mesh_hash_mesh), m_mesh_hash(other.m_mesh_hash),
         supported_facets(other.supported_facets), seam_facets(other.seam_facets), mmu_segmentation_facets(other.mmu_segmentation_facets)
     {
 		assert(this->id().valid()); 
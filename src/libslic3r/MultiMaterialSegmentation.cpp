@@ -12,6 +12,7 @@
 #include <boost/log/trivial.hpp>
 
 #include <tbb/parallel_for.h>
+#include <tbb/enumerable_thread_specific.h>
 
 #include <boost/geometry.hpp>
 #include <boost/geometry/geometries/point.hpp>
@@ -617,11 +618,30 @@ namespace bg  = boost::geometry;
 namespace bgm = boost::geometry::model;
 namespace bgi = boost::geometry::index;
 
-// float is needed because for coord_t bgi::intersects throws "bad numeric conversion: positive overflow"
-using rtree_point_t = bgm::point<float, 2, boost::geometry::cs::cartesian>;
-using rtree_t       = bgi::rtree<std::pair<rtree_point_t, size_t>, bgi::rstar<16, 4>>;
+// double is needed because for coord_t bgi::intersects throws "bad numeric conversion: positive overflow"
+using rtree_point_t   = bgm::point<double, 2, boost::geometry::cs::cartesian>;
+using rtree_segment_t = bgm::segment<rtree_point_t>;
+using rtree_box_t     = bgm::box<rtree_point_t>;
 
-static inline rtree_point_t mk_rtree_point(const Point &pt) { return rtree_point_t(float(pt.x()), float(pt.y())); }
+// Item of the spatial index used for merging Voronoi vertices with contour points and with each other.
+// Contour lines are stored with the index of the contour and the index of the line's first point inside the contour.
+// Voronoi vertices already inserted into MMU_Graph are stored as degenerated segments with contour_idx == size_t(-1)
+// and with point_idx set to the index of the node inside MMU_Graph.
+struct MMU_Graph_RtreeItem
+{
+    size_t contour_idx;
+    size_t point_idx;
+
+    bool is_contour_line() const { return this->contour_idx != size_t(-1); }
+};
+
+using rtree_t = bgi::rtree<std::pair<rtree_segment_t, MMU_Graph_RtreeItem>, bgi::rstar<16, 4>>;
+
+static inline rtree_point_t mk_rtree_point(const Point &pt) { return rtree_point_t(double(pt.x()), double(pt.y())); }
+
+static inline rtree_segment_t mk_rtree_segment(const Point &a, const Point &b) { return rtree_segment_t(mk_rtree_point(a), mk_rtree_point(b)); }
+
+static inline Point mk_point(const rtree_point_t &pt) { return Point(coord_t(bg::get<0>(pt)), coord_t(bg::get<1>(pt))); }
 
 static inline Point mk_point(const Voronoi::VD::vertex_type *point) { return Point(coord_t(point->x()), coord_t(point->y())); }
 
@@ -686,9 +706,9 @@ static inline void init_polygon_indices(const MMU_Graph
     }
 }
 
-static MMU_Graph build_graph(size_t layer_idx, const std::vector<std::vector<ColoredLine>> &color_poly)
+// Voronoi diagram is passed from the caller to allow reusing of its internal buffers between layers processed by the same thread.
+static MMU_Graph build_graph(size_t layer_idx, const std::vector<std::vector<ColoredLine>> &color_poly, Geometry::VoronoiDiagram &vd)
 {
-    Geometry::VoronoiDiagram vd;
     std::vector<ColoredLine> lines_colored  = to_lines(color_poly);
     Polygons                 color_poly_tmp = colored_points_to_polygon(color_poly);
     const Points             points         = to_points(color_poly_tmp);
@@ -712,6 +732,8 @@ static MMU_Graph build_graph(size_t layer_idx, const std::vector<std::vector<Col
         force_edge_adding[&c_poly - &color_poly.front()] = force_edge;
     }
 
+    // construct_voronoi() doesn't clear the output, it only appends to it.
+    vd.clear();
     boost::polygon::construct_voronoi(lines_colored.begin(), lines_colored.end(), &vd);
     MMU_Graph graph;
     for (const Point &point : points)
@@ -729,12 +751,25 @@ static MMU_Graph build_graph(size_t layer_idx, const std::vector<std::vector<Col
 
         BoundingBox bbox = get_extents(color_poly_tmp);
         bbox.offset(SCALED_EPSILON);
-        // EdgeGrid is used for vertices near to contour and rtree for other vertices
-        // FIXME Lukas H.: Get rid of EdgeGrid and rtree. Use only one structure for both cases.
-        EdgeGrid::Grid grid;
-        grid.set_bbox(bbox);
-        grid.create(color_poly_tmp, coord_t(scale_(10.)));
+        // A single R-tree is used both for vertices near to contour (indexed by contour lines)
+        // and for other vertices (indexed by already inserted Voronoi vertices).
+        // Contour lines take precedence over already inserted Voronoi vertices.
         rtree_t rtree;
+        {
+            std::vector<std::pair<rtree_segment_t, MMU_Graph_RtreeItem>> contour_lines;
+            contour_lines.reserve(graph.all_border_points);
+            for (size_t contour_idx = 0; contour_idx < color_poly_tmp.size(); ++contour_idx) {
+                const Points &contour_pts = color_poly_tmp[contour_idx].points;
+                for (size_t point_idx = 0; point_idx < contour_pts.size(); ++point_idx)
+                    contour_lines.emplace_back(mk_rtree_segment(contour_pts[point_idx], contour_pts[(point_idx + 1) % contour_pts.size()]),
+                                               MMU_Graph_RtreeItem{contour_idx, point_idx});
+            }
+            // Packing (bulk loading) constructor.
+            rtree = rtree_t(contour_lines.begin(), contour_lines.end());
+        }
+
+        const double search_radius = 3 * SCALED_EPSILON;
+        std::vector<std::pair<rtree_segment_t, MMU_Graph_RtreeItem>> candidates;
         for (const voronoi_diagram<double>::vertex_type &vertex : vd.vertices()) {
             vertex.color(-1);
             Point vertex_point = mk_point(vertex);
@@ -751,31 +786,39 @@ static MMU_Graph build_graph(size_t layer_idx, const std::vector<std::vector<Col
                 assert(vertex.color() != vertex.incident_edge()->twin()->cell()->source_index());
                 vertex.color(graph.get_arc(vertex.incident_edge()->twin()->cell()->source_index()).from_idx);
             } else if (bbox.contains(vertex_point)) {
-                EdgeGrid::Grid::ClosestPointResult cp = grid.closest_point_signed_distance(vertex_point, coord_t(3 * SCALED_EPSILON));
-                if (cp.valid()) {
-                    size_t global_idx      = graph.get_global_index(cp.contour_idx, cp.start_point_idx);
-                    size_t global_idx_next = graph.get_global_index(cp.contour_idx, (cp.start_point_idx + 1) % color_poly_tmp[cp.contour_idx].points.size());
-                    vertex.color(is_equal_points(vertex_point, graph.nodes[global_idx].point) ? global_idx : global_idx_next);
-                } else {
-                    if (rtree.empty()) {
-                        rtree.insert(std::make_pair(mk_rtree_point(vertex_point), graph.nodes_count()));
-                        vertex.color(graph.nodes_count());
-                        graph.nodes.push_back({vertex_point});
-                    } else {
-                        std::vector<std::pair<rtree_point_t, size_t>> closest;
-                        rtree.query(bgi::nearest(mk_rtree_point(vertex_point), 1), std::back_inserter(closest));
-                        assert(!closest.empty());
-                        rtree_point_t r_point = closest.front().first;
-                        Point         closest_p(bg::get<0>(r_point), bg::get<1>(r_point));
-                        if (Line(vertex_point, closest_p).length() > 3 * SCALED_EPSILON) {
-                            rtree.insert(std::make_pair(mk_rtree_point(vertex_point), graph.nodes_count()));
-                            vertex.color(graph.nodes_count());
-                            graph.nodes.push_back({vertex_point});
-                        } else {
-                            vertex.color(closest.front().second);
+                candidates.clear();
+                rtree.query(bgi::intersects(rtree_box_t(rtree_point_t(vertex_point.x() - search_radius, vertex_point.y() - search_radius),
+                                                        rtree_point_t(vertex_point.x() + search_radius, vertex_point.y() + search_radius))),
+                            std::back_inserter(candidates));
+
+                // Find the closest contour line (strictly inside the search radius) and the closest Voronoi vertex (inside the search radius).
+                const MMU_Graph_RtreeItem *closest_contour_line = nullptr;
+                const MMU_Graph_RtreeItem *closest_vertex       = nullptr;
+                double                     contour_line_dist    = search_radius;
+                double                     vertex_dist          = search_radius;
+                for (const std::pair<rtree_segment_t, MMU_Graph_RtreeItem> &candidate : candidates) {
+                    if (candidate.second.is_contour_line()) {
+                        if (double dist = Line(mk_point(candidate.first.first), mk_point(candidate.first.second)).distance_to(vertex_point); dist < contour_line_dist) {
+                            contour_line_dist    = dist;
+                            closest_contour_line = &candidate.second;
                         }
+                    } else if (double dist = (mk_point(candidate.first.first) - vertex_point).cast<double>().norm(); dist <= vertex_dist) {
+                        vertex_dist    = dist;
+                        closest_vertex = &candidate.second;
                     }
                 }
+
+                if (closest_contour_line != nullptr) {
+                    size_t global_idx      = graph.get_global_index(closest_contour_line->contour_idx, closest_contour_line->point_idx);
+                    size_t global_idx_next = graph.get_global_index(closest_contour_line->contour_idx, (closest_contour_line->point_idx + 1) % color_poly_tmp[closest_contour_line->contour_idx].points.size());
+                    vertex.color(is_equal_points(vertex_point, graph.nodes[global_idx].point) ? global_idx : global_idx_next);
+                } else if (closest_vertex != nullptr) {
+                    vertex.color(closest_vertex->point_idx);
+                } else {
+                    rtree.insert(std::make_pair(mk_rtree_segment(vertex_point, vertex_point), MMU_Graph_RtreeItem{size_t(-1), graph.nodes_count()}));
+                    vertex.color(graph.nodes_count());
+                    graph.nodes.push_back({vertex_point});
+                }
             }
         }
     };
@@ -1390,11 +1433,16 @@ static std::vector<std::vector<std::pair<ExPolygon, size_t>>> merge_segmented_la
     return segmented_regions_merged;
 }
 
+// Painted facet transformed into the print object coordinate system with vertices sorted by z-axis.
+struct PaintedFacet
+{
+    std::array<Vec3f, 3> vertices;
+    int                  color;
+};
+
 std::vector<std::vector<std::pair<ExPolygon, size_t>>> multi_material_segmentation_by_painting(const PrintObject &print_object, const std::function<void()> &throw_on_cancel_callback)
 {
     std::vector<std::vector<std::pair<ExPolygon, size_t>>> segmented_regions(print_object.layers().size());
-    std::vector<std::vector<PaintedLine>>                  painted_lines(print_object.layers().size());
-    std::vector<EdgeGrid::Grid>                            edge_grids(print_object.layers().size());
     const ConstLayerPtrsAdaptor                            layers = print_object.layers();
     std::vector<ExPolygons>                                input_expolygons(layers.size());
     std::vector<Polygons>                                  input_polygons(layers.size());
@@ -1426,14 +1474,10 @@ std::vector<std::vector<std::pair<ExPolygon, size_t>>> multi_material_segmentati
         }
     }); // end of parallel_for
 
-    for (size_t layer_idx = 0; layer_idx < layers.size(); ++layer_idx) {
-        throw_on_cancel_callback();
-        BoundingBox  bbox(get_extents(input_expolygons[layer_idx]));
-        bbox.offset(SCALED_EPSILON);
-        edge_grids[layer_idx].set_bbox(bbox);
-        edge_grids[layer_idx].create(input_expolygons[layer_idx], coord_t(scale_(10.)));
-    }
-
+    // Collect all painted facets and assign each of them to the layers intersecting its Z range,
+    // so that each layer is projected only with the facets that span it.
+    std::vector<PaintedFacet>        painted_facets;
+    std::vector<std::vector<size_t>> painted_facets_by_layer(layers.size());
     for (const ModelVolume *mv : print_object.model_object()->volumes) {
         const size_t num_extruders = print_object.print()->config().nozzle_diameter.size();
         for (size_t extruder_idx = 1; extruder_idx < num_extruders; ++extruder_idx) {
@@ -1444,70 +1488,83 @@ std::vector<std::vector<std::pair<ExPolygon, size_t>>> multi_material_segmentati
 
             const Transform3f tr = print_object.trafo().cast<float>() * mv->get_matrix().cast<float>();
             for (size_t facet_idx = 0; facet_idx < custom_facets.indices.size(); ++facet_idx) {
-                float min_z = std::numeric_limits<float>::max();
-                float max_z = std::numeric_limits<float>::lowest();
-
                 std::array<Vec3f, 3> facet;
-                for (int p_idx = 0; p_idx < 3; ++p_idx) {
+                for (int p_idx = 0; p_idx < 3; ++p_idx)
                     facet[p_idx] = tr * custom_facets.vertices[custom_facets.indices[facet_idx](p_idx)];
-                    max_z        = std::max(max_z, facet[p_idx].z());
-                    min_z        = std::min(min_z, facet[p_idx].z());
-                }
 
                 // Sort the vertices by z-axis for simplification of projected_facet on slices
                 std::sort(facet.begin(), facet.end(), [](const Vec3f &p1, const Vec3f &p2) { return p1.z() < p2.z(); });
 
                 // Find lowest slice not below the triangle.
-                auto first_layer = std::upper_bound(print_object.layers().begin(), print_object.layers().end(), float(min_z - EPSILON),
+                auto first_layer = std::upper_bound(layers.begin(), layers.end(), float(facet[0].z() - EPSILON),
                                                     [](float z, const Layer *l1) { return z < l1->slice_z; });
-                auto last_layer  = std::upper_bound(print_object.layers().begin(), print_object.layers().end(), float(max_z + EPSILON),
-                                                   [](float z, const Layer *l1) { return z < l1->slice_z; });
-                --last_layer;
-
-                for (auto layer_it = first_layer; layer_it != (last_layer + 1); ++layer_it) {
-                    const Layer *layer     = *layer_it;
-                    size_t       layer_idx = layer_it - print_object.layers().begin();
-                    if (facet[0].z() > layer->slice_z || layer->slice_z > facet[2].z())
-                        continue;
-
-                    // https://kandepet.com/3d-printing-slicing-3d-objects/
-                    float t            = (float(layer->slice_z) - facet[0].z()) / (facet[2].z() - facet[0].z());
-                    Vec3f line_start_f = facet[0] + t * (facet[2] - facet[0]);
-                    Vec3f line_end_f;
-
-                    if (facet[1].z() > layer->slice_z) {
-                        // [P0, P2] a [P0, P1]
-                        float t1   = (float(layer->slice_z) - facet[0].z()) / (facet[1].z() - facet[0].z());
-                        line_end_f = facet[0] + t1 * (facet[1] - facet[0]);
-                    } else if (facet[1].z() <= layer->slice_z) {
-                        // [P0, P2] a [P1, P2]
-                        float t2   = (float(layer->slice_z) - facet[1].z()) / (facet[2].z() - facet[1].z());
-                        line_end_f = facet[1] + t2 * (facet[2] - facet[1]);
-                    }
+                auto last_layer  = std::upper_bound(layers.begin(), layers.end(), float(facet[2].z() + EPSILON),
+                                                    [](float z, const Layer *l1) { return z < l1->slice_z; });
+                if (first_layer == last_layer)
+                    continue;
 
-                    Point line_start(scale_(line_start_f.x()), scale_(line_start_f.y()));
-                    Point line_end(scale_(line_end_f.x()), scale_(line_end_f.y()));
-                    line_start -= print_object.center_offset();
-                    line_end   -= print_object.center_offset();
-
-                    PaintedLineVisitor       visitor(edge_grids[layer_idx], painted_lines[layer_idx], 16);
-                    visitor.reset();
-                    visitor.line_to_test.a = line_start;
-                    visitor.line_to_test.b = line_end;
-                    visitor.color          = int(extruder_idx);
-                    edge_grids[layer_idx].visit_cells_intersecting_line(line_start, line_end, visitor);
-                }
+                const size_t painted_facet_idx = painted_facets.size();
+                painted_facets.push_back({facet, int(extruder_idx)});
+                for (auto layer_it = first_layer; layer_it != last_layer; ++layer_it)
+                    painted_facets_by_layer[layer_it - layers.begin()].emplace_back(painted_facet_idx);
             }
         }
     }
 
-    tbb::parallel_for(tbb::blocked_range<size_t>(0, print_object.layers().size()), [&](const tbb::blocked_range<size_t> &range) {
+    // Voronoi diagrams are reused between layers processed by the same thread to avoid reallocation of their buffers.
+    tbb::enumerable_thread_specific<Geometry::VoronoiDiagram> voronoi_diagrams;
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, layers.size()), [&](const tbb::blocked_range<size_t> &range) {
         for (size_t layer_idx = range.begin(); layer_idx < range.end(); ++layer_idx) {
             throw_on_cancel_callback();
-            //    for(size_t layer_idx = 0; layer_idx < print_object.layers().size(); ++layer_idx) {
+            if (painted_facets_by_layer[layer_idx].empty())
+                continue;
+
             BOOST_LOG_TRIVIAL(debug) << "MMU segmentation of layer: " << layer_idx;
-            auto comp = [&edge_grids, layer_idx](const PaintedLine &first, const PaintedLine &second) {
-                Point first_start_p = *(edge_grids[layer_idx].contours()[first.contour_idx].begin() + first.line_idx);
+            const Layer   *layer = layers[layer_idx];
+            EdgeGrid::Grid edge_grid;
+            {
+                BoundingBox bbox(get_extents(input_expolygons[layer_idx]));
+                bbox.offset(SCALED_EPSILON);
+                edge_grid.set_bbox(bbox);
+                edge_grid.create(input_expolygons[layer_idx], coord_t(scale_(10.)));
+            }
+
+            std::vector<PaintedLine> painted_lines;
+            PaintedLineVisitor       visitor(edge_grid, painted_lines, 16);
+            for (size_t painted_facet_idx : painted_facets_by_layer[layer_idx]) {
+                const std::array<Vec3f, 3> &facet = painted_facets[painted_facet_idx].vertices;
+                if (facet[0].z() > layer->slice_z || layer->slice_z > facet[2].z())
+                    continue;
+
+                // https://kandepet.com/3d-printing-slicing-3d-objects/
+                float t            = (float(layer->slice_z) - facet[0].z()) / (facet[2].z() - facet[0].z());
+                Vec3f line_start_f = facet[0] + t * (facet[2] - facet[0]);
+                Vec3f line_end_f;
+
+                if (facet[1].z() > layer->slice_z) {
+                    // [P0, P2] a [P0, P1]
+                    float t1   = (float(layer->slice_z) - facet[0].z()) / (facet[1].z() - facet[0].z());
+                    line_end_f = facet[0] + t1 * (facet[1] - facet[0]);
+                } else if (facet[1].z() <= layer->slice_z) {
+                    // [P0, P2] a [P1, P2]
+                    float t2   = (float(layer->slice_z) - facet[1].z()) / (facet[2].z() - facet[1].z());
+                    line_end_f = facet[1] + t2 * (facet[2] - facet[1]);
+                }
+
+                Point line_start(scale_(line_start_f.x()), scale_(line_start_f.y()));
+                Point line_end(scale_(line_end_f.x()), scale_(line_end_f.y()));
+                line_start -= print_object.center_offset();
+                line_end   -= print_object.center_offset();
+
+                visitor.reset();
+                visitor.line_to_test.a = line_start;
+                visitor.line_to_test.b = line_end;
+                visitor.color          = painted_facets[painted_facet_idx].color;
+                edge_grid.visit_cells_intersecting_line(line_start, line_end, visitor);
+            }
+
+            auto comp = [&edge_grid](const PaintedLine &first, const PaintedLine &second) {
+                Point first_start_p = *(edge_grid.contours()[first.contour_idx].begin() + first.line_idx);
 
                 return first.contour_idx < second.contour_idx ||
                        (first.contour_idx == second.contour_idx &&
@@ -1516,12 +1573,11 @@ std::vector<std::vector<std::pair<ExPolygon, size_t>>> multi_material_segmentati
                           Line(first_start_p, first.projected_line.a).length() < Line(first_start_p, second.projected_line.a).length())));
             };
 
-            std::sort(painted_lines[layer_idx].begin(), painted_lines[layer_idx].end(), comp);
-            std::vector<PaintedLine> &painted_lines_single = painted_lines[layer_idx];
+            std::sort(painted_lines.begin(), painted_lines.end(), comp);
 
-            if (!painted_lines_single.empty()) {
-                std::vector<std::vector<ColoredLine>> color_poly = colorize_polygons(input_polygons[layer_idx], painted_lines_single);
-                MMU_Graph                             graph      = build_graph(layer_idx, color_poly);
+            if (!painted_lines.empty()) {
+                std::vector<std::vector<ColoredLine>> color_poly = colorize_polygons(input_polygons[layer_idx], painted_lines);
+                MMU_Graph                             graph      = build_graph(layer_idx, color_poly, voronoi_diagrams.local());
                 remove_multiple_edges_in_vertices(graph, color_poly);
                 graph.remove_nodes_with_one_arc();
                 std::vector<std::pair<Polygon, size_t>> segmentation = extract_colored_segments(graph);
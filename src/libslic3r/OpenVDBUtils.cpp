@@ -12,8 +12,10 @@
 #endif // _MSC_VER
 
 #include <openvdb/tools/VolumeToMesh.h>
+#include <openvdb/tools/Clip.h>
 #include <openvdb/tools/Composite.h>
 #include <openvdb/tools/LevelSetRebuild.h>
+#include <openvdb/tools/SignedFloodFill.h>
 
 //#include "MTUtils.hpp"
 
@@ -155,4 +157,25 @@ openvdb::FloatGrid::Ptr redistance_grid(const openvdb::FloatGrid &grid,
     return new_grid;
 }
 
+openvdb::FloatGrid::Ptr clip_grid(const openvdb::FloatGrid &grid,
+                                  const openvdb::CoordBBox &bbox)
+{
+    auto new_grid = openvdb::tools::clip(grid, grid.transform().indexToWorld(bbox));
+
+    // Copies voxel_scale metadata, if it exists.
+    new_grid->insertMeta(*grid.deepCopyMeta());
+
+    return new_grid;
+}
+
+void merge_grid(openvdb::FloatGrid &dst, openvdb::FloatGrid &src)
+{
+    openvdb::tools::compReplace(dst, src);
+}
+
+void sign_grid(openvdb::FloatGrid &grid)
+{
+    openvdb::tools::signedFloodFill(grid.tree());
+}
+
 } // namespace Slic3r
@@ -50,6 +50,21 @@ openvdb::FloatGrid::Ptr redistance_grid(const openvdb::FloatGrid &grid,
                                         double ext_range = 3.,
                                         double int_range = 3.);
 
+// Copy of the grid with only the active voxels inside the bounding box given
+// in index space. The metadata of the grid are copied as well.
+openvdb::FloatGrid::Ptr clip_grid(const openvdb::FloatGrid &grid,
+                                  const openvdb::CoordBBox &bbox);
+
+// Move the active voxels of src into dst, overwriting the voxels of dst.
+// src is left empty.
+// The inactive values of src are not merged, call sign_grid() on dst
+// after the last merge.
+void merge_grid(openvdb::FloatGrid &dst, openvdb::FloatGrid &src);
+
+// Set the sign of the inactive voxels and tiles of a level set from its
+// narrow band, so that the values inside the level set are negative.
+void sign_grid(openvdb::FloatGrid &grid);
+
 } // namespace Slic3r
 
 #endif // OPENVDBUTILS_HPP
@@ -1,6 +1,7 @@
 #include "PerimeterGenerator.hpp"
 #include "ClipperUtils.hpp"
 #include "ExtrusionEntityCollection.hpp"
+#include "Geometry.hpp"
 #include "ShortestPath.hpp"
 
 #include <cmath>
@@ -317,6 +318,9 @@ void PerimeterGenerator::process()
         m_lower_slices_polygons = offset(*this->lower_slices, float(scale_(+nozzle_diameter/2)));
     }
 
+    // The thin walls and the gap fill of all the islands share the buffers of a single Voronoi builder.
+    Geometry::VoronoiDiagramBuilder voronoi_builder;
+
     // we need to process each island separately because we might have different
     // extra perimeters for each one
     for (const Surface &surface : this->slices->surfaces) {
@@ -353,7 +357,7 @@ void PerimeterGenerator::process()
                             - float(min_width / 2.), float(min_width / 2.));
                         // the maximum thickness of our thin wall area is equal to the minimum thickness of a single loop
                         for (ExPolygon &ex : expp)
-                            ex.medial_axis(ext_perimeter_width + ext_perimeter_spacing2, min_width, &thin_walls);
+                            ex.medial_axis(ext_perimeter_width + ext_perimeter_spacing2, min_width, &thin_walls, &voronoi_builder);
                     }
                     if (m_spiral_vase && offsets.size() > 1) {
                     	// Remove all but the largest area polygon.
@@ -499,7 +503,7 @@ void PerimeterGenerator::process()
                 offset2_ex(gaps, - float(max / 2.), float(max / 2. + ClipperSafetyOffset)));
             ThickPolylines polylines;
             for (const ExPolygon &ex : gaps_ex)
-                ex.medial_axis(max, min, &polylines);
+                ex.medial_axis(max, min, &polylines, &voronoi_builder);
             if (! polylines.empty()) {
 				ExtrusionEntityCollection gap_fill;
 				variable_width(polylines, erGapFill, this->solid_infill_flow, gap_fill.entities);
@@ -421,7 +421,7 @@ const std::vector<std::string>& Preset::print_options()
         "extra_perimeters", "ensure_vertical_shell_thickness", "avoid_crossing_perimeters", "thin_walls", "overhangs",
         "seam_position", "external_perimeters_first", "fill_density", "fill_pattern", "top_fill_pattern", "bottom_fill_pattern",
         "infill_every_layers", "infill_only_where_needed", "solid_infill_every_layers", "fill_angle", "bridge_angle",
-        "solid_infill_below_area", "only_retract_when_crossing_perimeters", "infill_first",
+        "solid_infill_below_area", "only_retract_when_crossing_perimeters", "infill_first", "monotonic_infill_rounds",
     	"ironing", "ironing_type", "ironing_flowrate", "ironing_speed", "ironing_spacing",
         "max_print_speed", "max_volumetric_speed", "avoid_crossing_perimeters_max_detour",
         "fuzzy_skin", "fuzzy_skin_thickness", "fuzzy_skin_point_dist",
@@ -439,7 +439,7 @@ const std::vector<std::string>& Preset::print_options()
         "support_material_interface_pattern", "support_material_interface_spacing", "support_material_interface_contact_loops", 
         "support_material_contact_distance", "support_material_bottom_contact_distance",
         "support_material_buildplate_only", "dont_support_bridges", "thick_bridges", "notes", "complete_objects", "extruder_clearance_radius",
-        "extruder_clearance_height", "gcode_comments", "gcode_label_objects", "output_filename_format", "post_process", "perimeter_extruder",
+        "extruder_clearance_height", "gcode_comments", "gcode_label_objects", "arc_fitting_tolerance", "output_filename_format", "post_process", "perimeter_extruder",
         "infill_extruder", "solid_infill_extruder", "support_material_extruder", "support_material_interface_extruder",
         "ooze_prevention", "standby_temperature_delta", "interface_shells", "extrusion_width", "first_layer_extrusion_width",
         "perimeter_extrusion_width", "external_perimeter_extrusion_width", "infill_extrusion_width", "solid_infill_extrusion_width",
@@ -491,7 +491,7 @@ const std::vector<std::string>& Preset::printer_options()
     if (s_opts.empty()) {
         s_opts = {
             "printer_technology",
-            "bed_shape", "bed_custom_texture", "bed_custom_model", "z_offset", "gcode_flavor", "use_relative_e_distances",
+            "bed_shape", "bed_custom_texture", "bed_custom_model", "z_offset", "gcode_flavor", "gcode_compression", "use_relative_e_distances",
             "use_firmware_retraction", "use_volumetric_e", "variable_layer_height",
             //FIXME the print host keys are left here just for conversion from the Printer preset to Physical Printer preset.
             "host_type", "print_host", "printhost_apikey", "printhost_cafile",
@@ -560,6 +560,7 @@ const std::vector<std::string>& Preset::sla_print_options()
             "hollowing_enable",
             "hollowing_min_thickness",
             "hollowing_quality",
+            "hollowing_adaptive",
             "hollowing_closing_distance",
             "output_filename_format",
             "default_sla_print_profile",
@@ -11,6 +11,7 @@
 #include "SupportMaterial.hpp"
 #include "Thread.hpp"
 #include "GCode.hpp"
+#include "Fill/FillPatternCache.hpp"
 #include "GCode/WipeTower.hpp"
 #include "Utils.hpp"
 
@@ -23,6 +24,9 @@
 #include <boost/format.hpp>
 #include <boost/log/trivial.hpp>
 
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_invoke.h>
+
 // Mark string for localization and translate.
 #define L(s) Slic3r::I18N::translate(s)
 
@@ -44,6 +48,8 @@ void Print::clear()
 	m_objects.clear();
     m_print_regions.clear();
     m_model.clear_objects();
+    // The spilled layers were deleted together with the objects.
+    m_layer_spill.reset();
 }
 
 // Called by Print::apply().
@@ -56,6 +62,7 @@ bool Print::invalidate_state_by_config_options(const ConfigOptionResolver & /* n
     // Cache the plenty of parameters, which influence the G-code generator only,
     // or they are only notes not influencing the generated G-code.
     static std::unordered_set<std::string> steps_gcode = {
+        "arc_fitting_tolerance",
         "avoid_crossing_perimeters",
         "avoid_crossing_perimeters_max_detour",
         "bed_shape",
@@ -90,6 +97,7 @@ bool Print::invalidate_state_by_config_options(const ConfigOptionResolver & /* n
         "first_layer_acceleration",
         "first_layer_bed_temperature",
         "gcode_comments",
+        "gcode_compression",
         "gcode_label_objects",
         "infill_acceleration",
         "layer_gcode",
@@ -840,54 +848,78 @@ void Print::process()
     name_tbb_thread_pool_threads();
 
     BOOST_LOG_TRIVIAL(info) << "Starting the slicing process." << log_memory_info();
+    // The layers spilled by the previous runs stay spilled, the budget applies to the layers produced from now on.
+    // Reclaim the records superseded by the previous runs.
+    if (m_layer_spill) {
+        m_layer_spill->set_budget(m_layer_memory_budget);
+        m_layer_spill->compact();
+    } else if (m_layer_memory_budget > 0)
+        m_layer_spill = std::make_unique<LayerSpill>(m_layer_memory_budget);
     for (PrintObject *obj : m_objects)
         obj->make_perimeters();
     this->set_status(70, L("Infilling layers"));
-    for (PrintObject *obj : m_objects)
-        obj->infill();
-    for (PrintObject *obj : m_objects)
-        obj->ironing();
-    for (PrintObject *obj : m_objects)
-        obj->generate_support_material();
-    if (this->set_started(psWipeTower)) {
-        m_wipe_tower_data.clear();
-        m_tool_ordering.clear();
-        if (this->has_wipe_tower()) {
-            //this->set_status(95, L("Generating wipe tower"));
-            this->_make_wipe_tower();
-        } else if (! this->config().complete_objects.value) {
-        	// Initialize the tool ordering, so it could be used by the G-code preview slider for planning tool changes and filament switches.
-        	m_tool_ordering = ToolOrdering(*this, -1, false);
-            if (m_tool_ordering.empty() || m_tool_ordering.last_extruder() == unsigned(-1))
-                throw Slic3r::SlicingError("The print is empty. The model is not printable with current print settings.");
-        }
-        this->set_done(psWipeTower);
+    {
+        // The infill patterns are shared by the objects, release them once all the objects are filled,
+        // also if the slicing is canceled or it fails.
+        ScopeGuard fill_pattern_cache_guard([]() { FillPatternCache::instance().clear(); });
+        for (PrintObject *obj : m_objects)
+            obj->infill();
+        for (PrintObject *obj : m_objects)
+            obj->ironing();
+        for (PrintObject *obj : m_objects)
+            obj->generate_support_material();
     }
-    if (this->set_started(psSkirt)) {
-        m_skirt.clear();
-        m_skirt_convex_hull.clear();
-        m_first_layer_convex_hull.points.clear();
-        if (this->has_skirt()) {
-            this->set_status(88, L("Generating skirt"));
-            this->_make_skirt();
+    // The wipe tower (or the tool ordering if there is no wipe tower), the skirt and the brim are print level steps
+    // depending on the first layers of all the objects. The skirt encloses the wipe tower and the brim is trimmed by the skirt,
+    // however without a wipe tower the tool ordering does not depend on the skirt and brim and it is calculated concurrently.
+    auto make_wipe_tower = [this]() {
+        if (this->set_started(psWipeTower)) {
+            m_wipe_tower_data.clear();
+            m_tool_ordering.clear();
+            if (this->has_wipe_tower()) {
+                //this->set_status(95, L("Generating wipe tower"));
+                this->_make_wipe_tower();
+            } else if (! this->config().complete_objects.value) {
+                // Initialize the tool ordering, so it could be used by the G-code preview slider for planning tool changes and filament switches.
+                m_tool_ordering = ToolOrdering(*this, -1, false);
+                if (m_tool_ordering.empty() || m_tool_ordering.last_extruder() == unsigned(-1))
+                    throw Slic3r::SlicingError("The print is empty. The model is not printable with current print settings.");
+            }
+            this->set_done(psWipeTower);
         }
-        this->set_done(psSkirt);
-    }
-	if (this->set_started(psBrim)) {
-        m_brim.clear();
-        m_first_layer_convex_hull.points.clear();
-        if (this->has_brim()) {
-            this->set_status(88, L("Generating brim"));
-            Polygons islands_area;
-            m_brim = make_brim(*this, this->make_try_cancel(), islands_area);
-            for (Polygon &poly : union_(this->first_layer_islands(), islands_area))
-                append(m_first_layer_convex_hull.points, std::move(poly.points));
+    };
+    auto make_skirt_brim = [this]() {
+        if (this->set_started(psSkirt)) {
+            m_skirt.clear();
+            m_skirt_convex_hull.clear();
+            m_first_layer_convex_hull.points.clear();
+            if (this->has_skirt()) {
+                this->set_status(88, L("Generating skirt"));
+                this->_make_skirt();
+            }
+            this->set_done(psSkirt);
         }
-        // Brim depends on skirt (brim lines are trimmed by the skirt lines), therefore if
-        // the skirt gets invalidated, brim gets invalidated as well and the following line is called.
-        this->finalize_first_layer_convex_hull();
-        this->set_done(psBrim);
-    }
+        if (this->set_started(psBrim)) {
+            m_brim.clear();
+            m_first_layer_convex_hull.points.clear();
+            if (this->has_brim()) {
+                this->set_status(88, L("Generating brim"));
+                Polygons islands_area;
+                m_brim = make_brim(*this, this->make_try_cancel(), islands_area);
+                for (Polygon &poly : union_(this->first_layer_islands(), islands_area))
+                    append(m_first_layer_convex_hull.points, std::move(poly.points));
+            }
+            // Brim depends on skirt (brim lines are trimmed by the skirt lines), therefore if
+            // the skirt gets invalidated, brim gets invalidated as well and the following line is called.
+            this->finalize_first_layer_convex_hull();
+            this->set_done(psBrim);
+        }
+    };
+    if (this->has_wipe_tower()) {
+        make_wipe_tower();
+        make_skirt_brim();
+    } else
+        tbb::parallel_invoke(make_wipe_tower, make_skirt_brim);
     BOOST_LOG_TRIVIAL(info) << "Slicing process finished." << log_memory_info();
 }
 
@@ -895,7 +927,7 @@ void Print::process()
 // The export_gcode may die for various reasons (fails to process output_filename_format,
 // write error into the G-code, cannot execute post-processing scripts).
 // It is up to the caller to show an error message.
-std::string Print::export_gcode(const std::string& path_template, GCodeProcessor::Result* result, ThumbnailsGeneratorCallback thumbnail_cb)
+std::string Print::export_gcode(const std::string& path_template, GCodeProcessor::Result* result, ThumbnailsGeneratorCallback thumbnail_cb, GCodeCompressedOutput compressed_output)
 {
     // output everything to a G-code file
     // The following call may die if the output_filename_format template substitution fails.
@@ -912,7 +944,7 @@ std::string Print::export_gcode(const std::string& path_template, GCodeProcessor
 
     // The following line may die for multiple reasons.
     GCode gcode;
-    gcode.do_export(this, path.c_str(), result, thumbnail_cb);
+    gcode.do_export(this, path.c_str(), result, thumbnail_cb, compressed_output);
     return path.c_str();
 }
 
@@ -936,24 +968,34 @@ void Print::_make_skirt()
         skirt_height_z = std::max(skirt_height_z, object->m_layers[skirt_layers-1]->print_z);
     }
     
-    // Collect points from all layers contained in skirt height.
+    // Collect points from all layers contained in skirt height, the objects are processed in parallel.
+    std::vector<Points> objects_points(m_objects.size());
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, m_objects.size()),
+        [this, skirt_height_z, &objects_points](const tbb::blocked_range<size_t> &range) {
+            for (size_t object_idx = range.begin(); object_idx < range.end(); ++ object_idx) {
+                const PrintObject *object        = m_objects[object_idx];
+                Points            &object_points = objects_points[object_idx];
+                // Get object layers up to skirt_height_z.
+                for (const Layer *layer : object->m_layers) {
+                    if (layer->print_z > skirt_height_z)
+                        break;
+                    for (const ExPolygon &expoly : layer->lslices)
+                        // Collect the outer contour points only, ignore holes for the calculation of the convex hull.
+                        append(object_points, expoly.contour.points);
+                }
+                // Get support layers up to skirt_height_z.
+                for (const SupportLayer *layer : object->support_layers()) {
+                    if (layer->print_z > skirt_height_z)
+                        break;
+                    RestoredLayers restored(this->layer_spill(), { layer });
+                    layer->support_fills.collect_points(object_points);
+                }
+            }
+        });
     Points points;
-    for (const PrintObject *object : m_objects) {
-        Points object_points;
-        // Get object layers up to skirt_height_z.
-        for (const Layer *layer : object->m_layers) {
-            if (layer->print_z > skirt_height_z)
-                break;
-            for (const ExPolygon &expoly : layer->lslices)
-                // Collect the outer contour points only, ignore holes for the calculation of the convex hull.
-                append(object_points, expoly.contour.points);
-        }
-        // Get support layers up to skirt_height_z.
-        for (const SupportLayer *layer : object->support_layers()) {
-            if (layer->print_z > skirt_height_z)
-                break;
-            layer->support_fills.collect_points(object_points);
-        }
+    for (size_t object_idx = 0; object_idx < m_objects.size(); ++ object_idx) {
+        const PrintObject *object        = m_objects[object_idx];
+        const Points      &object_points = objects_points[object_idx];
         // Repeat points for each object copy.
         for (const PrintInstance &instance : object->instances()) {
             Points copy_points = object_points;
@@ -1061,8 +1103,10 @@ Polygons Print::first_layer_islands() const
         Polygons object_islands;
         for (ExPolygon &expoly : object->m_layers.front()->lslices)
             object_islands.push_back(expoly.contour);
-        if (! object->support_layers().empty())
+        if (! object->support_layers().empty()) {
+            RestoredLayers restored(this->layer_spill(), { object->support_layers().front() });
             object->support_layers().front()->support_fills.polygons_covered_by_spacing(object_islands, float(SCALED_EPSILON));
+        }
         islands.reserve(islands.size() + object_islands.size() * object->instances().size());
         for (const PrintInstance &instance : object->instances())
             for (Polygon &poly : object_islands) {
@@ -1207,6 +1251,11 @@ void Print::_make_wipe_tower()
         for (auto &layer_tools : m_wipe_tower_data.tool_ordering.layer_tools()) { // for all layers
             if (!layer_tools.has_wipe_tower) continue;
             bool first_layer = &layer_tools == &m_wipe_tower_data.tool_ordering.front();
+            if (m_layer_spill && layer_tools.wiping_extrusions().is_anything_overridable())
+                // The extrusions wiped into are referenced by their addresses until the G-code is exported, keep them resident.
+                for (PrintObject *object : m_objects)
+                    if (Layer *layer = object->get_layer_at_printz(layer_tools.print_z, EPSILON); layer != nullptr)
+                        m_layer_spill->unspill(*layer);
             wipe_tower.plan_toolchange((float)layer_tools.print_z, (float)layer_tools.wipe_tower_layer_height, current_extruder_id, current_extruder_id, false);
             for (const auto extruder_id : layer_tools.extruders) {
                 if ((first_layer && extruder_id == m_wipe_tower_data.tool_ordering.all_extruders().back()) || extruder_id != current_extruder_id) {
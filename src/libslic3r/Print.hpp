@@ -6,6 +6,7 @@
 #include "BoundingBox.hpp"
 #include "ExtrusionEntityCollection.hpp"
 #include "Flow.hpp"
+#include "LayerSpill.hpp"
 #include "Point.hpp"
 #include "Slicing.hpp"
 #include "TriangleMeshSlicer.hpp"
@@ -13,6 +14,7 @@
 #include "GCode/WipeTower.hpp"
 #include "GCode/ThumbnailData.hpp"
 #include "GCode/GCodeProcessor.hpp"
+#include "GCode/GCodeCompressor.hpp"
 #include "MultiMaterialSegmentation.hpp"
 
 #include "libslic3r.h"
@@ -338,7 +340,7 @@ private:
     friend class Print;
 
 	PrintObject(Print* print, ModelObject* model_object, const Transform3d& trafo, PrintInstances&& instances);
-	~PrintObject() { if (m_shared_regions && -- m_shared_regions->m_ref_cnt == 0) delete m_shared_regions; }
+	~PrintObject();
  
     void                    config_apply(const ConfigBase &other, bool ignore_nonexistent = false) { m_config.apply(other, ignore_nonexistent); }
     void                    config_apply_only(const ConfigBase &other, const t_config_option_keys &keys, bool ignore_nonexistent = false) { m_config.apply_only(other, keys, ignore_nonexistent); }
@@ -513,7 +515,9 @@ public:
     void                process() override;
     // Exports G-code into a file name based on the path_template, returns the file path of the generated G-code file.
     // If preview_data is not null, the preview_data is filled in for the G-code visualization (not used by the command line Slic3r).
-    std::string         export_gcode(const std::string& path_template, GCodeProcessor::Result* result, ThumbnailsGeneratorCallback thumbnail_cb = nullptr);
+    // With compressed_output other than None, the G-code is also written compressed into compressed_gcode_path() of the returned path.
+    std::string         export_gcode(const std::string& path_template, GCodeProcessor::Result* result, ThumbnailsGeneratorCallback thumbnail_cb = nullptr,
+                                     GCodeCompressedOutput compressed_output = GCodeCompressedOutput::None);
 
     // methods for handling state
     bool                is_step_done(PrintStep step) const { return Inherited::is_step_done(step); }
@@ -573,6 +577,14 @@ public:
     const PrintStatistics&      print_statistics() const { return m_print_statistics; }
     PrintStatistics&            print_statistics() { return m_print_statistics; }
 
+    // Memory budget of the layer extrusions in bytes, zero to keep all the layers in memory. Once the slicing steps finished
+    // producing the extrusions of a layer, the extrusions of the layers over the budget are spilled to a scratch file.
+    // The steps reading the extrusions afterwards load the spilled layers back one by one. Applied by the next process().
+    void                        set_layer_memory_budget(size_t budget) { m_layer_memory_budget = budget; }
+    size_t                      layer_memory_budget() const { return m_layer_memory_budget; }
+    // Scratch file with the spilled layers, null if no memory budget was set.
+    LayerSpill*                 layer_spill() const { return m_layer_spill.get(); }
+
     // Wipe tower support.
     bool                        has_wipe_tower() const;
     const WipeTowerData&        wipe_tower_data(size_t extruders_cnt = 0) const;
@@ -628,6 +640,10 @@ private:
     // Estimated print time, filament consumed.
     PrintStatistics                         m_print_statistics;
 
+    size_t                                  m_layer_memory_budget { 0 };
+    // Scratch file with the extrusions of the layers spilled over the layer memory budget.
+    std::unique_ptr<LayerSpill>             m_layer_spill;
+
     // To allow GCode to set the Print's GCodeExport step status.
     friend class GCode;
     // Allow PrintObject to access m_mutex and m_cancel_callback.
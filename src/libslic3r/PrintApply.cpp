@@ -2,6 +2,10 @@
 #include "Print.hpp"
 
 #include <cfloat>
+#include <map>
+#include <tuple>
+
+#include <boost/functional/hash.hpp>
 
 namespace Slic3r {
 
@@ -148,6 +152,52 @@ static std::vector<PrintObjectTrafoAndInstances> print_objects_from_model_object
     return std::vector<PrintObjectTrafoAndInstances>(trafos.begin(), trafos.end());
 }
 
+// Will the two ModelVolumes be sliced the same way? Meshes are compared by identity first
+// (meshes shared by ModelVolume copies), then by content (the same file loaded multiple times).
+// Hash of the mesh and of the painted data of a ModelVolume, equal for ModelVolumes passing model_volumes_slice_equal().
+static size_t model_volume_slice_hash(const ModelVolume &mv)
+{
+    size_t seed = mv.mesh_hash();
+    boost::hash_combine(seed, mv.supported_facets.data_hash());
+    boost::hash_combine(seed, mv.seam_facets.data_hash());
+    boost::hash_combine(seed, mv.mmu_segmentation_facets.data_hash());
+    return seed;
+}
+
+static bool model_volumes_slice_equal(const ModelVolume &mv1, const ModelVolume &mv2)
+{
+    if (mv1.type() != mv2.type() || ! transform3d_equal(mv1.get_matrix(), mv2.get_matrix()) || mv1.config.get() != mv2.config.get())
+        return false;
+    // The hashes are cached, compare them first, then compare the content of the painted data with equal hashes.
+    auto facets_equal = [](const FacetsAnnotation &f1, const FacetsAnnotation &f2)
+        { return f1.data_hash() == f2.data_hash() && f1.get_data() == f2.get_data(); };
+    if (! facets_equal(mv1.supported_facets, mv2.supported_facets) ||
+        ! facets_equal(mv1.seam_facets, mv2.seam_facets) ||
+        ! facets_equal(mv1.mmu_segmentation_facets, mv2.mmu_segmentation_facets))
+        return false;
+    if (&mv1.mesh() == &mv2.mesh())
+        return true;
+    const indexed_triangle_set &its1 = mv1.mesh().its;
+    const indexed_triangle_set &its2 = mv2.mesh().its;
+    return mv1.mesh_hash() == mv2.mesh_hash() && its1.vertices == its2.vertices && its1.indices == its2.indices;
+}
+
+// Will the two ModelObjects be sliced the same way, so that their instances may share a single PrintObject?
+static bool model_objects_slice_equal(const ModelObject &mo1, const ModelObject &mo2)
+{
+    if (mo1.volumes.size() != mo2.volumes.size() || mo1.config.get() != mo2.config.get() ||
+        mo1.layer_height_profile.get() != mo2.layer_height_profile.get() ||
+        mo1.layer_config_ranges.size() != mo2.layer_config_ranges.size())
+        return false;
+    for (auto it1 = mo1.layer_config_ranges.begin(), it2 = mo2.layer_config_ranges.begin(); it1 != mo1.layer_config_ranges.end(); ++ it1, ++ it2)
+        if (it1->first != it2->first || it1->second.get() != it2->second.get())
+            return false;
+    for (size_t i = 0; i < mo1.volumes.size(); ++ i)
+        if (! model_volumes_slice_equal(*mo1.volumes[i], *mo2.volumes[i]))
+            return false;
+    return true;
+}
+
 // Compare just the layer ranges and their layer heights, not the associated configs.
 // Ignore the layer heights if check_layer_heights is false.
 static bool layer_height_ranges_equal(const t_layer_config_ranges &lr1, const t_layer_config_ranges &lr2, bool check_layer_height)
@@ -377,6 +427,50 @@ struct ModelObjectStatusDB
     std::set<ModelObjectStatus> db;
 };
 
+// Plates with many copies of the same object loaded as separate ModelObjects (3MF imports, the same STL loaded N times)
+// would be sliced N times. Move the instances of a ModelObject producing the same slices as some preceding ModelObject
+// to the preceding ModelObject, so that a single PrintObject is sliced for all of them.
+static void merge_print_instances_of_equal_model_objects(const ModelObjectPtrs &model_objects, ModelObjectStatusDB &model_object_status_db)
+{
+    struct Primary {
+        const ModelObject *model_object;
+        ModelObjectStatus *status;
+    };
+    // Bucket the ModelObjects by the cached content hashes of their volumes first to limit the number of full comparisons.
+    std::map<std::tuple<size_t, size_t, size_t, size_t>, std::vector<Primary>> primaries;
+    for (const ModelObject *model_object : model_objects) {
+        ModelObjectStatus &status = const_cast<ModelObjectStatus&>(model_object_status_db.reuse(*model_object));
+        if (status.print_instances.empty())
+            continue;
+        size_t num_vertices = 0;
+        size_t num_facets   = 0;
+        size_t hash         = 0;
+        for (const ModelVolume *model_volume : model_object->volumes) {
+            num_vertices += model_volume->mesh().its.vertices.size();
+            num_facets   += model_volume->mesh().its.indices.size();
+            boost::hash_combine(hash, model_volume_slice_hash(*model_volume));
+        }
+        std::vector<Primary> &bucket = primaries[std::make_tuple(model_object->volumes.size(), num_vertices, num_facets, hash)];
+        auto it = std::find_if(bucket.begin(), bucket.end(), [model_object](const Primary &p) { return model_objects_slice_equal(*p.model_object, *model_object); });
+        if (it == bucket.end()) {
+            bucket.push_back({ model_object, &status });
+            continue;
+        }
+        // Merge the instances with the instances of the primary ModelObject sharing the same trafo.
+        std::vector<PrintObjectTrafoAndInstances> &dst = it->status->print_instances;
+        for (PrintObjectTrafoAndInstances &src : status.print_instances) {
+            auto it_dst = std::find_if(dst.begin(), dst.end(), [&src](const PrintObjectTrafoAndInstances &d) { return transform3d_equal(d.trafo, src.trafo); });
+            if (it_dst == dst.end())
+                dst.emplace_back(std::move(src));
+            else
+                append(it_dst->instances, std::move(src.instances));
+        }
+        // Keep the PrintObjects of a ModelObject sorted by their trafos for merging with the old PrintObjects.
+        std::sort(dst.begin(), dst.end());
+        status.print_instances.clear();
+    }
+}
+
 struct PrintObjectStatus {
     enum Status {
         Unknown,
@@ -1171,10 +1265,12 @@ Print::ApplyStatus Print::apply(const Model &model, DynamicPrintConfig new_full_
         PrintObjectPtrs print_objects_new;
         print_objects_new.reserve(std::max(m_objects.size(), m_model.objects.size()));
         bool new_objects = false;
+        for (ModelObject *model_object : m_model.objects)
+            const_cast<ModelObjectStatus&>(model_object_status_db.reuse(*model_object)).print_instances = print_objects_from_model_object(*model_object);
+        merge_print_instances_of_equal_model_objects(m_model.objects, model_object_status_db);
         // Walk over all new model objects and check, whether there are matching PrintObjects.
         for (ModelObject *model_object : m_model.objects) {
             ModelObjectStatus &model_object_status = const_cast<ModelObjectStatus&>(model_object_status_db.reuse(*model_object));
-            model_object_status.print_instances    = print_objects_from_model_object(*model_object);
             std::vector<const PrintObjectStatus*> old;
             old.reserve(print_object_status_db.count(*model_object));
             for (const PrintObjectStatus &print_object_status : print_object_status_db.get_range(*model_object))
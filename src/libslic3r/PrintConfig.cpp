@@ -66,6 +66,13 @@ static t_config_enum_values s_keys_map_MachineLimitsUsage {
 };
 CONFIG_OPTION_ENUM_DEFINE_STATIC_MAPS(MachineLimitsUsage)
 
+static t_config_enum_values s_keys_map_GCodeCompression {
+    { "none",           int(GCodeCompression::None) },
+    { "gzip",           int(GCodeCompression::Gzip) },
+    { "meatpack",       int(GCodeCompression::MeatPack) }
+};
+CONFIG_OPTION_ENUM_DEFINE_STATIC_MAPS(GCodeCompression)
+
 static t_config_enum_values s_keys_map_PrintHostType {
     { "octoprint",      htOctoPrint },
     { "duet",           htDuet },
@@ -132,7 +139,8 @@ CONFIG_OPTION_ENUM_DEFINE_STATIC_MAPS(SupportMaterialPattern)
 
 static t_config_enum_values s_keys_map_SupportMaterialStyle {
     { "grid",           smsGrid },
-    { "snug",           smsSnug }
+    { "snug",           smsSnug },
+    { "tree",           smsTree }
 };
 CONFIG_OPTION_ENUM_DEFINE_STATIC_MAPS(SupportMaterialStyle)
 
@@ -321,6 +329,18 @@ void PrintConfigDef::init_fff_params()
     // Maximum extruder temperature, bumped to 1500 to support printing of glass.
     const int max_temp = 1500;
 
+    def = this->add("arc_fitting_tolerance", coFloat);
+    def->label = L("Arc fitting tolerance");
+    def->tooltip = L("Replace sequences of straight extrusion moves approximating a circular arc with G2 / G3 arc moves, "
+                   "if the arc does not deviate from the original path by more than this value. "
+                   "This reduces the size of the G-code and the load of the printer planner for finely tessellated curves. "
+                   "The printer firmware has to support arc moves (Marlin with ARC_SUPPORT, RepRapFirmware, "
+                   "Klipper with [gcode_arcs]). Set zero to disable arc fitting.");
+    def->sidetext = L("mm");
+    def->min = 0;
+    def->mode = comExpert;
+    def->set_default_value(new ConfigOptionFloat(0));
+
     def = this->add("avoid_crossing_perimeters", coBool);
     def->label = L("Avoid crossing perimeters");
     def->tooltip = L("Optimize travel moves in order to minimize the crossing of perimeters. "
@@ -1233,6 +1253,22 @@ void PrintConfigDef::init_fff_params()
     def->mode = comExpert;
     def->set_default_value(new ConfigOptionBool(0));
 
+    def = this->add("gcode_compression", coEnum);
+    def->label = L("G-code compression");
+    def->tooltip = L("Compress the exported and uploaded G-code. Gzip compressed G-code is saved with the .gz suffix "
+                   "and it has to be decompressed by the print host. MeatPack packs the G-code without comments for streaming "
+                   "to a firmware with MeatPack support (Marlin, Prusa firmware, OctoPrint MeatPack plugin), it is saved with the .mp suffix. "
+                   "The G-code is compressed after it is exported, the post-processing scripts are executed on the plain text G-code.");
+    def->enum_keys_map = &ConfigOptionEnum<GCodeCompression>::get_enum_values();
+    def->enum_values.push_back("none");
+    def->enum_values.push_back("gzip");
+    def->enum_values.push_back("meatpack");
+    def->enum_labels.push_back(L("None"));
+    def->enum_labels.push_back("gzip");
+    def->enum_labels.push_back("MeatPack");
+    def->mode = comExpert;
+    def->set_default_value(new ConfigOptionEnum<GCodeCompression>(GCodeCompression::None));
+
     def = this->add("gcode_flavor", coEnum);
     def->label = L("G-code flavor");
     def->tooltip = L("Some G/M-code commands, including temperature control and others, are not universal. "
@@ -1751,6 +1787,16 @@ void PrintConfigDef::init_fff_params()
     def->mode = comExpert;
     def->set_default_value(new ConfigOptionFloat(0));
 
+    def = this->add("monotonic_infill_rounds", coInt);
+    def->label = L("Monotonic infill optimization rounds");
+    def->category = L("Infill");
+    def->tooltip = L("Maximum number of rounds of the optimization ordering the regions of a monotonic infill "
+                   "to minimize the travel moves. Fewer rounds speed up the slicing of complex top surfaces "
+                   "at the expense of longer travel moves. Fewer rounds are run for surfaces split into many regions.");
+    def->min = 1;
+    def->mode = comExpert;
+    def->set_default_value(new ConfigOptionInt(25));
+
     def = this->add("notes", coString);
     def->label = L("Configuration notes");
     def->tooltip = L("You can put here your personal notes. This text will be added to the G-code "
@@ -2543,7 +2589,7 @@ void PrintConfigDef::init_fff_params()
     def = this->add("support_material_closing_radius", coFloat);
     def->label = L("Closing radius");
     def->category = L("Support material");
-    def->tooltip = L("For snug supports, the support regions will be merged using morphological closing operation."
+    def->tooltip = L("For snug and tree supports, the support regions will be merged using morphological closing operation."
                      " Gaps smaller than the closing radius will be filled in.");
     def->sidetext = L("mm");
     def->min = 0;
@@ -2623,12 +2669,15 @@ void PrintConfigDef::init_fff_params()
     def->category = L("Support material");
     def->tooltip = L("Style and shape of the support towers. Projecting the supports into a regular grid "
                      "will create more stable supports, while snug support towers will save material and reduce "
-                     "object scarring.");
+                     "object scarring. Tree supports grow branches from the overhangs down to the print bed, which merge "
+                     "into thicker trunks and avoid the object.");
     def->enum_keys_map = &ConfigOptionEnum<SupportMaterialStyle>::get_enum_values();
     def->enum_values.push_back("grid");
     def->enum_values.push_back("snug");
+    def->enum_values.push_back("tree");
     def->enum_labels.push_back(L("Grid"));
     def->enum_labels.push_back(L("Snug"));
+    def->enum_labels.push_back(L("Tree"));
     def->mode = comAdvanced;
     def->set_default_value(new ConfigOptionEnum<SupportMaterialStyle>(smsGrid));
 
@@ -3578,6 +3627,15 @@ void PrintConfigDef::init_sla_params()
     def->mode = comExpert;
     def->set_default_value(new ConfigOptionFloat(0.5));
     
+    def = this->add("hollowing_adaptive", coBool);
+    def->label = L("Adaptive resolution");
+    def->category = L("Hollowing");
+    def->tooltip  = L("Limit the memory needed to hollow large models: the resolution is lowered for models, which would not "
+                      "fit the voxel budget at the requested accuracy, and the interior of large models is calculated "
+                      "in blocks in parallel.");
+    def->mode = comExpert;
+    def->set_default_value(new ConfigOptionBool(false));
+    
     def = this->add("hollowing_closing_distance", coFloat);
     def->label = L("Closing distance");
     def->category = L("Hollowing");
@@ -4196,6 +4254,20 @@ CLIMiscConfigDef::CLIMiscConfigDef()
     def->label = L("Data directory");
     def->tooltip = L("Load and store settings at the given directory. This is useful for maintaining different profiles or including configurations from a network storage.");
 
+    def = this->add("layer_memory_budget", coInt);
+    def->label = L("Layer memory budget");
+    def->tooltip = L("Memory in MB the extrusions of the sliced layers may occupy. Each layer is checked once its perimeters, infill, ironing "
+                     "or support material are generated and its extrusions over the budget are moved to a temporary file, from which they are "
+                     "loaded back for the steps looking at them and for the G-code export. Layers with infill or objects wiped into by the wipe tower "
+                     "are kept in memory. Zero keeps all the layers in memory.");
+    def->min = 0;
+
+    def = this->add("export_gcode_preview", coBool);
+    def->label = L("Export G-code preview");
+    def->tooltip = L("Precompute the preview of the exported G-code and save it next to the G-code, "
+                     "so that the G-code viewer opens the G-code without generating the toolpaths.");
+    def->set_default_value(new ConfigOptionBool(false));
+
     def = this->add("loglevel", coInt);
     def->label = L("Logging level");
     def->tooltip = L("Sets logging sensitivity. 0:fatal, 1:error, 2:warning, 3:info, 4:debug, 5:trace\n"
@@ -43,6 +43,12 @@ enum class MachineLimitsUsage {
     Count,
 };
 
+enum class GCodeCompression {
+    None,
+    Gzip,
+    MeatPack,
+};
+
 enum PrintHostType {
     htOctoPrint, htDuet, htFlashAir, htAstroBox, htRepetier
 };
@@ -84,7 +90,7 @@ enum SupportMaterialPattern {
 };
 
 enum SupportMaterialStyle {
-    smsGrid, smsSnug,
+    smsGrid, smsSnug, smsTree,
 };
 
 enum SupportMaterialInterfacePattern {
@@ -128,6 +134,7 @@ enum BrimType {
 CONFIG_OPTION_ENUM_DECLARE_STATIC_MAPS(PrinterTechnology)
 CONFIG_OPTION_ENUM_DECLARE_STATIC_MAPS(GCodeFlavor)
 CONFIG_OPTION_ENUM_DECLARE_STATIC_MAPS(MachineLimitsUsage)
+CONFIG_OPTION_ENUM_DECLARE_STATIC_MAPS(GCodeCompression)
 CONFIG_OPTION_ENUM_DECLARE_STATIC_MAPS(PrintHostType)
 CONFIG_OPTION_ENUM_DECLARE_STATIC_MAPS(AuthorizationType)
 CONFIG_OPTION_ENUM_DECLARE_STATIC_MAPS(FuzzySkinType)
@@ -455,6 +462,7 @@ PRINT_CONFIG_CLASS_DEFINE(
     ((ConfigOptionBool,                interface_shells))
     ((ConfigOptionFloat,               layer_height))
     ((ConfigOptionFloat,               mmu_segmented_region_max_width))
+    ((ConfigOptionInt,                 monotonic_infill_rounds))
     ((ConfigOptionFloat,               raft_contact_distance))
     ((ConfigOptionFloat,               raft_expansion))
     ((ConfigOptionPercent,             raft_first_layer_density))
@@ -596,6 +604,7 @@ PRINT_CONFIG_CLASS_DEFINE(
 PRINT_CONFIG_CLASS_DEFINE(
     GCodeConfig,
 
+    ((ConfigOptionFloat,               arc_fitting_tolerance))
     ((ConfigOptionString,              before_layer_gcode))
     ((ConfigOptionString,              between_objects_gcode))
     ((ConfigOptionFloats,              deretract_speed))
@@ -623,6 +632,7 @@ PRINT_CONFIG_CLASS_DEFINE(
     ((ConfigOptionFloats,              filament_cooling_final_speed))
     ((ConfigOptionStrings,             filament_ramming_parameters))
     ((ConfigOptionBool,                gcode_comments))
+    ((ConfigOptionEnum<GCodeCompression>, gcode_compression))
     ((ConfigOptionEnum<GCodeFlavor>,   gcode_flavor))
     ((ConfigOptionBool,                gcode_label_objects))
     ((ConfigOptionString,              layer_gcode))
@@ -901,6 +911,10 @@ PRINT_CONFIG_CLASS_DEFINE(
     // Indirectly controls the voxel size (resolution) used by openvdb
     ((ConfigOptionFloat, hollowing_quality))
 
+    // Coarsen the voxels of large models to fit a voxel budget and process
+    // the interior of large models in tiles.
+    ((ConfigOptionBool, hollowing_adaptive))
+
     // Indirectly controls the minimum size of created cavities.
     ((ConfigOptionFloat, hollowing_closing_distance))
 )
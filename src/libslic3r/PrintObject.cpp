@@ -80,6 +80,19 @@ PrintObject::PrintObject(Print* print, ModelObject* model_object, const Transfor
     this->set_instances(std::move(instances));
 }
 
+PrintObject::~PrintObject()
+{
+    if (m_shared_regions && -- m_shared_regions->m_ref_cnt == 0)
+        delete m_shared_regions;
+    // Don't leave the records of the layers of this object in the spill file, their addresses may be reused.
+    if (LayerSpill *layer_spill = m_print->layer_spill()) {
+        for (const Layer *layer : m_layers)
+            layer_spill->forget(*layer);
+        for (const Layer *layer : m_support_layers)
+            layer_spill->forget(*layer);
+    }
+}
+
 PrintBase::ApplyStatus PrintObject::set_instances(PrintInstances &&instances)
 {
     for (PrintInstance &i : instances)
@@ -207,10 +220,14 @@ void PrintObject::make_perimeters()
     BOOST_LOG_TRIVIAL(debug) << "Generating perimeters in parallel - start";
     tbb::parallel_for(
         tbb::blocked_range<size_t>(0, m_layers.size()),
-        [this](const tbb::blocked_range<size_t>& range) {
+        [this, layer_spill = m_print->layer_spill()](const tbb::blocked_range<size_t>& range) {
             for (size_t layer_idx = range.begin(); layer_idx < range.end(); ++ layer_idx) {
                 m_print->throw_if_canceled();
-                m_layers[layer_idx]->make_perimeters();
+                Layer *layer = m_layers[layer_idx];
+                if (layer_spill)
+                    // The perimeters are regenerated and the fills will be regenerated by the infill step, drop the spilled ones.
+                    layer_spill->forget(*layer);
+                layer->make_perimeters();
             }
         }
     );
@@ -346,10 +363,14 @@ void PrintObject::infill()
         BOOST_LOG_TRIVIAL(debug) << "Filling layers in parallel - start";
         tbb::parallel_for(
             tbb::blocked_range<size_t>(0, m_layers.size()),
-            [this, &adaptive_fill_octree = adaptive_fill_octree, &support_fill_octree = support_fill_octree](const tbb::blocked_range<size_t>& range) {
+            [this, &adaptive_fill_octree = adaptive_fill_octree, &support_fill_octree = support_fill_octree, layer_spill = m_print->layer_spill()](const tbb::blocked_range<size_t>& range) {
                 for (size_t layer_idx = range.begin(); layer_idx < range.end(); ++ layer_idx) {
                     m_print->throw_if_canceled();
-                    m_layers[layer_idx]->make_fills(adaptive_fill_octree.get(), support_fill_octree.get());
+                    Layer *layer = m_layers[layer_idx];
+                    // The fills are added to the perimeters, load them back if spilled by a previous slicing run.
+                    if (layer_spill)
+                        layer_spill->unspill(*layer);
+                    layer->make_fills(adaptive_fill_octree.get(), support_fill_octree.get());
                 }
             }
         );
@@ -366,13 +387,25 @@ void PrintObject::ironing()
 {
     if (this->set_started(posIroning)) {
         BOOST_LOG_TRIVIAL(debug) << "Ironing in parallel - start";
+        // Ironing is the last step producing the extrusions of the object layers, which are spilled over the memory budget once ironed.
+        // The ironing is added to the fills of the layers spilled by a previous slicing run, which are only loaded back if any region is ironed.
+        LayerSpill *layer_spill = m_print->layer_spill();
+        bool        ironing     = false;
+        for (size_t region_id = 0; region_id < this->num_printing_regions(); ++ region_id)
+            if (this->printing_region(region_id).config().ironing)
+                ironing = true;
         tbb::parallel_for(
             // Ironing starting with layer 0 to support ironing all surfaces.
             tbb::blocked_range<size_t>(0, m_layers.size()),
-            [this](const tbb::blocked_range<size_t>& range) {
+            [this, layer_spill, ironing](const tbb::blocked_range<size_t>& range) {
                 for (size_t layer_idx = range.begin(); layer_idx < range.end(); ++ layer_idx) {
                     m_print->throw_if_canceled();
-                    m_layers[layer_idx]->make_ironing();
+                    Layer *layer = m_layers[layer_idx];
+                    if (layer_spill && ironing)
+                        layer_spill->unspill(*layer);
+                    layer->make_ironing();
+                    if (layer_spill)
+                        layer_spill->spill_over_budget(*layer);
                 }
             }
         );
@@ -390,6 +423,15 @@ void PrintObject::generate_support_material()
             m_print->set_status(85, L("Generating support material"));    
             this->_generate_support_material();
             m_print->throw_if_canceled();
+            if (LayerSpill *layer_spill = m_print->layer_spill()) {
+                // The support layers are generated at once, spill them over the budget once all of them are finished.
+                tbb::parallel_for(tbb::blocked_range<size_t>(0, m_support_layers.size()),
+                    [this, layer_spill](const tbb::blocked_range<size_t>& range) {
+                        for (size_t layer_idx = range.begin(); layer_idx < range.end(); ++ layer_idx)
+                            layer_spill->spill_over_budget(*m_support_layers[layer_idx]);
+                    });
+                m_print->throw_if_canceled();
+            }
         } else {
 #if 0
             // Printing without supports. Empty layer means some objects or object parts are levitating,
@@ -464,8 +506,11 @@ std::pair<FillAdaptive::OctreePtr, FillAdaptive::OctreePtr> PrintObject::prepare
 
 void PrintObject::clear_layers()
 {
-    for (Layer *l : m_layers)
+    for (Layer *l : m_layers) {
+        if (LayerSpill *layer_spill = m_print->layer_spill())
+            layer_spill->forget(*l);
         delete l;
+    }
     m_layers.clear();
 }
 
@@ -477,8 +522,11 @@ Layer* PrintObject::add_layer(int id, coordf_t height, coordf_t print_z, coordf_
 
 void PrintObject::clear_support_layers()
 {
-    for (Layer *l : m_support_layers)
+    for (Layer *l : m_support_layers) {
+        if (LayerSpill *layer_spill = m_print->layer_spill())
+            layer_spill->forget(*l);
         delete l;
+    }
     m_support_layers.clear();
 }
 
@@ -599,6 +647,7 @@ bool PrintObject::invalidate_state_by_config_options(
             || opt_key == "external_fill_link_max_length"
             || opt_key == "fill_angle"
             || opt_key == "fill_pattern"
+            || opt_key == "monotonic_infill_rounds"
             || opt_key == "infill_anchor"
             || opt_key == "infill_anchor_max"
             || opt_key == "top_infill_extrusion_width"
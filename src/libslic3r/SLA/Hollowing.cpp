@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <cmath>
 #include <functional>
 #include <optional>
 
@@ -9,6 +11,7 @@
 #include <libslic3r/ClipperUtils.hpp>
 #include <libslic3r/SimplifyMesh.hpp>
 #include <libslic3r/SLA/SupportTreeMesher.hpp>
+#include <libslic3r/SLA/Concurrency.hpp>
 
 #include <boost/log/trivial.hpp>
 
@@ -63,11 +66,144 @@ const TriangleMesh &get_mesh(const Interior &interior)
     return interior.mesh;
 }
 
+// Adaptive mode: Maximum number of voxels in the narrow band of the model surface.
+static const double ADAPTIVE_MAX_VOXELS = 1.5e8;
+// Adaptive mode: Minimum number of voxels across the wall thickness.
+static const double ADAPTIVE_MIN_WALL_VOXELS = 4.;
+// Adaptive mode: Size of the blocks of the grid processed independently, in voxels.
+static const int    ADAPTIVE_TILE_SIZE = 256;
+
+// Coarsen the voxels if the narrow band of the model surface would not fit the
+// voxel budget. The band holds the voxels within the wall thickness plus the
+// closing distance from the surface, its voxel count grows with the cube of
+// voxel_scale.
+static double adaptive_voxel_scale(const TriangleMesh &   mesh,
+                                   const HollowingConfig &hc,
+                                   double                 voxel_scale)
+{
+    double area = 0.;
+    for (const stl_facet &facet : mesh.stl.facet_start)
+        area += 0.5 * double((facet.vertex[1] - facet.vertex[0]).cross(facet.vertex[2] - facet.vertex[0]).norm());
+
+    double band = 1.2 * (hc.min_thickness + hc.closing_distance);
+    if (area * band <= 0.)
+        return voxel_scale;
+
+    double budget_scale = std::cbrt(ADAPTIVE_MAX_VOXELS / (area * band));
+    double min_scale    = ADAPTIVE_MIN_WALL_VOXELS / hc.min_thickness;
+
+    return std::min(voxel_scale, std::max(min_scale, budget_scale));
+}
+
+// Rebuild the interior level set and extract the interior surface in
+// independent blocks of the grid in parallel, then stitch the blocks.
+// Each block is rebuilt from its neighborhood wide enough to contain the
+// narrow band of the voxels of the block, thus the intermediate meshes and
+// grids of the level set rebuild are bounded by the block size.
+static bool generate_interior_tiled(const openvdb::FloatGrid &grid,
+                                    const JobController &     ctl,
+                                    double                    iso_rebuild,
+                                    double                    narrowb,
+                                    double                    iso_surface,
+                                    double                    voxel_scale,
+                                    Interior &                interior)
+{
+    openvdb::CoordBBox bbox = grid.evalActiveVoxelBoundingBox();
+    openvdb::Coord     dim  = bbox.dim();
+
+    int ntiles[3];
+    for (int i = 0; i < 3; ++i)
+        ntiles[i] = std::max(1, (dim[i] + ADAPTIVE_TILE_SIZE - 1) / ADAPTIVE_TILE_SIZE);
+
+    size_t num_tiles = size_t(ntiles[0]) * size_t(ntiles[1]) * size_t(ntiles[2]);
+    int    margin    = int(std::ceil(narrowb)) + 2;
+
+    std::vector<Contour3D>               parts(num_tiles);
+    std::vector<openvdb::FloatGrid::Ptr> grids(num_tiles);
+
+    ccr::for_each(size_t(0), num_tiles, [&](size_t tile_idx) {
+        if (ctl.stopcondition()) return;
+
+        openvdb::Coord core_min = bbox.min().offsetBy(
+            int(tile_idx % size_t(ntiles[0])) * ADAPTIVE_TILE_SIZE,
+            int(tile_idx / size_t(ntiles[0]) % size_t(ntiles[1])) * ADAPTIVE_TILE_SIZE,
+            int(tile_idx / (size_t(ntiles[0]) * size_t(ntiles[1]))) * ADAPTIVE_TILE_SIZE);
+        openvdb::CoordBBox core(core_min, core_min.offsetBy(ADAPTIVE_TILE_SIZE - 1));
+        openvdb::CoordBBox neighborhood = core;
+        neighborhood.expand(margin);
+
+        openvdb::FloatGrid::Ptr tile = clip_grid(grid, neighborhood);
+        tile = redistance_grid(*tile, iso_rebuild, narrowb, narrowb);
+
+        // Keep the faces of the cells owned by this block, the cells of the
+        // margin are owned by the neighbor blocks.
+        Contour3D part = grid_to_contour3d(*tile, iso_surface, 0.);
+        Vec3d cmin = Vec3d(core.min().x(), core.min().y(), core.min().z()) / voxel_scale;
+        Vec3d cmax = Vec3d(core.max().x() + 1, core.max().y() + 1, core.max().z() + 1) / voxel_scale;
+        auto in_core = [&cmin, &cmax](const Vec3d &c) {
+            return c.x() >= cmin.x() && c.x() < cmax.x() &&
+                   c.y() >= cmin.y() && c.y() < cmax.y() &&
+                   c.z() >= cmin.z() && c.z() < cmax.z();
+        };
+        auto it3 = std::remove_if(part.faces3.begin(), part.faces3.end(), [&](const Vec3i &f) {
+            return ! in_core((part.points[f(0)] + part.points[f(1)] + part.points[f(2)]) / 3.);
+        });
+        part.faces3.erase(it3, part.faces3.end());
+        auto it4 = std::remove_if(part.faces4.begin(), part.faces4.end(), [&](const Vec4i &f) {
+            return ! in_core((part.points[f(0)] + part.points[f(1)] + part.points[f(2)] + part.points[f(3)]) / 4.);
+        });
+        part.faces4.erase(it4, part.faces4.end());
+
+        parts[tile_idx] = std::move(part);
+        grids[tile_idx] = clip_grid(*tile, core);
+    });
+
+    if (ctl.stopcondition()) return false;
+    else ctl.statuscb(70, L("Hollowing"));
+
+    // Stitch the blocks. The vertices on the block boundaries are calculated
+    // from the same voxels by both blocks, thus they match exactly.
+    indexed_triangle_set its;
+    for (Contour3D &part : parts) {
+        auto offset = int(its.vertices.size());
+        for (const Vec3d &p : part.points)
+            its.vertices.emplace_back(p.cast<float>());
+        for (const Vec3i &f : part.faces3)
+            its.indices.emplace_back(f(0) + offset, f(1) + offset, f(2) + offset);
+        for (const Vec4i &f : part.faces4) {
+            its.indices.emplace_back(f(0) + offset, f(1) + offset, f(2) + offset);
+            its.indices.emplace_back(f(2) + offset, f(3) + offset, f(0) + offset);
+        }
+        part = {};
+    }
+    its_merge_vertices(its);
+    its_compactify_vertices(its);
+    interior.mesh = TriangleMesh{its};
+
+    // The interior grid is needed to trim the model triangles inside the interior.
+    auto gridptr = openvdb::FloatGrid::create(float(narrowb));
+    gridptr->setTransform(grid.transform().copy());
+    gridptr->setGridClass(openvdb::GRID_LEVEL_SET);
+    gridptr->insertMeta(*grid.deepCopyMeta());
+    for (openvdb::FloatGrid::Ptr &tile : grids)
+        if (tile) {
+            merge_grid(*gridptr, *tile);
+            tile.reset();
+        }
+    // Only the narrow bands of the blocks were merged, the inactive tiles
+    // deep inside the interior are negative again after the flood fill.
+    sign_grid(*gridptr);
+    interior.gridptr = gridptr;
+
+    return true;
+}
+
 static InteriorPtr generate_interior_verbose(const TriangleMesh & mesh,
                                              const JobController &ctl,
                                              double min_thickness,
                                              double voxel_scale,
-                                             double closing_dist)
+                                             double closing_dist,
+                                             bool   adaptive)
 {
     double offset = voxel_scale * min_thickness;
     double D = voxel_scale * closing_dist;
@@ -91,16 +227,24 @@ static InteriorPtr generate_interior_verbose(const TriangleMesh & mesh,
 
     double iso_surface = D;
     auto   narrowb = double(in_range);
-    gridptr = redistance_grid(*gridptr, -(offset + D), narrowb, narrowb);
-
-    if (ctl.stopcondition()) return {};
-    else ctl.statuscb(70, L("Hollowing"));
-
-    double adaptivity = 0.;
     InteriorPtr interior = InteriorPtr{new Interior{}};
 
-    interior->mesh = grid_to_mesh(*gridptr, iso_surface, adaptivity);
-    interior->gridptr = gridptr;
+    openvdb::Coord dim = gridptr->evalActiveVoxelBoundingBox().dim();
+    if (adaptive && std::max({dim[0], dim[1], dim[2]}) > ADAPTIVE_TILE_SIZE) {
+        if (!generate_interior_tiled(*gridptr, ctl, -(offset + D), narrowb,
+                                     iso_surface, voxel_scale, *interior))
+            return {};
+        gridptr.reset();
+    } else {
+        gridptr = redistance_grid(*gridptr, -(offset + D), narrowb, narrowb);
+
+        if (ctl.stopcondition()) return {};
+        else ctl.statuscb(70, L("Hollowing"));
+
+        double adaptivity = 0.;
+        interior->mesh = grid_to_mesh(*gridptr, iso_surface, adaptivity);
+        interior->gridptr = gridptr;
+    }
 
     if (ctl.stopcondition()) return {};
     else ctl.statuscb(100, L("Hollowing"));
@@ -130,9 +274,18 @@ InteriorPtr generate_interior(const TriangleMesh &   mesh,
     // max 8x upscale, min is native voxel size
     auto voxel_scale = MIN_OVERSAMPL + (MAX_OVERSAMPL - MIN_OVERSAMPL) * hc.quality;
 
+    if (hc.adaptive) {
+        double requested_scale = voxel_scale;
+        voxel_scale = adaptive_voxel_scale(mesh, hc, voxel_scale);
+        if (voxel_scale < requested_scale)
+            BOOST_LOG_TRIVIAL(info) << "Hollowing: voxel scale lowered from "
+                                    << requested_scale << " to " << voxel_scale
+                                    << " to fit the voxel budget";
+    }
+
     InteriorPtr interior =
         generate_interior_verbose(mesh, ctl, hc.min_thickness, voxel_scale,
-                                  hc.closing_distance);
+                                  hc.closing_distance, hc.adaptive);
 
     if (interior && !interior->mesh.empty()) {
 
@@ -17,6 +17,9 @@ struct HollowingConfig
     double quality          = 0.5;
     double closing_distance = 0.5;
     bool enabled = true;
+    // Coarsen the voxels of large models to fit a voxel budget and generate
+    // the interior of large models in independent blocks in parallel.
+    bool adaptive = false;
 };
 
 enum HollowingFlags { hfRemoveInsideTriangles = 0x1 };
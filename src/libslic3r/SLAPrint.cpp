@@ -6,6 +6,7 @@
 #include "MTUtils.hpp"
 #include "Thread.hpp"
 
+#include <atomic>
 #include <unordered_set>
 #include <numeric>
 
@@ -905,6 +906,14 @@ SLAPrintObject::SLAPrintObject(SLAPrint *print, ModelObject *model_object)
 
 SLAPrintObject::~SLAPrintObject() {}
 
+void SLAPrintObject::update_slices_revision()
+{
+    // Revisions are unique over all the objects, thus a layer merged from a deleted object
+    // is never mistaken for a layer of a new object allocated at the same address.
+    static std::atomic<size_t> s_last_revision { 0 };
+    m_slices_revision = ++ s_last_revision;
+}
+
 // Called by SLAPrint::apply().
 // This method only accepts SLAPrintObjectConfig option keys.
 bool SLAPrintObject::invalidate_state_by_config_options(const std::vector<t_config_option_key> &opt_keys)
@@ -918,6 +927,7 @@ bool SLAPrintObject::invalidate_state_by_config_options(const std::vector<t_conf
         if (   opt_key == "hollowing_enable"
             || opt_key == "hollowing_min_thickness"
             || opt_key == "hollowing_quality"
+            || opt_key == "hollowing_adaptive"
             || opt_key == "hollowing_closing_distance"
             ) {
             steps.emplace_back(slaposHollowing);
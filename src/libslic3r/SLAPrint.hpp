@@ -68,6 +68,10 @@ public:
     };
     const std::vector<Instance>& instances() const { return m_instances; }
 
+    // Unique stamp of the current model and support slices and of the instances placing them.
+    // Changes whenever the slices are recalculated or the instances are modified.
+    size_t                  slices_revision() const { return m_slices_revision; }
+
     bool                    has_mesh(SLAPrintObjectStep step) const;
     TriangleMesh            get_mesh(SLAPrintObjectStep step) const;
 
@@ -273,7 +277,8 @@ protected:
         m_transformed_rmesh.invalidate([this, &trafo, left_handed](){ m_trafo = trafo; m_left_handed = left_handed; });
     }
 
-    template<class InstVec> inline void set_instances(InstVec&& instances) { m_instances = std::forward<InstVec>(instances); }
+    template<class InstVec> inline void set_instances(InstVec&& instances) { m_instances = std::forward<InstVec>(instances); this->update_slices_revision(); }
+    void                    update_slices_revision();
 
     // Invalidates the step, and its depending steps in SLAPrintObject and SLAPrint.
     bool                    invalidate_step(SLAPrintObjectStep step);
@@ -296,6 +301,9 @@ private:
 
     std::vector<Instance> 					m_instances;
 
+    // See slices_revision().
+    size_t                                  m_slices_revision = 0;
+
     // Individual 2d slice polygons from lower z to higher z levels
     std::vector<ExPolygons>                 m_model_slices;
 
@@ -482,12 +490,32 @@ public:
         // The collection of slice records for the current level.
         std::vector<std::reference_wrapper<const SliceRecord>> m_slices;
 
+        // Slices revisions of the objects contributing m_slices, see SLAPrintObject::slices_revision().
+        std::vector<size_t> m_slices_revisions;
+
         ExPolygons m_transformed_slices;
+        // Areas of the merged model and support slices, valid together with m_transformed_slices.
+        double     m_model_area   = 0.;
+        double     m_support_area = 0.;
+        bool       m_merged       = false;
 
         template<class Container> void transformed_slices(Container&& c)
         {
             m_transformed_slices = std::forward<Container>(c);
         }
+
+        // Take over the merged slices of a layer from the previous run of slapsMergeSlicesAndEval
+        // if the same revisions of the same objects contribute to both layers.
+        bool reuse_merged(PrintLayer &&prev)
+        {
+            if (! prev.m_merged || prev.m_level != m_level || prev.m_slices_revisions != m_slices_revisions)
+                return false;
+            m_transformed_slices = std::move(prev.m_transformed_slices);
+            m_model_area         = prev.m_model_area;
+            m_support_area       = prev.m_support_area;
+            m_merged             = true;
+            return true;
+        }
         
         friend class SLAPrint::Steps;
 
@@ -500,7 +528,10 @@ public:
             return m_level < other.m_level;
         }
 
-        void add(const SliceRecord& sr) { m_slices.emplace_back(sr); }
+        void add(const SliceRecord& sr) {
+            m_slices.emplace_back(sr);
+            m_slices_revisions.emplace_back(sr.print_obj() ? sr.print_obj()->slices_revision() : 0);
+        }
 
         coord_t level() const { return m_level; }
 
@@ -132,6 +132,7 @@ void SLAPrint::Steps::hollow_model(SLAPrintObject &po)
     double quality  = po.m_config.hollowing_quality.getFloat();
     double closing_d = po.m_config.hollowing_closing_distance.getFloat();
     sla::HollowingConfig hlwcfg{thickness, quality, closing_d};
+    hlwcfg.adaptive = po.m_config.hollowing_adaptive.getBool();
 
     sla::InteriorPtr interior = generate_interior(po.transformed_mesh(), hlwcfg);
 
@@ -694,6 +695,9 @@ void SLAPrint::Steps::generate_pad(SLAPrintObject &po) {
 void SLAPrint::Steps::slice_supports(SLAPrintObject &po) {
     auto& sd = po.m_supportdata;
 
+    // This is the last step modifying the slices of the object, the model slices are invalidated together with the supports.
+    po.update_slices_revision();
+
     if(sd) sd->support_slices.clear();
 
     // Don't bother if no supports and no pad is present.
@@ -864,6 +868,9 @@ void SLAPrint::Steps::initialize_printer_input()
 // calculating print statistics from the merge result.
 void SLAPrint::Steps::merge_slices_and_eval_stats() {
 
+    // Keep the layers of the previous run, their merged slices are reused
+    // if the contributing objects did not change.
+    std::vector<PrintLayer> prev_printer_input = std::move(m_print->m_printer_input);
     initialize_printer_input();
 
     auto &print_statistics = m_print->m_print_statistics;
@@ -886,40 +893,25 @@ void SLAPrint::Steps::merge_slices_and_eval_stats() {
     const auto height         = scaled<double>(printer_config.display_height.getFloat());
     const double display_area = width*height;
 
-    double supports_volume(0.0);
-    double models_volume(0.0);
-
-    double estim_time(0.0);
-    std::vector<double> layers_times;
-    layers_times.reserve(printer_input.size());
-
-    size_t slow_layers = 0;
-    size_t fast_layers = 0;
-
-    const double delta_fade_time = (init_exp_time - exp_time) / (fade_layers_cnt + 1);
-    double fade_layer_time = init_exp_time;
-
-    sla::ccr::SpinningMutex mutex;
-    using Lock = std::lock_guard<sla::ccr::SpinningMutex>;
-
-    // Going to parallel:
-    auto printlayerfn = [this,
-            // functions and read only vars
-            area_fill, display_area, exp_time, init_exp_time, fast_tilt, slow_tilt, delta_fade_time,
+    // Both the old and the new layers are sorted by their levels.
+    size_t num_reused = 0;
+    for (PrintLayer &layer : printer_input) {
+        auto it = std::lower_bound(prev_printer_input.begin(), prev_printer_input.end(), layer);
+        if (it != prev_printer_input.end() && layer.reuse_merged(std::move(*it)))
+            ++ num_reused;
+    }
+    prev_printer_input.clear();
+    BOOST_LOG_TRIVIAL(debug) << "SLA merged layers reused: " << num_reused << " of " << printer_input.size();
 
-            // write vars
-            &mutex, &models_volume, &supports_volume, &estim_time, &slow_layers,
-            &fast_layers, &fade_layer_time, &layers_times](size_t sliced_layer_cnt)
+    // Going to parallel, each layer is merged independently:
+    auto printlayerfn = [this](size_t sliced_layer_cnt)
     {
         PrintLayer &layer = m_print->m_printer_input[sliced_layer_cnt];
 
         // vector of slice record references
         auto& slicerecord_references = layer.slices();
 
-        if(slicerecord_references.empty()) return;
-
-        // Layer height should match for all object slices for a given level.
-        const auto l_height = double(slicerecord_references.front().get().layer_height());
+        if(slicerecord_references.empty() || layer.m_merged) return;
 
         // Calculation of the consumed material
 
@@ -959,10 +951,6 @@ void SLAPrint::Steps::merge_slices_and_eval_stats() {
         for (const ExPolygon& polygon : model_polygons)
             layer_model_area += area(polygon);
 
-        if (layer_model_area < 0 || layer_model_area > 0) {
-            Lock lck(mutex); models_volume += layer_model_area * l_height;
-        }
-
         if(!supports_polygons.empty()) {
             if(model_polygons.empty()) supports_polygons = union_ex(supports_polygons);
             else supports_polygons = diff_ex(supports_polygons, model_polygons);
@@ -973,10 +961,6 @@ void SLAPrint::Steps::merge_slices_and_eval_stats() {
         for (const ExPolygon& polygon : supports_polygons)
             layer_support_area += area(polygon);
 
-        if (layer_support_area < 0 || layer_support_area > 0) {
-            Lock lck(mutex); supports_volume += layer_support_area * l_height;
-        }
-
         // Here we can save the expensively calculated polygons for printing
         ExPolygons trslices;
         trslices.reserve(model_polygons.size() + supports_polygons.size());
@@ -984,39 +968,67 @@ void SLAPrint::Steps::merge_slices_and_eval_stats() {
         for(ExPolygon& poly : supports_polygons) trslices.emplace_back(std::move(poly));
 
         layer.transformed_slices(union_ex(trslices));
+        layer.m_model_area   = layer_model_area;
+        layer.m_support_area = layer_support_area;
+        layer.m_merged       = true;
+    };
+
+    // sequential version for debugging:
+    // for(size_t i = 0; i < m_printer_input.size(); ++i) printlayerfn(i);
+    sla::ccr::for_each(size_t(0), printer_input.size(), printlayerfn);
+
+    // Reduce the per layer results in the order of the layers,
+    // the exposure time of the faded layers depends on the preceding layers.
+    double supports_volume(0.0);
+    double models_volume(0.0);
+
+    double estim_time(0.0);
+    std::vector<double> layers_times;
+    layers_times.reserve(printer_input.size());
+
+    size_t slow_layers = 0;
+    size_t fast_layers = 0;
+
+    const double delta_fade_time = (init_exp_time - exp_time) / (fade_layers_cnt + 1);
+    double fade_layer_time = init_exp_time;
+
+    for (size_t sliced_layer_cnt = 0; sliced_layer_cnt < printer_input.size(); ++ sliced_layer_cnt) {
+        const PrintLayer &layer = printer_input[sliced_layer_cnt];
+        if (layer.slices().empty())
+            continue;
+
+        // Layer height should match for all object slices for a given level.
+        const auto l_height = double(layer.slices().front().get().layer_height());
+
+        models_volume   += layer.m_model_area * l_height;
+        supports_volume += layer.m_support_area * l_height;
 
         // Calculation of the slow and fast layers to the future controlling those values on FW
 
-        const bool is_fast_layer = (layer_model_area + layer_support_area) <= display_area*area_fill;
+        const bool is_fast_layer = (layer.m_model_area + layer.m_support_area) <= display_area*area_fill;
         const double tilt_time = is_fast_layer ? fast_tilt : slow_tilt;
 
-        { Lock lck(mutex);
-            if (is_fast_layer)
-                fast_layers++;
-            else
-                slow_layers++;
+        if (is_fast_layer)
+            fast_layers++;
+        else
+            slow_layers++;
 
-            // Calculation of the printing time
+        // Calculation of the printing time
 
-            double layer_times = 0.0;
-            if (sliced_layer_cnt < 3)
-                layer_times += init_exp_time;
-            else if (fade_layer_time > exp_time) {
-                fade_layer_time -= delta_fade_time;
-                layer_times += fade_layer_time;
-            }
-            else
-                layer_times += exp_time;
-            layer_times += tilt_time;
-
-            layers_times.push_back(layer_times);
-            estim_time += layer_times;
+        double layer_times = 0.0;
+        if (sliced_layer_cnt < 3)
+            layer_times += init_exp_time;
+        else if (fade_layer_time > exp_time) {
+            fade_layer_time -= delta_fade_time;
+            layer_times += fade_layer_time;
         }
-    };
+        else
+            layer_times += exp_time;
+        layer_times += tilt_time;
 
-    // sequential version for debugging:
-    // for(size_t i = 0; i < m_printer_input.size(); ++i) printlayerfn(i);
-    sla::ccr::for_each(size_t(0), printer_input.size(), printlayerfn);
+        layers_times.push_back(layer_times);
+        estim_time += layer_times;
+    }
 
     auto SCALING2 = SCALING_FACTOR * SCALING_FACTOR;
     print_statistics.support_used_material = supports_volume * SCALING2;
@@ -1033,6 +1033,38 @@ void chain_and_reorder_extrusion_entities(std::vector<ExtrusionEntity*> &entitie
 	reorder_extrusion_entities(entities, chain_extrusion_entities(entities, start_near));
 }
 
+ExtrusionEntityReferences chain_extrusion_references(const ExtrusionEntitiesPtr &entities, const Point *start_near)
+{
+	auto segment_end_point = [&entities](size_t idx, bool first_point) -> const Point& { return first_point ? entities[idx]->first_point() : entities[idx]->last_point(); };
+	auto could_reverse = [&entities](size_t idx) { const ExtrusionEntity *ee = entities[idx]; return ee->is_loop() || ee->can_reverse(); };
+	std::vector<std::pair<size_t, bool>> chain = chain_segments_greedy_constrained_reversals<Point, decltype(segment_end_point), decltype(could_reverse)>(segment_end_point, could_reverse, entities.size(), start_near);
+	ExtrusionEntityReferences out;
+	out.reserve(chain.size());
+	for (const std::pair<size_t, bool> &idx : chain) {
+		const ExtrusionEntity *ee = entities[idx.first];
+		assert(ee != nullptr);
+		// Ignore reversals for loops, as the start point equals the end point.
+		out.emplace_back(*ee, idx.second && ! ee->is_loop());
+	}
+	return out;
+}
+
+ExtrusionEntityReferences chain_extrusion_references(const ExtrusionEntityCollection &eec, const Point *start_near, bool reversed)
+{
+	if (! eec.no_sort)
+		return chain_extrusion_references(eec.entities, start_near);
+	ExtrusionEntityReferences out;
+	out.reserve(eec.entities.size());
+	if (reversed) {
+		for (auto it = eec.entities.rbegin(); it != eec.entities.rend(); ++ it)
+			out.emplace_back(**it, ! (*it)->is_loop());
+	} else {
+		for (const ExtrusionEntity *ee : eec.entities)
+			out.emplace_back(*ee, false);
+	}
+	return out;
+}
+
 std::vector<std::pair<size_t, bool>> chain_extrusion_paths(std::vector<ExtrusionPath> &extrusion_paths, const Point *start_near)
 {
 	auto segment_end_point = [&extrusion_paths](size_t idx, bool first_point) -> const Point& { return first_point ? extrusion_paths[idx].first_point() : extrusion_paths[idx].last_point(); };
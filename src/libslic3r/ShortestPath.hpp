@@ -17,6 +17,11 @@ std::vector<size_t> 				 chain_points(const Points &points, Point *start_near =
 std::vector<std::pair<size_t, bool>> chain_extrusion_entities(std::vector<ExtrusionEntity*> &entities, const Point *start_near = nullptr);
 void                                 reorder_extrusion_entities(std::vector<ExtrusionEntity*> &entities, const std::vector<std::pair<size_t, bool>> &chain);
 void                                 chain_and_reorder_extrusion_entities(std::vector<ExtrusionEntity*> &entities, const Point *start_near = nullptr);
+// Chain the extrusion entities without modifying them, the reversals are stored into the references.
+ExtrusionEntityReferences            chain_extrusion_references(const ExtrusionEntitiesPtr &entities, const Point *start_near = nullptr);
+// Chain the entities of a collection, unless the collection is not to be sorted. Then the entities are referenced in their order,
+// reversed if the collection is reversed.
+ExtrusionEntityReferences            chain_extrusion_references(const ExtrusionEntityCollection &eec, const Point *start_near = nullptr, bool reversed = false);
 
 std::vector<std::pair<size_t, bool>> chain_extrusion_paths(std::vector<ExtrusionPath> &extrusion_paths, const Point *start_near = nullptr);
 void                                 reorder_extrusion_paths(std::vector<ExtrusionPath> &extrusion_paths, std::vector<std::pair<size_t, bool>> &chain);
@@ -3,11 +3,13 @@
 #include "Layer.hpp"
 #include "Print.hpp"
 #include "SupportMaterial.hpp"
+#include "TreeSupport.hpp"
 #include "Fill/FillBase.hpp"
 #include "Geometry.hpp"
 #include "Point.hpp"
 #include "MutablePolygon.hpp"
 
+#include <atomic>
 #include <cmath>
 #include <memory>
 #include <boost/log/trivial.hpp>
@@ -15,7 +17,7 @@
 
 #include <tbb/parallel_for.h>
 #include <tbb/atomic.h>
-#include <tbb/spin_mutex.h>
+#include <tbb/task_arena.h>
 #include <tbb/task_group.h>
 
 #define SUPPORT_USE_AGG_RASTERIZER
@@ -369,27 +371,11 @@ PrintObjectSupportMaterial::PrintObjectSupportMaterial(const PrintObject *object
     }
 }
 
-// Using the std::deque as an allocator.
 inline PrintObjectSupportMaterial::MyLayer& layer_allocate(
-    std::deque<PrintObjectSupportMaterial::MyLayer> &layer_storage, 
+    PrintObjectSupportMaterial::MyLayerStorage      &layer_storage, 
     PrintObjectSupportMaterial::SupporLayerType      layer_type)
 { 
-    layer_storage.push_back(PrintObjectSupportMaterial::MyLayer());
-    layer_storage.back().layer_type = layer_type;
-    return layer_storage.back();
-}
-
-inline PrintObjectSupportMaterial::MyLayer& layer_allocate(
-    std::deque<PrintObjectSupportMaterial::MyLayer> &layer_storage,
-    tbb::spin_mutex                                 &layer_storage_mutex,
-    PrintObjectSupportMaterial::SupporLayerType      layer_type)
-{ 
-    layer_storage_mutex.lock();
-    layer_storage.push_back(PrintObjectSupportMaterial::MyLayer());
-    PrintObjectSupportMaterial::MyLayer *layer_new = &layer_storage.back();
-    layer_storage_mutex.unlock();
-    layer_new->layer_type = layer_type;
-    return *layer_new;
+    return layer_storage.allocate(layer_type);
 }
 
 inline void layers_append(PrintObjectSupportMaterial::MyLayersPtr &dst, const PrintObjectSupportMaterial::MyLayersPtr &src)
@@ -879,7 +865,9 @@ public:
             return out;
         }
         case smsSnug:
+        case smsTree:
             // Merge the support polygons by applying morphological closing and inwards smoothing.
+            // Tree supports start their branches from the snug contact areas.
             auto closing_distance   = scaled<float>(m_support_material_closing_radius);
             auto smoothing_distance = scaled<float>(m_extrusion_width);
             return smooth_outward(offset(offset_ex(*m_support_polygons, closing_distance), - closing_distance), smoothing_distance);
@@ -1591,8 +1579,7 @@ static inline std::pair<PrintObjectSupportMaterial::MyLayer*, PrintObjectSupport
     const PrintObjectConfig                             &object_config,
     const SlicingParameters                             &slicing_params, 
     const Layer                                         &layer, 
-    std::deque<PrintObjectSupportMaterial::MyLayer>     &layer_storage,
-    tbb::spin_mutex                                     &layer_storage_mutex)
+    PrintObjectSupportMaterial::MyLayerStorage          &layer_storage)
 {
     double print_z, bottom_z, height;
     PrintObjectSupportMaterial::MyLayer* bridging_layer = nullptr;
@@ -1648,7 +1635,7 @@ static inline std::pair<PrintObjectSupportMaterial::MyLayer*, PrintObjectSupport
                 }
                 if (bridging_print_z < print_z - EPSILON) {
                     // Allocate the new layer.
-                    bridging_layer = &layer_allocate(layer_storage, layer_storage_mutex, PrintObjectSupportMaterial::sltTopContact);
+                    bridging_layer = &layer_allocate(layer_storage, PrintObjectSupportMaterial::sltTopContact);
                     bridging_layer->idx_object_layer_above = layer_id;
                     bridging_layer->print_z = bridging_print_z;
                     if (bridging_print_z == slicing_params.first_print_layer_height) {
@@ -1665,7 +1652,7 @@ static inline std::pair<PrintObjectSupportMaterial::MyLayer*, PrintObjectSupport
         }
     }
 
-    PrintObjectSupportMaterial::MyLayer &new_layer = layer_allocate(layer_storage, layer_storage_mutex, PrintObjectSupportMaterial::sltTopContact);
+    PrintObjectSupportMaterial::MyLayer &new_layer = layer_allocate(layer_storage, PrintObjectSupportMaterial::sltTopContact);
     new_layer.idx_object_layer_above = layer_id;
     new_layer.print_z  = print_z;
     new_layer.bottom_z = bottom_z;
@@ -1888,15 +1875,16 @@ PrintObjectSupportMaterial::MyLayersPtr PrintObjectSupportMaterial::top_contact_
     // For each overhang layer, two supporting layers may be generated: One for the overhangs extruded with a bridging flow, 
     // and the other for the overhangs extruded with a normal flow.
     contact_out.assign(num_layers * 2, nullptr);
-    tbb::spin_mutex layer_storage_mutex;
     tbb::parallel_for(tbb::blocked_range<size_t>(this->has_raft() ? 0 : 1, num_layers),
-        [this, &object, &annotations, &layer_storage, &layer_storage_mutex, &contact_out]
+        [this, &object, &annotations, &layer_storage, &contact_out]
         (const tbb::blocked_range<size_t>& range) {
             for (size_t layer_id = range.begin(); layer_id < range.end(); ++ layer_id) 
             {
                 const Layer        &layer                = *object.layers()[layer_id];
                 Polygons            lower_layer_polygons = (layer_id == 0) ? Polygons() : to_polygons(object.layers()[layer_id - 1]->lslices);
                 SlicesMarginCache   slices_margin;
+                // The bridging extrusions of the layer are looked at, load them back if spilled.
+                RestoredLayers      restored(m_object_config->dont_support_bridges || m_object_config->thick_bridges ? object.print()->layer_spill() : nullptr, { &layer });
 
                 auto [overhang_polygons, contact_polygons, enforcer_polygons, no_interface_offset] =
                     detect_overhangs(layer, layer_id, lower_layer_polygons, *m_print_config, *m_object_config, annotations, slices_margin, m_support_params.gap_xy
@@ -1907,7 +1895,7 @@ PrintObjectSupportMaterial::MyLayersPtr PrintObjectSupportMaterial::top_contact_
 
                 // Now apply the contact areas to the layer where they need to be made.
                 if (! contact_polygons.empty()) {
-                    auto [new_layer, bridging_layer] = new_contact_layer(*m_print_config, *m_object_config, m_slicing_params, layer, layer_storage, layer_storage_mutex);
+                    auto [new_layer, bridging_layer] = new_contact_layer(*m_print_config, *m_object_config, m_slicing_params, layer, layer_storage);
                     if (new_layer) {
                         fill_contact_layer(*new_layer, layer_id, m_slicing_params,
                             *m_object_config, slices_margin, overhang_polygons, contact_polygons, enforcer_polygons, lower_layer_polygons,
@@ -1951,11 +1939,12 @@ static inline PrintObjectSupportMaterial::MyLayer* detect_bottom_contacts(
     // First top contact layer index overlapping with this new bottom interface layer.
     size_t                                            contact_idx,
     // To allocate a new layer from.
-    std::deque<PrintObjectSupportMaterial::MyLayer>  &layer_storage,
-    // To trim the support areas above this bottom interface layer with this newly created bottom interface layer.
-    std::vector<Polygons>                            &layer_support_areas,
+    PrintObjectSupportMaterial::MyLayerStorage       &layer_storage,
     // Support areas projected from top to bottom, starting with top support interfaces.
-    const Polygons                                   &supports_projected
+    const Polygons                                   &supports_projected,
+    // Output: Areas of the top surfaces touching the support areas projected from above,
+    // to trim the support areas above this bottom interface layer with, see trim_support_areas_by_bottom_contact().
+    Polygons                                         &touching_out
 #ifdef SLIC3R_DEBUG
     , size_t                                          iRun
     , const Polygons                                 &polygons_new
@@ -2041,111 +2030,155 @@ static inline PrintObjectSupportMaterial::MyLayer* detect_bottom_contacts(
         union_ex(layer_new.polygons, false));
 #endif /* SLIC3R_DEBUG */
 
-    // Trim the already created base layers above the current layer intersecting with the new bottom contacts layer.
-    //FIXME Maybe this is no more needed, as the overlapping base layers are trimmed by the bottom layers at the final stage?
-    touching = offset(touching, float(SCALED_EPSILON));
-    for (int layer_id_above = layer_id + 1; layer_id_above < int(object.total_layer_count()); ++layer_id_above) {
+    touching_out = offset(touching, float(SCALED_EPSILON));
+    return &layer_new;
+}
+
+// Trim the support areas of the layers above a new bottom contact layer intersecting with the new bottom contacts layer.
+//FIXME Maybe this is no more needed, as the overlapping base layers are trimmed by the bottom layers at the final stage?
+static inline void trim_support_areas_by_bottom_contact(
+    const PrintObject                                &object,
+    const PrintObjectSupportMaterial::MyLayer        &layer_new,
+    // Areas of the top surfaces supporting the new bottom contact layer, see detect_bottom_contacts().
+    const Polygons                                   &touching,
+    std::vector<Polygons>                            &layer_support_areas
+#ifdef SLIC3R_DEBUG
+    , size_t                                          iRun
+#endif // SLIC3R_DEBUG
+    )
+{
+    for (int layer_id_above = int(layer_new.idx_object_layer_below) + 1; layer_id_above < int(object.total_layer_count()); ++layer_id_above) {
         const Layer &layer_above = *object.layers()[layer_id_above];
         if (layer_above.print_z > layer_new.print_z - EPSILON)
             break;
         if (! layer_support_areas[layer_id_above].empty()) {
 #ifdef SLIC3R_DEBUG
-            SVG::export_expolygons(debug_out_path("support-support-areas-raw-before-trimming-%d-with-%f-%lf.svg", iRun, layer.print_z, layer_above.print_z),
+            SVG::export_expolygons(debug_out_path("support-support-areas-raw-before-trimming-%d-with-%f-%lf.svg", iRun, layer_new.bottom_z, layer_above.print_z),
                 { { { union_ex(touching, false) },                            { "touching", "blue", 0.5f } },
                     { { union_ex(layer_support_areas[layer_id_above], true) },  { "above",    "red", "black", "", scaled<coord_t>(0.1f), 0.5f } } });
 #endif /* SLIC3R_DEBUG */
             layer_support_areas[layer_id_above] = diff(layer_support_areas[layer_id_above], touching);
 #ifdef SLIC3R_DEBUG
             Slic3r::SVG::export_expolygons(
-                debug_out_path("support-support-areas-raw-after-trimming-%d-with-%f-%lf.svg", iRun, layer.print_z, layer_above.print_z),
+                debug_out_path("support-support-areas-raw-after-trimming-%d-with-%f-%lf.svg", iRun, layer_new.bottom_z, layer_above.print_z),
                 union_ex(layer_support_areas[layer_id_above], false));
 #endif /* SLIC3R_DEBUG */
         }
     }
-
-    return &layer_new;
 }
 
-// Returns polygons to print + polygons to propagate downwards.
+// Overhangs projected from the layers above to a layer, trimmed by the layer and snapped to the support grid.
+// Owns the polygons referenced by the grid pattern, thus the support polygons may be extracted from the grid asynchronously.
+struct ProjectedSupportGrid
+{
+    Polygons                                trimming;
+    Polygons                                overhangs_projection;
+    std::unique_ptr<SupportGridPattern>     pattern;
+};
+
+// Project the overhangs to the support grid of a layer. Both the polygons to print and the polygons to propagate downwards are extracted from the grid.
 // Called twice: First for normal supports, possibly trimmed by "on build plate only", second for support enforcers not trimmed by "on build plate only".
-static inline std::pair<Polygons, Polygons> project_support_to_grid(const Layer &layer, const SupportGridParams &grid_params, const Polygons &overhangs, Polygons *layer_buildplate_covered
+static inline std::shared_ptr<ProjectedSupportGrid> project_support_to_grid(const Layer &layer, const SupportGridParams &grid_params, const Polygons &overhangs, Polygons *layer_buildplate_covered
 #ifdef SLIC3R_DEBUG 
     , size_t iRun, size_t layer_id, const char *debug_name
 #endif /* SLIC3R_DEBUG */
 )
 {
+    auto out = std::make_shared<ProjectedSupportGrid>();
+
     // Remove the areas that touched from the projection that will continue on next, lower, top surfaces.
 //            Polygons trimming = union_(to_polygons(layer.slices), touching, true);
-    Polygons trimming = layer_buildplate_covered ? std::move(*layer_buildplate_covered) : offset(layer.lslices, float(SCALED_EPSILON));
-    Polygons overhangs_projection = diff(overhangs, trimming);
+    out->trimming = layer_buildplate_covered ? std::move(*layer_buildplate_covered) : offset(layer.lslices, float(SCALED_EPSILON));
+    out->overhangs_projection = diff(overhangs, out->trimming);
 
 #ifdef SLIC3R_DEBUG
     SVG::export_expolygons(debug_out_path("support-support-areas-%s-raw-%d-%lf.svg", debug_name, iRun, layer.print_z),
-        { { { union_ex(trimming, false) },              { "trimming",               "blue", 0.5f } },
-          { { union_ex(overhangs_projection, true) },   { "overhangs_projection",   "red", "black", "", scaled<coord_t>(0.1f), 0.5f } } });
+        { { { union_ex(out->trimming, false) },              { "trimming",               "blue", 0.5f } },
+          { { union_ex(out->overhangs_projection, true) },   { "overhangs_projection",   "red", "black", "", scaled<coord_t>(0.1f), 0.5f } } });
 #endif /* SLIC3R_DEBUG */
 
-    remove_sticks(overhangs_projection);
-    remove_degenerate(overhangs_projection);
+    remove_sticks(out->overhangs_projection);
+    remove_degenerate(out->overhangs_projection);
 
 #ifdef SLIC3R_DEBUG
     SVG::export_expolygons(debug_out_path("support-support-areas-%s-raw-cleaned-%d-%lf.svg", debug_name, iRun, layer.print_z),
-        { { { union_ex(trimming, false) },              { "trimming",             "blue", 0.5f } },
-          { { union_ex(overhangs_projection, false) },  { "overhangs_projection", "red", "black", "", scaled<coord_t>(0.1f), 0.5f } } });
+        { { { union_ex(out->trimming, false) },              { "trimming",             "blue", 0.5f } },
+          { { union_ex(out->overhangs_projection, false) },  { "overhangs_projection", "red", "black", "", scaled<coord_t>(0.1f), 0.5f } } });
 #endif /* SLIC3R_DEBUG */
 
-    SupportGridPattern support_grid_pattern(&overhangs_projection, &trimming, grid_params);
-    tbb::task_group task_group_inner;
-
-    std::pair<Polygons, Polygons> out;
+    out->pattern = std::make_unique<SupportGridPattern>(&out->overhangs_projection, &out->trimming, grid_params);
+    return out;
+}
 
-    // 1) Cache the slice of a support volume. The support volume is expanded by 1/2 of support material flow spacing
-    // to allow a placement of suppot zig-zag snake along the grid lines.
-    task_group_inner.run([&grid_params, &support_grid_pattern, &out
+// Cache the slice of a support volume. The support volume is expanded by 1/2 of support material flow spacing
+// to allow a placement of suppot zig-zag snake along the grid lines.
+static inline Polygons extract_support_area(ProjectedSupportGrid &grid, const SupportGridParams &grid_params
 #ifdef SLIC3R_DEBUG 
-        , &layer, layer_id, iRun, debug_name
+    , const Layer &layer, size_t iRun, size_t layer_id, const char *debug_name
 #endif /* SLIC3R_DEBUG */
-    ] {
-            out.first = support_grid_pattern.extract_support(grid_params.expansion_to_slice, true
+)
+{
+    Polygons out = grid.pattern->extract_support(grid_params.expansion_to_slice, true
 #ifdef SLIC3R_DEBUG
-                , (std::string(debug_name) + "_support_area").c_str(), iRun, layer_id, layer.print_z
+        , (std::string(debug_name) + "_support_area").c_str(), iRun, layer_id, layer.print_z
 #endif // SLIC3R_DEBUG
-            );
+    );
 #ifdef SLIC3R_DEBUG
-            Slic3r::SVG::export_expolygons(
-                debug_out_path("support-layer_support_area-gridded-%s-%d-%lf.svg", debug_name, iRun, layer.print_z),
-                union_ex(out.first, false));
+    Slic3r::SVG::export_expolygons(
+        debug_out_path("support-layer_support_area-gridded-%s-%d-%lf.svg", debug_name, iRun, layer.print_z),
+        union_ex(out, false));
 #endif /* SLIC3R_DEBUG */
-        });
+    return out;
+}
 
-    // 2) Support polygons will be projected down. To keep the interface and base layers from growing, return a contour a tiny bit smaller than the grid cells.
-    task_group_inner.run([&grid_params, &support_grid_pattern, &out
+// Support polygons will be projected down. To keep the interface and base layers from growing, return a contour a tiny bit smaller than the grid cells.
+static inline Polygons extract_support_projection(ProjectedSupportGrid &grid, const SupportGridParams &grid_params
 #ifdef SLIC3R_DEBUG 
-        , &layer, layer_id, &overhangs_projection, &trimming, iRun, debug_name
+    , const Layer &layer, size_t iRun, size_t layer_id
 #endif /* SLIC3R_DEBUG */
-    ] {
-            out.second = support_grid_pattern.extract_support(grid_params.expansion_to_propagate, true
+)
+{
+    Polygons out = grid.pattern->extract_support(grid_params.expansion_to_propagate, true
 #ifdef SLIC3R_DEBUG
-                , "support_projection", iRun, layer_id, layer.print_z
+        , "support_projection", iRun, layer_id, layer.print_z
 #endif // SLIC3R_DEBUG
-            );
-#ifdef SLIC3R_DEBUG
-            Slic3r::SVG::export_expolygons(
-                debug_out_path("support-projection_new-gridded-%d-%lf.svg", iRun, layer.print_z),
-                union_ex(out.second, false));
-#endif /* SLIC3R_DEBUG */
+    );
 #ifdef SLIC3R_DEBUG
-            SVG::export_expolygons(debug_out_path("support-projection_new-gridded-%d-%lf.svg", iRun, layer.print_z),
-                { { { union_ex(trimming, false) },                { "trimming",               "gray", 0.5f } },
-                    { { union_ex(overhangs_projection, true) },   { "overhangs_projection",   "blue", 0.5f } },
-                    { { union_ex(out.second, true) },             { "projection_new", "red",  "black", "", scaled<coord_t>(0.1f), 0.5f } } });
+    SVG::export_expolygons(debug_out_path("support-projection_new-gridded-%d-%lf.svg", iRun, layer.print_z),
+        { { { union_ex(grid.trimming, false) },                { "trimming",               "gray", 0.5f } },
+            { { union_ex(grid.overhangs_projection, true) },   { "overhangs_projection",   "blue", 0.5f } },
+            { { union_ex(out, true) },                         { "projection_new", "red",  "black", "", scaled<coord_t>(0.1f), 0.5f } } });
 #endif /* SLIC3R_DEBUG */
-        });
-
-    task_group_inner.wait();
     return out;
 }
 
+// Trim the support areas of the layers above the bottom contacts, return the bottom contacts sorted bottom up.
+static inline PrintObjectSupportMaterial::MyLayersPtr collect_bottom_contacts(
+    const PrintObject                                           &object,
+    // Bottom contact layers indexed by the object layer they are placed on.
+    const std::vector<PrintObjectSupportMaterial::MyLayer*>     &bottom_contacts_by_layer,
+    // Areas to trim the support areas above the bottom contact layers with, see detect_bottom_contacts().
+    const std::vector<Polygons>                                 &bottom_contacts_touching,
+    std::vector<Polygons>                                       &layer_support_areas
+#ifdef SLIC3R_DEBUG
+    , size_t                                                     iRun
+#endif // SLIC3R_DEBUG
+    )
+{
+    PrintObjectSupportMaterial::MyLayersPtr bottom_contacts;
+    for (int layer_id = int(bottom_contacts_by_layer.size()) - 1; layer_id >= 0; -- layer_id)
+        if (const PrintObjectSupportMaterial::MyLayer *layer_new = bottom_contacts_by_layer[layer_id]; layer_new)
+            trim_support_areas_by_bottom_contact(object, *layer_new, bottom_contacts_touching[layer_id], layer_support_areas
+#ifdef SLIC3R_DEBUG
+                , iRun
+#endif // SLIC3R_DEBUG
+            );
+    for (PrintObjectSupportMaterial::MyLayer *layer_new : bottom_contacts_by_layer)
+        if (layer_new)
+            bottom_contacts.push_back(layer_new);
+    return bottom_contacts;
+}
+
 // Generate bottom contact layers supporting the top contact layers.
 // For a soluble interface material synchronize the layer heights with the object, 
 // otherwise set the layer height to a bridging flow of a support interface nozzle.
@@ -2156,6 +2189,9 @@ PrintObjectSupportMaterial::MyLayersPtr PrintObjectSupportMaterial::bottom_conta
     if (top_contacts.empty())
         return MyLayersPtr();
 
+    if (m_object_config->support_material_style == smsTree)
+        return this->bottom_contact_layers_and_tree_support_areas(object, top_contacts, buildplate_covered, layer_storage, layer_support_areas);
+
 #ifdef SLIC3R_DEBUG
     static size_t s_iRun = 0;
     size_t iRun = s_iRun ++;
@@ -2181,6 +2217,18 @@ PrintObjectSupportMaterial::MyLayersPtr PrintObjectSupportMaterial::bottom_conta
     Polygons  enforcers_projection;
     // Last top contact layer visited when collecting the projection of contact areas.
     int       contact_idx = int(top_contacts.size()) - 1;
+
+    // Number of the asynchronous tasks not finished yet.
+    std::atomic<size_t>     num_pending { 0 };
+    const size_t            max_pending = 4 * size_t(tbb::this_task_arena::max_concurrency());
+    // Bottom contact layers and the areas they trim the support areas above with, indexed by the object layer they are placed on.
+    std::vector<MyLayer*>   bottom_contacts_by_layer(object.total_layer_count(), nullptr);
+    std::vector<Polygons>   bottom_contacts_touching(object.total_layer_count());
+    // Support areas are extracted and bottom contacts are detected by asynchronous tasks.
+    // Declared after all the data the tasks reference, so that the tasks are waited for before the data is destroyed
+    // when an exception unwinds the stack.
+    tbb::task_group         task_group;
+
     for (int layer_id = int(object.total_layer_count()) - 2; layer_id >= 0; -- layer_id) {
         BOOST_LOG_TRIVIAL(trace) << "Support generator - bottom_contact_layers - layer " << layer_id;
         const Layer &layer = *object.get_layer(layer_id);
@@ -2218,71 +2266,183 @@ PrintObjectSupportMaterial::MyLayersPtr PrintObjectSupportMaterial::bottom_conta
         if (overhangs_projection.empty() && enforcers_projection.empty())
             continue;
 
-        // Overhangs_projection will be filled in asynchronously, move it away.
-        Polygons overhangs_projection_raw = union_(std::move(overhangs_projection));
-        Polygons enforcers_projection_raw = union_(std::move(enforcers_projection));
+        // Overhangs_projection will be replaced by the projection to this layer, move it away.
+        auto overhangs_projection_raw = std::make_shared<Polygons>(union_(std::move(overhangs_projection)));
+        auto enforcers_projection_raw = std::make_shared<Polygons>(union_(std::move(enforcers_projection)));
 
-        tbb::task_group task_group;
-        const Polygons &overhangs_for_bottom_contacts = buildplate_only ? enforcers_projection_raw : overhangs_projection_raw;
-        if (! overhangs_for_bottom_contacts.empty())
-            // Find the bottom contact layers above the top surfaces of this layer.
-            task_group.run([this, &object, &layer, &top_contacts, contact_idx, &layer_storage, &layer_support_areas, &bottom_contacts, &overhangs_for_bottom_contacts
-    #ifdef SLIC3R_DEBUG
-                , iRun, &polygons_new
-    #endif // SLIC3R_DEBUG
+        // The projection to the layer below depends on the projection to this layer only, thus the propagation
+        // is the only serial part. Project to this layer, then continue with the layer below while the support
+        // areas of this layer are extracted and the bottom contacts are detected asynchronously.
+        std::shared_ptr<ProjectedSupportGrid> support_grid;
+        std::shared_ptr<ProjectedSupportGrid> enforcers_grid;
+        {
+            tbb::task_group task_group_projection;
+            Polygons *layer_buildplate_covered = buildplate_covered.empty() ? nullptr : &buildplate_covered[layer_id];
+            task_group_projection.run([&grid_params, &overhangs_projection, &overhangs_projection_raw, &layer, &support_grid, layer_buildplate_covered
+#ifdef SLIC3R_DEBUG 
+                , iRun, layer_id
+#endif /* SLIC3R_DEBUG */
                 ] {
-                    // Find the bottom contact layers above the top surfaces of this layer.
-                    MyLayer *layer_new = detect_bottom_contacts(
-                        m_slicing_params, m_support_params, object, layer, top_contacts, contact_idx, layer_storage, layer_support_areas, overhangs_for_bottom_contacts
-#ifdef SLIC3R_DEBUG
-                        , iRun, polygons_new
-#endif // SLIC3R_DEBUG
+                    // buildplate_covered[layer_id] will be consumed here.
+                    support_grid = project_support_to_grid(layer, grid_params, *overhangs_projection_raw, layer_buildplate_covered
+#ifdef SLIC3R_DEBUG 
+                        , iRun, layer_id, "general"
+#endif /* SLIC3R_DEBUG */
+                    );
+                    overhangs_projection = extract_support_projection(*support_grid, grid_params
+#ifdef SLIC3R_DEBUG 
+                        , layer, iRun, layer_id
+#endif /* SLIC3R_DEBUG */
                     );
-                    if (layer_new)
-                        bottom_contacts.push_back(layer_new);
                 });
-
-        Polygons &layer_support_area = layer_support_areas[layer_id];
-        Polygons *layer_buildplate_covered = buildplate_covered.empty() ? nullptr : &buildplate_covered[layer_id];
-        task_group.run([&grid_params, &overhangs_projection, &overhangs_projection_raw, &layer, &layer_support_area, layer_buildplate_covered
+            if (! enforcers_projection_raw->empty())
+                // Project the enforcers polygons downwards, don't trim them with the "buildplate only" polygons.
+                task_group_projection.run([&grid_params, &enforcers_projection, &enforcers_projection_raw, &layer, &enforcers_grid
 #ifdef SLIC3R_DEBUG 
-            , iRun, layer_id
+                    , iRun, layer_id
 #endif /* SLIC3R_DEBUG */
-            ] {
-                // buildplate_covered[layer_id] will be consumed here.
-                std::tie(layer_support_area, overhangs_projection) = project_support_to_grid(layer, grid_params, overhangs_projection_raw, layer_buildplate_covered
+                    ] {
+                        enforcers_grid = project_support_to_grid(layer, grid_params, *enforcers_projection_raw, nullptr
 #ifdef SLIC3R_DEBUG 
-                    , iRun, layer_id, "general"
+                            , iRun, layer_id, "enforcers"
 #endif /* SLIC3R_DEBUG */
-                );
-            });
+                        );
+                        enforcers_projection = extract_support_projection(*enforcers_grid, grid_params
+#ifdef SLIC3R_DEBUG 
+                            , layer, iRun, layer_id
+#endif /* SLIC3R_DEBUG */
+                        );
+                    });
+            task_group_projection.wait();
+        }
 
-        Polygons layer_support_area_enforcers;
-        if (! enforcers_projection.empty())
-            // Project the enforcers polygons downwards, don't trim them with the "buildplate only" polygons.
-            task_group.run([&grid_params, &enforcers_projection, &enforcers_projection_raw, &layer, &layer_support_area_enforcers
+        ++ num_pending;
+        Polygons &layer_support_area = layer_support_areas[layer_id];
+        task_group.run([&grid_params, &layer_support_area, support_grid, enforcers_grid, &num_pending
 #ifdef SLIC3R_DEBUG 
-                , iRun, layer_id
+            , &layer, iRun, layer_id
 #endif /* SLIC3R_DEBUG */
-            ]{
-                std::tie(layer_support_area_enforcers, enforcers_projection) = project_support_to_grid(layer, grid_params, enforcers_projection_raw, nullptr
+            ] {
+                layer_support_area = extract_support_area(*support_grid, grid_params
 #ifdef SLIC3R_DEBUG 
-                    , iRun, layer_id, "enforcers"
+                    , layer, iRun, layer_id, "general"
 #endif /* SLIC3R_DEBUG */
                 );
+                if (enforcers_grid) {
+                    Polygons layer_support_area_enforcers = extract_support_area(*enforcers_grid, grid_params
+#ifdef SLIC3R_DEBUG 
+                        , layer, iRun, layer_id, "enforcers"
+#endif /* SLIC3R_DEBUG */
+                    );
+                    if (! layer_support_area_enforcers.empty()) {
+                        if (layer_support_area.empty())
+                            layer_support_area = std::move(layer_support_area_enforcers);
+                        else
+                            layer_support_area = union_(layer_support_area, layer_support_area_enforcers);
+                    }
+                }
+                -- num_pending;
             });
 
-        task_group.wait();
-
-        if (! layer_support_area_enforcers.empty()) {
-            if (layer_support_area.empty())
-                layer_support_area = std::move(layer_support_area_enforcers);
-            else
-                layer_support_area = union_(layer_support_area, layer_support_area_enforcers);
+        std::shared_ptr<Polygons> overhangs_for_bottom_contacts = buildplate_only ? enforcers_projection_raw : overhangs_projection_raw;
+        if (! overhangs_for_bottom_contacts->empty()) {
+            ++ num_pending;
+            // Find the bottom contact layers above the top surfaces of this layer.
+            task_group.run([this, &object, &layer, &top_contacts, contact_idx, &layer_storage, &bottom_contacts_by_layer, &bottom_contacts_touching, overhangs_for_bottom_contacts, layer_id, &num_pending
+    #ifdef SLIC3R_DEBUG
+                , iRun, polygons_new
+    #endif // SLIC3R_DEBUG
+                ] {
+                    bottom_contacts_by_layer[layer_id] = detect_bottom_contacts(
+                        m_slicing_params, m_support_params, object, layer, top_contacts, contact_idx, layer_storage, *overhangs_for_bottom_contacts, bottom_contacts_touching[layer_id]
+#ifdef SLIC3R_DEBUG
+                        , iRun, polygons_new
+#endif // SLIC3R_DEBUG
+                    );
+                    -- num_pending;
+                });
         }
+
+        // Don't let the asynchronous tasks lag too much behind the propagation, they hold the support grids of their layers.
+        if (num_pending > max_pending)
+            task_group.wait();
     } // over all layers downwards
 
-    std::reverse(bottom_contacts.begin(), bottom_contacts.end());
+    task_group.wait();
+
+    bottom_contacts = collect_bottom_contacts(object, bottom_contacts_by_layer, bottom_contacts_touching, layer_support_areas
+#ifdef SLIC3R_DEBUG
+        , iRun
+#endif // SLIC3R_DEBUG
+        );
+    trim_support_layers_by_object(object, bottom_contacts, m_slicing_params.gap_support_object, m_slicing_params.gap_object_support, m_support_params.gap_xy);
+    return bottom_contacts;
+}
+
+// Tree supports: The support areas are generated by growing branches from the top contact layers down, see tree_support_areas().
+// The bottom contact layers are then detected where the branches land on the object.
+PrintObjectSupportMaterial::MyLayersPtr PrintObjectSupportMaterial::bottom_contact_layers_and_tree_support_areas(
+    const PrintObject &object, const MyLayersPtr &top_contacts, std::vector<Polygons> &buildplate_covered, 
+    MyLayerStorage &layer_storage, std::vector<Polygons> &layer_support_areas) const
+{
+#ifdef SLIC3R_DEBUG
+    static size_t s_iRun = 0;
+    size_t iRun = s_iRun ++;
+#endif /* SLIC3R_DEBUG */
+
+    // Contact areas to be supported by the branches starting at an object layer: The top contact layers resting on this object layer.
+    std::vector<Polygons> contact_areas(object.total_layer_count());
+    for (const MyLayer *top_contact : top_contacts) {
+        auto it = std::upper_bound(object.layers().begin(), object.layers().end(), top_contact->bottom_z + EPSILON,
+            [](coordf_t z, const Layer *layer) { return z < layer->print_z; });
+        // Contact layers below the first object layer (raft) are supported by the raft.
+        if (it != object.layers().begin())
+            polygons_append(contact_areas[it - object.layers().begin() - 1], top_contact->polygons);
+    }
+
+    TreeSupportParams params;
+    params.gap_xy          = scaled<coord_t>(m_support_params.gap_xy);
+    params.tip_radius      = m_support_params.support_material_flow.scaled_spacing();
+    params.tip_spacing     = scaled<coord_t>(m_object_config->support_material_spacing.value + m_support_params.support_material_flow.spacing());
+    params.buildplate_only = ! buildplate_covered.empty();
+
+    BOOST_LOG_TRIVIAL(debug) << "PrintObjectSupportMaterial::bottom_contact_layers_and_tree_support_areas() - tree support areas";
+    layer_support_areas = tree_support_areas(object, params, contact_areas);
+    layer_support_areas.resize(object.total_layer_count());
+
+    // Find the bottom contact layers above the top surfaces of the layers, where the branches of the layer above land, in parallel over the layers.
+    BOOST_LOG_TRIVIAL(debug) << "PrintObjectSupportMaterial::bottom_contact_layers_and_tree_support_areas() - bottom contacts";
+    std::vector<MyLayer*>   bottom_contacts_by_layer(object.total_layer_count(), nullptr);
+    std::vector<Polygons>   bottom_contacts_touching(object.total_layer_count());
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, object.total_layer_count() - 1),
+        [this, &object, &top_contacts, &layer_storage, &layer_support_areas, &bottom_contacts_by_layer, &bottom_contacts_touching
+#ifdef SLIC3R_DEBUG
+        , iRun
+#endif // SLIC3R_DEBUG
+        ](const tbb::blocked_range<size_t> &range) {
+        for (size_t layer_id = range.begin(); layer_id < range.end(); ++ layer_id) {
+            const Polygons &supports_above = layer_support_areas[layer_id + 1];
+            if (supports_above.empty())
+                continue;
+            const Layer &layer = *object.get_layer(int(layer_id));
+            // Last top contact layer below this layer.
+            auto it = std::upper_bound(top_contacts.begin(), top_contacts.end(), layer.print_z - EPSILON,
+                [](coordf_t z, const MyLayer *contact) { return z < contact->print_z; });
+            bottom_contacts_by_layer[layer_id] = detect_bottom_contacts(
+                m_slicing_params, m_support_params, object, layer, top_contacts, size_t(int(it - top_contacts.begin()) - 1), layer_storage, 
+                supports_above, bottom_contacts_touching[layer_id]
+#ifdef SLIC3R_DEBUG
+                , iRun, supports_above
+#endif // SLIC3R_DEBUG
+            );
+        }
+    });
+
+    MyLayersPtr bottom_contacts = collect_bottom_contacts(object, bottom_contacts_by_layer, bottom_contacts_touching, layer_support_areas
+#ifdef SLIC3R_DEBUG
+        , iRun
+#endif // SLIC3R_DEBUG
+        );
     trim_support_layers_by_object(object, bottom_contacts, m_slicing_params.gap_support_object, m_slicing_params.gap_object_support, m_support_params.gap_xy);
     return bottom_contacts;
 }
@@ -2762,6 +2922,7 @@ void PrintObjectSupportMaterial::trim_support_layers_by_object(
                     // Collect all bottom surfaces, which will be extruded with a bridging flow.
                     for (; i < object.layers().size(); ++ i) {
                         const Layer &object_layer = *object.layers()[i];
+                        RestoredLayers restored(object.print()->layer_spill(), { &object_layer });
                         bool some_region_overlaps = false;
                         for (LayerRegion *region : object_layer.regions()) {
                             coordf_t bridging_height = region->region().bridging_height_avg(*m_print_config);
@@ -2974,11 +3135,10 @@ std::pair<PrintObjectSupportMaterial::MyLayersPtr, PrintObjectSupportMaterial::M
         interface_layers.assign(intermediate_layers.size(), nullptr);
         if (num_base_interface_layers_top || num_base_interface_layers_bottom)
             base_interface_layers.assign(intermediate_layers.size(), nullptr);
-        tbb::spin_mutex layer_storage_mutex;
         // Insert a new layer into base_interface_layers, if intersection with base exists.
-        auto insert_layer = [&layer_storage, &layer_storage_mutex](MyLayer &intermediate_layer, Polygons &bottom, Polygons &&top, const Polygons *subtract, SupporLayerType type) {
+        auto insert_layer = [&layer_storage](MyLayer &intermediate_layer, Polygons &bottom, Polygons &&top, const Polygons *subtract, SupporLayerType type) {
             assert(! bottom.empty() || ! top.empty());
-            MyLayer &layer_new = layer_allocate(layer_storage, layer_storage_mutex, type);
+            MyLayer &layer_new = layer_allocate(layer_storage, type);
             layer_new.print_z    = intermediate_layer.print_z;
             layer_new.bottom_z   = intermediate_layer.bottom_z;
             layer_new.height     = intermediate_layer.height;
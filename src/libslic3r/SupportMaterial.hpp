@@ -5,6 +5,10 @@
 #include "PrintConfig.hpp"
 #include "Slicing.hpp"
 
+#include <deque>
+
+#include <tbb/enumerable_thread_specific.h>
+
 namespace Slic3r {
 
 class PrintObject;
@@ -134,10 +138,19 @@ public:
 		coordf_t	gap_xy;
 	};
 
-	// Layers are allocated and owned by a deque. Once a layer is allocated, it is maintained
-	// up to the end of a generate() method. The layer storage may be replaced by an allocator class in the future, 
-	// which would allocate layers by multiple chunks.
-	typedef std::deque<MyLayer> 				MyLayerStorage;
+	// Layers are allocated and owned by per thread deques. Once a layer is allocated, it is maintained
+	// up to the end of a generate() method. Layers may be allocated from multiple threads without locking.
+	class MyLayerStorage {
+	public:
+		MyLayer& allocate(SupporLayerType layer_type) {
+			std::deque<MyLayer> &layers = m_layers.local();
+			layers.push_back(MyLayer());
+			layers.back().layer_type = layer_type;
+			return layers.back();
+		}
+	private:
+		tbb::enumerable_thread_specific<std::deque<MyLayer>> m_layers;
+	};
 	typedef std::vector<MyLayer*> 				MyLayersPtr;
 
 public:
@@ -171,6 +184,10 @@ private:
 	MyLayersPtr bottom_contact_layers_and_layer_support_areas(
 		const PrintObject &object, const MyLayersPtr &top_contacts, std::vector<Polygons> &buildplate_covered, 
 		MyLayerStorage &layer_storage, std::vector<Polygons> &layer_support_areas) const;
+	// Tree supports: Generate the support areas by growing branches from the top contact layers, then the bottom contact layers.
+	MyLayersPtr bottom_contact_layers_and_tree_support_areas(
+		const PrintObject &object, const MyLayersPtr &top_contacts, std::vector<Polygons> &buildplate_covered, 
+		MyLayerStorage &layer_storage, std::vector<Polygons> &layer_support_areas) const;
 
 	// Trim the top_contacts layers with the bottom_contacts layers if they overlap, so there would not be enough vertical space for both of them.
 	void trim_top_contacts_by_bottom_contacts(const PrintObject &object, const MyLayersPtr &bottom_contacts, MyLayersPtr &top_contacts) const;
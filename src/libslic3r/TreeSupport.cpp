@@ -0,0 +1,302 @@
+#include "TreeSupport.hpp"
+
+#include "BoundingBox.hpp"
+#include "ClipperUtils.hpp"
+#include "ExPolygon.hpp"
+#include "Layer.hpp"
+#include "Print.hpp"
+
+#include <cmath>
+#include <unordered_map>
+
+#include <boost/log/trivial.hpp>
+
+#include <tbb/parallel_for.h>
+
+namespace Slic3r {
+
+// Number of segments of the branch cross sections.
+static constexpr const size_t TREE_BRANCH_SEGMENTS = 16;
+
+namespace {
+
+// A branch crossing an object layer.
+struct TreeNode
+{
+    TreeNode(const Point &position, double distance_to_top) : position(position), distance_to_top(distance_to_top) {}
+
+    Point   position;
+    // Length of the branch from its tip, in mm.
+    double  distance_to_top;
+    // Index of the node continuing this branch at the layer below, -1 if the branch ends at this layer.
+    int     child { -1 };
+    // Does the branch reach the print bed?
+    bool    to_bed { false };
+};
+
+// Nodes of a single layer binned into a square grid to find the neighbors quickly.
+class TreeNodeGrid
+{
+public:
+    TreeNodeGrid(const std::vector<TreeNode> &nodes, coord_t cell_size) : m_cell_size(std::max<coord_t>(cell_size, 1)) {
+        for (size_t i = 0; i < nodes.size(); ++ i)
+            m_cells[this->cell_key(this->cell_x(nodes[i].position.x()), this->cell_y(nodes[i].position.y()))].emplace_back(i);
+    }
+
+    // Call fn(node_idx) for the nodes closer than radius to pt and possibly for some more distant nodes.
+    template<typename Fn> void visit(const Point &pt, coord_t radius, Fn fn) const {
+        for (coord_t y = this->cell_y(pt.y() - radius); y <= this->cell_y(pt.y() + radius); ++ y)
+            for (coord_t x = this->cell_x(pt.x() - radius); x <= this->cell_x(pt.x() + radius); ++ x)
+                if (auto it = m_cells.find(this->cell_key(x, y)); it != m_cells.end())
+                    for (size_t idx : it->second)
+                        fn(idx);
+    }
+
+private:
+    coord_t  cell_x(coord_t x) const { return coord_t(std::floor(double(x) / double(m_cell_size))); }
+    coord_t  cell_y(coord_t y) const { return coord_t(std::floor(double(y) / double(m_cell_size))); }
+    uint64_t cell_key(coord_t x, coord_t y) const { return (uint64_t(uint32_t(x)) << 32) | uint64_t(uint32_t(y)); }
+
+    coord_t                                              m_cell_size;
+    std::unordered_map<uint64_t, std::vector<size_t>>    m_cells;
+};
+
+// Islands with their bounding boxes for fast point containment queries.
+struct TreeIslands
+{
+    TreeIslands() = default;
+    TreeIslands(ExPolygons &&islands) : islands(std::move(islands)) {
+        bboxes.reserve(this->islands.size());
+        for (const ExPolygon &island : this->islands)
+            bboxes.emplace_back(get_extents(island.contour));
+    }
+
+    // Index of the island containing pt, -1 if none.
+    int containing(const Point &pt) const {
+        for (size_t i = 0; i < islands.size(); ++ i)
+            if (bboxes[i].contains(pt) && islands[i].contains(pt))
+                return int(i);
+        return -1;
+    }
+
+    ExPolygons                  islands;
+    std::vector<BoundingBox>    bboxes;
+};
+
+// Closest point on the contour or on the holes of an island.
+Point closest_boundary_point(const ExPolygon &island, const Point &pt)
+{
+    Point  out = island.contour.point_projection(pt);
+    double d2  = (out - pt).cast<double>().squaredNorm();
+    for (const Polygon &hole : island.holes) {
+        Point  p     = hole.point_projection(pt);
+        double d2new = (p - pt).cast<double>().squaredNorm();
+        if (d2new < d2) {
+            out = p;
+            d2  = d2new;
+        }
+    }
+    return out;
+}
+
+Polygon make_circle(const Point &center, coord_t radius)
+{
+    Polygon out;
+    out.points.reserve(TREE_BRANCH_SEGMENTS);
+    for (size_t i = 0; i < TREE_BRANCH_SEGMENTS; ++ i) {
+        double angle = 2. * M_PI * double(i) / double(TREE_BRANCH_SEGMENTS);
+        out.points.emplace_back(center.x() + coord_t(double(radius) * cos(angle)), center.y() + coord_t(double(radius) * sin(angle)));
+    }
+    return out;
+}
+
+// Sample the contact areas into branch tips on a grid aligned over all the layers, so that the tips of the neighbor layers merge easily.
+// An island too small to contain a grid point is supported by a single tip.
+void add_tips(const Polygons &contact_areas, const TreeIslands &collision, coord_t spacing, std::vector<TreeNode> &nodes)
+{
+    for (const ExPolygon &island : union_ex(contact_areas)) {
+        BoundingBox bbox = get_extents(island.contour);
+        bbox.align_to_grid(spacing);
+        size_t num_nodes_old = nodes.size();
+        for (coord_t y = bbox.min.y(); y <= bbox.max.y(); y += spacing)
+            for (coord_t x = bbox.min.x(); x <= bbox.max.x(); x += spacing) {
+                Point pt(x, y);
+                if (island.contains(pt) && collision.containing(pt) == -1)
+                    nodes.emplace_back(pt, 0.);
+            }
+        if (nodes.size() == num_nodes_old) {
+            Point pt = island.contour.centroid();
+            if (! island.contains(pt))
+                pt = island.contour.points.front();
+            if (collision.containing(pt) == -1)
+                nodes.emplace_back(pt, 0.);
+        }
+    }
+}
+
+} // namespace
+
+std::vector<Polygons> tree_support_areas(const PrintObject &object, const TreeSupportParams &params, const std::vector<Polygons> &contact_areas)
+{
+    const size_t num_layers = std::min(object.layers().size(), contact_areas.size());
+    std::vector<Polygons> out(object.layers().size());
+    if (num_layers == 0)
+        return out;
+
+    BOOST_LOG_TRIVIAL(debug) << "Tree support - collision areas - start";
+    // The object inflated by the XY gap, calculated in parallel over the layers.
+    std::vector<TreeIslands> collision(num_layers);
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, num_layers),
+        [&object, &params, &collision](const tbb::blocked_range<size_t> &range) {
+        for (size_t layer_id = range.begin(); layer_id < range.end(); ++ layer_id)
+            collision[layer_id] = TreeIslands(offset_ex(object.layers()[layer_id]->lslices, float(params.gap_xy)));
+    });
+
+    // Maximum horizontal move of a branch from a layer to the layer below.
+    const double tan_angle = tan(params.max_angle);
+    std::vector<coord_t> max_move(num_layers, 0);
+    for (size_t layer_id = 1; layer_id < num_layers; ++ layer_id)
+        max_move[layer_id] = scaled<coord_t>((object.layers()[layer_id]->print_z - object.layers()[layer_id - 1]->print_z) * tan_angle);
+
+    BOOST_LOG_TRIVIAL(debug) << "Tree support - avoidance areas - start";
+    // Areas of zero radius branches, which cannot reach the print bed without colliding with the object:
+    // The collision areas of the layers below shrunk by the maximum move of the branch, accumulated bottom up.
+    // Serial, each layer depends on the layer below.
+    std::vector<Polygons> avoidance(num_layers);
+    avoidance.front() = to_polygons(collision.front().islands);
+    for (size_t layer_id = 1; layer_id < num_layers; ++ layer_id)
+        avoidance[layer_id] = union_(to_polygons(collision[layer_id].islands), offset(avoidance[layer_id - 1], - float(max_move[layer_id])));
+
+    // The branch radii are rounded up to radius classes, the avoidance areas are inflated by the radius of the class.
+    auto node_radius  = [&params](double distance_to_top)
+        { return std::min<coord_t>(params.max_radius, params.tip_radius + scaled<coord_t>(distance_to_top * params.radius_increase)); };
+    const coord_t radius_step  = std::max<coord_t>(params.radius_step, 1);
+    auto radius_class = [&params, radius_step](coord_t radius)
+        { return size_t(std::max<coord_t>(0, radius - params.tip_radius + radius_step - 1) / radius_step); };
+    const size_t num_radius_classes = radius_class(params.max_radius) + 1;
+
+    auto inflated_avoidance = [&params, &avoidance, radius_step](size_t layer_id, size_t radius_class_id)
+        { return TreeIslands(offset_ex(avoidance[layer_id], float(params.tip_radius + coord_t(radius_class_id) * radius_step))); };
+
+    BOOST_LOG_TRIVIAL(debug) << "Tree support - propagate branches - start";
+    std::vector<std::vector<TreeNode>> nodes(num_layers);
+    for (size_t layer_id = num_layers - 1; layer_id > 0; -- layer_id) {
+        std::vector<TreeNode> &nodes_above = nodes[layer_id];
+        add_tips(contact_areas[layer_id], collision[layer_id], params.tip_spacing, nodes_above);
+        if (nodes_above.empty())
+            continue;
+        const size_t  layer_below_id = layer_id - 1;
+        const double  height         = object.layers()[layer_id]->print_z - object.layers()[layer_below_id]->print_z;
+        const coord_t move           = max_move[layer_id];
+
+        // Avoidance areas of the layer below, inflated by the radius classes of the branches crossing it.
+        // Only the radius classes of these branches are calculated, in parallel.
+        std::vector<TreeIslands> avoidance_by_class(num_radius_classes);
+        std::vector<size_t>      node_classes(nodes_above.size());
+        std::vector<size_t>      radius_classes;
+        for (size_t i = 0; i < nodes_above.size(); ++ i)
+            radius_classes.emplace_back(node_classes[i] = radius_class(node_radius(nodes_above[i].distance_to_top + height)));
+        sort_remove_duplicates(radius_classes);
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, radius_classes.size(), 1),
+            [&radius_classes, &avoidance_by_class, &inflated_avoidance, layer_below_id](const tbb::blocked_range<size_t> &range) {
+            for (size_t i = range.begin(); i < range.end(); ++ i)
+                avoidance_by_class[radius_classes[i]] = inflated_avoidance(layer_below_id, radius_classes[i]);
+        });
+
+        // Move the branches in parallel: Out of the avoidance areas first, then towards the closest neighbor branch.
+        std::vector<Point> positions(nodes_above.size());
+        std::vector<char>  landed(nodes_above.size(), false);
+        TreeNodeGrid       grid(nodes_above, params.attraction_distance);
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, nodes_above.size()),
+            [&params, &nodes_above, &node_classes, &avoidance_by_class, &collision, &grid, &positions, &landed, layer_below_id, move](const tbb::blocked_range<size_t> &range) {
+            for (size_t i = range.begin(); i < range.end(); ++ i) {
+                const TreeIslands &avoid = avoidance_by_class[node_classes[i]];
+                Point pt = nodes_above[i].position;
+                if (int island = avoid.containing(pt); island != -1) {
+                    // Escape the avoidance area. If it cannot be escaped, the branch will end up on the object.
+                    Point  target = closest_boundary_point(avoid.islands[island], pt);
+                    Vec2d  v      = (target - pt).cast<double>();
+                    double len    = v.norm();
+                    if (len > 0.)
+                        pt = (pt.cast<double>() + v * (std::min(len + double(SCALED_EPSILON), double(move)) / len)).cast<coord_t>();
+                } else {
+                    // Attraction to the closest neighbor branch, the two branches meet halfway.
+                    double d2min = sqr(double(params.attraction_distance));
+                    int    idx_closest = -1;
+                    grid.visit(pt, params.attraction_distance, [&nodes_above, &pt, &d2min, &idx_closest, i](size_t j) {
+                        if (j != i) {
+                            double d2 = (nodes_above[j].position - pt).cast<double>().squaredNorm();
+                            if (d2 < d2min) {
+                                d2min       = d2;
+                                idx_closest = int(j);
+                            }
+                        }
+                    });
+                    if (idx_closest != -1) {
+                        Vec2d  v   = (nodes_above[idx_closest].position - pt).cast<double>();
+                        double len = v.norm();
+                        Point  pt_new = (pt.cast<double>() + v * (std::min(0.5 * len, double(move)) / len)).cast<coord_t>();
+                        if (avoid.containing(pt_new) == -1)
+                            pt = pt_new;
+                    }
+                }
+                positions[i] = pt;
+                landed[i]    = collision[layer_below_id].containing(pt) != -1;
+            }
+        });
+
+        // Merge the branches closer than a single move, create the nodes of the layer below.
+        std::vector<TreeNode> &nodes_below = nodes[layer_below_id];
+        std::vector<TreeNode>  moved;
+        moved.reserve(nodes_above.size());
+        for (size_t i = 0; i < nodes_above.size(); ++ i)
+            moved.emplace_back(positions[i], nodes_above[i].distance_to_top);
+        TreeNodeGrid       grid_moved(moved, std::max<coord_t>(move, SCALED_EPSILON));
+        const double       d2merge = sqr(double(std::max<coord_t>(move, SCALED_EPSILON)));
+        for (size_t i = 0; i < nodes_above.size(); ++ i) {
+            if (landed[i] || nodes_above[i].child != -1)
+                continue;
+            int idx_merge = -1;
+            grid_moved.visit(positions[i], move, [&positions, &nodes_above, &landed, &idx_merge, d2merge, i](size_t j) {
+                if (j > i && idx_merge == -1 && ! landed[j] && nodes_above[j].child == -1 &&
+                    (positions[j] - positions[i]).cast<double>().squaredNorm() < d2merge)
+                    idx_merge = int(j);
+            });
+            nodes_above[i].child = int(nodes_below.size());
+            if (idx_merge == -1)
+                nodes_below.emplace_back(positions[i], nodes_above[i].distance_to_top + height);
+            else {
+                nodes_above[idx_merge].child = nodes_above[i].child;
+                nodes_below.emplace_back(((positions[i].cast<double>() + positions[idx_merge].cast<double>()) * 0.5).cast<coord_t>(),
+                    std::max(nodes_above[i].distance_to_top, nodes_above[idx_merge].distance_to_top) + height);
+            }
+        }
+        // Each layer is crossed once, its avoidance areas are released here.
+    }
+    add_tips(contact_areas.front(), collision.front(), params.tip_spacing, nodes.front());
+
+    // Which branches reach the print bed?
+    for (TreeNode &node : nodes.front())
+        node.to_bed = true;
+    for (size_t layer_id = 1; layer_id < num_layers; ++ layer_id)
+        for (TreeNode &node : nodes[layer_id])
+            node.to_bed = node.child != -1 && nodes[layer_id - 1][node.child].to_bed;
+
+    BOOST_LOG_TRIVIAL(debug) << "Tree support - support areas - start";
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, num_layers),
+        [&params, &nodes, &collision, &node_radius, &out](const tbb::blocked_range<size_t> &range) {
+        for (size_t layer_id = range.begin(); layer_id < range.end(); ++ layer_id) {
+            Polygons circles;
+            for (const TreeNode &node : nodes[layer_id])
+                if (node.to_bed || ! params.buildplate_only)
+                    circles.emplace_back(make_circle(node.position, node_radius(node.distance_to_top)));
+            if (! circles.empty())
+                out[layer_id] = diff(union_(circles), to_polygons(collision[layer_id].islands));
+        }
+    });
+    BOOST_LOG_TRIVIAL(debug) << "Tree support - end";
+
+    return out;
+}
+
+} // namespace Slic3r
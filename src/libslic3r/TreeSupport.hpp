@@ -0,0 +1,49 @@
+#ifndef slic3r_TreeSupport_hpp_
+#define slic3r_TreeSupport_hpp_
+
+#include "libslic3r.h"
+#include "Polygon.hpp"
+
+#include <vector>
+
+namespace Slic3r {
+
+class PrintObject;
+
+// Branching tree supports, an alternative to projecting the support areas down to the print bed.
+// The contact areas are sampled into tips of thin branches. The branches grow downwards layer by layer,
+// they avoid the object, they are attracted by their neighbors and they merge into thicker trunks.
+// Only the support areas are generated here, the support layers and their extrusions are produced
+// by PrintObjectSupportMaterial the same way as for the other support styles.
+struct TreeSupportParams
+{
+    // Horizontal gap between the branches and the object.
+    coord_t     gap_xy              { scaled<coord_t>(0.8) };
+    // Radius of the branch tips.
+    coord_t     tip_radius          { scaled<coord_t>(0.8) };
+    // Maximum radius of the trunks.
+    coord_t     max_radius          { scaled<coord_t>(3.) };
+    // Growth of the branch radius per mm of the branch length.
+    double      radius_increase     { 0.1 };
+    // Radii of the branches are rounded up to multiples of this step, the branches of the same radius class share their avoidance areas.
+    coord_t     radius_step         { scaled<coord_t>(0.4) };
+    // Maximum angle of the branches from the vertical, in radians.
+    double      max_angle           { 40. * M_PI / 180. };
+    // Distance of the branch tips sampled from the contact areas.
+    coord_t     tip_spacing         { scaled<coord_t>(3.) };
+    // Distance at which the branches are attracted to each other.
+    coord_t     attraction_distance { scaled<coord_t>(6.) };
+    // Only keep the branches reaching the print bed.
+    bool        buildplate_only     { false };
+};
+
+// contact_areas: Per object layer, the areas to be supported from this layer upwards.
+// Returns the support areas per object layer, trimmed by the object inflated by gap_xy.
+// The collision areas are calculated in parallel over the layers. The avoidance areas are accumulated bottom up
+// layer by layer. While the branches are grown top down, the avoidance areas of each layer are inflated in parallel by the radius classes
+// of the branches crossing the layer, and released once the branches reached the layer below.
+std::vector<Polygons> tree_support_areas(const PrintObject &object, const TreeSupportParams &params, const std::vector<Polygons> &contact_areas);
+
+} // namespace Slic3r
+
+#endif /* slic3r_TreeSupport_hpp_ */
@@ -1,6 +1,9 @@
 #include "TriangleSelector.hpp"
 #include "Model.hpp"
 
+#include <algorithm>
+#include <numeric>
+
 
 namespace Slic3r {
 
@@ -60,6 +63,7 @@ void TriangleSelector::select_patch(const Vec3f& hit, int facet_start,
         int facet = facets_to_check[facet_idx];
         if (! visited[facet]) {
             if (select_triangle(facet, new_state, false, triangle_splitting)) {
+                mark_dirty(facet);
                 // add neighboring facets to list to be proccessed later
                 for (int n=0; n<3; ++n) {
                     int neighbor_idx = m_mesh->stl.neighbors_start[facet].neighbor[n];
@@ -194,6 +198,7 @@ void TriangleSelector::set_facet(int facet_idx, EnforcerBlockerType state)
     undivide_triangle(facet_idx);
     assert(! m_triangles[facet_idx].is_split());
     m_triangles[facet_idx].set_state(state);
+    mark_dirty(facet_idx);
 }
 
 void TriangleSelector::split_triangle(int facet_idx)
@@ -479,6 +484,7 @@ void TriangleSelector::reset(const EnforcerBlockerType reset_state)
     m_orig_size_vertices = m_vertices.size();
     m_orig_size_indices = m_triangles.size();
     m_invalid_triangles = 0;
+    mark_all_dirty();
 }
 
 
@@ -593,7 +599,26 @@ indexed_triangle_set TriangleSelector::get_facets(EnforcerBlockerType state) con
 
 
 
-std::map<int, std::vector<bool>> TriangleSelector::serialize() const
+void TriangleSelector::mark_dirty(int orig_facet_idx) const
+{
+    assert(orig_facet_idx >= 0 && orig_facet_idx < m_orig_size_indices);
+    if (! m_orig_triangles_dirty[orig_facet_idx]) {
+        m_orig_triangles_dirty[orig_facet_idx] = true;
+        m_orig_triangles_dirty_list.emplace_back(orig_facet_idx);
+    }
+}
+
+void TriangleSelector::mark_all_dirty() const
+{
+    m_serialized.clear();
+    m_serialized_touched.clear();
+    m_serialized_touched_all = true;
+    m_orig_triangles_dirty.assign(m_orig_size_indices, true);
+    m_orig_triangles_dirty_list.resize(m_orig_size_indices);
+    std::iota(m_orig_triangles_dirty_list.begin(), m_orig_triangles_dirty_list.end(), 0);
+}
+
+void TriangleSelector::serialize_triangle(int orig_facet_idx, std::vector<bool> &data) const
 {
     // Each original triangle of the mesh is assigned a number encoding its state
     // or how it is split. Each triangle is encoded by 4 bits (xxyy) or 8 bits (zzzzxxyy):
@@ -601,71 +626,103 @@ std::map<int, std::vector<bool>> TriangleSelector::serialize() const
     // leaf triangle: xx = 0b11, yy = 0b00, zzzz = EnforcerBlockerType (subtracted by 3)
     // non-leaf:      xx = special side, yy = number of split sides
     // These are bitwise appended and formed into one 64-bit integer.
+    std::function<void(int)> serialize_recursive;
+    serialize_recursive = [this, &serialize_recursive, &data](int facet_idx) {
+        const Triangle& tr = m_triangles[facet_idx];
 
-    // The function returns a map from original triangle indices to
-    // stream of bits encoding state and offsprings.
+        // Always save number of split sides. It is zero for unsplit triangles.
+        int split_sides = tr.number_of_split_sides();
+        assert(split_sides >= 0 && split_sides <= 3);
 
-    std::map<int, std::vector<bool>> out;
-    for (int i=0; i<m_orig_size_indices; ++i) {
-        const Triangle& tr = m_triangles[i];
+        //data |= (split_sides << (stored_triangles * 4));
+        data.push_back(split_sides & 0b01);
+        data.push_back(split_sides & 0b10);
 
-        if (! tr.is_split() && tr.get_state() == EnforcerBlockerType::NONE)
-            continue; // no need to save anything, unsplit and unselected is default
-
-        std::vector<bool> data; // complete encoding of this mesh triangle
-        int stored_triangles = 0; // how many have been already encoded
-
-        std::function<void(int)> serialize_recursive;
-        serialize_recursive = [this, &serialize_recursive, &stored_triangles, &data](int facet_idx) {
-            const Triangle& tr = m_triangles[facet_idx];
-
-            // Always save number of split sides. It is zero for unsplit triangles.
-            int split_sides = tr.number_of_split_sides();
-            assert(split_sides >= 0 && split_sides <= 3);
-
-            //data |= (split_sides << (stored_triangles * 4));
-            data.push_back(split_sides & 0b01);
-            data.push_back(split_sides & 0b10);
-
-            if (tr.is_split()) {
-                // If this triangle is split, save which side is split (in case
-                // of one split) or kept (in case of two splits). The value will
-                // be ignored for 3-side split.
-                assert(split_sides > 0);
-                assert(tr.special_side() >= 0 && tr.special_side() <= 3);
-                data.push_back(tr.special_side() & 0b01);
-                data.push_back(tr.special_side() & 0b10);
-                ++stored_triangles;
-                // Now save all children.
-                for (int child_idx=0; child_idx<=split_sides; ++child_idx)
-                    serialize_recursive(tr.children[child_idx]);
-            } else {
-                // In case this is leaf, we better save information about its state.
-                assert(int(tr.get_state()) <= 15);
-                if (3 <= int(tr.get_state()) && int(tr.get_state()) <= 15) {
-                    data.insert(data.end(), {true, true});
-                    for (size_t bit_idx = 0; bit_idx < 4; ++bit_idx) {
-                        size_t bit_mask = uint64_t(0b0001) << bit_idx;
-                        data.push_back((int(tr.get_state()) - 3) & bit_mask);
-                    }
-                } else {
-                    data.push_back(int(tr.get_state()) & 0b01);
-                    data.push_back(int(tr.get_state()) & 0b10);
+        if (tr.is_split()) {
+            // If this triangle is split, save which side is split (in case
+            // of one split) or kept (in case of two splits). The value will
+            // be ignored for 3-side split.
+            assert(split_sides > 0);
+            assert(tr.special_side() >= 0 && tr.special_side() <= 3);
+            data.push_back(tr.special_side() & 0b01);
+            data.push_back(tr.special_side() & 0b10);
+            // Now save all children.
+            for (int child_idx=0; child_idx<=split_sides; ++child_idx)
+                serialize_recursive(tr.children[child_idx]);
+        } else {
+            // In case this is leaf, we better save information about its state.
+            assert(int(tr.get_state()) <= 15);
+            if (3 <= int(tr.get_state()) && int(tr.get_state()) <= 15) {
+                data.insert(data.end(), {true, true});
+                for (size_t bit_idx = 0; bit_idx < 4; ++bit_idx) {
+                    size_t bit_mask = uint64_t(0b0001) << bit_idx;
+                    data.push_back((int(tr.get_state()) - 3) & bit_mask);
                 }
-                ++stored_triangles;
+            } else {
+                data.push_back(int(tr.get_state()) & 0b01);
+                data.push_back(int(tr.get_state()) & 0b10);
             }
-        };
+        }
+    };
 
-        serialize_recursive(i);
-        out[i] = data;
+    serialize_recursive(orig_facet_idx);
+}
+
+const std::map<int, std::vector<bool>>& TriangleSelector::serialize() const
+{
+    // The function returns a map from original triangle indices to
+    // stream of bits encoding state and offsprings.
+    // Only the original triangles touched since the last call are encoded again,
+    // the rest of the map is reused.
+    for (int i : m_orig_triangles_dirty_list) {
+        const Triangle& tr = m_triangles[i];
+        m_orig_triangles_dirty[i] = false;
+        if (! m_serialized_touched_all)
+            m_serialized_touched.emplace_back(i);
+
+        if (! tr.is_split() && tr.get_state() == EnforcerBlockerType::NONE) {
+            // no need to save anything, unsplit and unselected is default
+            m_serialized.erase(i);
+            continue;
+        }
+
+        std::vector<bool> &data = m_serialized[i]; // complete encoding of this mesh triangle
+        data.clear();
+        serialize_triangle(i, data);
     }
+    m_orig_triangles_dirty_list.clear();
 
-    return out;
+    return m_serialized;
+}
+
+bool TriangleSelector::take_touched_triangles(std::vector<int> &touched) const
+{
+    assert(m_orig_triangles_dirty_list.empty());
+    touched.clear();
+    bool all = m_serialized_touched_all;
+    if (! all) {
+        // A triangle may have been encoded again by multiple calls to serialize().
+        touched = std::move(m_serialized_touched);
+        std::sort(touched.begin(), touched.end());
+        touched.erase(std::unique(touched.begin(), touched.end()), touched.end());
+    }
+    m_serialized_touched.clear();
+    m_serialized_touched_all = false;
+    return ! all;
 }
 
 void TriangleSelector::deserialize(const std::map<int, std::vector<bool>> data, const EnforcerBlockerType init_state)
 {
     reset(init_state); // dump any current state
+    if (init_state == EnforcerBlockerType::NONE) {
+        // The loaded data are exactly what serialize() would produce, take them as the cached encoding.
+        m_serialized = data;
+        m_orig_triangles_dirty.assign(m_orig_size_indices, false);
+        m_orig_triangles_dirty_list.clear();
+        // The caller holds the data, only the changes of the loaded data are reported by take_touched_triangles().
+        m_serialized_touched.clear();
+        m_serialized_touched_all = false;
+    }
     for (const auto& [triangle_id, code] : data) {
         assert(triangle_id < int(m_triangles.size()));
         assert(! code.empty());
@@ -707,6 +764,9 @@ void TriangleSelector::deserialize(const std::map<int, std::vector<bool>> data,
                 if (! is_split) {
                     // root is not split. just set the state and that's it.
                     m_triangles[triangle_id].set_state(state);
+                    if (state == EnforcerBlockerType::NONE)
+                        // Default state is not stored by serialize(), drop it from the cache.
+                        mark_dirty(triangle_id);
                     break;
                 } else {
                     // root is split, add it into list of parents and split it.
@@ -764,6 +824,10 @@ void TriangleSelector::seed_fill_unselect_all_triangles() {
 
 void TriangleSelector::seed_fill_apply_on_triangles(EnforcerBlockerType new_state)
 {
+    for (int facet_idx = 0; facet_idx < m_orig_size_indices; ++facet_idx)
+        if (has_seed_fill_selected_leaf(facet_idx))
+            mark_dirty(facet_idx);
+
     for (Triangle &triangle : m_triangles)
         if (!triangle.is_split() && triangle.is_selected_by_seed_fill())
             triangle.set_state(new_state);
@@ -775,6 +839,18 @@ void TriangleSelector::seed_fill_apply_on_triangles(EnforcerBlockerType new_stat
         }
 }
 
+// Is any valid leaf of the subtree of the triangle selected by seed fill?
+bool TriangleSelector::has_seed_fill_selected_leaf(int facet_idx) const
+{
+    const Triangle &tr = m_triangles[facet_idx];
+    if (! tr.is_split())
+        return tr.is_selected_by_seed_fill();
+    for (int child_idx = 0; child_idx <= tr.number_of_split_sides(); ++child_idx)
+        if (has_seed_fill_selected_leaf(tr.children[child_idx]))
+            return true;
+    return false;
+}
+
 TriangleSelector::Cursor::Cursor(
         const Vec3f& center_, const Vec3f& source_, float radius_world,
         CursorType type_, const Transform3d& trafo_)
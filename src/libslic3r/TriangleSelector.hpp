@@ -56,7 +56,16 @@ public:
 
     // Store the division trees in compact form (a long stream of
     // bits for each triangle of the original mesh).
-    std::map<int, std::vector<bool>> serialize() const;
+    // The encoding is cached and only the original triangles modified since
+    // the last call are encoded again, thus the cost scales with the stroke.
+    const std::map<int, std::vector<bool>>& serialize() const;
+
+    // Original triangles, whose encoding returned by serialize() may have changed since the last call
+    // to this function or to deserialize(), to patch a copy of the encoding instead of comparing
+    // and copying all of it. The encoding of the other original triangles is unchanged.
+    // Returns false if the whole encoding may have changed (the selector was reset or deserialized
+    // with a state other than NONE), touched is left empty then. Call serialize() first.
+    bool take_touched_triangles(std::vector<int> &touched) const;
 
     // Load serialized data. Assumes that correct mesh is loaded.
     void deserialize(const std::map<int, std::vector<bool>> data, const EnforcerBlockerType init_state = EnforcerBlockerType{0});
@@ -76,10 +85,10 @@ protected:
         Triangle(int a, int b, int c, const Vec3f& normal_, const EnforcerBlockerType init_state)
             : verts_idxs{a, b, c},
               normal{normal_},
-              state{init_state},
               number_of_splits{0},
               special_side_idx{0},
-              old_number_of_splits{0}
+              old_number_of_splits{0},
+              state{init_state}
         {}
         // Indices into m_vertices.
         std::array<int, 3> verts_idxs;
@@ -114,14 +123,14 @@ protected:
         void forget_history() { old_number_of_splits = 0; }
 
     private:
-        int number_of_splits;
-        int special_side_idx;
-        EnforcerBlockerType state;
-        bool m_selected_by_seed_fill = false;
-
+        // All the values below fit into a byte, they are packed to keep the triangle pool compact.
+        int8_t number_of_splits;
+        int8_t special_side_idx;
         // How many children were spawned during last split?
         // Is not reset on remerging the triangle.
-        int old_number_of_splits;
+        int8_t old_number_of_splits;
+        EnforcerBlockerType state;
+        bool m_selected_by_seed_fill = false;
     };
 
     struct Vertex {
@@ -148,6 +157,16 @@ protected:
     int m_orig_size_vertices = 0;
     int m_orig_size_indices = 0;
 
+    // Original triangles modified since the last call to serialize().
+    mutable std::vector<bool> m_orig_triangles_dirty;
+    mutable std::vector<int>  m_orig_triangles_dirty_list;
+    // Cached result of serialize(), valid for all original triangles not marked as dirty.
+    mutable std::map<int, std::vector<bool>> m_serialized;
+    // Original triangles encoded again by serialize() since the last call to take_touched_triangles(),
+    // the list is not maintained while m_serialized_touched_all is set.
+    mutable std::vector<int> m_serialized_touched;
+    mutable bool             m_serialized_touched_all = true;
+
     // Cache for cursor position, radius and direction.
     struct Cursor {
         Cursor() = default;
@@ -167,7 +186,7 @@ protected:
     };
 
     Cursor m_cursor;
-    float m_old_cursor_radius_sqr;
+    float m_old_cursor_radius_sqr = 0.f;
 
     // Private functions:
     bool select_triangle(int facet_idx, EnforcerBlockerType type, bool recursive_call = false, bool triangle_splitting = true);
@@ -180,6 +199,10 @@ protected:
     bool is_edge_inside_cursor(int facet_idx) const;
     void push_triangle(int a, int b, int c, const Vec3f &normal, const EnforcerBlockerType state = EnforcerBlockerType{0});
     void perform_split(int facet_idx, EnforcerBlockerType old_state);
+    void mark_dirty(int orig_facet_idx) const;
+    void mark_all_dirty() const;
+    bool has_seed_fill_selected_leaf(int facet_idx) const;
+    void serialize_triangle(int orig_facet_idx, std::vector<bool> &data) const;
 };
 
 
@@ -15,10 +15,12 @@
 #include <miniz.h>
 
 // Print now includes tbb, and tbb includes Windows. This breaks compilation of wxWidgets if included before wx.
+#include "libslic3r/AppConfig.hpp"
 #include "libslic3r/Print.hpp"
 #include "libslic3r/SLAPrint.hpp"
 #include "libslic3r/Utils.hpp"
 #include "libslic3r/GCode/PostProcessor.hpp"
+#include "libslic3r/GCode/GCodeCompressor.hpp"
 #include "libslic3r/Format/SL1.hpp"
 #include "libslic3r/Thread.hpp"
 #include "libslic3r/libslic3r.h"
@@ -102,6 +104,13 @@ BackgroundSlicingProcess::~BackgroundSlicingProcess()
 	this->stop();
 	this->join_background_thread();
 	boost::nowide::remove(m_temp_output_path.c_str());
+	this->remove_temp_compressed_outputs();
+}
+
+void BackgroundSlicingProcess::remove_temp_compressed_outputs() const
+{
+	for (GCodeCompression compression : { GCodeCompression::Gzip, GCodeCompression::MeatPack })
+		boost::nowide::remove(compressed_gcode_path(m_temp_output_path, compression).c_str());
 }
 
 bool BackgroundSlicingProcess::select_technology(PrinterTechnology tech)
@@ -140,12 +149,21 @@ void BackgroundSlicingProcess::process_fff()
 {
 	assert(m_print == m_fff_print);
     m_print->process();
+	// Generate the toolpaths of the preview before the G-code export. The extrusions of the layers spilled to a scratch file by the slicing steps
+	// are loaded back one layer after the other. Only the toolpaths of the objects, whose steps were invalidated, are regenerated.
+	m_toolpaths_cache.update(*m_fff_print, [this](){ m_fff_print->throw_if_canceled(); });
 	wxCommandEvent evt(m_event_slicing_completed_id);
 	// Post the Slicing Finished message for the G-code viewer to update.
 	// Passing the timestamp 
 	evt.SetInt((int)(m_fff_print->step_state_with_timestamp(PrintStep::psSlicingFinished).timestamp));
 	wxQueueEvent(GUI::wxGetApp().mainframe->m_plater, evt.Clone());
-	m_fff_print->export_gcode(m_temp_output_path, m_gcode_result, [this](const ThumbnailsParams& params) { return this->render_thumbnails(params); });
+	// Without the post-processing scripts, which expect plain text, the G-code is compressed by the same pass, which inserts the M73 lines
+	// into the temporary G-code. The plain text temporary G-code is kept for the G-code preview.
+	GCodeCompression compression = m_fff_print->config().gcode_compression.value;
+	bool             compress_on_export = compression != GCodeCompression::None && m_fff_print->config().post_process.values.empty();
+	this->remove_temp_compressed_outputs();
+	m_fff_print->export_gcode(m_temp_output_path, m_gcode_result, [this](const ThumbnailsParams& params) { return this->render_thumbnails(params); },
+		compress_on_export ? GCodeCompressedOutput::WithPlain : GCodeCompressedOutput::None);
 	if (this->set_step_started(bspsGCodeFinalize)) {
 	    if (! m_export_path.empty()) {
 			wxQueueEvent(GUI::wxGetApp().mainframe->m_plater, new wxCommandEvent(m_event_export_began_id));
@@ -167,16 +185,36 @@ void BackgroundSlicingProcess::process_fff()
 			//FIXME localize the messages
 			// Perform the final post-processing of the export path by applying the print statistics over the file name.
 			std::string export_path = m_fff_print->print_statistics().finalize_output_path(m_export_path);
+			// The G-code is compressed into a temporary file on the local drive first, only the compact result is copied
+			// to the (possibly slow, removable) destination. Without the post-processing scripts the compressed G-code
+			// was already written by the G-code export, otherwise the output of the scripts is compressed by a separate pass.
+			std::string source_path = m_temp_output_path;
+			if (compression != GCodeCompression::None) {
+				export_path = compressed_gcode_path(export_path, compression);
+				if (compress_on_export)
+					source_path = compressed_gcode_path(m_temp_output_path, compression);
+				else {
+					m_print->set_status(97, _utf8(L("Compressing G-code")));
+					source_path = m_temp_output_path + ".compressed";
+					compress_gcode_file(m_temp_output_path, source_path, compression);
+				}
+			}
+			// The compressed G-code written by the G-code export is kept for the upload to a print host.
+			bool remove_source = source_path != m_temp_output_path && ! compress_on_export;
 			std::string error_message;
 			int copy_ret_val = CopyFileResult::SUCCESS;
 			try
 			{
-				copy_ret_val = copy_file(m_temp_output_path, export_path, error_message, m_export_path_on_removable_media);
+				copy_ret_val = copy_file(source_path, export_path, error_message, m_export_path_on_removable_media);
 			}
 			catch (...)
 			{
+				if (remove_source)
+					boost::nowide::remove(source_path.c_str());
 				throw Slic3r::ExportError(_utf8(L("Unknown error occured during exporting G-code.")));
 			}
+			if (remove_source)
+				boost::nowide::remove(source_path.c_str());
 			switch (copy_ret_val) {
 			case CopyFileResult::SUCCESS: break; // no error
 			case CopyFileResult::FAIL_COPY_FILE:
@@ -189,7 +227,7 @@ void BackgroundSlicingProcess::process_fff()
 				throw Slic3r::ExportError((boost::format(_utf8(L("Renaming of the G-code after copying to the selected destination folder has failed. Current path is %1%.tmp. Please try exporting again."))) % export_path).str());
 				break;
 			case CopyFileResult::FAIL_CHECK_ORIGIN_NOT_OPENED:
-				throw Slic3r::ExportError((boost::format(_utf8(L("Copying of the temporary G-code has finished but the original code at %1% couldn't be opened during copy check. The output G-code is at %2%.tmp."))) % m_temp_output_path % export_path).str());
+				throw Slic3r::ExportError((boost::format(_utf8(L("Copying of the temporary G-code has finished but the original code at %1% couldn't be opened during copy check. The output G-code is at %2%.tmp."))) % source_path % export_path).str());
 				break;
 			case CopyFileResult::FAIL_CHECK_TARGET_NOT_OPENED:
 				throw Slic3r::ExportError((boost::format(_utf8(L("Copying of the temporary G-code has finished but the exported code couldn't be opened during copy check. The output G-code is at %1%.tmp."))) % export_path).str());
@@ -359,6 +397,9 @@ bool BackgroundSlicingProcess::start()
 		return false;
 	if (! this->idle())
 		throw Slic3r::RuntimeError("Cannot start a background task, the worker thread is not idle.");
+	if (m_print == m_fff_print)
+		// The application config is only accessed from the UI thread, pass the budget to the Print before the slicing starts.
+		m_fff_print->set_layer_memory_budget(size_t(std::max(0, atoi(GUI::wxGetApp().app_config->get("layer_memory_budget").c_str()))) << 20);
 	m_state = STATE_STARTED;
 	m_print->set_cancel_callback([this](){ this->stop_internal(); });
 	lck.unlock();
@@ -399,6 +440,7 @@ bool BackgroundSlicingProcess::reset()
 	bool stopped = this->stop();
 	this->reset_export();
 	m_print->clear();
+	m_toolpaths_cache.clear();
 	this->invalidate_all_steps();
 	return stopped;
 }
@@ -599,13 +641,30 @@ void BackgroundSlicingProcess::prepare_upload()
 		/ boost::filesystem::unique_path("." SLIC3R_APP_KEY ".upload.%%%%-%%%%-%%%%-%%%%");
 
 	if (m_print == m_fff_print) {
+		GCodeCompression compression     = m_fff_print->config().gcode_compression.value;
+		std::string      temp_compressed = compressed_gcode_path(m_temp_output_path, compression);
+		// Without the post-processing scripts the compressed G-code was already written by the G-code export.
+		bool             compressed_on_export = compression != GCodeCompression::None && m_fff_print->config().post_process.values.empty() &&
+			boost::filesystem::exists(temp_compressed);
 		m_print->set_status(95, _utf8(L("Running post-processing scripts")));
 		std::string error_message;
-		if (copy_file(m_temp_output_path, source_path.string(), error_message) != SUCCESS) {
+		if (copy_file(compressed_on_export ? temp_compressed : m_temp_output_path, source_path.string(), error_message) != SUCCESS) {
 			throw Slic3r::RuntimeError(_utf8(L("Copying of the temporary G-code to the output G-code failed")));
 		}
-		run_post_process_scripts(source_path.string(), m_fff_print->full_print_config());
+		if (! compressed_on_export)
+			run_post_process_scripts(source_path.string(), m_fff_print->full_print_config());
         m_upload_job.upload_data.upload_path = m_fff_print->print_statistics().finalize_output_path(m_upload_job.upload_data.upload_path.string());
+		// Upload the compressed G-code to save the transfer time.
+		if (compressed_on_export)
+			m_upload_job.upload_data.upload_path = compressed_gcode_path(m_upload_job.upload_data.upload_path.string(), compression);
+		else if (compression != GCodeCompression::None) {
+			m_print->set_status(97, _utf8(L("Compressing G-code")));
+			boost::filesystem::path compressed_path = source_path.string() + ".compressed";
+			compress_gcode_file(source_path.string(), compressed_path.string(), compression);
+			boost::filesystem::remove(source_path);
+			source_path = std::move(compressed_path);
+			m_upload_job.upload_data.upload_path = compressed_gcode_path(m_upload_job.upload_data.upload_path.string(), compression);
+		}
     } else {
         m_upload_job.upload_data.upload_path = m_sla_print->print_statistics().finalize_output_path(m_upload_job.upload_data.upload_path.string());
         
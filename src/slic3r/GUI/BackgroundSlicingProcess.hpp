@@ -14,6 +14,7 @@
 #include "libslic3r/Format/SL1.hpp"
 #include "slic3r/Utils/PrintHost.hpp"
 #include "libslic3r/GCode/GCodeProcessor.hpp"
+#include "ToolpathsCache.hpp"
 
 
 namespace boost { namespace filesystem { class path; } }
@@ -110,6 +111,8 @@ public:
 	const PrintBase*    current_print() const { return m_print; }
 	const Print* 		fff_print() const { return m_fff_print; }
 	const SLAPrint* 	sla_print() const { return m_sla_print; }
+	// Toolpaths of the sliced objects for the preview, generated in advance by the background processing.
+	GUI::ToolpathsCache& toolpaths_cache() { return m_toolpaths_cache; }
     // Take the project path (if provided), extract the name of the project, run it through the macro processor and save it next to the project file.
     // If the project_path is empty, just run output_filepath().
 	std::string 		output_filepath_for_project(const boost::filesystem::path &project_path);
@@ -192,6 +195,8 @@ private:
 	// Non-owned pointers to Print instances.
 	Print 					   *m_fff_print 		 = nullptr;
 	SLAPrint 				   *m_sla_print			 = nullptr;
+	// Toolpaths of m_fff_print for the preview, generated once the slicing is finished.
+	GUI::ToolpathsCache         m_toolpaths_cache;
 	// Data structure, to which the G-code export writes its annotations.
 	GCodeProcessor::Result     *m_gcode_result = nullptr;
 	// Callback function, used to write thumbnails into gcode.
@@ -241,6 +246,8 @@ private:
     // If the background processing stop was requested, throw CanceledException.
     void                throw_if_canceled() const { if (m_print->canceled()) throw CanceledException(); }
     void                prepare_upload();
+    // Remove the compressed temporary G-code written by the G-code export next to m_temp_output_path, if any.
+    void                remove_temp_compressed_outputs() const;
     // To be executed at the background thread.
 	ThumbnailsList		render_thumbnails(const ThumbnailsParams &params);
 	// Execute task from background thread on the UI thread synchronously. Returns true if processed, false if cancelled before executing the task.
@@ -292,7 +292,7 @@ void ConfigManipulation::toggle_print_fff_options(DynamicPrintConfig* config)
         toggle_field(el, have_support_material);
     toggle_field("support_material_threshold", have_support_material_auto);
     toggle_field("support_material_bottom_contact_distance", have_support_material && ! have_support_soluble);
-    toggle_field("support_material_closing_radius", have_support_material && support_material_style == smsSnug);
+    toggle_field("support_material_closing_radius", have_support_material && (support_material_style == smsSnug || support_material_style == smsTree));
 
     for (auto el : { "support_material_bottom_interface_layers", "support_material_interface_spacing", "support_material_interface_extruder",
                     "support_material_interface_speed", "support_material_interface_contact_loops" })
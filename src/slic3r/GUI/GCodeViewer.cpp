@@ -29,21 +29,21 @@
 #include <boost/nowide/cstdio.hpp>
 #include <boost/nowide/fstream.hpp>
 #include <wx/progdlg.h>
-#include <wx/numformatter.h>
 
 #include <array>
 #include <algorithm>
 #include <chrono>
+#include <tuple>
 
 namespace Slic3r {
 namespace GUI {
 
 static unsigned char buffer_id(EMoveType type) {
-    return static_cast<unsigned char>(type) - static_cast<unsigned char>(EMoveType::Retract);
+    return GCodePreviewBuffers::buffer_id(type);
 }
 
 static EMoveType buffer_type(unsigned char id) {
-    return static_cast<EMoveType>(static_cast<unsigned char>(EMoveType::Retract) + id);
+    return GCodePreviewBuffers::buffer_type(id);
 }
 
 static std::array<float, 3> decode_color(const std::string& color) {
@@ -109,37 +109,6 @@ void GCodeViewer::IBuffer::reset()
     count = 0;
 }
 
-bool GCodeViewer::Path::matches(const GCodeProcessor::MoveVertex& move) const
-{
-    auto matches_percent = [](float value1, float value2, float max_percent) {
-        return std::abs(value2 - value1) / value1 <= max_percent;
-    };
-
-    switch (move.type)
-    {
-    case EMoveType::Tool_change:
-    case EMoveType::Color_change:
-    case EMoveType::Pause_Print:
-    case EMoveType::Custom_GCode:
-    case EMoveType::Retract:
-    case EMoveType::Unretract:
-#if ENABLE_SEAMS_VISUALIZATION
-    case EMoveType::Seam:
-#endif // ENABLE_SEAMS_VISUALIZATION
-    case EMoveType::Extrude: {
-        // use rounding to reduce the number of generated paths
-        return type == move.type && extruder_id == move.extruder_id && cp_color_id == move.cp_color_id && role == move.extrusion_role &&
-            move.position[2] <= sub_paths.front().first.position[2] && feedrate == move.feedrate && fan_speed == move.fan_speed &&
-            height == round_to_nearest(move.height, 2) && width == round_to_nearest(move.width, 2) &&
-            matches_percent(volumetric_rate, move.volumetric_rate(), 0.05f);
-    }
-    case EMoveType::Travel: {
-        return type == move.type && feedrate == move.feedrate && extruder_id == move.extruder_id && cp_color_id == move.cp_color_id;
-    }
-    default: { return false; }
-    }
-}
-
 void GCodeViewer::TBuffer::reset()
 {
     // release gpu memory
@@ -154,16 +123,6 @@ void GCodeViewer::TBuffer::reset()
     render_paths.clear();
 }
 
-void GCodeViewer::TBuffer::add_path(const GCodeProcessor::MoveVertex& move, unsigned int b_id, size_t i_id, size_t s_id)
-{
-    Path::Endpoint endpoint = { b_id, i_id, s_id, move.position };
-    // use rounding to reduce the number of generated paths
-    paths.push_back({ move.type, move.extrusion_role, move.delta_extruder,
-        round_to_nearest(move.height, 2), round_to_nearest(move.width, 2),
-        move.feedrate, move.fan_speed, move.temperature,
-        move.volumetric_rate(), move.extruder_id, move.cp_color_id, { { endpoint, endpoint } } });
-}
-
 GCodeViewer::Color GCodeViewer::Extrusions::Range::get_color_at(float value) const
 {
     // Input value scaled to the colors range
@@ -553,40 +512,7 @@ GCodeViewer::GCodeViewer()
     // OpenGL data are initialized into render().init_gl_data()
     for (size_t i = 0; i < m_buffers.size(); ++i) {
         TBuffer& buffer = m_buffers[i];
-        switch (buffer_type(i))
-        {
-        default: { break; }
-        case EMoveType::Tool_change:
-        case EMoveType::Color_change:
-        case EMoveType::Pause_Print:
-        case EMoveType::Custom_GCode:
-        case EMoveType::Retract:
-#if ENABLE_SEAMS_VISUALIZATION
-        case EMoveType::Unretract:
-        case EMoveType::Seam: {
-            buffer.render_primitive_type = TBuffer::ERenderPrimitiveType::Point;
-            buffer.vertices.format = VBuffer::EFormat::Position;
-            break;
-        }
-#else
-        case EMoveType::Unretract: {
-            buffer.render_primitive_type = TBuffer::ERenderPrimitiveType::Point;
-            buffer.vertices.format = VBuffer::EFormat::Position;
-            break;
-        }
-#endif // ENABLE_SEAMS_VISUALIZATION
-        case EMoveType::Wipe:
-        case EMoveType::Extrude: {
-            buffer.render_primitive_type = TBuffer::ERenderPrimitiveType::Triangle;
-            buffer.vertices.format = VBuffer::EFormat::PositionNormal3;
-            break;
-        }
-        case EMoveType::Travel: {
-            buffer.render_primitive_type = TBuffer::ERenderPrimitiveType::Line;
-            buffer.vertices.format = VBuffer::EFormat::PositionNormal1;
-            break;
-        }
-        }
+        std::tie(buffer.render_primitive_type, buffer.vertices.format) = GCodePreviewBuffers::buffer_layout(buffer_type(i));
     }
 
     set_toolpath_move_type_visible(EMoveType::Extrude, true);
@@ -1141,274 +1067,6 @@ void GCodeViewer::stop_mapping_gcode_window()
 
 void GCodeViewer::load_toolpaths(const GCodeProcessor::Result& gcode_result)
 {
-    // max index buffer size, in bytes
-    static const size_t IBUFFER_THRESHOLD_BYTES = 64 * 1024 * 1024;
-
-    auto log_memory_usage = [this](const std::string& label, const std::vector<MultiVertexBuffer>& vertices, const std::vector<MultiIndexBuffer>& indices) {
-        int64_t vertices_size = 0;
-        for (const MultiVertexBuffer& buffers : vertices) {
-            for (const VertexBuffer& buffer : buffers) {
-                vertices_size += SLIC3R_STDVEC_MEMSIZE(buffer, float);
-            }
-        }
-        int64_t indices_size = 0;
-        for (const MultiIndexBuffer& buffers : indices) {
-            for (const IndexBuffer& buffer : buffers) {
-                indices_size += SLIC3R_STDVEC_MEMSIZE(buffer, IBufferType);
-            }
-        }
-        log_memory_used(label, vertices_size + indices_size);
-    };
-
-    // format data into the buffers to be rendered as points
-    auto add_vertices_as_point = [](const GCodeProcessor::MoveVertex& curr, VertexBuffer& vertices) {
-        vertices.push_back(curr.position[0]);
-        vertices.push_back(curr.position[1]);
-        vertices.push_back(curr.position[2]);
-    };
-    auto add_indices_as_point = [](const GCodeProcessor::MoveVertex& curr, TBuffer& buffer,
-        unsigned int ibuffer_id, IndexBuffer& indices, size_t move_id) {
-            buffer.add_path(curr, ibuffer_id, indices.size(), move_id);
-            indices.push_back(static_cast<IBufferType>(indices.size()));
-    };
-
-    // format data into the buffers to be rendered as lines
-    auto add_vertices_as_line = [](const GCodeProcessor::MoveVertex& prev, const GCodeProcessor::MoveVertex& curr, VertexBuffer& vertices) {
-        // x component of the normal to the current segment (the normal is parallel to the XY plane)
-        float normal_x = (curr.position - prev.position).normalized()[1];
-
-        auto add_vertex = [&vertices, normal_x](const GCodeProcessor::MoveVertex& vertex) {
-            // add position
-            vertices.push_back(vertex.position[0]);
-            vertices.push_back(vertex.position[1]);
-            vertices.push_back(vertex.position[2]);
-            // add normal x component
-            vertices.push_back(normal_x);
-        };
-
-        // add previous vertex
-        add_vertex(prev);
-        // add current vertex
-        add_vertex(curr);
-    };
-    auto add_indices_as_line = [](const GCodeProcessor::MoveVertex& prev, const GCodeProcessor::MoveVertex& curr, TBuffer& buffer,
-        unsigned int ibuffer_id, IndexBuffer& indices, size_t move_id) {
-            if (prev.type != curr.type || !buffer.paths.back().matches(curr)) {
-                // add starting index
-                indices.push_back(static_cast<unsigned int>(indices.size()));
-                buffer.add_path(curr, ibuffer_id, indices.size() - 1, move_id - 1);
-                buffer.paths.back().sub_paths.front().first.position = prev.position;
-            }
-
-            Path& last_path = buffer.paths.back();
-            if (last_path.sub_paths.front().first.i_id != last_path.sub_paths.back().last.i_id) {
-                // add previous index
-                indices.push_back(static_cast<unsigned int>(indices.size()));
-            }
-
-            // add current index
-            indices.push_back(static_cast<unsigned int>(indices.size()));
-            last_path.sub_paths.back().last = { ibuffer_id, indices.size() - 1, move_id, curr.position };
-    };
-
-    // format data into the buffers to be rendered as solid
-    auto add_vertices_as_solid = [](const GCodeProcessor::MoveVertex& prev, const GCodeProcessor::MoveVertex& curr, TBuffer& buffer, unsigned int vbuffer_id, VertexBuffer& vertices, size_t move_id) {
-        auto store_vertex = [](VertexBuffer& vertices, const Vec3f& position, const Vec3f& normal) {
-            // append position
-            vertices.push_back(position[0]);
-            vertices.push_back(position[1]);
-            vertices.push_back(position[2]);
-            // append normal
-            vertices.push_back(normal[0]);
-            vertices.push_back(normal[1]);
-            vertices.push_back(normal[2]);
-        };
-
-        if (prev.type != curr.type || !buffer.paths.back().matches(curr)) {
-            buffer.add_path(curr, vbuffer_id, vertices.size(), move_id - 1);
-            buffer.paths.back().sub_paths.back().first.position = prev.position;
-        }
-
-        Path& last_path = buffer.paths.back();
-
-        Vec3f dir = (curr.position - prev.position).normalized();
-        Vec3f right = Vec3f(dir[1], -dir[0], 0.0f).normalized();
-        Vec3f left = -right;
-        Vec3f up = right.cross(dir);
-        Vec3f down = -up;
-        float half_width = 0.5f * last_path.width;
-        float half_height = 0.5f * last_path.height;
-        Vec3f prev_pos = prev.position - half_height * up;
-        Vec3f curr_pos = curr.position - half_height * up;
-        Vec3f d_up = half_height * up;
-        Vec3f d_down = -half_height * up;
-        Vec3f d_right = half_width * right;
-        Vec3f d_left = -half_width * right;
-
-        // vertices 1st endpoint
-        if (last_path.vertices_count() == 1 || vertices.empty()) {
-            // 1st segment or restart into a new vertex buffer
-            // ===============================================
-            store_vertex(vertices, prev_pos + d_up, up);
-            store_vertex(vertices, prev_pos + d_right, right);
-            store_vertex(vertices, prev_pos + d_down, down);
-            store_vertex(vertices, prev_pos + d_left, left);
-        }
-        else {
-            // any other segment
-            // =================
-            store_vertex(vertices, prev_pos + d_right, right);
-            store_vertex(vertices, prev_pos + d_left, left);
-        }
-
-        // vertices 2nd endpoint
-        store_vertex(vertices, curr_pos + d_up, up);
-        store_vertex(vertices, curr_pos + d_right, right);
-        store_vertex(vertices, curr_pos + d_down, down);
-        store_vertex(vertices, curr_pos + d_left, left);
-
-        last_path.sub_paths.back().last = { vbuffer_id, vertices.size(), move_id, curr.position };
-    };
-    auto add_indices_as_solid = [&](const GCodeProcessor::MoveVertex& prev, const GCodeProcessor::MoveVertex& curr, const GCodeProcessor::MoveVertex* next,
-        TBuffer& buffer, size_t& vbuffer_size, unsigned int ibuffer_id, IndexBuffer& indices, size_t move_id) {
-            static Vec3f prev_dir;
-            static Vec3f prev_up;
-            static float sq_prev_length;
-            auto store_triangle = [](IndexBuffer& indices, IBufferType i1, IBufferType i2, IBufferType i3) {
-                indices.push_back(i1);
-                indices.push_back(i2);
-                indices.push_back(i3);
-            };
-            auto append_dummy_cap = [store_triangle](IndexBuffer& indices, IBufferType id) {
-                store_triangle(indices, id, id, id);
-                store_triangle(indices, id, id, id);
-            };
-            auto convert_vertices_offset = [](size_t vbuffer_size, const std::array<int, 8>& v_offsets) {
-                std::array<IBufferType, 8> ret = {
-                    static_cast<IBufferType>(static_cast<int>(vbuffer_size) + v_offsets[0]),
-                    static_cast<IBufferType>(static_cast<int>(vbuffer_size) + v_offsets[1]),
-                    static_cast<IBufferType>(static_cast<int>(vbuffer_size) + v_offsets[2]),
-                    static_cast<IBufferType>(static_cast<int>(vbuffer_size) + v_offsets[3]),
-                    static_cast<IBufferType>(static_cast<int>(vbuffer_size) + v_offsets[4]),
-                    static_cast<IBufferType>(static_cast<int>(vbuffer_size) + v_offsets[5]),
-                    static_cast<IBufferType>(static_cast<int>(vbuffer_size) + v_offsets[6]),
-                    static_cast<IBufferType>(static_cast<int>(vbuffer_size) + v_offsets[7])
-                };
-                return ret;
-            };
-            auto append_starting_cap_triangles = [&](IndexBuffer& indices, const std::array<IBufferType, 8>& v_offsets) {
-                store_triangle(indices, v_offsets[0], v_offsets[2], v_offsets[1]);
-                store_triangle(indices, v_offsets[0], v_offsets[3], v_offsets[2]);
-            };
-            auto append_stem_triangles = [&](IndexBuffer& indices, const std::array<IBufferType, 8>& v_offsets) {
-                store_triangle(indices, v_offsets[0], v_offsets[1], v_offsets[4]);
-                store_triangle(indices, v_offsets[1], v_offsets[5], v_offsets[4]);
-                store_triangle(indices, v_offsets[1], v_offsets[2], v_offsets[5]);
-                store_triangle(indices, v_offsets[2], v_offsets[6], v_offsets[5]);
-                store_triangle(indices, v_offsets[2], v_offsets[3], v_offsets[6]);
-                store_triangle(indices, v_offsets[3], v_offsets[7], v_offsets[6]);
-                store_triangle(indices, v_offsets[3], v_offsets[0], v_offsets[7]);
-                store_triangle(indices, v_offsets[0], v_offsets[4], v_offsets[7]);
-            };
-            auto append_ending_cap_triangles = [&](IndexBuffer& indices, const std::array<IBufferType, 8>& v_offsets) {
-                store_triangle(indices, v_offsets[4], v_offsets[6], v_offsets[7]);
-                store_triangle(indices, v_offsets[4], v_offsets[5], v_offsets[6]);
-            };
-
-            if (prev.type != curr.type || !buffer.paths.back().matches(curr)) {
-                buffer.add_path(curr, ibuffer_id, indices.size(), move_id - 1);
-                buffer.paths.back().sub_paths.back().first.position = prev.position;
-            }
-
-            Path& last_path = buffer.paths.back();
-
-            Vec3f dir = (curr.position - prev.position).normalized();
-            Vec3f right = Vec3f(dir[1], -dir[0], 0.0f).normalized();
-            Vec3f up = right.cross(dir);
-            float sq_length = (curr.position - prev.position).squaredNorm();
-
-            const std::array<IBufferType, 8> first_seg_v_offsets = convert_vertices_offset(vbuffer_size, { 0, 1, 2, 3, 4, 5, 6, 7 });
-            const std::array<IBufferType, 8> non_first_seg_v_offsets = convert_vertices_offset(vbuffer_size, { -4, 0, -2, 1, 2, 3, 4, 5 });
-            bool is_first_segment = (last_path.vertices_count() == 1);
-            if (is_first_segment || vbuffer_size == 0) {
-                // 1st segment or restart into a new vertex buffer
-                // ===============================================
-                if (is_first_segment)
-                    // starting cap triangles
-                    append_starting_cap_triangles(indices, first_seg_v_offsets);
-                // dummy triangles outer corner cap
-                append_dummy_cap(indices, vbuffer_size);
-
-                // stem triangles
-                append_stem_triangles(indices, first_seg_v_offsets);
-
-                vbuffer_size += 8;
-            }
-            else {
-                // any other segment
-                // =================
-                float displacement = 0.0f;
-                float cos_dir = prev_dir.dot(dir);
-                if (cos_dir > -0.9998477f) {
-                    // if the angle between adjacent segments is smaller than 179 degrees
-                    Vec3f med_dir = (prev_dir + dir).normalized();
-                    float half_width = 0.5f * last_path.width;
-                    displacement = half_width * ::tan(::acos(std::clamp(dir.dot(med_dir), -1.0f, 1.0f)));
-                }
-
-                float sq_displacement = sqr(displacement);
-                bool can_displace = displacement > 0.0f && sq_displacement < sq_prev_length && sq_displacement < sq_length;
-
-                bool is_right_turn = prev_up.dot(prev_dir.cross(dir)) <= 0.0f;
-                // whether the angle between adjacent segments is greater than 45 degrees
-                bool is_sharp = cos_dir < 0.7071068f;
-
-                bool right_displaced = false;
-                bool left_displaced = false;
-
-                if (!is_sharp && can_displace) {
-                    if (is_right_turn)
-                        left_displaced = true;
-                    else
-                        right_displaced = true;
-                }
-
-                // triangles outer corner cap
-                if (is_right_turn) {
-                    if (left_displaced)
-                        // dummy triangles
-                        append_dummy_cap(indices, vbuffer_size);
-                    else {
-                        store_triangle(indices, vbuffer_size - 4, vbuffer_size + 1, vbuffer_size - 1);
-                        store_triangle(indices, vbuffer_size + 1, vbuffer_size - 2, vbuffer_size - 1);
-                    }
-                }
-                else {
-                    if (right_displaced)
-                        // dummy triangles
-                        append_dummy_cap(indices, vbuffer_size);
-                    else {
-                        store_triangle(indices, vbuffer_size - 4, vbuffer_size - 3, vbuffer_size + 0);
-                        store_triangle(indices, vbuffer_size - 3, vbuffer_size - 2, vbuffer_size + 0);
-                    }
-                }
-
-                // stem triangles
-                append_stem_triangles(indices, non_first_seg_v_offsets);
-
-                vbuffer_size += 6;
-            }
-
-            if (next != nullptr && (curr.type != next->type || !last_path.matches(*next)))
-                // ending cap triangles
-                append_ending_cap_triangles(indices, is_first_segment ? first_seg_v_offsets : non_first_seg_v_offsets);
-
-            last_path.sub_paths.back().last = { ibuffer_id, indices.size() - 1, move_id, curr.position };
-            prev_dir = dir;
-            prev_up = up;
-            sq_prev_length = sq_length;
-    };
-
 #if ENABLE_GCODE_VIEWER_STATISTICS
     auto start_time = std::chrono::high_resolution_clock::now();
     m_statistics.results_size = SLIC3R_STDVEC_MEMSIZE(gcode_result.moves, GCodeProcessor::MoveVertex);
@@ -1421,28 +1079,41 @@ void GCodeViewer::load_toolpaths(const GCodeProcessor::Result& gcode_result)
 
     m_extruders_count = gcode_result.extruders_count;
 
-    unsigned int progress_count = 0;
-    static const unsigned int progress_threshold = 1000;
+    // for the gcode viewer we need to take in account all moves to correctly size the printbed
+    const bool bounding_box_all_moves = wxGetApp().is_gcode_viewer();
     wxProgressDialog* progress_dialog = wxGetApp().is_gcode_viewer() ?
         new wxProgressDialog(_L("Generating toolpaths"), "...",
             100, wxGetApp().plater(), wxPD_AUTO_HIDE | wxPD_APP_MODAL) : nullptr;
 
     wxBusyCursor busy;
 
-    // extract approximate paths bounding box from result
-    for (const GCodeProcessor::MoveVertex& move : gcode_result.moves) {
-        if (wxGetApp().is_gcode_viewer())
-            // for the gcode viewer we need to take in account all moves to correctly size the printbed
-            m_paths_bounding_box.merge(move.position.cast<double>());
-        else {
-#if ENABLE_START_GCODE_VISUALIZATION
-            if (move.type == EMoveType::Extrude && move.extrusion_role != erCustom && move.width != 0.0f && move.height != 0.0f)
-#else
-            if (move.type == EMoveType::Extrude && move.width != 0.0f && move.height != 0.0f)
-#endif // ENABLE_START_GCODE_VISUALIZATION
-                m_paths_bounding_box.merge(move.position.cast<double>());
-        }
+    // toolpaths data -> vertex and index buffers, either precomputed next to the G-code file or generated from result
+    GCodePreviewBuffers preview;
+#if ENABLE_GCODE_WINDOW
+    if (wxGetApp().is_gcode_viewer() && ! gcode_result.filename.empty()) {
+        std::string preview_path = gcode_preview_buffers_path(gcode_result.filename);
+        if (preview.load(preview_path, gcode_result.gcode_hash, bounding_box_all_moves) && preview.moves_count != m_moves_count)
+            preview.clear();
+        if (! preview.empty())
+            BOOST_LOG_TRIVIAL(info) << "Loaded the G-code preview from " << preview_path;
     }
+#endif // ENABLE_GCODE_WINDOW
+    if (preview.empty())
+        preview.generate(gcode_result, bounding_box_all_moves);
+
+    log_memory_used("Loaded G-code generated buffers ", int64_t(preview.memsize()));
+
+#if ENABLE_GCODE_VIEWER_STATISTICS
+    auto load_vertices_time = std::chrono::high_resolution_clock::now();
+    m_statistics.load_vertices = std::chrono::duration_cast<std::chrono::milliseconds>(load_vertices_time - start_time).count();
+#endif // ENABLE_GCODE_VIEWER_STATISTICS
+
+    if (progress_dialog != nullptr) {
+        progress_dialog->Update(50, "");
+        progress_dialog->Fit();
+    }
+
+    m_paths_bounding_box = preview.paths_bounding_box;
 
     // set approximate max bounding box (take in account also the tool marker)
     m_max_bounding_box = m_paths_bounding_box;
@@ -1455,239 +1126,13 @@ void GCodeViewer::load_toolpaths(const GCodeProcessor::Result& gcode_result)
     }
 #endif // ENABLE_GCODE_LINES_ID_IN_H_SLIDER
 
-    std::vector<MultiVertexBuffer> vertices(m_buffers.size());
-    std::vector<MultiIndexBuffer> indices(m_buffers.size());
-    std::vector<float> options_zs;
-
-    // toolpaths data -> extract vertices from result
-    for (size_t i = 0; i < m_moves_count; ++i) {
-        const GCodeProcessor::MoveVertex& curr = gcode_result.moves[i];
-
-        // skip first vertex
-        if (i == 0)
-            continue;
-
-        const GCodeProcessor::MoveVertex& prev = gcode_result.moves[i - 1];
-
-        // update progress dialog
-        ++progress_count;
-        if (progress_dialog != nullptr && progress_count % progress_threshold == 0) {
-            progress_dialog->Update(int(100.0f * float(i) / (2.0f * float(m_moves_count))),
-                _L("Generating vertex buffer") + ": " + wxNumberFormatter::ToString(100.0 * double(i) / double(m_moves_count), 0, wxNumberFormatter::Style_None) + "%");
-            progress_dialog->Fit();
-            progress_count = 0;
-        }
-
-        unsigned char id = buffer_id(curr.type);
-        TBuffer& t_buffer = m_buffers[id];
-        MultiVertexBuffer& v_multibuffer = vertices[id];
-
-        // ensure there is at least one vertex buffer
-        if (v_multibuffer.empty())
-            v_multibuffer.push_back(VertexBuffer());
-
-        // if adding the vertices for the current segment exceeds the threshold size of the current vertex buffer
-        // add another vertex buffer
-        if (v_multibuffer.back().size() * sizeof(float) > t_buffer.vertices.max_size_bytes() - t_buffer.max_vertices_per_segment_size_bytes()) {
-            v_multibuffer.push_back(VertexBuffer());
-            if (t_buffer.render_primitive_type == TBuffer::ERenderPrimitiveType::Triangle) {
-                Path& last_path = t_buffer.paths.back();
-                if (prev.type == curr.type && last_path.matches(curr))
-                    last_path.add_sub_path(prev, static_cast<unsigned int>(v_multibuffer.size()) - 1, 0, i - 1);
-            }
-        }
-
-        VertexBuffer& v_buffer = v_multibuffer.back();
-
-        switch (t_buffer.render_primitive_type)
-        {
-        case TBuffer::ERenderPrimitiveType::Point:    { add_vertices_as_point(curr, v_buffer); break; }
-        case TBuffer::ERenderPrimitiveType::Line:     { add_vertices_as_line(prev, curr, v_buffer); break; }
-        case TBuffer::ERenderPrimitiveType::Triangle: { add_vertices_as_solid(prev, curr, t_buffer, static_cast<unsigned int>(v_multibuffer.size()) - 1, v_buffer, i); break; }
-        }
-
-        // collect options zs for later use
-        if (curr.type == EMoveType::Pause_Print || curr.type == EMoveType::Custom_GCode) {
-            const float* const last_z = options_zs.empty() ? nullptr : &options_zs.back();
-            if (last_z == nullptr || curr.position[2] < *last_z - EPSILON || *last_z + EPSILON < curr.position[2])
-                options_zs.emplace_back(curr.position[2]);
-        }
-    }
-
-    // smooth toolpaths corners for the given TBuffer using triangles
-    auto smooth_triangle_toolpaths_corners = [&gcode_result](const TBuffer& t_buffer, MultiVertexBuffer& v_multibuffer) {
-        auto extract_position_at = [](const VertexBuffer& vertices, size_t offset) {
-            return Vec3f(vertices[offset + 0], vertices[offset + 1], vertices[offset + 2]);
-        };
-        auto update_position_at = [](VertexBuffer& vertices, size_t offset, const Vec3f& position) {
-            vertices[offset + 0] = position[0];
-            vertices[offset + 1] = position[1];
-            vertices[offset + 2] = position[2];
-        };
-        auto match_right_vertices = [&](const Path::Sub_Path& prev_sub_path, const Path::Sub_Path& next_sub_path,
-            size_t curr_s_id, size_t vertex_size_floats, const Vec3f& displacement_vec) {
-                if (&prev_sub_path == &next_sub_path) { // previous and next segment are both contained into to the same vertex buffer
-                    VertexBuffer& vbuffer = v_multibuffer[prev_sub_path.first.b_id];
-                    // offset into the vertex buffer of the next segment 1st vertex
-                    size_t next_1st_offset = (prev_sub_path.last.s_id - curr_s_id) * 6 * vertex_size_floats;
-                    // offset into the vertex buffer of the right vertex of the previous segment 
-                    size_t prev_right_offset = prev_sub_path.last.i_id - next_1st_offset - 3 * vertex_size_floats;
-                    // new position of the right vertices
-                    Vec3f shared_vertex = extract_position_at(vbuffer, prev_right_offset) + displacement_vec;
-                    // update previous segment
-                    update_position_at(vbuffer, prev_right_offset, shared_vertex);
-                    // offset into the vertex buffer of the right vertex of the next segment
-                    size_t next_right_offset = next_sub_path.last.i_id - next_1st_offset;
-                    // update next segment
-                    update_position_at(vbuffer, next_right_offset, shared_vertex);
-                }
-                else { // previous and next segment are contained into different vertex buffers
-                    VertexBuffer& prev_vbuffer = v_multibuffer[prev_sub_path.first.b_id];
-                    VertexBuffer& next_vbuffer = v_multibuffer[next_sub_path.first.b_id];
-                    // offset into the previous vertex buffer of the right vertex of the previous segment 
-                    size_t prev_right_offset = prev_sub_path.last.i_id - 3 * vertex_size_floats;
-                    // new position of the right vertices
-                    Vec3f shared_vertex = extract_position_at(prev_vbuffer, prev_right_offset) + displacement_vec;
-                    // update previous segment
-                    update_position_at(prev_vbuffer, prev_right_offset, shared_vertex);
-                    // offset into the next vertex buffer of the right vertex of the next segment
-                    size_t next_right_offset = next_sub_path.first.i_id + 1 * vertex_size_floats;
-                    // update next segment
-                    update_position_at(next_vbuffer, next_right_offset, shared_vertex);
-                }
-        };
-        auto match_left_vertices = [&](const Path::Sub_Path& prev_sub_path, const Path::Sub_Path& next_sub_path,
-            size_t curr_s_id, size_t vertex_size_floats, const Vec3f& displacement_vec) {
-                if (&prev_sub_path == &next_sub_path) { // previous and next segment are both contained into to the same vertex buffer
-                    VertexBuffer& vbuffer = v_multibuffer[prev_sub_path.first.b_id];
-                    // offset into the vertex buffer of the next segment 1st vertex
-                    size_t next_1st_offset = (prev_sub_path.last.s_id - curr_s_id) * 6 * vertex_size_floats;
-                    // offset into the vertex buffer of the left vertex of the previous segment 
-                    size_t prev_left_offset = prev_sub_path.last.i_id - next_1st_offset - 1 * vertex_size_floats;
-                    // new position of the left vertices
-                    Vec3f shared_vertex = extract_position_at(vbuffer, prev_left_offset) + displacement_vec;
-                    // update previous segment
-                    update_position_at(vbuffer, prev_left_offset, shared_vertex);
-                    // offset into the vertex buffer of the left vertex of the next segment
-                    size_t next_left_offset = next_sub_path.last.i_id - next_1st_offset + 1 * vertex_size_floats;
-                    // update next segment
-                    update_position_at(vbuffer, next_left_offset, shared_vertex);
-                }
-                else { // previous and next segment are contained into different vertex buffers
-                    VertexBuffer& prev_vbuffer = v_multibuffer[prev_sub_path.first.b_id];
-                    VertexBuffer& next_vbuffer = v_multibuffer[next_sub_path.first.b_id];
-                    // offset into the previous vertex buffer of the left vertex of the previous segment 
-                    size_t prev_left_offset = prev_sub_path.last.i_id - 1 * vertex_size_floats;
-                    // new position of the left vertices
-                    Vec3f shared_vertex = extract_position_at(prev_vbuffer, prev_left_offset) + displacement_vec;
-                    // update previous segment
-                    update_position_at(prev_vbuffer, prev_left_offset, shared_vertex);
-                    // offset into the next vertex buffer of the left vertex of the next segment
-                    size_t next_left_offset = next_sub_path.first.i_id + 3 * vertex_size_floats;
-                    // update next segment
-                    update_position_at(next_vbuffer, next_left_offset, shared_vertex);
-                }
-        };
-
-        size_t vertex_size_floats = t_buffer.vertices.vertex_size_floats();
-        for (const Path& path : t_buffer.paths) {
-            // the two segments of the path sharing the current vertex may belong
-            // to two different vertex buffers
-            size_t prev_sub_path_id = 0;
-            size_t next_sub_path_id = 0;
-            size_t path_vertices_count = path.vertices_count();
-            float half_width = 0.5f * path.width;
-            for (size_t j = 1; j < path_vertices_count - 1; ++j) {
-                size_t curr_s_id = path.sub_paths.front().first.s_id + j;
-                const Vec3f& prev = gcode_result.moves[curr_s_id - 1].position;
-                const Vec3f& curr = gcode_result.moves[curr_s_id].position;
-                const Vec3f& next = gcode_result.moves[curr_s_id + 1].position;
-
-                // select the subpaths which contains the previous/next segments
-                if (!path.sub_paths[prev_sub_path_id].contains(curr_s_id))
-                    ++prev_sub_path_id;
-                if (!path.sub_paths[next_sub_path_id].contains(curr_s_id + 1))
-                    ++next_sub_path_id;
-                const Path::Sub_Path& prev_sub_path = path.sub_paths[prev_sub_path_id];
-                const Path::Sub_Path& next_sub_path = path.sub_paths[next_sub_path_id];
-
-                Vec3f prev_dir = (curr - prev).normalized();
-                Vec3f prev_right = Vec3f(prev_dir[1], -prev_dir[0], 0.0f).normalized();
-                Vec3f prev_up = prev_right.cross(prev_dir);
-
-                Vec3f next_dir = (next - curr).normalized();
-
-                bool is_right_turn = prev_up.dot(prev_dir.cross(next_dir)) <= 0.0f;
-                float cos_dir = prev_dir.dot(next_dir);
-                // whether the angle between adjacent segments is greater than 45 degrees
-                bool is_sharp = cos_dir < 0.7071068f;
-
-                float displacement = 0.0f;
-                if (cos_dir > -0.9998477f) {
-                    // if the angle between adjacent segments is smaller than 179 degrees
-                    Vec3f med_dir = (prev_dir + next_dir).normalized();
-                    displacement = half_width * ::tan(::acos(std::clamp(next_dir.dot(med_dir), -1.0f, 1.0f)));
-                }
-
-                float sq_prev_length = (curr - prev).squaredNorm();
-                float sq_next_length = (next - curr).squaredNorm();
-                float sq_displacement = sqr(displacement);
-                bool can_displace = displacement > 0.0f && sq_displacement < sq_prev_length && sq_displacement < sq_next_length;
-
-                if (can_displace) {
-                    // displacement to apply to the vertices to match
-                    Vec3f displacement_vec = displacement * prev_dir;
-                    // matches inner corner vertices
-                    if (is_right_turn)
-                        match_right_vertices(prev_sub_path, next_sub_path, curr_s_id, vertex_size_floats, -displacement_vec);
-                    else
-                        match_left_vertices(prev_sub_path, next_sub_path, curr_s_id, vertex_size_floats, -displacement_vec);
-
-                    if (!is_sharp) {
-                        // matches outer corner vertices
-                        if (is_right_turn)
-                            match_left_vertices(prev_sub_path, next_sub_path, curr_s_id, vertex_size_floats, displacement_vec);
-                        else
-                            match_right_vertices(prev_sub_path, next_sub_path, curr_s_id, vertex_size_floats, displacement_vec);
-                    }
-                }
-            }
-        }
-    };
-
-#if ENABLE_GCODE_VIEWER_STATISTICS
-    auto load_vertices_time = std::chrono::high_resolution_clock::now();
-    m_statistics.load_vertices = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start_time).count();
-#endif // ENABLE_GCODE_VIEWER_STATISTICS
-
-    // smooth toolpaths corners for TBuffers using triangles
-    for (size_t i = 0; i < m_buffers.size(); ++i) {
-        const TBuffer& t_buffer = m_buffers[i];
-        if (t_buffer.render_primitive_type == TBuffer::ERenderPrimitiveType::Triangle) {
-            smooth_triangle_toolpaths_corners(t_buffer, vertices[i]);
-        }
-    }
-
-    for (MultiVertexBuffer& v_multibuffer : vertices) {
-        for (VertexBuffer& v_buffer : v_multibuffer) {
-            v_buffer.shrink_to_fit();
-        }
-    }
-
-    // move the wipe toolpaths half height up to render them on proper position
-    MultiVertexBuffer& wipe_vertices = vertices[buffer_id(EMoveType::Wipe)];
-    for (VertexBuffer& v_buffer : wipe_vertices) {
-        for (size_t i = 2; i < v_buffer.size(); i += 3) {
-            v_buffer[i] += 0.5f * GCodeProcessor::Wipe_Height;
-        }
-    }
-
     // send vertices data to gpu
     for (size_t i = 0; i < m_buffers.size(); ++i) {
         TBuffer& t_buffer = m_buffers[i];
+        GCodePreviewBuffers::Buffer& buffer = preview.buffers[i];
+        assert(buffer.render_primitive_type == t_buffer.render_primitive_type && buffer.vertex_format == t_buffer.vertices.format);
 
-        const MultiVertexBuffer& v_multibuffer = vertices[i];
-        for (const VertexBuffer& v_buffer : v_multibuffer) {
+        for (VertexBuffer& v_buffer : buffer.vertices) {
             size_t size_elements = v_buffer.size();
             size_t size_bytes = size_elements * sizeof(float);
             size_t vertices_count = size_elements / t_buffer.vertices.vertex_size_floats();
@@ -1706,123 +1151,26 @@ void GCodeViewer::load_toolpaths(const GCodeProcessor::Result& gcode_result)
             glsafe(::glBindBuffer(GL_ARRAY_BUFFER, id));
             glsafe(::glBufferData(GL_ARRAY_BUFFER, size_bytes, v_buffer.data(), GL_STATIC_DRAW));
             glsafe(::glBindBuffer(GL_ARRAY_BUFFER, 0));
+
+            // dismiss vertices data, no more needed
+            VertexBuffer().swap(v_buffer);
         }
     }
 
 #if ENABLE_GCODE_VIEWER_STATISTICS
     auto smooth_vertices_time = std::chrono::high_resolution_clock::now();
-    m_statistics.smooth_vertices = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - load_vertices_time).count();
+    m_statistics.smooth_vertices = std::chrono::duration_cast<std::chrono::milliseconds>(smooth_vertices_time - load_vertices_time).count();
 #endif // ENABLE_GCODE_VIEWER_STATISTICS
-    log_memory_usage("Loaded G-code generated vertex buffers ", vertices, indices);
-
-    // dismiss vertices data, no more needed
-    std::vector<MultiVertexBuffer>().swap(vertices);
-
-    // toolpaths data -> extract indices from result
-    // paths may have been filled while extracting vertices,
-    // so reset them, they will be filled again while extracting indices
-    for (TBuffer& buffer : m_buffers) {
-        buffer.paths.clear();
-    }
-
-    // variable used to keep track of the current vertex buffers index and size
-    using CurrVertexBuffer = std::pair<unsigned int, size_t>;
-    std::vector<CurrVertexBuffer> curr_vertex_buffers(m_buffers.size(), { 0, 0 });
-
-    // variable used to keep track of the vertex buffers ids
-    using VboIndexList = std::vector<unsigned int>;
-    std::vector<VboIndexList> vbo_indices(m_buffers.size());
-
-    for (size_t i = 0; i < m_moves_count; ++i) {
-        const GCodeProcessor::MoveVertex& curr = gcode_result.moves[i];
-
-        // skip first vertex
-        if (i == 0)
-            continue;
-
-        const GCodeProcessor::MoveVertex& prev = gcode_result.moves[i - 1];
-        const GCodeProcessor::MoveVertex* next = nullptr;
-        if (i < m_moves_count - 1)
-            next = &gcode_result.moves[i + 1];
-
-        ++progress_count;
-        if (progress_dialog != nullptr && progress_count % progress_threshold == 0) {
-            progress_dialog->Update(int(100.0f * float(m_moves_count + i) / (2.0f * float(m_moves_count))),
-                _L("Generating index buffers") + ": " + wxNumberFormatter::ToString(100.0 * double(i) / double(m_moves_count), 0, wxNumberFormatter::Style_None) + "%");
-            progress_dialog->Fit();
-            progress_count = 0;
-        }
-
-        unsigned char id = buffer_id(curr.type);
-        TBuffer& t_buffer = m_buffers[id];
-        MultiIndexBuffer& i_multibuffer = indices[id];
-        CurrVertexBuffer& curr_vertex_buffer = curr_vertex_buffers[id];
-        VboIndexList& vbo_index_list = vbo_indices[id];
-
-        // ensure there is at least one index buffer
-        if (i_multibuffer.empty()) {
-            i_multibuffer.push_back(IndexBuffer());
-            vbo_index_list.push_back(t_buffer.vertices.vbos[curr_vertex_buffer.first]);
-        }
-
-        // if adding the indices for the current segment exceeds the threshold size of the current index buffer
-        // create another index buffer
-        if (i_multibuffer.back().size() * sizeof(IBufferType) >= IBUFFER_THRESHOLD_BYTES - t_buffer.max_indices_per_segment_size_bytes()) {
-            i_multibuffer.push_back(IndexBuffer());
-            vbo_index_list.push_back(t_buffer.vertices.vbos[curr_vertex_buffer.first]);
-            if (t_buffer.render_primitive_type != TBuffer::ERenderPrimitiveType::Point) {
-                Path& last_path = t_buffer.paths.back();
-                last_path.add_sub_path(prev, static_cast<unsigned int>(i_multibuffer.size()) - 1, 0, i - 1);
-            }
-        }
-
-        // if adding the vertices for the current segment exceeds the threshold size of the current vertex buffer
-        // create another index buffer
-        if (curr_vertex_buffer.second * t_buffer.vertices.vertex_size_bytes() > t_buffer.vertices.max_size_bytes() - t_buffer.max_vertices_per_segment_size_bytes()) {
-            i_multibuffer.push_back(IndexBuffer());
-
-            ++curr_vertex_buffer.first;
-            curr_vertex_buffer.second = 0;
-            vbo_index_list.push_back(t_buffer.vertices.vbos[curr_vertex_buffer.first]);
-
-            if (t_buffer.render_primitive_type != TBuffer::ERenderPrimitiveType::Point) {
-                Path& last_path = t_buffer.paths.back();
-                last_path.add_sub_path(prev, static_cast<unsigned int>(i_multibuffer.size()) - 1, 0, i - 1);
-            }
-        }
-
-        IndexBuffer& i_buffer = i_multibuffer.back();
-
-        switch (t_buffer.render_primitive_type)
-        {
-        case TBuffer::ERenderPrimitiveType::Point: {
-            add_indices_as_point(curr, t_buffer, static_cast<unsigned int>(i_multibuffer.size()) - 1, i_buffer, i);
-            curr_vertex_buffer.second += t_buffer.max_vertices_per_segment();
-            break;
-        }
-        case TBuffer::ERenderPrimitiveType::Line: {
-            add_indices_as_line(prev, curr, t_buffer, static_cast<unsigned int>(i_multibuffer.size()) - 1, i_buffer, i);
-            curr_vertex_buffer.second += t_buffer.max_vertices_per_segment();
-            break;
-        }
-        case TBuffer::ERenderPrimitiveType::Triangle: {
-            add_indices_as_solid(prev, curr, next, t_buffer, curr_vertex_buffer.second, static_cast<unsigned int>(i_multibuffer.size()) - 1, i_buffer, i);
-            break;
-        }
-        }
-    }
-
-    for (MultiIndexBuffer& i_multibuffer : indices) {
-        for (IndexBuffer& i_buffer : i_multibuffer) {
-            i_buffer.shrink_to_fit();
-        }
-    }
 
     // toolpaths data -> send indices data to gpu
     for (size_t i = 0; i < m_buffers.size(); ++i) {
         TBuffer& t_buffer = m_buffers[i];
-        const MultiIndexBuffer& i_multibuffer = indices[i];
-        for (const IndexBuffer& i_buffer : i_multibuffer) {
+        GCodePreviewBuffers::Buffer& buffer = preview.buffers[i];
+#if ENABLE_GCODE_VIEWER_STATISTICS
+        int64_t indices_count = 0;
+#endif // ENABLE_GCODE_VIEWER_STATISTICS
+        for (size_t j = 0; j < buffer.indices.size(); ++j) {
+            IndexBuffer& i_buffer = buffer.indices[j];
             size_t size_elements = i_buffer.size();
             size_t size_bytes = size_elements * sizeof(IBufferType);
 
@@ -1830,19 +1178,35 @@ void GCodeViewer::load_toolpaths(const GCodeProcessor::Result& gcode_result)
             t_buffer.indices.push_back(IBuffer());
             IBuffer& ibuf = t_buffer.indices.back();
             ibuf.count = size_elements;
-            ibuf.vbo = vbo_indices[i][t_buffer.indices.size() - 1];
+            ibuf.vbo = t_buffer.vertices.vbos[buffer.indices_vbuffer_ids[j]];
 
 #if ENABLE_GCODE_VIEWER_STATISTICS
             m_statistics.total_indices_gpu_size += static_cast<int64_t>(size_bytes);
             m_statistics.max_ibuffer_gpu_size = std::max(m_statistics.max_ibuffer_gpu_size, static_cast<int64_t>(size_bytes));
             ++m_statistics.ibuffers_count;
+            indices_count += static_cast<int64_t>(size_elements);
 #endif // ENABLE_GCODE_VIEWER_STATISTICS
 
             glsafe(::glGenBuffers(1, &ibuf.ibo));
             glsafe(::glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibuf.ibo));
             glsafe(::glBufferData(GL_ELEMENT_ARRAY_BUFFER, size_bytes, i_buffer.data(), GL_STATIC_DRAW));
             glsafe(::glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
+
+            // dismiss indices data, no more needed
+            IndexBuffer().swap(i_buffer);
+        }
+        t_buffer.paths = std::move(buffer.paths);
+
+#if ENABLE_GCODE_VIEWER_STATISTICS
+        EMoveType type = buffer_type(i);
+        if (type == EMoveType::Travel || type == EMoveType::Wipe || type == EMoveType::Extrude) {
+            if (t_buffer.render_primitive_type == TBuffer::ERenderPrimitiveType::Triangle)
+                indices_count -= static_cast<int64_t>(12 * t_buffer.paths.size()); // remove the starting + ending caps = 4 triangles
+            int64_t& count = (type == EMoveType::Travel) ? m_statistics.travel_segments_count :
+                             (type == EMoveType::Wipe) ? m_statistics.wipe_segments_count : m_statistics.extrude_segments_count;
+            count += indices_count / t_buffer.indices_per_segment();
         }
+#endif // ENABLE_GCODE_VIEWER_STATISTICS
     }
 
     if (progress_dialog != nullptr) {
@@ -1854,83 +1218,19 @@ void GCodeViewer::load_toolpaths(const GCodeProcessor::Result& gcode_result)
     for (const TBuffer& buffer : m_buffers) {
         m_statistics.paths_size += SLIC3R_STDVEC_MEMSIZE(buffer.paths, Path);
     }
-
-    auto update_segments_count = [&](EMoveType type, int64_t& count) {
-        unsigned int id = buffer_id(type);
-        const MultiIndexBuffer& buffers = indices[id];
-        int64_t indices_count = 0;
-        for (const IndexBuffer& buffer : buffers) {
-            indices_count += buffer.size();
-        }
-        const TBuffer& t_buffer = m_buffers[id];
-        if (t_buffer.render_primitive_type == TBuffer::ERenderPrimitiveType::Triangle)
-            indices_count -= static_cast<int64_t>(12 * t_buffer.paths.size()); // remove the starting + ending caps = 4 triangles
-
-        count += indices_count / t_buffer.indices_per_segment();
-    };
-
-    update_segments_count(EMoveType::Travel, m_statistics.travel_segments_count);
-    update_segments_count(EMoveType::Wipe, m_statistics.wipe_segments_count);
-    update_segments_count(EMoveType::Extrude, m_statistics.extrude_segments_count);
-
     m_statistics.load_indices = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - smooth_vertices_time).count();
 #endif // ENABLE_GCODE_VIEWER_STATISTICS
 
-    log_memory_usage("Loaded G-code generated indices buffers ", vertices, indices);
-
-    // dismiss indices data, no more needed
-    std::vector<MultiIndexBuffer>().swap(indices);
-
-    // layers zs / roles / extruder ids -> extract from result
-    size_t last_travel_s_id = 0;
-    for (size_t i = 0; i < m_moves_count; ++i) {
-        const GCodeProcessor::MoveVertex& move = gcode_result.moves[i];
-        if (move.type == EMoveType::Extrude) {
-            // layers zs
-            const double* const last_z = m_layers.empty() ? nullptr : &m_layers.get_zs().back();
-            double z = static_cast<double>(move.position[2]);
-            if (last_z == nullptr || z < *last_z - EPSILON || *last_z + EPSILON < z)
-                m_layers.append(z, { last_travel_s_id, i });
-            else
-                m_layers.get_endpoints().back().last = i;
-            // extruder ids
-            m_extruder_ids.emplace_back(move.extruder_id);
-            // roles
-            if (i > 0)
-                m_roles.emplace_back(move.extrusion_role);
-        }
-        else if (move.type == EMoveType::Travel) {
-            if (i - last_travel_s_id > 1 && !m_layers.empty())
-                m_layers.get_endpoints().back().last = i;
-
-            last_travel_s_id = i;
-        }
-    }
-
-    // roles -> remove duplicates
-    std::sort(m_roles.begin(), m_roles.end());
-    m_roles.erase(std::unique(m_roles.begin(), m_roles.end()), m_roles.end());
-    m_roles.shrink_to_fit();
-
-    // extruder ids -> remove duplicates
-    std::sort(m_extruder_ids.begin(), m_extruder_ids.end());
-    m_extruder_ids.erase(std::unique(m_extruder_ids.begin(), m_extruder_ids.end()), m_extruder_ids.end());
-    m_extruder_ids.shrink_to_fit();
+    // layers zs / roles / extruder ids
+    for (size_t i = 0; i < preview.layers_zs.size(); ++i)
+        m_layers.append(preview.layers_zs[i], { preview.layers_endpoints[i].first, preview.layers_endpoints[i].last });
+    m_roles = std::move(preview.roles);
+    m_extruder_ids = std::move(preview.extruder_ids);
 
     // set layers z range
     if (!m_layers.empty())
         m_layers_z_range = { 0, static_cast<unsigned int>(m_layers.size() - 1) };
 
-    // change color of paths whose layer contains option points
-    if (!options_zs.empty()) {
-        TBuffer& extrude_buffer = m_buffers[buffer_id(EMoveType::Extrude)];
-        for (Path& path : extrude_buffer.paths) {
-            float z = path.sub_paths.front().first.position[2];
-            if (std::find_if(options_zs.begin(), options_zs.end(), [z](float f) { return f - EPSILON <= z && z <= f + EPSILON; }) != options_zs.end())
-                path.cp_color_id = 255 - path.cp_color_id;
-        }
-    }
-
 #if ENABLE_GCODE_VIEWER_STATISTICS
     m_statistics.load_time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start_time).count();
 #endif // ENABLE_GCODE_VIEWER_STATISTICS
@@ -1945,11 +1245,16 @@ void GCodeViewer::load_shells(const Print& print, bool initialized)
         // no shells, return
         return;
 
+    // The instances of a PrintObject may belong to multiple identical ModelObjects.
+    std::vector<const ModelObject*> model_objs;
+    for (const PrintObject* obj : print.objects())
+        for (const PrintInstance& instance : obj->instances())
+            if (std::find(model_objs.begin(), model_objs.end(), instance.model_instance->get_object()) == model_objs.end())
+                model_objs.emplace_back(instance.model_instance->get_object());
+
     // adds objects' volumes 
     int object_id = 0;
-    for (const PrintObject* obj : print.objects()) {
-        const ModelObject* model_obj = obj->model_object();
-
+    for (const ModelObject* model_obj : model_objs) {
         std::vector<int> instance_ids(model_obj->instances.size());
         for (int i = 0; i < (int)model_obj->instances.size(); ++i) {
             instance_ids[i] = i;
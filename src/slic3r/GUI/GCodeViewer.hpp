@@ -3,6 +3,7 @@
 
 #include "3DScene.hpp"
 #include "libslic3r/GCode/GCodeProcessor.hpp"
+#include "libslic3r/GCode/PreviewBuffers.hpp"
 #include "GLModel.hpp"
 
 #if ENABLE_GCODE_WINDOW
@@ -23,12 +24,12 @@ namespace GUI {
 
 class GCodeViewer
 {
-    using IBufferType = unsigned short;
+    using IBufferType = GCodePreviewBuffers::IBufferType;
     using Color = std::array<float, 3>;
-    using VertexBuffer = std::vector<float>;
-    using MultiVertexBuffer = std::vector<VertexBuffer>;
-    using IndexBuffer = std::vector<IBufferType>;
-    using MultiIndexBuffer = std::vector<IndexBuffer>;
+    using VertexBuffer = GCodePreviewBuffers::VertexBuffer;
+    using MultiVertexBuffer = GCodePreviewBuffers::MultiVertexBuffer;
+    using IndexBuffer = GCodePreviewBuffers::IndexBuffer;
+    using MultiIndexBuffer = GCodePreviewBuffers::MultiIndexBuffer;
 
     static const std::vector<Color> Extrusion_Role_Colors;
     static const std::vector<Color> Options_Colors;
@@ -52,15 +53,7 @@ class GCodeViewer
     // vbo buffer containing vertices data used to render a specific toolpath type
     struct VBuffer
     {
-        enum class EFormat : unsigned char
-        {
-            // vertex format: 3 floats -> position.x|position.y|position.z
-            Position,
-            // vertex format: 4 floats -> position.x|position.y|position.z|normal.x
-            PositionNormal1,
-            // vertex format: 6 floats -> position.x|position.y|position.z|normal.x|normal.y|normal.z
-            PositionNormal3
-        };
+        using EFormat = GCodePreviewBuffers::EVertexFormat;
 
         EFormat format{ EFormat::Position };
         // vbos id
@@ -114,68 +107,7 @@ class GCodeViewer
     };
 
     // Used to identify different toolpath sub-types inside a IBuffer
-    struct Path
-    {
-        struct Endpoint
-        {
-            // index of the buffer in the multibuffer vector
-            // the buffer type may change:
-            // it is the vertex buffer while extracting vertices data,
-            // the index buffer while extracting indices data
-            unsigned int b_id{ 0 };
-            // index into the buffer
-            size_t i_id{ 0 };
-            // move id
-            size_t s_id{ 0 };
-            Vec3f position{ Vec3f::Zero() };
-        };
-
-        struct Sub_Path
-        {
-            Endpoint first;
-            Endpoint last;
-
-            bool contains(size_t s_id) const {
-                return first.s_id <= s_id && s_id <= last.s_id;
-            }
-        };
-
-        EMoveType type{ EMoveType::Noop };
-        ExtrusionRole role{ erNone };
-        float delta_extruder{ 0.0f };
-        float height{ 0.0f };
-        float width{ 0.0f };
-        float feedrate{ 0.0f };
-        float fan_speed{ 0.0f };
-        float temperature{ 0.0f };
-        float volumetric_rate{ 0.0f };
-        unsigned char extruder_id{ 0 };
-        unsigned char cp_color_id{ 0 };
-        std::vector<Sub_Path> sub_paths;
-
-        bool matches(const GCodeProcessor::MoveVertex& move) const;
-        size_t vertices_count() const {
-            return sub_paths.empty() ? 0 : sub_paths.back().last.s_id - sub_paths.front().first.s_id + 1;
-        }
-        bool contains(size_t s_id) const {
-            return sub_paths.empty() ? false : sub_paths.front().first.s_id <= s_id && s_id <= sub_paths.back().last.s_id;
-        }
-        int get_id_of_sub_path_containing(size_t s_id) const {
-            if (sub_paths.empty())
-                return -1;
-            else {
-                for (int i = 0; i < static_cast<int>(sub_paths.size()); ++i) {
-                    if (sub_paths[i].contains(s_id))
-                        return i;
-                }
-                return -1;
-            }
-        }
-        void add_sub_path(const GCodeProcessor::MoveVertex& move, unsigned int b_id, size_t i_id, size_t s_id) {
-            Endpoint endpoint = { b_id, i_id, s_id, move.position };
-            sub_paths.push_back({ endpoint , endpoint });
-        }
-    };
+    using Path = GCodePreviewBuffers::Path;
 
     // Used to batch the indices needed to render the paths
     struct RenderPath
@@ -229,12 +161,7 @@ class GCodeViewer
     // buffer containing data for rendering a specific toolpath type
     struct TBuffer
     {
-        enum class ERenderPrimitiveType : unsigned char
-        {
-            Point,
-            Line,
-            Triangle
-        };
+        using ERenderPrimitiveType = GCodePreviewBuffers::ERenderPrimitiveType;
 
         ERenderPrimitiveType render_primitive_type;
         VBuffer vertices;
@@ -249,11 +176,6 @@ class GCodeViewer
 
         void reset();
 
-        // b_id index of buffer contained in this->indices
-        // i_id index of first index contained in this->indices[b_id]
-        // s_id index of first vertex contained in this->vertices
-        void add_path(const GCodeProcessor::MoveVertex& move, unsigned int b_id, size_t i_id, size_t s_id);
-
         unsigned int max_vertices_per_segment() const {
             switch (render_primitive_type)
             {
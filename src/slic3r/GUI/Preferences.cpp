@@ -60,6 +60,8 @@ void PreferencesDialog::build()
 	m_optgroup_general->m_on_change = [this](t_config_option_key opt_key, boost::any value) {
 		if (opt_key == "default_action_on_close_application" || opt_key == "default_action_on_select_preset")
 			m_values[opt_key] = boost::any_cast<bool>(value) ? "none" : "discard";
+		else if (opt_key == "layer_memory_budget")
+			m_values[opt_key] = std::to_string(boost::any_cast<int>(value));
 		else
 		    m_values[opt_key] = boost::any_cast<bool>(value) ? "1" : "0";
 	};
@@ -93,6 +95,16 @@ void PreferencesDialog::build()
 		option = Option(def, "background_processing");
 		m_optgroup_general->append_single_option_line(option);
 
+		def.label = L("Layer memory budget (MB)");
+		def.type = coInt;
+		def.min = 0;
+		def.tooltip = L("Memory the extrusions of the sliced layers may occupy. The extrusions over the budget are moved "
+			"to a temporary file once the layer is sliced and loaded back when needed, at the cost of a slower slicing. "
+			"Zero keeps all the layers in memory.");
+		def.set_default_value(new ConfigOptionInt{ std::max(0, atoi(app_config->get("layer_memory_budget").c_str())) });
+		option = Option(def, "layer_memory_budget");
+		m_optgroup_general->append_single_option_line(option);
+
 		// Please keep in sync with ConfigWizard
 		def.label = L("Check for application updates");
 		def.type = coBool;
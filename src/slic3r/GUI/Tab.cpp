@@ -1480,6 +1480,7 @@ void TabPrint::build()
         optgroup->append_single_option_line("bridge_angle");
         optgroup->append_single_option_line("only_retract_when_crossing_perimeters");
         optgroup->append_single_option_line("infill_first");
+        optgroup->append_single_option_line("monotonic_infill_rounds");
 
     page = add_options_page(L("Skirt and brim"), "skirt+brim");
         category_path = "skirt-and-brim_133969#";
@@ -1630,6 +1631,7 @@ void TabPrint::build()
         optgroup = page->new_optgroup(L("Output file"));
         optgroup->append_single_option_line("gcode_comments");
         optgroup->append_single_option_line("gcode_label_objects");
+        optgroup->append_single_option_line("arc_fitting_tolerance");
         option = optgroup->get_option("output_filename_format");
         option.opt.full_width = true;
         optgroup->append_single_option_line(option);
@@ -2262,6 +2264,7 @@ void TabPrinter::build_fff()
 
         optgroup = page->new_optgroup(L("Firmware"));
         optgroup->append_single_option_line("gcode_flavor");
+        optgroup->append_single_option_line("gcode_compression");
 
         option = optgroup->get_option("thumbnails");
         option.opt.full_width = true;
@@ -4315,6 +4318,7 @@ void TabSLAPrint::build()
     optgroup->append_single_option_line("hollowing_enable");
     optgroup->append_single_option_line("hollowing_min_thickness");
     optgroup->append_single_option_line("hollowing_quality");
+    optgroup->append_single_option_line("hollowing_adaptive");
     optgroup->append_single_option_line("hollowing_closing_distance");
 
     page = add_options_page(L("Advanced"), "wrench");
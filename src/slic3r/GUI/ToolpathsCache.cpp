@@ -0,0 +1,425 @@
+#include "libslic3r/libslic3r.h"
+#include "ToolpathsCache.hpp"
+
+#include "libslic3r/ExtrusionEntity.hpp"
+#include "libslic3r/Layer.hpp"
+#include "libslic3r/Print.hpp"
+#include "libslic3r/Utils.hpp"
+
+#include <algorithm>
+
+#include <boost/log/trivial.hpp>
+
+#include <tbb/parallel_for.h>
+#include <tbb/spin_mutex.h>
+
+namespace Slic3r {
+namespace GUI {
+
+namespace {
+
+struct Ctxt
+{
+    const PrintInstances           *shifted_copies;
+    std::vector<const Layer*>       layers;
+    bool                            has_perimeters;
+    bool                            has_infill;
+    bool                            has_support;
+    const ToolpathsColoring        *coloring;
+
+    bool                            color_by_tool() const { return coloring->color_by_tool(); }
+    size_t                          number_tools()  const { return coloring->number_tools; }
+
+    // For coloring by a color_print(M600), return a parsed color.
+    bool                            color_by_color_print() const { return coloring->color_by_color_print(); }
+    const size_t                    color_print_color_idx_by_layer_idx_and_extruder(const size_t layer_idx, const int extruder) const
+    {
+        const std::vector<CustomGCode::Item> &color_print_values = coloring->color_print_values;
+        const int                             extruders_cnt      = coloring->extruders_cnt;
+        const coordf_t                        print_z            = layers[layer_idx]->print_z;
+
+        auto it = std::find_if(color_print_values.begin(), color_print_values.end(),
+            [print_z](const CustomGCode::Item& code)
+            { return fabs(code.print_z - print_z) < EPSILON; });
+        if (it != color_print_values.end()) {
+            CustomGCode::Type type = it->type;
+            // pause print or custom Gcode
+            if (type == CustomGCode::PausePrint ||
+                (type != CustomGCode::ColorChange && type != CustomGCode::ToolChange))
+                return number_tools()-1; // last color item is a gray color for pause print or custom G-code
+
+            // change tool (extruder)
+            if (type == CustomGCode::ToolChange)
+                return get_color_idx_for_tool_change(it, extruder);
+            // change color for current extruder
+            if (type == CustomGCode::ColorChange) {
+                int color_idx = get_color_idx_for_color_change(it, extruder);
+                if (color_idx >= 0)
+                    return color_idx;
+            }
+        }
+
+        const CustomGCode::Item value{print_z + EPSILON, CustomGCode::Custom, 0, ""};
+        it = std::lower_bound(color_print_values.begin(), color_print_values.end(), value);
+        while (it != color_print_values.begin()) {
+            --it;
+            // change color for current extruder
+            if (it->type == CustomGCode::ColorChange) {
+                int color_idx = get_color_idx_for_color_change(it, extruder);
+                if (color_idx >= 0)
+                    return color_idx;
+            }
+            // change tool (extruder)
+            if (it->type == CustomGCode::ToolChange)
+                return get_color_idx_for_tool_change(it, extruder);
+        }
+
+        return std::min<int>(extruders_cnt - 1, std::max<int>(extruder - 1, 0));;
+    }
+
+private:
+    int get_m600_color_idx(std::vector<CustomGCode::Item>::const_iterator it) const
+    {
+        int shift = 0;
+        while (it != coloring->color_print_values.begin()) {
+            --it;
+            if (it->type == CustomGCode::ColorChange)
+                shift++;
+        }
+        return coloring->extruders_cnt + shift;
+    }
+
+    int get_color_idx_for_tool_change(std::vector<CustomGCode::Item>::const_iterator it, const int extruder) const
+    {
+        const int extruders_cnt    = coloring->extruders_cnt;
+        const int current_extruder = it->extruder == 0 ? extruder : it->extruder;
+        if (number_tools() == size_t(extruders_cnt + 1)) // there is no one "M600"
+            return std::min<int>(extruders_cnt - 1, std::max<int>(current_extruder - 1, 0));
+
+        auto it_n = it;
+        while (it_n != coloring->color_print_values.begin()) {
+            --it_n;
+            if (it_n->type == CustomGCode::ColorChange && it_n->extruder == current_extruder)
+                return get_m600_color_idx(it_n);
+        }
+
+        return std::min<int>(extruders_cnt - 1, std::max<int>(current_extruder - 1, 0));
+    }
+
+    int get_color_idx_for_color_change(std::vector<CustomGCode::Item>::const_iterator it, const int extruder) const
+    {
+        if (coloring->extruders_cnt == 1)
+            return get_m600_color_idx(it);
+
+        auto it_n = it;
+        bool is_tool_change = false;
+        while (it_n != coloring->color_print_values.begin()) {
+            --it_n;
+            if (it_n->type == CustomGCode::ToolChange) {
+                is_tool_change = true;
+                if (it_n->extruder == it->extruder || (it_n->extruder == 0 && it->extruder == extruder))
+                    return get_m600_color_idx(it);
+                break;
+            }
+        }
+        if (!is_tool_change && it->extruder == extruder)
+            return get_m600_color_idx(it);
+
+        return -1;
+    }
+};
+
+std::array<PrintStateBase::TimeStamp, 3> toolpaths_timestamps(const PrintObject &print_object)
+{
+    std::array<PrintStateBase::TimeStamp, 3> out;
+    size_t i = 0;
+    for (PrintObjectStep step : { posPerimeters, posInfill, posSupportMaterial }) {
+        PrintStateBase::StateWithTimeStamp state = print_object.step_state_with_timestamp(step);
+        out[i ++] = state.state == PrintStateBase::DONE ? state.timestamp : 0;
+    }
+    return out;
+}
+
+Points instance_shifts(const PrintObject &print_object)
+{
+    Points out;
+    out.reserve(print_object.instances().size());
+    for (const PrintInstance &instance : print_object.instances())
+        out.emplace_back(instance.shift);
+    return out;
+}
+
+} // namespace
+
+bool PrintObjectToolpaths::valid(const PrintObject &print_object, const ToolpathsColoring &coloring) const
+{
+    return this->coloring == coloring && this->timestamps == toolpaths_timestamps(print_object) && this->instance_shifts == Slic3r::GUI::instance_shifts(print_object);
+}
+
+size_t PrintObjectToolpaths::cpu_memory_used() const
+{
+    size_t memsize = sizeof(*this) + this->volumes.capacity() * sizeof(std::unique_ptr<GLVolume>);
+    for (const std::unique_ptr<GLVolume> &volume : this->volumes)
+        memsize += volume->cpu_memory_used();
+    return memsize;
+}
+
+std::unique_ptr<PrintObjectToolpaths> generate_print_object_toolpaths(const PrintObject &print_object, const ToolpathsColoring &coloring)
+{
+    auto out = std::make_unique<PrintObjectToolpaths>();
+    // Read the timestamps first, so that the toolpaths generated from a step being invalidated in the meantime will not be reused.
+    out->timestamps      = toolpaths_timestamps(print_object);
+    out->instance_shifts = instance_shifts(print_object);
+    out->coloring        = coloring;
+
+    Ctxt ctxt;
+    ctxt.has_perimeters = out->timestamps[0] != 0;
+    ctxt.has_infill     = out->timestamps[1] != 0;
+    ctxt.has_support    = out->timestamps[2] != 0;
+    ctxt.coloring       = &out->coloring;
+    ctxt.shifted_copies = &print_object.instances();
+
+    // order layers by print_z
+    {
+        size_t nlayers = 0;
+        if (ctxt.has_perimeters || ctxt.has_infill)
+            nlayers = print_object.layers().size();
+        if (ctxt.has_support)
+            nlayers += print_object.support_layers().size();
+        ctxt.layers.reserve(nlayers);
+    }
+    if (ctxt.has_perimeters || ctxt.has_infill)
+        for (const Layer *layer : print_object.layers())
+            ctxt.layers.emplace_back(layer);
+    if (ctxt.has_support)
+        for (const Layer *layer : print_object.support_layers())
+            ctxt.layers.emplace_back(layer);
+    std::sort(ctxt.layers.begin(), ctxt.layers.end(), [](const Layer *l1, const Layer *l2) { return l1->print_z < l2->print_z; });
+
+    BOOST_LOG_TRIVIAL(debug) << "Generating print object toolpaths in parallel - start" << log_memory_info();
+
+    const int  selected_extruder             = coloring.selected_extruder;
+    const bool is_selected_separate_extruder = selected_extruder > 0 && ctxt.color_by_color_print();
+
+    //FIXME Improve the heuristics for a grain size.
+    size_t          grain_size = std::max(ctxt.layers.size() / 16, size_t(1));
+    tbb::spin_mutex new_volume_mutex;
+    auto            new_volume = [&out, &new_volume_mutex](size_t color_idx) -> GLVolume* {
+    	// Allocate the volume before locking.
+        auto volume = std::make_unique<GLVolume>();
+        volume->is_extrusion_path = true;
+        volume->extruder_id       = int(color_idx);
+        GLVolume *ptr = volume.get();
+    	tbb::spin_mutex::scoped_lock lock(new_volume_mutex);
+        out->volumes.emplace_back(std::move(volume));
+        return ptr;
+    };
+    tbb::parallel_for(
+        tbb::blocked_range<size_t>(0, ctxt.layers.size(), grain_size),
+        [&ctxt, &new_volume, is_selected_separate_extruder, selected_extruder, layer_spill = print_object.print()->layer_spill()](const tbb::blocked_range<size_t>& range) {
+        GLVolumePtrs 		vols;
+        auto                volume = [&ctxt, &vols](size_t layer_idx, int extruder, int feature) -> GLVolume& {
+            return *vols[ctxt.color_by_color_print()?
+                ctxt.color_print_color_idx_by_layer_idx_and_extruder(layer_idx, extruder) :
+				ctxt.color_by_tool() ?
+					std::min<int>(ctxt.number_tools() - 1, std::max<int>(extruder - 1, 0)) :
+					feature
+				];
+        };
+        if (ctxt.color_by_color_print() || ctxt.color_by_tool()) {
+            for (size_t i = 0; i < ctxt.number_tools(); ++i)
+                vols.emplace_back(new_volume(i));
+        }
+        else
+            vols = { new_volume(0), new_volume(1), new_volume(2) };
+        for (GLVolume *vol : vols)
+			// Reserving number of vertices (3x position + 3x color)
+        	vol->indexed_vertex_array.reserve(VERTEX_BUFFER_RESERVE_SIZE / 6);
+        for (size_t idx_layer = range.begin(); idx_layer < range.end(); ++ idx_layer) {
+            const Layer *layer = ctxt.layers[idx_layer];
+            // Load the spilled extrusions back for the time of generating the toolpaths of this layer.
+            RestoredLayers restored(layer_spill, { layer });
+
+            if (is_selected_separate_extruder)
+            {
+                bool at_least_one_has_correct_extruder = false;
+                for (const LayerRegion* layerm : layer->regions())
+                {
+                    if (layerm->slices.surfaces.empty())
+                        continue;
+                    const PrintRegionConfig& cfg = layerm->region().config();
+                    if (cfg.perimeter_extruder.value    == selected_extruder ||
+                        cfg.infill_extruder.value       == selected_extruder ||
+                        cfg.solid_infill_extruder.value == selected_extruder ) {
+                        at_least_one_has_correct_extruder = true;
+                        break;
+                    }
+                }
+                if (!at_least_one_has_correct_extruder)
+                    continue;
+            }
+
+            for (GLVolume *vol : vols)
+                if (vol->print_zs.empty() || vol->print_zs.back() != layer->print_z) {
+                    vol->print_zs.emplace_back(layer->print_z);
+                    vol->offsets.emplace_back(vol->indexed_vertex_array.quad_indices.size());
+                    vol->offsets.emplace_back(vol->indexed_vertex_array.triangle_indices.size());
+                }
+            for (const PrintInstance &instance : *ctxt.shifted_copies) {
+                const Point &copy = instance.shift;
+                for (const LayerRegion *layerm : layer->regions()) {
+                    if (is_selected_separate_extruder)
+                    {
+                        const PrintRegionConfig& cfg = layerm->region().config();
+                        if (cfg.perimeter_extruder.value    != selected_extruder ||
+                            cfg.infill_extruder.value       != selected_extruder ||
+                            cfg.solid_infill_extruder.value != selected_extruder)
+                            continue;
+                    }
+                    if (ctxt.has_perimeters)
+                        _3DScene::extrusionentity_to_verts(layerm->perimeters, float(layer->print_z), copy,
+                        	volume(idx_layer, layerm->region().config().perimeter_extruder.value, 0));
+                    if (ctxt.has_infill) {
+                        for (const ExtrusionEntity *ee : layerm->fills.entities) {
+                            // fill represents infill extrusions of a single island.
+                            const auto *fill = dynamic_cast<const ExtrusionEntityCollection*>(ee);
+                            if (! fill->entities.empty())
+                                _3DScene::extrusionentity_to_verts(*fill, float(layer->print_z), copy,
+	                                volume(idx_layer,
+		                                is_solid_infill(fill->entities.front()->role()) ?
+			                                layerm->region().config().solid_infill_extruder :
+			                                layerm->region().config().infill_extruder,
+		                                1));
+                        }
+                    }
+                }
+                if (ctxt.has_support) {
+                    const SupportLayer *support_layer = dynamic_cast<const SupportLayer*>(layer);
+                    if (support_layer) {
+                        for (const ExtrusionEntity *extrusion_entity : support_layer->support_fills.entities)
+                            _3DScene::extrusionentity_to_verts(extrusion_entity, float(layer->print_z), copy,
+	                            volume(idx_layer,
+		                            (extrusion_entity->role() == erSupportMaterial) ?
+			                            support_layer->object()->config().support_material_extruder :
+			                            support_layer->object()->config().support_material_interface_extruder,
+		                            2));
+                    }
+                }
+            }
+            // Ensure that no volume grows over the limits. If the volume is too large, allocate a new one.
+	        for (size_t i = 0; i < vols.size(); ++i) {
+	            GLVolume &vol = *vols[i];
+	            if (vol.indexed_vertex_array.vertices_and_normals_interleaved.size() > MAX_VERTEX_BUFFER_SIZE) {
+	                vols[i] = new_volume(size_t(vol.extruder_id));
+	                // Assign the large pre-allocated buffers to the new GLVolume, copy the content back to the old GLVolume.
+	                vols[i]->indexed_vertex_array = std::move(vol.indexed_vertex_array);
+	                vol.indexed_vertex_array = vols[i]->indexed_vertex_array;
+	                vol.indexed_vertex_array.shrink_to_fit();
+	                // Clear the buffers, but keep them pre-allocated.
+	                vols[i]->indexed_vertex_array.clear();
+	                vols[i]->indexed_vertex_array.reserve(VERTEX_BUFFER_RESERVE_SIZE / 6);
+	            }
+	        }
+        }
+        for (GLVolume *vol : vols)
+            vol->indexed_vertex_array.shrink_to_fit();
+    });
+
+    // Remove empty volumes.
+    out->volumes.erase(
+        std::remove_if(out->volumes.begin(), out->volumes.end(), [](const std::unique_ptr<GLVolume> &volume) { return volume->empty(); }),
+        out->volumes.end());
+
+    BOOST_LOG_TRIVIAL(debug) << "Generating print object toolpaths in parallel - end" << log_memory_info();
+    return out;
+}
+
+std::shared_ptr<PrintObjectToolpaths> ToolpathsCache::find(const PrintObject &print_object, const ToolpathsColoring &coloring)
+{
+    std::scoped_lock<std::mutex> lock(m_mutex);
+    auto it = m_entries.find(print_object.id());
+    if (it == m_entries.end() || ! it->second.toolpaths->valid(print_object, coloring))
+        return nullptr;
+    it->second.last_used = ++ m_clock;
+    return it->second.toolpaths;
+}
+
+void ToolpathsCache::insert(const PrintObject &print_object, std::shared_ptr<PrintObjectToolpaths> toolpaths)
+{
+    size_t memory = toolpaths->cpu_memory_used();
+    std::scoped_lock<std::mutex> lock(m_mutex);
+    Entry &entry = m_entries[print_object.id()];
+    m_memory_used -= entry.memory;
+    entry.toolpaths = std::move(toolpaths);
+    entry.memory    = memory;
+    entry.last_used = ++ m_clock;
+    m_memory_used += memory;
+    this->evict();
+}
+
+void ToolpathsCache::evict()
+{
+    while (m_memory_used > m_memory_budget) {
+        // The entry inserted last is released last, possibly right away if it does not fit the budget alone.
+        auto it_lru = std::min_element(m_entries.begin(), m_entries.end(),
+            [](const auto &lhs, const auto &rhs) { return lhs.second.last_used < rhs.second.last_used; });
+        assert(it_lru != m_entries.end());
+        m_memory_used -= it_lru->second.memory;
+        m_entries.erase(it_lru);
+    }
+}
+
+std::shared_ptr<PrintObjectToolpaths> ToolpathsCache::get(const PrintObject &print_object, const ToolpathsColoring &coloring)
+{
+    {
+        std::scoped_lock<std::mutex> lock(m_mutex);
+        m_last_coloring = coloring;
+    }
+    if (std::shared_ptr<PrintObjectToolpaths> toolpaths = this->find(print_object, coloring); toolpaths)
+        return toolpaths;
+    // Generate outside of the lock, the background slicing process may be generating the toolpaths of the other objects.
+    std::shared_ptr<PrintObjectToolpaths> toolpaths = generate_print_object_toolpaths(print_object, coloring);
+    this->insert(print_object, toolpaths);
+    return toolpaths;
+}
+
+void ToolpathsCache::update(const Print &print, const std::function<void()> &throw_if_canceled)
+{
+    ToolpathsColoring coloring;
+    {
+        std::scoped_lock<std::mutex> lock(m_mutex);
+        // Release the toolpaths of the deleted objects.
+        for (auto it = m_entries.begin(); it != m_entries.end();)
+            if (std::none_of(print.objects().begin(), print.objects().end(), [id = it->first](const PrintObject *object) { return object->id() == id; })) {
+                m_memory_used -= it->second.memory;
+                it = m_entries.erase(it);
+            } else
+                ++ it;
+        coloring = m_last_coloring;
+    }
+    for (const PrintObject *object : print.objects())
+        if (! this->find(*object, coloring)) {
+            // Don't generate toolpaths in advance just to release them again.
+            if (this->memory_used() >= this->memory_budget())
+                break;
+            throw_if_canceled();
+            this->insert(*object, generate_print_object_toolpaths(*object, coloring));
+        }
+}
+
+void ToolpathsCache::clear()
+{
+    std::scoped_lock<std::mutex> lock(m_mutex);
+    m_entries.clear();
+    m_memory_used = 0;
+}
+
+void ToolpathsCache::set_memory_budget(size_t memory_budget)
+{
+    std::scoped_lock<std::mutex> lock(m_mutex);
+    m_memory_budget = memory_budget;
+    this->evict();
+}
+
+} // namespace GUI
+} // namespace Slic3r
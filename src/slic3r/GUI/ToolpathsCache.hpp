@@ -0,0 +1,121 @@
+#ifndef slic3r_GUI_ToolpathsCache_hpp_
+#define slic3r_GUI_ToolpathsCache_hpp_
+
+#include "libslic3r/CustomGCode.hpp"
+#include "libslic3r/ObjectID.hpp"
+#include "libslic3r/Point.hpp"
+#include "libslic3r/PrintBase.hpp"
+
+#include "3DScene.hpp"
+
+#include <array>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Slic3r {
+
+class Print;
+class PrintObject;
+
+namespace GUI {
+
+// Parameters of the preview of the sliced objects, which split the toolpaths of a PrintObject into differently colored volumes.
+// The colors themselves are not part of the parameters, they are assigned to the volumes when loaded to the 3D scene.
+struct ToolpathsColoring
+{
+    // Number of the tool colors. Zero if colored by the extrusion features: perimeters, infill and support.
+    size_t                          number_tools      { 0 };
+    // Color changes, the toolpaths are colored by the color changes if not empty.
+    std::vector<CustomGCode::Item>  color_print_values;
+    int                             extruders_cnt     { 1 };
+    // Extruder selected in the preview to show the color changes of, zero for all extruders.
+    int                             selected_extruder { 0 };
+
+    bool color_by_tool()        const { return number_tools > 0; }
+    bool color_by_color_print() const { return ! color_print_values.empty(); }
+
+    // The number of extruders and the selected extruder only matter for the coloring by the color changes.
+    bool operator==(const ToolpathsColoring &rhs) const {
+        return number_tools == rhs.number_tools && color_print_values == rhs.color_print_values &&
+               (! this->color_by_color_print() || (extruders_cnt == rhs.extruders_cnt && selected_extruder == rhs.selected_extruder));
+    }
+    bool operator!=(const ToolpathsColoring &rhs) const { return ! (*this == rhs); }
+};
+
+// Toolpaths of a single PrintObject with all its instances, the vertex data are kept on the CPU side only.
+// GLVolume::extruder_id is the index of the color of the volume: Into the tool colors if colored by tool
+// or by the color changes, otherwise 0 for perimeters, 1 for infill and 2 for support.
+struct PrintObjectToolpaths
+{
+    // Timestamps of posPerimeters, posInfill and posSupportMaterial the toolpaths were generated from, zero for the steps not done.
+    std::array<PrintStateBase::TimeStamp, 3>    timestamps { 0, 0, 0 };
+    // Shifts of the instances, which are baked into the vertices.
+    Points                                      instance_shifts;
+    ToolpathsColoring                           coloring;
+    std::vector<std::unique_ptr<GLVolume>>      volumes;
+
+    bool valid(const PrintObject &print_object, const ToolpathsColoring &coloring) const;
+    // Memory held by the vertex data of the volumes.
+    size_t cpu_memory_used() const;
+};
+
+// Generate the toolpaths of a print object for the given coloring, in parallel over the layers.
+std::unique_ptr<PrintObjectToolpaths> generate_print_object_toolpaths(const PrintObject &print_object, const ToolpathsColoring &coloring);
+
+// Default limit of the memory held by the vertex data of the cached toolpaths.
+static constexpr size_t TOOLPATHS_CACHE_MEMORY_BUDGET = size_t(512) << 20;
+
+// Toolpaths of the print objects cached for the preview of the sliced objects. The toolpaths are generated
+// by the background slicing process as soon as the slicing is finished and they are regenerated only for the objects,
+// whose steps were invalidated, thus the preview only uploads the cached vertex data to the GPU.
+// The toolpaths least recently used are released once the cached vertex data exceed the memory budget.
+// Thread safe, filled by the background slicing thread and consumed by the UI thread.
+class ToolpathsCache
+{
+public:
+    // Returns the cached toolpaths if valid for the current state of the print object and the coloring,
+    // otherwise the toolpaths are generated and cached. The coloring is remembered for update().
+    // If the returned pointer is the only reference (use_count() == 1), the toolpaths were released by the cache
+    // to stay within the memory budget, and the caller may move the vertex data out of them instead of copying.
+    std::shared_ptr<PrintObjectToolpaths> get(const PrintObject &print_object, const ToolpathsColoring &coloring);
+    // Generate the toolpaths of the print objects not cached yet, with the coloring of the last get().
+    // Until the preview requested the toolpaths, they are generated with the default coloring of the preview
+    // by the extrusion features. The cached toolpaths of the objects no longer present in the print are released.
+    // No toolpaths are generated in advance once the memory budget is exhausted.
+    void update(const Print &print, const std::function<void()> &throw_if_canceled);
+    void clear();
+
+    void   set_memory_budget(size_t memory_budget);
+    size_t memory_budget() const { std::scoped_lock<std::mutex> lock(m_mutex); return m_memory_budget; }
+    // Memory held by the vertex data of the cached toolpaths.
+    size_t memory_used() const { std::scoped_lock<std::mutex> lock(m_mutex); return m_memory_used; }
+
+private:
+    struct Entry {
+        std::shared_ptr<PrintObjectToolpaths> toolpaths;
+        size_t                                memory    { 0 };
+        // Value of m_clock when the toolpaths were used last.
+        size_t                                last_used { 0 };
+    };
+
+    std::shared_ptr<PrintObjectToolpaths> find(const PrintObject &print_object, const ToolpathsColoring &coloring);
+    void insert(const PrintObject &print_object, std::shared_ptr<PrintObjectToolpaths> toolpaths);
+    // Release the toolpaths least recently used until the memory budget is met. To be called with m_mutex locked.
+    void evict();
+
+    mutable std::mutex                                              m_mutex;
+    std::map<ObjectID, Entry>                                       m_entries;
+    size_t                                                          m_memory_used   { 0 };
+    size_t                                                          m_memory_budget { TOOLPATHS_CACHE_MEMORY_BUDGET };
+    size_t                                                          m_clock         { 0 };
+    // Coloring of the last preview, used to generate the toolpaths in advance.
+    ToolpathsColoring                                               m_last_coloring;
+};
+
+} // namespace GUI
+} // namespace Slic3r
+
+#endif // slic3r_GUI_ToolpathsCache_hpp_
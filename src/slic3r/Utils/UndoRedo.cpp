@@ -1,4 +1,5 @@
 #include "UndoRedo.hpp"
+#include "UndoRedoDataPool.hpp"
 
 #include <algorithm>
 #include <iostream>
@@ -308,31 +309,12 @@ private:
 struct MutableHistoryInterval
 {
 private:
-	struct Data
-	{
-		// Reference counter of this data chunk. We may have used shared_ptr, but the shared_ptr is thread safe
-		// with the associated cost of CPU cache invalidation on refcount change.
-		size_t		refcnt;
-		size_t		size;
-		char 		data[1];
-
-		// The serialized data matches the data stored here.
-		bool 		matches(const std::string& rhs) { return this->size == rhs.size() && memcmp(this->data, rhs.data(), this->size) == 0; }
-
-		// The timestamp matches the timestamp serialized in the data stored here.
-		bool 		matches_timestamp(uint64_t timestamp) { assert(timestamp > 0);  assert(this->size > 8); return memcmp(this->data, &timestamp, 8) == 0; }
-	};
-
-	Interval    m_interval;
-	Data	   *m_data;
+	Interval    	m_interval;
+	SerializedData *m_data;
 
 public:
-	MutableHistoryInterval(const Interval &interval, const std::string &input_data) : m_interval(interval), m_data(nullptr) {
-		m_data = (Data*)new char[offsetof(Data, data) + input_data.size()];
-		m_data->refcnt = 1;
-		m_data->size = input_data.size();
-		memcpy(m_data->data, input_data.data(), input_data.size());
-	}
+	// Takes over a reference to data acquired from SerializedDataPool.
+	MutableHistoryInterval(const Interval &interval, SerializedData *data) : m_interval(interval), m_data(data) {}
 
 	MutableHistoryInterval(const Interval &interval, MutableHistoryInterval &other) : m_interval(interval), m_data(other.m_data) {
 		++ m_data->refcnt;
@@ -342,11 +324,18 @@ public:
 	MutableHistoryInterval(const size_t begin, const size_t end) : m_interval(begin, end), m_data(nullptr) {}
 
 	MutableHistoryInterval(MutableHistoryInterval&& rhs) : m_interval(rhs.m_interval), m_data(rhs.m_data) { rhs.m_data = nullptr; }
-	MutableHistoryInterval& operator=(MutableHistoryInterval&& rhs) { m_interval = rhs.m_interval; m_data = rhs.m_data; rhs.m_data = nullptr; return *this; }
+	MutableHistoryInterval& operator=(MutableHistoryInterval&& rhs) {
+		if (this == &rhs)
+			return *this;
+		// Release the data, otherwise the data overwritten by std::vector::erase() would leak.
+		if (m_data != nullptr)
+			m_data->pool->release(m_data);
+		m_interval = rhs.m_interval; m_data = rhs.m_data; rhs.m_data = nullptr; return *this;
+	}
 
 	~MutableHistoryInterval() {
-		if (m_data != nullptr && -- m_data->refcnt == 0)
-			delete[] (char*)m_data;
+		if (m_data != nullptr)
+			m_data->pool->release(m_data);
 	}
 
 	const Interval& interval() const { return m_interval; }
@@ -359,17 +348,17 @@ public:
 	bool		operator<(const MutableHistoryInterval& rhs) const { return m_interval < rhs.m_interval; }
 	bool 		operator==(const MutableHistoryInterval& rhs) const { return m_interval == rhs.m_interval; }
 
-	const char* data() const { return m_data->data; }
+	const SerializedData* data() const { return m_data; }
+	std::string	serialized() const { return m_data->compressed() ? m_data->decompress() : std::string(m_data->data, m_data->data + m_data->size); }
 	size_t  	size() const { return m_data->size; }
 	size_t		refcnt() const { return m_data->refcnt; }
-	bool		matches(const std::string& data) { return m_data->matches(data); }
 	bool		matches_timestamp(uint64_t timestamp) { return m_data->matches_timestamp(timestamp); }
 	size_t 		memsize() const {
 		return m_data->refcnt == 1 ?
 			// Count just the size of the snapshot data.
-			m_data->size :
+			m_data->stored_size :
 			// Count the size of the snapshot data divided by the number of references, rounded up.
-			(m_data->size + m_data->refcnt - 1) / m_data->refcnt;
+			(m_data->stored_size + m_data->refcnt - 1) / m_data->refcnt;
 	}
 
 private:
@@ -389,6 +378,7 @@ template<typename T>
 class MutableObjectHistory : public ObjectHistory<MutableHistoryInterval>
 {
 public:
+	MutableObjectHistory(SerializedDataPool &pool) : m_pool(pool) {}
 	~MutableObjectHistory() override {}
 
 	bool is_mutable() const override { return true; }
@@ -426,22 +416,20 @@ public:
 
 	void save(size_t active_snapshot_time, size_t current_time, const std::string &data) {
 		assert(m_history.empty() || m_history.back().end() <= active_snapshot_time);
-		if (m_history.empty() || m_history.back().end() < active_snapshot_time) {
-			if (! m_history.empty() && m_history.back().matches(data))
-				// Share the previous data by reference counting.
-				m_history.emplace_back(Interval(current_time, current_time + 1), m_history.back());
-			else
-				// Allocate new data.
-				m_history.emplace_back(Interval(current_time, current_time + 1), data);
-		} else {
+		// Share the same data stored by this or any other object by reference counting, or allocate new data.
+		SerializedData *serialized = m_pool.acquire(data);
+		if (m_history.empty() || m_history.back().end() < active_snapshot_time)
+			m_history.emplace_back(Interval(current_time, current_time + 1), serialized);
+		else {
 			assert(! m_history.empty());
 			assert(m_history.back().end() == active_snapshot_time);
-			if (m_history.back().matches(data))
+			if (m_history.back().data() == serialized) {
 				// Just extend the last interval using the old data.
 				m_history.back().extend_end(current_time + 1);
-			else
-				// Allocate new data time continuous with the previous data.
-				m_history.emplace_back(Interval(active_snapshot_time, current_time + 1), data);
+				m_pool.release(serialized);
+			} else
+				// Store the data time continuous with the previous data.
+				m_history.emplace_back(Interval(active_snapshot_time, current_time + 1), serialized);
 		}
 	}
 
@@ -453,7 +441,7 @@ public:
 			-- it;
 		}
 		assert(timestamp >= it->begin() && timestamp < it->end());
-		return std::string(it->data(), it->data() + it->size());
+		return it->serialized();
 	}
 
 	// Currently all mutable snapshots are mandatory.
@@ -465,7 +453,7 @@ public:
 	std::string format() override {
 		std::string out = typeid(T).name();
 		for (const MutableHistoryInterval &interval : m_history)
-			out += std::string(", ptr:") + ptr_to_string(interval.data()) + " len:" + std::to_string(interval.size()) + " <" + std::to_string(interval.begin()) + "," + std::to_string(interval.end()) + ")";
+			out += std::string(", ptr:") + ptr_to_string(interval.data()) + " len:" + std::to_string(interval.size()) + " stored:" + std::to_string(interval.data()->stored_size) + " <" + std::to_string(interval.begin()) + "," + std::to_string(interval.end()) + ")";
 		return out;
 	}
 #endif /* SLIC3R_UNDOREDO_DEBUG */
@@ -473,6 +461,9 @@ public:
 #ifndef NDEBUG
 	bool valid() override;
 #endif /* NDEBUG */
+
+private:
+	SerializedDataPool &m_pool;
 };
 
 #ifndef NDEBUG
@@ -494,8 +485,9 @@ template<typename T>
 bool MutableObjectHistory<T>::valid()
 {
 	// Verify that the history intervals are sorted and do not overlap, and that the data reference counters are correct.
+	// The data may be shared with the other objects, thus the reference counters may be higher than the number of references from this history.
 	if (! m_history.empty()) {
-		std::map<const char*, size_t> refcntrs;
+		std::map<const SerializedData*, size_t> refcntrs;
 		assert(m_history.front().data() != nullptr);
 		++ refcntrs[m_history.front().data()];
 		for (size_t i = 1; i < m_history.size(); ++ i) {
@@ -504,7 +496,7 @@ bool MutableObjectHistory<T>::valid()
 		}
 		for (const auto &hi : m_history) {
 			assert(hi.data() != nullptr);
-			assert(refcntrs[hi.data()] == hi.refcnt());
+			assert(refcntrs[hi.data()] <= hi.refcnt());
 		}
 	}
 	return true;
@@ -536,6 +528,9 @@ public:
 	void set_memory_limit(size_t memsize) { m_memory_limit = memsize; }
 	size_t get_memory_limit() const { return m_memory_limit; }
 
+	void set_compression(bool enable) { m_data_pool.set_compression(enable); }
+	bool get_compression() const { return m_data_pool.get_compression(); }
+
 	size_t memsize() const {
 		size_t memsize = 0;
 		for (const auto &object : m_objects)
@@ -625,6 +620,9 @@ private:
 	// Maximum memory allowed to be occupied by the Undo / Redo stack. If the limit is exceeded,
 	// least recently used snapshots will be released.
 	size_t 													m_memory_limit;
+	// Serialized data of the mutable objects, shared by all the histories in m_objects. Declared before m_objects,
+	// so that it is destroyed after the histories referencing it.
+	SerializedDataPool 										m_data_pool;
 	// Each individual object (Model, ModelObject, ModelInstance, ModelVolume, Selection, TriangleMesh)
 	// is stored with its own history, referenced by the ObjectID. Immutable objects do not provide
 	// their own IDs, therefore there are temporary IDs generated for them and stored to m_shared_ptr_to_object_id.
@@ -774,7 +772,7 @@ template<typename T> ObjectID StackImpl::save_mutable_object(const T &object)
 	// First find or allocate a history stack for the ObjectID of this object instance.
 	auto it_object_history = m_objects.find(object.id());
 	if (it_object_history == m_objects.end())
-		it_object_history = m_objects.insert(it_object_history, std::make_pair(object.id(), std::unique_ptr<MutableObjectHistory<T>>(new MutableObjectHistory<T>())));
+		it_object_history = m_objects.insert(it_object_history, std::make_pair(object.id(), std::unique_ptr<MutableObjectHistory<T>>(new MutableObjectHistory<T>(m_data_pool))));
 	auto *object_history = static_cast<MutableObjectHistory<T>*>(it_object_history->second.get());
 	bool  needs_to_save  = true;
 	{
@@ -1084,6 +1082,8 @@ bool Stack::empty() const { return pimpl->empty(); }
 
 void Stack::set_memory_limit(size_t memsize) { pimpl->set_memory_limit(memsize); }
 size_t Stack::get_memory_limit() const { return pimpl->get_memory_limit(); }
+void Stack::set_compression(bool enable) { pimpl->set_compression(enable); }
+bool Stack::get_compression() const { return pimpl->get_compression(); }
 size_t Stack::memsize() const { return pimpl->memsize(); }
 void Stack::release_least_recently_used() { pimpl->release_least_recently_used(); }
 void Stack::take_snapshot(const std::string& snapshot_name, const Slic3r::Model& model, const Slic3r::GUI::Selection& selection, const Slic3r::GUI::GLGizmosManager& gizmos, const SnapshotData &snapshot_data)
@@ -95,6 +95,11 @@ public:
 	void set_memory_limit(size_t memsize);
 	size_t get_memory_limit() const;
 
+	// Compress the serialized snapshots of the mutable objects (Model, ModelObject, ModelVolume, configs, painted facets)
+	// with a fast codec, enabled by default. Snapshots stored already are not affected.
+	void set_compression(bool enable);
+	bool get_compression() const;
+
 	// Estimate size of the RAM consumed by the Undo / Redo stack.
 	size_t memsize() const;
 
@@ -0,0 +1,75 @@
+#include "UndoRedoDataPool.hpp"
+
+#include "libslic3r/Exception.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <string_view>
+
+#include <miniz.h>
+
+namespace Slic3r {
+namespace UndoRedo {
+
+std::string SerializedData::decompress() const
+{
+	assert(this->compressed());
+	std::string out(this->size, 0);
+	size_t size = tinfl_decompress_mem_to_mem(out.data(), out.size(), this->data, this->stored_size, 0);
+	if (size != this->size)
+		throw Slic3r::RuntimeError("Undo / Redo stack: Failed to decompress a snapshot");
+	return out;
+}
+
+SerializedData* SerializedDataPool::acquire(const std::string &input_data)
+{
+	size_t hash = std::hash<std::string_view>()(std::string_view(input_data));
+	for (auto [it, it_end] = m_data.equal_range(hash); it != it_end; ++ it)
+		if (it->second->matches(input_data, hash)) {
+			++ it->second->refcnt;
+			return it->second;
+		}
+	SerializedData *data = this->allocate(input_data, hash);
+	m_data.emplace(hash, data);
+	return data;
+}
+
+void SerializedDataPool::release(SerializedData *data)
+{
+	assert(data->pool == this);
+	if (-- data->refcnt == 0) {
+		for (auto [it, it_end] = m_data.equal_range(data->hash); it != it_end; ++ it)
+			if (it->second == data) {
+				m_data.erase(it);
+				break;
+			}
+		delete[] (char*)data;
+	}
+}
+
+SerializedData* SerializedDataPool::allocate(const std::string &input_data, size_t hash)
+{
+	std::string compressed;
+	if (m_compression && input_data.size() >= SERIALIZED_DATA_COMPRESSION_MIN_SIZE) {
+		// Only keep the compressed data if it saves at least 1/8 of the memory, it fails to compress into a smaller buffer otherwise.
+		compressed.assign(input_data.size() - input_data.size() / 8, 0);
+		mz_uint flags = tdefl_create_comp_flags_from_zip_params(MZ_BEST_SPEED, - MZ_DEFAULT_WINDOW_BITS, MZ_DEFAULT_STRATEGY);
+		size_t  size  = tdefl_compress_mem_to_mem(compressed.data(), compressed.size(), input_data.data(), input_data.size(), int(flags));
+		compressed.resize(size);
+	}
+	const std::string &stored = compressed.empty() ? input_data : compressed;
+	auto *data = (SerializedData*)new char[offsetof(SerializedData, data) + stored.size()];
+	data->refcnt 	  = 1;
+	data->size 		  = input_data.size();
+	data->stored_size = stored.size();
+	data->hash 		  = hash;
+	data->head 		  = 0;
+	memcpy(&data->head, input_data.data(), std::min(input_data.size(), sizeof(data->head)));
+	data->pool 		  = this;
+	memcpy(data->data, stored.data(), stored.size());
+	return data;
+}
+
+} // namespace UndoRedo
+} // namespace Slic3r
@@ -0,0 +1,81 @@
+#ifndef slic3r_Utils_UndoRedoDataPool_hpp_
+#define slic3r_Utils_UndoRedoDataPool_hpp_
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+
+namespace Slic3r {
+namespace UndoRedo {
+
+class SerializedDataPool;
+
+// Serialized snapshot of a mutable object, possibly compressed.
+struct SerializedData
+{
+	// Reference counter of this data chunk. We may have used shared_ptr, but the shared_ptr is thread safe
+	// with the associated cost of CPU cache invalidation on refcount change.
+	size_t				refcnt;
+	// Size of the serialized data.
+	size_t				size;
+	// Size of the data stored below, smaller than size if compressed.
+	size_t				stored_size;
+	// Hash of the serialized data.
+	size_t				hash;
+	// First 8 bytes of the serialized data, accessible without decompressing.
+	uint64_t			head;
+	// Pool this data chunk is registered with.
+	SerializedDataPool *pool;
+	char 				data[1];
+
+	bool 		compressed() const { return this->stored_size != this->size; }
+	std::string decompress() const;
+
+	// The serialized data matches the data stored here.
+	bool 		matches(const std::string &rhs, size_t rhs_hash) const {
+		if (this->size != rhs.size() || this->hash != rhs_hash)
+			return false;
+		return this->compressed() ? this->decompress() == rhs : memcmp(this->data, rhs.data(), this->size) == 0;
+	}
+
+	// The timestamp matches the timestamp serialized in the data stored here.
+	bool 		matches_timestamp(uint64_t timestamp) const { assert(timestamp > 0); assert(this->size > 8); return this->head == timestamp; }
+};
+
+// Minimum size of the serialized data to be compressed.
+constexpr const size_t SERIALIZED_DATA_COMPRESSION_MIN_SIZE = 1024;
+
+// Serialized snapshots of the mutable objects, shared by all the objects tracked by the Undo / Redo stack.
+// The same serialized data is stored just once, for example the configs or the painted facets of copied objects
+// or a state of an object returned to after a series of modifications.
+class SerializedDataPool
+{
+public:
+	~SerializedDataPool() { assert(m_data.empty()); }
+
+	// Return the data matching the serialized data, either already stored or newly allocated,
+	// with its reference counter incremented.
+	SerializedData* acquire(const std::string &input_data);
+	// Decrement the reference counter, release the data if no longer referenced.
+	void 			release(SerializedData *data);
+
+	void set_compression(bool enable) { m_compression = enable; }
+	bool get_compression() const { return m_compression; }
+
+	// Number of distinct data chunks stored.
+	size_t size() const { return m_data.size(); }
+	bool   empty() const { return m_data.empty(); }
+
+private:
+	SerializedData* allocate(const std::string &input_data, size_t hash);
+
+	std::unordered_multimap<size_t, SerializedData*> 	m_data;
+	bool 												m_compression { true };
+};
+
+} // namespace UndoRedo
+} // namespace Slic3r
+
+#endif /* slic3r_Utils_UndoRedoDataPool_hpp_ */
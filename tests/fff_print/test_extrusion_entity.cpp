@@ -5,6 +5,7 @@
 #include "libslic3r/ExtrusionEntityCollection.hpp"
 #include "libslic3r/ExtrusionEntity.hpp"
 #include "libslic3r/Point.hpp"
+#include "libslic3r/ShortestPath.hpp"
 #include "libslic3r/libslic3r.h"
 
 #include "test_data.hpp"
@@ -83,3 +84,43 @@ SCENARIO("ExtrusionEntityCollection: Polygon flattening", "[ExtrusionEntity]") {
         }
     }
 }
+
+SCENARIO("ExtrusionEntityCollection: Chaining by references", "[ExtrusionEntity]") {
+    srand(0xDEADBEEF); // consistent seed for test reproducibility.
+
+    GIVEN("A sortable collection of random paths") {
+        Slic3r::ExtrusionEntityCollection collection;
+        collection.append(random_paths());
+        std::vector<Points> points_before;
+        for (const ExtrusionEntity *ee : collection.entities)
+            points_before.emplace_back(dynamic_cast<const ExtrusionPath*>(ee)->polyline.points);
+        Point start_near(0, 0);
+        WHEN("The collection is chained by references") {
+            ExtrusionEntityReferences chained = chain_extrusion_references(collection, &start_near);
+            ExtrusionEntityCollection cloned  = collection.chained_path_from(start_near);
+            THEN("The source paths are not modified") {
+                for (size_t i = 0; i < collection.entities.size(); ++ i)
+                    REQUIRE(dynamic_cast<const ExtrusionPath*>(collection.entities[i])->polyline.points == points_before[i]);
+            }
+            THEN("The references follow the same chain as the cloned collection") {
+                REQUIRE(chained.size() == cloned.entities.size());
+                for (size_t i = 0; i < chained.size(); ++ i) {
+                    const ExtrusionEntity &ee = chained[i].extrusion_entity();
+                    REQUIRE((chained[i].flipped() ? ee.last_point() : ee.first_point()) == cloned.entities[i]->first_point());
+                    REQUIRE((chained[i].flipped() ? ee.first_point() : ee.last_point()) == cloned.entities[i]->last_point());
+                }
+            }
+        }
+        WHEN("The collection is marked no-sort and chained in reverse") {
+            collection.no_sort = true;
+            ExtrusionEntityReferences chained = chain_extrusion_references(collection, &start_near, true);
+            THEN("The paths are referenced in the reverse order, flipped") {
+                REQUIRE(chained.size() == collection.entities.size());
+                for (size_t i = 0; i < chained.size(); ++ i) {
+                    REQUIRE(&chained[i].extrusion_entity() == collection.entities[collection.entities.size() - i - 1]);
+                    REQUIRE(chained[i].flipped());
+                }
+            }
+        }
+    }
+}
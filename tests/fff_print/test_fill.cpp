@@ -3,8 +3,11 @@
 #include <numeric>
 #include <sstream>
 
+#include <tbb/task_arena.h>
+
 #include "libslic3r/ClipperUtils.hpp"
 #include "libslic3r/Fill/Fill.hpp"
+#include "libslic3r/Fill/FillPatternCache.hpp"
 #include "libslic3r/Flow.hpp"
 #include "libslic3r/Geometry.hpp"
 #include "libslic3r/Print.hpp"
@@ -190,6 +193,78 @@ TEST_CASE("Fill: Pattern Path Length", "[Fill]") {
     }
 }
 
+TEST_CASE("Fill: Monotonic infill is reproducible", "[Fill]") {
+    // A square with a grid of holes splits into many monotonic regions.
+    // The finer grid splits it into enough regions to be chained by several ant colonies in parallel.
+    for (int num_holes : { 4, 8 }) {
+        double    step      = 44. / num_holes;
+        double    size      = 0.55 * step;
+        ExPolygon expolygon(Points { Point::new_scale(0, 0), Point::new_scale(50, 0), Point::new_scale(50, 50), Point::new_scale(0, 50) });
+        for (int i = 0; i < num_holes; ++ i)
+            for (int j = 0; j < num_holes; ++ j) {
+                double x = 5. + step * i + 0.18 * step * j;
+                double y = 5. + step * j;
+                expolygon.holes.emplace_back(Points { Point::new_scale(x, y), Point::new_scale(x, y + size), Point::new_scale(x + size, y + size), Point::new_scale(x + size, y) });
+            }
+        auto fill = [&expolygon](int max_rounds) {
+            std::unique_ptr<Slic3r::Fill> filler(Slic3r::Fill::new_from_type("monotonic"));
+            filler->angle   = float(M_PI / 4.);
+            filler->spacing = 0.5;
+            FillParams fill_params;
+            fill_params.density              = 1.f;
+            fill_params.monotonic_max_rounds = max_rounds;
+            Slic3r::Surface surface(stTop, expolygon);
+            return filler->fill_surface(&surface, fill_params);
+        };
+        Polylines paths = fill(25);
+        REQUIRE(! paths.empty());
+        REQUIRE(fill(25) == paths);
+        // The same infill on a single thread and on several threads.
+        Polylines paths_serial, paths_parallel;
+        tbb::task_arena(1).execute([&fill, &paths_serial]() { paths_serial = fill(25); });
+        tbb::task_arena(8).execute([&fill, &paths_parallel]() { paths_parallel = fill(25); });
+        REQUIRE(paths_serial == paths);
+        REQUIRE(paths_parallel == paths);
+        // A single round still produces a complete infill.
+        auto length = [](const Polylines &polylines) { return std::accumulate(polylines.begin(), polylines.end(), 0., [](double acc, const Polyline &pl) { return acc + pl.length(); }); };
+        REQUIRE(length(fill(1)) > 0.95 * length(paths));
+    }
+}
+
+TEST_CASE("Fill: Shared pattern matches the pattern generated for the surface", "[Fill]") {
+    auto square = [](double x0, double y0) {
+        return ExPolygon(Points { Point::new_scale(x0, y0), Point::new_scale(x0 + 30., y0), Point::new_scale(x0 + 30., y0 + 30.), Point::new_scale(x0, y0 + 30.) });
+    };
+    for (const char *pattern : { "gyroid", "honeycomb", "3dhoneycomb" }) {
+        std::unique_ptr<Slic3r::Fill> filler(Slic3r::Fill::new_from_type(pattern));
+        filler->angle    = 0.f;
+        filler->spacing  = 0.5;
+        filler->layer_id = 10;
+        filler->z        = 2.1;
+        FillParams fill_params;
+        fill_params.density = 0.2f;
+        auto fill_length = [&filler, &fill_params](const ExPolygon &expolygon) {
+            Slic3r::Surface surface(stInternal, expolygon);
+            Slic3r::Polylines paths = filler->fill_surface(&surface, fill_params);
+            return std::accumulate(paths.begin(), paths.end(), 0., [](double acc, const Polyline &pl) { return acc + pl.length(); });
+        };
+        FillPatternCache::instance().clear();
+        double length_alone  = fill_length(square(0., 0.));
+        size_t memory_alone  = FillPatternCache::instance().memory_usage();
+        // Cache the tiles of a distant surface, then fill the first surface again from the cached tiles.
+        fill_length(square(150., 100.));
+        size_t memory_shared = FillPatternCache::instance().memory_usage();
+        double length_shared = fill_length(square(0., 0.));
+        REQUIRE(length_alone > 0.);
+        REQUIRE(length_shared == Approx(length_alone).epsilon(0.001));
+        // Only the tiles of the distant surface were added, the tiles already cached are not generated again.
+        REQUIRE(memory_shared > memory_alone);
+        REQUIRE(memory_shared < 4 * memory_alone);
+        REQUIRE(FillPatternCache::instance().memory_usage() == memory_shared);
+    }
+    FillPatternCache::instance().clear();
+}
+
 /*
 {
     my $collection = Slic3r::Polyline::Collection->new(
@@ -1,8 +1,19 @@
 #include <catch2/catch.hpp>
 
 #include <memory>
+#include <fstream>
+#include <iterator>
+
+#include <boost/filesystem.hpp>
+#include <miniz.h>
 
 #include "libslic3r/GCode.hpp"
+#include "libslic3r/GCode/CoolingBuffer.hpp"
+#include "libslic3r/GCode/GCodeCompressor.hpp"
+#include "libslic3r/GCode/SeamPlacer.hpp"
+#include "libslic3r/Layer.hpp"
+
+#include "test_data.hpp"
 
 using namespace Slic3r;
 
@@ -20,3 +31,251 @@ SCENARIO("Origin manipulation", "[GCode]") {
     	}
     }
 }
+
+SCENARIO("Arc fitting", "[GCode]") {
+    GIVEN("G-code of a tessellated circular arc followed by straight extrusions") {
+        PrintConfig config;
+        config.arc_fitting_tolerance.value = 0.05;
+        std::string gcode = "G92 E0\nG1 X110.000 Y100.000 F9000\nG1 F1800\n";
+        double e = 0.;
+        char buf[128];
+        for (int i = 1; i <= 40; ++ i) {
+            double angle = i * 2. * M_PI / 48.;
+            e += 0.01;
+            sprintf(buf, "G1 X%.3f Y%.3f E%.5f\n", 100. + 10. * cos(angle), 100. + 10. * sin(angle), e);
+            gcode += buf;
+        }
+        gcode += "G1 X50.000 Y50.000 F9000\n";
+        for (int i = 1; i <= 5; ++ i) {
+            e += 0.1;
+            sprintf(buf, "G1 X%.3f Y50.000 E%.5f\n", 50. + i, e);
+            gcode += buf;
+        }
+        WHEN("the arc fitting is applied") {
+            std::string out = ArcFitter(config).process_layer(gcode);
+            THEN("the arc is replaced by a single counterclockwise arc move ending at the last point of the arc") {
+                REQUIRE(out.find("G3 X105.000 Y91.340 I-10.000 J0.000 E0.40000\n") != std::string::npos);
+                REQUIRE(out.find("G2 ") == std::string::npos);
+            }
+            THEN("the straight extrusions are kept") {
+                REQUIRE(out.find("G1 X55.000 Y50.000 E0.90000\n") != std::string::npos);
+            }
+        }
+    }
+}
+
+SCENARIO("Cooling buffer dwell time", "[GCode]") {
+    GIVEN("A layer extruded in 1 second, shorter than slowdown_below_layer_time") {
+        DynamicPrintConfig config = DynamicPrintConfig::full_print_config();
+        config.set_deserialize({
+            { "cooling",                    "1" },
+            { "slowdown_below_layer_time",  "10" },
+            { "disable_fan_first_layers",   "0" }
+        });
+        PrintConfig print_config;
+        print_config.apply(config, true);
+        GCode gcodegen;
+        gcodegen.apply_print_config(print_config);
+        gcodegen.set_layer_count(10);
+        gcodegen.writer().set_extruders({ 0 });
+        gcodegen.writer().set_extruder(0);
+        // 50mm at 50mm/s.
+        const std::string layer = "G1 F3000 ;_EXTRUDE_SET_SPEED\nG1 X50 E1\n;_EXTRUDE_END\n";
+        auto slowed_down = [&gcodegen, &layer](const std::string &dwell) {
+            CoolingBuffer cooling_buffer(gcodegen);
+            return cooling_buffer.process_layer(layer + dwell, 1, true).find("G1 F3000") == std::string::npos;
+        };
+        THEN("the layer is slowed down without a dwell") {
+            REQUIRE(slowed_down(""));
+        }
+        THEN("a dwell in seconds is accounted for in the layer time") {
+            REQUIRE(! slowed_down("G4 S20\n"));
+            REQUIRE(! slowed_down("G4 S20 ; wait\n"));
+            REQUIRE(slowed_down("G4 S0.5\n"));
+        }
+        THEN("a dwell in milliseconds is accounted for in the layer time") {
+            REQUIRE(! slowed_down("G4 P20000\n"));
+            REQUIRE(! slowed_down("G4 P20000;wait\n"));
+            REQUIRE(slowed_down("G4 P500\n"));
+        }
+        THEN("the seconds take precedence over the milliseconds") {
+            REQUIRE(! slowed_down("G4 P500 S20\n"));
+            REQUIRE(slowed_down("G4 S0.5 P20000\n"));
+        }
+    }
+}
+
+SCENARIO("G-code compression", "[GCode]") {
+    GIVEN("A plain text G-code file") {
+        std::string gcode = "; comment\nG92 E0\nG1 X10.000 Y20.000 E0.12345\nM107 ; fan off\n";
+        // The same G-code without the comments.
+        std::string gcode_stripped = "G92 E0\nG1 X10.000 Y20.000 E0.12345\nM107\n";
+        for (int i = 0; i < 1000; ++ i) {
+            std::string line = "G1 X" + std::to_string(i) + ".500 Y10.000 E" + std::to_string(i) + ".00000\n";
+            gcode          += line;
+            gcode_stripped += line;
+        }
+        boost::filesystem::path src = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("gcode-compression-%%%%-%%%%.gcode");
+        boost::filesystem::path dst = src.string() + ".out";
+        {
+            std::ofstream f(src.string(), std::ios::binary);
+            f << gcode;
+        }
+        auto read_file = [](const boost::filesystem::path &path) {
+            std::ifstream f(path.string(), std::ios::binary);
+            return std::string(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+        };
+        WHEN("compressed with gzip") {
+            compress_gcode_file(src.string(), dst.string(), GCodeCompression::Gzip);
+            std::string data = read_file(dst);
+            THEN("the file is smaller and decompresses into the source G-code") {
+                REQUIRE(data.size() < gcode.size());
+                REQUIRE(data.size() > 18);
+                REQUIRE((unsigned char)data[0] == 0x1f);
+                REQUIRE((unsigned char)data[1] == 0x8b);
+                // Skip the 10 bytes header and the 8 bytes trailer, decompress the raw deflate stream.
+                size_t out_len = 0;
+                void  *out = tinfl_decompress_mem_to_heap(data.data() + 10, data.size() - 18, &out_len, 0);
+                REQUIRE(out != nullptr);
+                REQUIRE(std::string((const char*)out, out_len) == gcode);
+                mz_free(out);
+            }
+        }
+        WHEN("packed with MeatPack") {
+            compress_gcode_file(src.string(), dst.string(), GCodeCompression::MeatPack);
+            std::string data = read_file(dst);
+            THEN("the file is smaller and starts with the enable packing command") {
+                REQUIRE(data.size() < gcode.size());
+                REQUIRE(data.substr(0, 3) == "\xff\xff\xfb");
+            }
+            THEN("the packed file unpacks into the source G-code without comments") {
+                static const char table[] = "0123456789. \nGX";
+                std::string unpacked;
+                for (size_t i = 3; i < data.size();) {
+                    unsigned char b  = (unsigned char)data[i ++];
+                    char          c1 = (b & 0x0f) == 0x0f ? data[i ++] : table[b & 0x0f];
+                    unpacked += c1;
+                    if (c1 != '\n')
+                        unpacked += (b >> 4) == 0x0f ? data[i ++] : table[b >> 4];
+                }
+                REQUIRE(unpacked == gcode_stripped);
+            }
+        }
+        THEN("the compressed G-code is saved with a suffix of the compression method") {
+            REQUIRE(compressed_gcode_path("out.gcode", GCodeCompression::None) == "out.gcode");
+            REQUIRE(compressed_gcode_path("out.gcode", GCodeCompression::Gzip) == "out.gcode.gz");
+            REQUIRE(compressed_gcode_path("out.gcode.gz", GCodeCompression::Gzip) == "out.gcode.gz");
+            REQUIRE(compressed_gcode_path("out.gcode", GCodeCompression::MeatPack) == "out.gcode.mp");
+        }
+        boost::filesystem::remove(src);
+        boost::filesystem::remove(dst);
+    }
+}
+
+SCENARIO("G-code compressed while being exported", "[GCode]") {
+    GIVEN("A sliced print with the remaining times and the gzip compression enabled") {
+        auto read_file = [](const std::string &path) {
+            std::ifstream f(path, std::ios::binary);
+            return std::string(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+        };
+        // Skip the first line with the time stamp of the export.
+        auto skip_header = [](const std::string &gcode) { return gcode.substr(gcode.find('\n') + 1); };
+        for (bool remaining_times : { true, false }) {
+            Slic3r::Print print;
+            Slic3r::Model model;
+            Test::init_print({ Test::TestMesh::cube_20x20x20 }, print, model, {
+                { "remaining_times",   remaining_times },
+                { "gcode_flavor",      "marlinfirmware" },
+                { "gcode_compression", "gzip" }
+            });
+            print.set_status_silent();
+            print.process();
+            boost::filesystem::path plain = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("gcode-export-%%%%-%%%%.gcode");
+            boost::filesystem::path path  = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("gcode-export-%%%%-%%%%.gcode");
+            print.export_gcode(plain.string(), nullptr, nullptr);
+            print.export_gcode(path.string(), nullptr, nullptr, GCodeCompressedOutput::Only);
+            std::string compressed = compressed_gcode_path(path.string(), GCodeCompression::Gzip);
+            THEN("only the compressed G-code is written and it decompresses into the plain text G-code") {
+                REQUIRE(! boost::filesystem::exists(path));
+                REQUIRE(! boost::filesystem::exists(path.string() + ".tmp"));
+                std::string data = read_file(compressed);
+                REQUIRE(data.size() > 18);
+                size_t out_len = 0;
+                void  *out = tinfl_decompress_mem_to_heap(data.data() + 10, data.size() - 18, &out_len, 0);
+                REQUIRE(out != nullptr);
+                std::string gcode((const char*)out, out_len);
+                mz_free(out);
+                std::string gcode_plain = read_file(plain.string());
+                REQUIRE((gcode_plain.find("M73 ") != std::string::npos) == remaining_times);
+                REQUIRE(skip_header(gcode) == skip_header(gcode_plain));
+            }
+            boost::filesystem::remove(plain);
+            boost::filesystem::remove(compressed);
+        }
+    }
+}
+
+SCENARIO("Avoid crossing perimeters with a memory budget", "[GCode]") {
+    GIVEN("Two objects printed with avoid_crossing_perimeters") {
+        auto export_gcode = [](bool complete_objects, size_t layer_memory_budget) {
+            Slic3r::Print print;
+            Slic3r::Model model;
+            Test::init_print({ Test::TestMesh::cube_with_hole, Test::TestMesh::two_hollow_squares }, print, model, {
+                { "avoid_crossing_perimeters", true },
+                { "complete_objects",          complete_objects },
+                { "layer_height",              0.2 }
+            });
+            // The budget limits the batches of the boundaries precomputed ahead of the layer being exported.
+            print.set_layer_memory_budget(layer_memory_budget);
+            std::string gcode = Test::gcode(print);
+            // Skip the first line with the time stamp of the export.
+            return gcode.substr(gcode.find('\n') + 1);
+        };
+        THEN("The same G-code is exported with a tiny memory budget, both layer by layer and object by object") {
+            for (bool complete_objects : { false, true }) {
+                // Without a budget all the layers fit into a single batch, a tiny budget precomputes a single layer group per batch.
+                std::string gcode_unbounded = export_gcode(complete_objects, 0);
+                std::string gcode_tiny      = export_gcode(complete_objects, 1);
+                REQUIRE(! gcode_unbounded.empty());
+                REQUIRE(gcode_tiny == gcode_unbounded);
+            }
+        }
+    }
+}
+
+SCENARIO("Seam placer lower layer distance fields", "[GCode]") {
+    GIVEN("Two instances of a cube printed with complete_objects") {
+        Slic3r::Print print;
+        Slic3r::Model model;
+        Slic3r::Test::init_print({ Slic3r::Test::TestMesh::cube_20x20x20, Slic3r::Test::TestMesh::cube_20x20x20 }, print, model, {
+            { "complete_objects",   true },
+            { "layer_height",       0.1 },
+            { "first_layer_height", 0.1 }
+            });
+        print.set_status_silent();
+        print.process();
+        SeamPlacer seam_placer;
+        seam_placer.init(print);
+        WHEN("the layers are exported from the first layer again for each instance") {
+            bool   all_built = true;
+            size_t max_count = 0;
+            size_t max_layers = 0;
+            for (const PrintObject *object : print.objects())
+                for (size_t instance = 0; instance < object->instances().size(); ++ instance) {
+                    max_layers = std::max(max_layers, object->layers().size());
+                    for (const Layer *layer : object->layers()) {
+                        const EdgeGrid::Grid *grid = seam_placer.get_lower_layer_edge_grid(*layer);
+                        all_built &= (grid != nullptr) == (layer->lower_layer != nullptr);
+                        max_count = std::max(max_count, seam_placer.lower_layer_edge_grids_count());
+                    }
+                }
+            THEN("the distance field is provided for all but the first layer") {
+                REQUIRE(all_built);
+            }
+            THEN("the distance fields are released in batches, not accumulated over the layers") {
+                REQUIRE(max_layers == 200);
+                REQUIRE(max_count < max_layers / 4);
+            }
+        }
+    }
+}
@@ -1,6 +1,8 @@
 #include <catch2/catch.hpp>
 
+#include <iomanip>
 #include <memory>
+#include <sstream>
 
 #include "libslic3r/GCodeWriter.hpp"
 
@@ -94,3 +96,34 @@ SCENARIO("set_speed emits values with fixed-point output.", "[GCodeWriter]") {
         }
     }
 }
+
+SCENARIO("GCodeFormatter emits the same fixed-point values as std::ostream.", "[GCodeWriter]") {
+
+    GIVEN("A set of coordinates and precisions") {
+        std::vector<double> values { 0., -0., 1., -1., 0.0005, 1.0005, 203.200022, 203.200522, -123.45678901, 99999.123, 1e-7, -1e-7 };
+        WHEN("the values are formatted by GCodeFormatter::append_fixed") {
+            THEN("the output matches std::fixed with std::setprecision") {
+                for (int precision : { GCodeFormatter::XYZF_PRECISION, GCodeFormatter::E_PRECISION })
+                    for (double v : values) {
+                        std::ostringstream ss;
+                        ss << std::fixed << std::setprecision(precision) << v;
+                        std::string out;
+                        GCodeFormatter::append_fixed(out, v, precision);
+                        REQUIRE_THAT(out, Catch::Equals(ss.str()));
+                    }
+            }
+        }
+    }
+    GIVEN("GCodeWriter instance") {
+        GCodeWriter writer;
+        WHEN("travel_to_xy is appended to an existing G-code buffer") {
+            std::string gcode = "; start\n";
+            writer.travel_to_xy(gcode, Vec2d(10.5, -3.0004));
+            THEN("the move is appended to the buffer") {
+                std::ostringstream ss;
+                ss << "; start\nG1 X10.500 Y-3.000 F" << std::fixed << std::setprecision(3) << writer.config.travel_speed.value * 60. << "\n";
+                REQUIRE_THAT(gcode, Catch::Equals(ss.str()));
+            }
+        }
+    }
+}
@@ -3,6 +3,9 @@
 #include "libslic3r/libslic3r.h"
 #include "libslic3r/Model.hpp"
 #include "libslic3r/ModelArrange.hpp"
+#include "libslic3r/TriangleSelector.hpp"
+
+#include <functional>
 
 #include <boost/nowide/cstdio.hpp>
 #include <boost/filesystem.hpp>
@@ -59,3 +62,100 @@ SCENARIO("Model construction", "[Model]") {
         }
     }
 }
+
+SCENARIO("Painted facets serialization", "[Model]") {
+    GIVEN("A cube painted by brush strokes") {
+        Slic3r::Model        model;
+        Slic3r::ModelVolume *volume = model.add_object()->add_volume(Slic3r::make_cube(20, 20, 20));
+        const TriangleMesh  &mesh   = volume->mesh();
+        auto stroke = [&mesh](int facet_idx, float radius, EnforcerBlockerType state) {
+            return [&mesh, facet_idx, radius, state](TriangleSelector &selector) {
+                const stl_triangle_vertex_indices &facet = mesh.its.indices[facet_idx];
+                Vec3f hit = (mesh.its.vertices[facet(0)] + mesh.its.vertices[facet(1)] + mesh.its.vertices[facet(2)]) / 3.f;
+                Vec3f source = hit + 100.f * mesh.stl.facet_start[facet_idx].normal;
+                selector.select_patch(hit, facet_idx, source, radius, TriangleSelector::SPHERE, state, Transform3d::Identity(), true);
+            };
+        };
+        std::vector<std::function<void(TriangleSelector&)>> steps {
+            stroke(0, 3.f, EnforcerBlockerType::ENFORCER),
+            stroke(0, 1.5f, EnforcerBlockerType::BLOCKER),
+            stroke(5, 5.f, EnforcerBlockerType::ENFORCER),
+            [](TriangleSelector &selector) { selector.set_facet(1, EnforcerBlockerType::BLOCKER); },
+            stroke(5, 5.f, EnforcerBlockerType::NONE),
+            [](TriangleSelector &selector) { selector.reset(); },
+            stroke(9, 2.f, EnforcerBlockerType::BLOCKER),
+            [](TriangleSelector &selector) { selector.set_facet(9, EnforcerBlockerType::NONE); },
+            stroke(2, 4.f, EnforcerBlockerType::ENFORCER)
+        };
+        WHEN("The painting is serialized incrementally after each step") {
+            Slic3r::ModelVolume *other = model.objects.front()->add_volume(Slic3r::make_cube(20, 20, 20));
+            TriangleSelector selector(mesh);
+            selector.deserialize(volume->supported_facets.get_data());
+            THEN("The incremental serialization is identical to a full serialization after each step") {
+                for (size_t i = 0; i < steps.size(); ++ i) {
+                    steps[i](selector);
+                    volume->supported_facets.set(selector);
+                    // A fresh selector encodes all triangles.
+                    TriangleSelector full(mesh);
+                    for (size_t j = 0; j <= i; ++ j)
+                        steps[j](full);
+                    const std::map<int, std::vector<bool>> &data = full.serialize();
+                    REQUIRE(selector.serialize() == data);
+                    REQUIRE(volume->supported_facets.get_data() == data);
+                    // The cached hash of the patched data matches the hash of the fully serialized data.
+                    other->supported_facets.set(full);
+                    REQUIRE(volume->supported_facets.data_hash() == other->supported_facets.data_hash());
+                }
+                REQUIRE(! volume->supported_facets.empty());
+            }
+            THEN("Loading the patched painting into a new selector reproduces it") {
+                for (const auto &step : steps) {
+                    step(selector);
+                    volume->supported_facets.set(selector);
+                }
+                TriangleSelector loaded(mesh);
+                loaded.deserialize(volume->supported_facets.get_data());
+                REQUIRE(loaded.serialize() == selector.serialize());
+                REQUIRE(! volume->supported_facets.set(loaded));
+                loaded.set_facet(3, EnforcerBlockerType::BLOCKER);
+                selector.set_facet(3, EnforcerBlockerType::BLOCKER);
+                volume->supported_facets.set(loaded);
+                REQUIRE(volume->supported_facets.get_data() == selector.serialize());
+                REQUIRE(! volume->supported_facets.set(loaded));
+            }
+        }
+    }
+}
+
+SCENARIO("Mesh content hash", "[Model]") {
+    GIVEN("Two volumes with equal meshes") {
+        Slic3r::Model        model;
+        Slic3r::ModelObject *object  = model.add_object();
+        Slic3r::ModelVolume *volume1 = object->add_volume(Slic3r::make_cube(20, 20, 20));
+        Slic3r::ModelVolume *volume2 = object->add_volume(Slic3r::make_cube(20, 20, 20));
+        THEN("The hashes are equal") {
+            REQUIRE(volume1->mesh_hash() == volume2->mesh_hash());
+        }
+        WHEN("The geometry of one volume is scaled") {
+            size_t hash = volume2->mesh_hash();
+            volume2->scale_geometry_after_creation(Vec3d(2., 1., 1.));
+            THEN("Its hash is recalculated") {
+                REQUIRE(volume2->mesh_hash() != hash);
+                REQUIRE(volume1->mesh_hash() != volume2->mesh_hash());
+            }
+            AND_WHEN("The mesh is replaced by an equal mesh") {
+                volume2->set_mesh(volume1->mesh());
+                THEN("The hashes are equal again") {
+                    REQUIRE(volume1->mesh_hash() == volume2->mesh_hash());
+                }
+            }
+        }
+        WHEN("A volume is copied") {
+            Slic3r::ModelVolume *copy = object->add_volume(*volume1);
+            THEN("The copy shares the mesh and its hash") {
+                REQUIRE(&copy->mesh() == &volume1->mesh());
+                REQUIRE(copy->mesh_hash() == volume1->mesh_hash());
+            }
+        }
+    }
+}
@@ -3,6 +3,12 @@
 #include "libslic3r/libslic3r.h"
 #include "libslic3r/Print.hpp"
 #include "libslic3r/Layer.hpp"
+#include "libslic3r/MultiMaterialSegmentation.hpp"
+#include "libslic3r/TriangleSelector.hpp"
+
+#include <numeric>
+
+#include <tbb/task_arena.h>
 
 #include "test_data.hpp"
 
@@ -126,3 +132,138 @@ SCENARIO("Print: Brim generation", "[Print]") {
         }
     }
 }
+
+SCENARIO("Print: Identical objects are sliced once", "[Print]") {
+    GIVEN("Two separate ModelObjects with the same 20mm cube mesh") {
+        Slic3r::Print print;
+        Slic3r::Model model;
+        Slic3r::Test::init_print({TestMesh::cube_20x20x20, TestMesh::cube_20x20x20}, print, model, {
+            { "layer_height", 0.2 }
+        });
+        THEN("A single PrintObject is created with an instance for each ModelObject") {
+            REQUIRE(model.objects.size() == 2);
+            REQUIRE(print.objects().size() == 1);
+            REQUIRE(print.objects().front()->instances().size() == 2);
+            REQUIRE(print.objects().front()->instances()[0].model_instance->get_object() != print.objects().front()->instances()[1].model_instance->get_object());
+        }
+        WHEN("The second object gets a different configuration") {
+            model.objects.back()->config.set("perimeters", 5);
+            print.apply(model, print.full_print_config());
+            THEN("Each ModelObject gets its own PrintObject") {
+                REQUIRE(print.objects().size() == 2);
+                REQUIRE(print.objects().front()->instances().size() == 1);
+            }
+        }
+        WHEN("The second object gets painted") {
+            ModelVolume     *volume = model.objects.back()->volumes.front();
+            TriangleSelector selector(volume->mesh());
+            selector.set_facet(0, EnforcerBlockerType::ENFORCER);
+            volume->supported_facets.set(selector);
+            print.apply(model, print.full_print_config());
+            THEN("Each ModelObject gets its own PrintObject") {
+                REQUIRE(model.objects.front()->volumes.front()->supported_facets.data_hash() != volume->supported_facets.data_hash());
+                REQUIRE(print.objects().size() == 2);
+            }
+            AND_WHEN("The first object gets painted the same way") {
+                model.objects.front()->volumes.front()->supported_facets.set(selector);
+                print.apply(model, print.full_print_config());
+                THEN("A single PrintObject is created again") {
+                    REQUIRE(model.objects.front()->volumes.front()->supported_facets.data_hash() == volume->supported_facets.data_hash());
+                    REQUIRE(print.objects().size() == 1);
+                    REQUIRE(print.objects().front()->instances().size() == 2);
+                }
+            }
+        }
+    }
+}
+
+SCENARIO("Print: MMU segmentation by painting", "[Print]") {
+    GIVEN("20mm cube with its +X side painted with the second extruder") {
+        Slic3r::Print      print;
+        Slic3r::Model      model;
+        DynamicPrintConfig config = DynamicPrintConfig::full_print_config();
+        config.set_num_extruders(2);
+        config.set_deserialize({ { "layer_height", 0.2 }, { "first_layer_height", 0.2 } });
+        Slic3r::Test::init_print({TestMesh::cube_20x20x20}, print, model, config);
+        ModelVolume        *volume = model.objects.front()->volumes.front();
+        const TriangleMesh &mesh   = volume->mesh();
+        TriangleSelector    selector(mesh);
+        for (int facet_idx = 0; facet_idx < int(mesh.its.indices.size()); ++ facet_idx)
+            if (mesh.stl.facet_start[facet_idx].normal.x() > 0.5f)
+                // The painted state is the 0-based extruder index.
+                selector.set_facet(facet_idx, EnforcerBlockerType(1));
+        volume->mmu_segmentation_facets.set(selector);
+        print.apply(model, print.full_print_config());
+        print.process();
+        const PrintObject &object = *print.objects().front();
+        auto area = [](const ExPolygons &expolygons) {
+            return std::accumulate(expolygons.begin(), expolygons.end(), 0., [](double acc, const ExPolygon &expoly) { return acc + expoly.area(); });
+        };
+        THEN("The layers between the top and bottom shells are split into the triangle of the painted side bounded by the medial axis and the rest of the square") {
+            REQUIRE(object.layers().size() == 100);
+            for (size_t layer_idx = 0; layer_idx < object.layers().size(); ++ layer_idx) {
+                std::vector<double> area_by_extruder(2, 0.);
+                for (const LayerRegion *layerm : object.layers()[layer_idx]->regions()) {
+                    REQUIRE(layerm->region().extruder(frPerimeter) >= 1);
+                    REQUIRE(layerm->region().extruder(frPerimeter) <= 2);
+                    area_by_extruder[layerm->region().extruder(frPerimeter) - 1] += unscaled<double>(unscaled<double>(area(to_expolygons(layerm->slices.surfaces))));
+                }
+                REQUIRE(area_by_extruder[0] + area_by_extruder[1] == Approx(400.).epsilon(0.01));
+                if (layer_idx == 0 || layer_idx + 1 == object.layers().size()) {
+                    // The unpainted bottom and top sides are projected into the shells with the first extruder.
+                    REQUIRE(area_by_extruder[1] == 0.);
+                } else if (layer_idx >= 10 && layer_idx < 90) {
+                    REQUIRE(area_by_extruder[0] == Approx(300.).epsilon(0.02));
+                    REQUIRE(area_by_extruder[1] == Approx(100.).epsilon(0.02));
+                }
+            }
+        }
+        THEN("The same segmentation is calculated on a single thread and on several threads") {
+            std::vector<std::vector<std::pair<ExPolygon, size_t>>> segmentation_serial, segmentation_parallel;
+            tbb::task_arena(1).execute([&object, &segmentation_serial]() { segmentation_serial = multi_material_segmentation_by_painting(object, []() {}); });
+            tbb::task_arena(8).execute([&object, &segmentation_parallel]() { segmentation_parallel = multi_material_segmentation_by_painting(object, []() {}); });
+            REQUIRE(segmentation_serial.size() == object.layers().size());
+            REQUIRE(segmentation_serial == segmentation_parallel);
+        }
+    }
+}
+
+SCENARIO("Print: Layer extrusions spilled to a scratch file", "[Print]") {
+    GIVEN("20mm cube sliced with and without the layer memory budget") {
+        Slic3r::Print print, print_spilled;
+        Slic3r::Model model, model_spilled;
+        Slic3r::Test::init_print({TestMesh::cube_20x20x20}, print, model, { { "layer_height", 0.2 } });
+        Slic3r::Test::init_print({TestMesh::cube_20x20x20}, print_spilled, model_spilled, { { "layer_height", 0.2 } });
+        // Spill all the layers.
+        print_spilled.set_layer_memory_budget(1);
+        std::string gcode         = Slic3r::Test::gcode(print);
+        std::string gcode_spilled = Slic3r::Test::gcode(print_spilled);
+        THEN("The same G-code is exported, except for the time stamp") {
+            REQUIRE(gcode.substr(gcode.find('\n')) == gcode_spilled.substr(gcode_spilled.find('\n')));
+        }
+        THEN("The layers were spilled once by the slicing steps and they are released after the export") {
+            REQUIRE(print_spilled.layer_spill() != nullptr);
+            REQUIRE(print_spilled.layer_spill()->size() > 0);
+            REQUIRE(print_spilled.layer_spill()->size() == print_spilled.layer_spill()->live_size());
+            for (const Layer *layer : print_spilled.objects().front()->layers()) {
+                REQUIRE(print_spilled.layer_spill()->spilled(*layer));
+                REQUIRE(layer->regions().front()->perimeters.empty());
+                REQUIRE(layer->regions().front()->fills.empty());
+            }
+        }
+        WHEN("The infill is changed and the spilled layers are sliced again") {
+            DynamicPrintConfig config = print.full_print_config();
+            config.set_deserialize({ { "fill_density", "40%" } });
+            print.apply(model, config);
+            print_spilled.apply(model_spilled, config);
+            gcode         = Slic3r::Test::gcode(print);
+            gcode_spilled = Slic3r::Test::gcode(print_spilled);
+            THEN("The perimeters are loaded back for the infill step, the same G-code is exported") {
+                REQUIRE(gcode.substr(gcode.find('\n')) == gcode_spilled.substr(gcode_spilled.find('\n')));
+            }
+            THEN("The records of the previous slicing run are not kept in the scratch file") {
+                REQUIRE(print_spilled.layer_spill()->size() == print_spilled.layer_spill()->live_size());
+            }
+        }
+    }
+}
@@ -2,10 +2,13 @@
 
 #include "libslic3r/libslic3r.h"
 #include "libslic3r/GCodeReader.hpp"
+#include "libslic3r/GCode/PreviewBuffers.hpp"
 
 #include "test_data.hpp"
 
 #include <algorithm>
+#include <boost/filesystem/operations.hpp>
+#include <boost/nowide/cstdio.hpp>
 #include <boost/regex.hpp>
 
 using namespace Slic3r;
@@ -54,6 +57,10 @@ SCENARIO( "PrintGCode basic functionality", "[PrintGCode]") {
             THEN("GCode preamble is emitted.") {
                 REQUIRE(gcode.find("G21 ; set units to millimeters") != std::string::npos);
             }
+            THEN("Estimated printing time placeholder is resolved.") {
+                REQUIRE(gcode.find("; estimated printing time (normal mode) = ") != std::string::npos);
+                REQUIRE(gcode.find("_GP_") == std::string::npos);
+            }
 
             THEN("Config options emitted for print config, default region config, default object config") {
                 REQUIRE(gcode.find("; first_layer_temperature") != std::string::npos);
@@ -269,3 +276,79 @@ SCENARIO( "PrintGCode basic functionality", "[PrintGCode]") {
         }
     }
 }
+
+SCENARIO("G-code preview buffers", "[PrintGCode]") {
+    GIVEN("The processed G-code of a 20mm cube") {
+        Slic3r::Print print;
+        Slic3r::Model model;
+        Slic3r::Test::init_print({TestMesh::cube_20x20x20}, print, model, {
+            { "layer_height",                   0.2 },
+            { "first_layer_height",             0.2 }
+            });
+        print.set_status_silent();
+        print.process();
+        std::string gcode_path = boost::filesystem::unique_path().string();
+        print.export_gcode(gcode_path, nullptr, nullptr);
+        // Process the exported G-code the way the G-code viewer does.
+        GCodeProcessor processor;
+        processor.enable_producers(true);
+        processor.process_file(gcode_path, false);
+        const GCodeProcessor::Result &result = processor.get_result();
+        REQUIRE(result.gcode_hash != 0);
+
+        GCodePreviewBuffers preview;
+        preview.generate(result, true);
+        const GCodePreviewBuffers::Buffer &extrude = preview.buffers[GCodePreviewBuffers::buffer_id(EMoveType::Extrude)];
+        THEN("The layers and the extrusions are generated") {
+            REQUIRE(preview.moves_count == result.moves.size());
+            REQUIRE(! preview.layers_zs.empty());
+            REQUIRE(preview.layers_zs.front() == Approx(0.2));
+            REQUIRE(preview.layers_zs.back() == Approx(20.));
+            REQUIRE(! extrude.paths.empty());
+            REQUIRE(! extrude.indices.empty());
+            REQUIRE(extrude.indices.size() == extrude.indices_vbuffer_ids.size());
+            for (unsigned int id : extrude.indices_vbuffer_ids)
+                REQUIRE(id < extrude.vertices.size());
+        }
+        WHEN("The buffers are saved next to the G-code") {
+            std::string path = gcode_preview_buffers_path(gcode_path);
+            preview.save(path);
+            GCodePreviewBuffers loaded;
+            THEN("The buffers are loaded back unchanged") {
+                REQUIRE(loaded.load(path, result.gcode_hash, true));
+                REQUIRE(loaded.moves_count == preview.moves_count);
+                REQUIRE(loaded.layers_zs == preview.layers_zs);
+                REQUIRE(loaded.roles == preview.roles);
+                REQUIRE(loaded.extruder_ids == preview.extruder_ids);
+                for (size_t i = 0; i < preview.buffers.size(); ++ i) {
+                    REQUIRE(loaded.buffers[i].vertices == preview.buffers[i].vertices);
+                    REQUIRE(loaded.buffers[i].indices == preview.buffers[i].indices);
+                    REQUIRE(loaded.buffers[i].paths.size() == preview.buffers[i].paths.size());
+                }
+            }
+            THEN("The buffers are not loaded for a different bounding box") {
+                REQUIRE(! loaded.load(path, result.gcode_hash, false));
+                REQUIRE(loaded.empty());
+            }
+            THEN("The buffers are not loaded for a modified G-code") {
+                FILE *file = boost::nowide::fopen(gcode_path.c_str(), "ab");
+                REQUIRE(file != nullptr);
+                fputs("; modified\n", file);
+                fclose(file);
+                GCodeProcessor processor_modified;
+                processor_modified.enable_producers(true);
+                processor_modified.process_file(gcode_path, false);
+                REQUIRE(processor_modified.get_result().gcode_hash != result.gcode_hash);
+                REQUIRE(! loaded.load(path, processor_modified.get_result().gcode_hash, true));
+                REQUIRE(loaded.empty());
+            }
+            THEN("A truncated file is rejected") {
+                boost::filesystem::resize_file(path, boost::filesystem::file_size(path) / 2);
+                REQUIRE(! loaded.load(path, result.gcode_hash, true));
+                REQUIRE(loaded.empty());
+            }
+            boost::nowide::remove(path.c_str());
+        }
+        boost::nowide::remove(gcode_path.c_str());
+    }
+}
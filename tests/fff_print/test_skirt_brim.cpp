@@ -5,6 +5,7 @@
 #include "libslic3r/Geometry.hpp"
 
 #include <boost/algorithm/string.hpp>
+#include <tbb/task_arena.h>
 
 #include "test_data.hpp" // get access to init_print, etc
 
@@ -257,6 +258,24 @@ SCENARIO("Original Slic3r Skirt/Brim tests", "[SkirtBrim]") {
 #endif
 
         }
+        WHEN("Skirt and brim are generated around several objects") {
+            config.set_deserialize({
+                { "skirts",     2 },
+                { "brim_width", 5 },
+                { "brim_type",  "outer_and_inner" }
+            });
+            THEN("The same G-code is generated on a single thread and on several threads, except for the time stamp") {
+                auto slice = [&config]() {
+                    std::string gcode = Slic3r::Test::slice({TestMesh::cube_20x20x20, TestMesh::cube_with_hole, TestMesh::two_hollow_squares}, config);
+                    return gcode.substr(gcode.find('\n'));
+                };
+                std::string gcode_serial, gcode_parallel;
+                tbb::task_arena(1).execute([&slice, &gcode_serial]() { gcode_serial = slice(); });
+                tbb::task_arena(8).execute([&slice, &gcode_parallel]() { gcode_parallel = slice(); });
+                REQUIRE(! gcode_serial.empty());
+                REQUIRE(gcode_serial == gcode_parallel);
+            }
+        }
         WHEN("Large minimum skirt length is used.") {
             config.set("min_skirt_length", 20);
             THEN("Gcode generation doesn't crash") {
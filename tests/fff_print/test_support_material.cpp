@@ -18,6 +18,36 @@ TEST_CASE("SupportMaterial: Three raft layers created", "[SupportMaterial]")
     REQUIRE(print.objects().front()->support_layers().size() == 3);
 }
 
+TEST_CASE("SupportMaterial: Tree supports generated", "[SupportMaterial]")
+{
+    auto support_volume = [](const PrintObject &object) {
+        double volume = 0.;
+        for (const SupportLayer *layer : object.support_layers())
+            volume += layer->support_fills.total_volume();
+        return volume;
+    };
+    Slic3r::Print print_tree, print_grid;
+    Slic3r::Test::init_and_process_print({ TestMesh::overhang }, print_tree, {
+        { "support_material",       1 },
+        { "support_material_style", "tree" }
+        });
+    Slic3r::Test::init_and_process_print({ TestMesh::overhang }, print_grid, {
+        { "support_material",       1 },
+        { "support_material_style", "grid" }
+        });
+    const PrintObject &object = *print_tree.objects().front();
+    REQUIRE(! object.support_layers().empty());
+    size_t num_extrusions = 0;
+    for (const SupportLayer *layer : object.support_layers())
+        num_extrusions += layer->support_fills.entities.size();
+    REQUIRE(num_extrusions > 0);
+    // The branches support the same overhang with less material than the support areas projected down to the bed.
+    double volume_tree = support_volume(object);
+    double volume_grid = support_volume(*print_grid.objects().front());
+    REQUIRE(volume_tree > 0.);
+    REQUIRE(volume_tree < volume_grid);
+}
+
 SCENARIO("SupportMaterial: support_layers_z and contact_distance", "[SupportMaterial]")
 {
     // Box h = 20mm, hole bottom at 5mm, hole height 10mm (top edge at 15mm).
@@ -7,6 +7,7 @@
 #include "libslic3r/Line.hpp"
 #include "libslic3r/Geometry.hpp"
 #include "libslic3r/ClipperUtils.hpp"
+#include "libslic3r/EdgeGrid.hpp"
 #include "libslic3r/ShortestPath.hpp"
 
 using namespace Slic3r;
@@ -452,3 +453,82 @@ SCENARIO("Ported from xs/t/14_geometry.t", "[Geometry]"){
     	REQUIRE(! Slic3r::Geometry::directions_parallel(M_PI /2, PI, M_PI /180));
     }
 }
+
+TEST_CASE("EdgeGrid signed distance matches the distance to the closest edge", "[Geometry]") {
+    // Enough segments to rasterize the grid in multiple chunks and bands.
+    Polygons circles;
+    for (int i = 0; i < 8; ++ i)
+        for (int j = 0; j < 8; ++ j) {
+            Polygon circle;
+            for (int k = 0; k < 128; ++ k) {
+                double angle = 2. * M_PI * k / 128.;
+                circle.points.emplace_back(scaled<coord_t>(12. * i + 5. * cos(angle)), scaled<coord_t>(12. * j + 5. * sin(angle)));
+            }
+            circles.emplace_back(std::move(circle));
+        }
+    EdgeGrid::Grid grid;
+    grid.create(circles, scaled<coord_t>(1.));
+
+    Points pts;
+    for (double x = -4.9; x < 90.; x += 0.7)
+        for (double y = -4.9; y < 90.; y += 0.7)
+            pts.emplace_back(scaled<coord_t>(x), scaled<coord_t>(y));
+    const coord_t search_radius = scaled<coord_t>(3.);
+    std::vector<coordf_t>                           distances = grid.signed_distances(pts, search_radius);
+    std::vector<EdgeGrid::Grid::ClosestPointResult> closest   = grid.closest_points_signed_distance(pts, search_radius);
+    REQUIRE(distances.size() == pts.size());
+    REQUIRE(closest.size() == pts.size());
+
+    for (size_t i = 0; i < pts.size(); ++ i) {
+        double dist_min = std::numeric_limits<double>::max();
+        bool   inside   = false;
+        for (const Polygon &circle : circles) {
+            for (const Line &line : circle.lines())
+                dist_min = std::min(dist_min, line.distance_to(pts[i]));
+            inside |= circle.contains(pts[i]);
+        }
+        if (dist_min < search_radius - SCALED_EPSILON) {
+            REQUIRE(closest[i].valid());
+            REQUIRE(std::abs(std::abs(distances[i]) - dist_min) < SCALED_EPSILON);
+            REQUIRE(distances[i] == Approx(closest[i].distance));
+            REQUIRE((distances[i] < 0) == inside);
+        } else if (dist_min > search_radius + SCALED_EPSILON) {
+            REQUIRE(! closest[i].valid());
+            REQUIRE(distances[i] == std::numeric_limits<coordf_t>::max());
+        }
+    }
+}
+
+TEST_CASE("Medial axis with a shared Voronoi builder", "[Geometry]") {
+    ExPolygons expolygons {
+        ExPolygon(Polygon { { 0, 0 }, { scaled<coord_t>(20.), 0 }, { scaled<coord_t>(20.), scaled<coord_t>(0.4) }, { 0, scaled<coord_t>(0.4) } }),
+        ExPolygon(Polygon { { 0, 0 }, { scaled<coord_t>(10.), 0 }, { scaled<coord_t>(10.), scaled<coord_t>(0.5) },
+                            { scaled<coord_t>(0.5), scaled<coord_t>(0.5) }, { scaled<coord_t>(0.5), scaled<coord_t>(10.) }, { 0, scaled<coord_t>(10.) } }),
+        // Narrower than min_width, no medial axis.
+        ExPolygon(Polygon { { 0, 0 }, { scaled<coord_t>(5.), 0 }, { scaled<coord_t>(5.), scaled<coord_t>(0.05) }, { 0, scaled<coord_t>(0.05) } })
+    };
+    const double max_width = scaled<double>(1.);
+    const double min_width = scaled<double>(0.1);
+
+    Geometry::VoronoiDiagramBuilder builder;
+    for (const ExPolygon &expoly : expolygons) {
+        ThickPolylines shared, fresh;
+        expoly.medial_axis(max_width, min_width, &shared, &builder);
+        expoly.medial_axis(max_width, min_width, &fresh);
+        REQUIRE(shared.size() == fresh.size());
+        for (size_t i = 0; i < shared.size(); ++ i) {
+            REQUIRE(shared[i].points == fresh[i].points);
+            REQUIRE(shared[i].width == fresh[i].width);
+        }
+        if (&expoly == &expolygons.front()) {
+            // The medial axis of a thin rectangle runs along its center line.
+            REQUIRE(shared.size() == 1);
+            REQUIRE(shared.front().length() > scaled<double>(19.));
+            for (const Point &pt : shared.front().points)
+                REQUIRE(std::abs(pt.y() - scaled<coord_t>(0.2)) <= SCALED_EPSILON);
+        } else if (&expoly == &expolygons.back())
+            REQUIRE(shared.empty());
+        else
+            REQUIRE(! shared.empty());
+    }
+}
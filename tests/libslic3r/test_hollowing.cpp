@@ -1,5 +1,7 @@
 #include <iostream>
 #include <fstream>
+#include <algorithm>
+#include <map>
 #include <catch2/catch.hpp>
 
 #include "libslic3r/SLA/Hollowing.hpp"
@@ -20,3 +22,36 @@ TEST_CASE("Hollow two overlapping spheres") {
     sphere1.WriteOBJFile("twospheres.obj");
 }
 
+
+TEST_CASE("Adaptive hollowing of a sphere in blocks") {
+    using namespace Slic3r;
+
+    // Large enough to be split into 2x2x2 blocks at the default accuracy.
+    TriangleMesh sphere = make_sphere(30., 2 * PI / 60.);
+    sphere.require_shared_vertices();
+
+    sla::HollowingConfig hcfg;
+    hcfg.adaptive = true;
+    sla::InteriorPtr interior = sla::generate_interior(sphere, hcfg);
+
+    REQUIRE(interior);
+    const TriangleMesh &mesh = sla::get_mesh(*interior);
+    REQUIRE(! mesh.empty());
+
+    // The blocks are stitched into a single interior surface offset by the wall thickness.
+    BoundingBoxf3 bb = mesh.bounding_box();
+    for (int i = 0; i < 3; ++ i)
+        REQUIRE(bb.size()(i) == Approx(2. * (30. - hcfg.min_thickness)).margin(1.));
+
+    // No open edges at the seams of the blocks: each edge is shared by exactly two triangles.
+    std::map<std::pair<int, int>, int> edges;
+    for (const Vec3i &f : mesh.its.indices)
+        for (int i = 0; i < 3; ++ i)
+            ++ edges[std::make_pair(std::min(f(i), f((i + 1) % 3)), std::max(f(i), f((i + 1) % 3)))];
+    size_t open_edges = std::count_if(edges.begin(), edges.end(), [](const auto &e) { return e.second != 2; });
+    REQUIRE(open_edges == 0);
+
+    // The interior grid is negative deep inside, in the inactive tiles of the blocks.
+    REQUIRE(sla::get_distance(Vec3f(0.f, 0.f, 0.f), *interior) < 0.);
+    REQUIRE(sla::get_distance(Vec3f(10.f, -10.f, 10.f), *interior) < 0.);
+}
@@ -0,0 +1,127 @@
+#include <catch2/catch.hpp>
+
+#include "libslic3r/Model.hpp"
+#include "libslic3r/Print.hpp"
+#include "libslic3r/PrintConfig.hpp"
+#include "libslic3r/TriangleMesh.hpp"
+
+#include "slic3r/GUI/ToolpathsCache.hpp"
+
+using namespace Slic3r;
+using namespace Slic3r::GUI;
+
+SCENARIO("Toolpaths of the sliced objects cached for the preview", "[ToolpathsCache]") {
+    GIVEN("A sliced 20mm cube") {
+        DynamicPrintConfig config = DynamicPrintConfig::full_print_config();
+        Model              model;
+        ModelObject       *model_object = model.add_object();
+        model_object->add_volume(make_cube(20., 20., 20.));
+        model_object->add_instance()->set_offset(Vec3d(100., 100., 0.));
+        model_object->ensure_on_bed();
+        Print print;
+        print.apply(model, config);
+        print.set_status_silent();
+        print.process();
+        const PrintObject &print_object = *print.objects().front();
+
+        ToolpathsCache cache;
+        cache.update(print, [](){});
+        // Default coloring of the preview by the extrusion features.
+        ToolpathsColoring coloring;
+        coloring.extruders_cnt = int(config.option<ConfigOptionFloats>("nozzle_diameter")->values.size());
+        std::shared_ptr<const PrintObjectToolpaths> toolpaths = cache.get(print_object, coloring);
+
+        THEN("The toolpaths are generated by update() before the preview requested them") {
+            REQUIRE(toolpaths);
+            REQUIRE(! toolpaths->volumes.empty());
+            REQUIRE(toolpaths->valid(print_object, coloring));
+            REQUIRE(cache.get(print_object, coloring) == toolpaths);
+        }
+        WHEN("The preview is colored by tool") {
+            ToolpathsColoring coloring_by_tool = coloring;
+            coloring_by_tool.number_tools = 1;
+            THEN("The toolpaths are generated again") {
+                REQUIRE(! toolpaths->valid(print_object, coloring_by_tool));
+                REQUIRE(cache.get(print_object, coloring_by_tool) != toolpaths);
+            }
+        }
+        WHEN("The infill is invalidated and sliced again") {
+            config.set_key_value("fill_density", new ConfigOptionPercent(40));
+            print.apply(model, config);
+            print.process();
+            cache.update(print, [](){});
+            THEN("The toolpaths are regenerated by update()") {
+                const PrintObject &print_object_new = *print.objects().front();
+                REQUIRE(! toolpaths->valid(print_object_new, coloring));
+                std::shared_ptr<const PrintObjectToolpaths> toolpaths_new = cache.get(print_object_new, coloring);
+                REQUIRE(toolpaths_new != toolpaths);
+                REQUIRE(toolpaths_new->valid(print_object_new, coloring));
+            }
+        }
+        WHEN("The memory budget is lower than the memory held by the toolpaths") {
+            REQUIRE(cache.memory_used() == toolpaths->cpu_memory_used());
+            cache.set_memory_budget(toolpaths->cpu_memory_used() - 1);
+            THEN("The toolpaths are released by the cache and referenced by the caller only") {
+                REQUIRE(cache.memory_used() == 0);
+                REQUIRE(toolpaths.use_count() == 1);
+                std::shared_ptr<const PrintObjectToolpaths> toolpaths_new = cache.get(print_object, coloring);
+                REQUIRE(toolpaths_new != toolpaths);
+                REQUIRE(toolpaths_new.use_count() == 1);
+                REQUIRE(cache.memory_used() == 0);
+            }
+        }
+        WHEN("The instance is moved") {
+            model_object->instances.front()->set_offset(Vec3d(120., 100., 0.));
+            print.apply(model, config);
+            print.process();
+            THEN("The toolpaths are not valid for the new instance position") {
+                const PrintObject &print_object_new = *print.objects().front();
+                REQUIRE(! toolpaths->valid(print_object_new, coloring));
+                REQUIRE(cache.get(print_object_new, coloring) != toolpaths);
+            }
+        }
+    }
+
+    GIVEN("Two sliced objects") {
+        DynamicPrintConfig config = DynamicPrintConfig::full_print_config();
+        Model              model;
+        for (double size : { 20., 10. }) {
+            ModelObject *model_object = model.add_object();
+            model_object->add_volume(make_cube(size, size, size));
+            model_object->add_instance()->set_offset(Vec3d(size * 5., 100., 0.));
+            model_object->ensure_on_bed();
+        }
+        Print print;
+        print.apply(model, config);
+        print.set_status_silent();
+        print.process();
+        REQUIRE(print.objects().size() == 2);
+        const PrintObject &object1 = *print.objects().front();
+        const PrintObject &object2 = *print.objects().back();
+
+        ToolpathsCache    cache;
+        ToolpathsColoring coloring;
+        coloring.extruders_cnt = int(config.option<ConfigOptionFloats>("nozzle_diameter")->values.size());
+        std::shared_ptr<const PrintObjectToolpaths> toolpaths1 = cache.get(object1, coloring);
+        std::shared_ptr<const PrintObjectToolpaths> toolpaths2 = cache.get(object2, coloring);
+        REQUIRE(cache.memory_used() == toolpaths1->cpu_memory_used() + toolpaths2->cpu_memory_used());
+
+        WHEN("The memory budget fits the toolpaths of a single object and the first object is used again") {
+            REQUIRE(cache.get(object1, coloring) == toolpaths1);
+            cache.set_memory_budget(std::max(toolpaths1->cpu_memory_used(), toolpaths2->cpu_memory_used()));
+            THEN("The toolpaths least recently used are released") {
+                REQUIRE(cache.memory_used() == toolpaths1->cpu_memory_used());
+                REQUIRE(cache.get(object1, coloring) == toolpaths1);
+                REQUIRE(toolpaths2.use_count() == 1);
+            }
+        }
+        WHEN("The memory budget is exhausted") {
+            cache.clear();
+            cache.set_memory_budget(1);
+            cache.update(print, [](){});
+            THEN("No toolpaths are generated in advance") {
+                REQUIRE(cache.memory_used() == 0);
+            }
+        }
+    }
+}
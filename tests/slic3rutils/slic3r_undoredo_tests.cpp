@@ -0,0 +1,110 @@
+#include <catch2/catch.hpp>
+
+#include <random>
+#include <string>
+
+#include "slic3r/Utils/UndoRedoDataPool.hpp"
+
+using namespace Slic3r;
+using namespace Slic3r::UndoRedo;
+
+// Serialized data of a layer height profile like object, long enough to be compressed.
+static std::string compressible_data()
+{
+    std::string out;
+    for (size_t i = 0; i < 2000; ++ i)
+        out += "layer " + std::to_string(i) + " height 0.25\n";
+    return out;
+}
+
+// Serialized data not compressible by 1/8, for example an already compressed texture.
+static std::string random_data()
+{
+    std::mt19937 rng(42);
+    std::string  out(4 * SERIALIZED_DATA_COMPRESSION_MIN_SIZE, 0);
+    for (char &c : out)
+        c = char(rng() & 0x0ff);
+    return out;
+}
+
+SCENARIO("Undo / Redo snapshot data pool", "[UndoRedo]") {
+    GIVEN("A pool with compression enabled") {
+        SerializedDataPool pool;
+        REQUIRE(pool.get_compression());
+        const std::string input = compressible_data();
+        WHEN("The same data is acquired twice") {
+            SerializedData *data1 = pool.acquire(input);
+            SerializedData *data2 = pool.acquire(std::string(input));
+            THEN("It is stored once with two references") {
+                REQUIRE(data1 == data2);
+                REQUIRE(data1->refcnt == 2);
+                REQUIRE(pool.size() == 1);
+            }
+            THEN("It is stored compressed and decompresses to the input") {
+                REQUIRE(data1->compressed());
+                REQUIRE(data1->size == input.size());
+                REQUIRE(data1->stored_size < input.size());
+                REQUIRE(data1->decompress() == input);
+                REQUIRE(data1->matches(input, data1->hash));
+            }
+            pool.release(data1);
+            REQUIRE(pool.size() == 1);
+            REQUIRE(data2->refcnt == 1);
+            pool.release(data2);
+            REQUIRE(pool.empty());
+        }
+        WHEN("Different data is acquired") {
+            std::string     other = input;
+            other.back() = 'x';
+            SerializedData *data1 = pool.acquire(input);
+            SerializedData *data2 = pool.acquire(other);
+            THEN("Both are stored") {
+                REQUIRE(data1 != data2);
+                REQUIRE(pool.size() == 2);
+                REQUIRE(data2->decompress() == other);
+                REQUIRE(! data1->matches(other, data2->hash));
+            }
+            pool.release(data1);
+            pool.release(data2);
+            REQUIRE(pool.empty());
+        }
+        WHEN("Data smaller than the compression threshold is acquired") {
+            const std::string small(SERIALIZED_DATA_COMPRESSION_MIN_SIZE - 1, 'a');
+            SerializedData   *data = pool.acquire(small);
+            THEN("It is stored uncompressed") {
+                REQUIRE(! data->compressed());
+                REQUIRE(std::string(data->data, data->stored_size) == small);
+                REQUIRE(data->matches(small, data->hash));
+            }
+            pool.release(data);
+            REQUIRE(pool.empty());
+        }
+        WHEN("Data not compressible by 1/8 is acquired") {
+            const std::string input_random = random_data();
+            SerializedData   *data         = pool.acquire(input_random);
+            THEN("It is stored uncompressed") {
+                REQUIRE(! data->compressed());
+                REQUIRE(data->matches(input_random, data->hash));
+            }
+            pool.release(data);
+            REQUIRE(pool.empty());
+        }
+    }
+
+    GIVEN("A pool with compression disabled") {
+        SerializedDataPool pool;
+        pool.set_compression(false);
+        const std::string input = compressible_data();
+        WHEN("Compressible data is acquired") {
+            SerializedData *data = pool.acquire(input);
+            THEN("It is stored uncompressed") {
+                REQUIRE(! data->compressed());
+                REQUIRE(data->stored_size == input.size());
+                REQUIRE(data->matches(input, data->hash));
+            }
+            pool.release(data);
+            REQUIRE(pool.empty());
+        }
+    }
+    // Data leaked by the pool triggers an assert in the destructor of the pool in the debug build.
+}